@@ -0,0 +1,113 @@
+#include "benchmark.h"
+
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+
+namespace smidi_bench
+{
+    namespace
+    {
+        using benchmark_entry = std::pair<std::string, benchmark_function>;
+
+        std::vector<benchmark_entry>& registered_benchmarks()
+        {
+            static std::vector<benchmark_entry> benchmarks;
+            return benchmarks;
+        }
+
+        void write_json_string(std::ostream& stream, const std::string& value)
+        {
+            stream << '"';
+            for (char c : value)
+            {
+                if (c == '"' || c == '\\')
+                {
+                    stream << '\\';
+                }
+                stream << c;
+            }
+            stream << '"';
+        }
+    } // namespace
+
+    reporter::reporter(std::ostream& stream)
+        : _stream(stream)
+    {
+    }
+
+    void reporter::report(const std::string& name, const value_list& values)
+    {
+        _stream << "{";
+        write_json_string(_stream, "name");
+        _stream << ": ";
+        write_json_string(_stream, name);
+        for (const auto& value : values)
+        {
+            _stream << ", ";
+            write_json_string(_stream, value.first);
+            _stream << ": ";
+            if (std::isfinite(value.second))
+            {
+                _stream << std::setprecision(std::numeric_limits<double>::digits10) << value.second;
+            }
+            else
+            {
+                _stream << "null";
+            }
+        }
+        _stream << "}" << std::endl;
+    }
+
+    registrar::registrar(const char* name, benchmark_function function)
+    {
+        registered_benchmarks().emplace_back(name, function);
+    }
+
+    double percentile(const std::vector<double>& sorted_samples, double fraction)
+    {
+        if (sorted_samples.empty())
+        {
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+
+        size_t index = static_cast<size_t>(fraction * static_cast<double>(sorted_samples.size() - 1) + 0.5);
+        return sorted_samples[std::min(index, sorted_samples.size() - 1)];
+    }
+} // namespace smidi_bench
+
+int main(int argc, char* argv[])
+{
+    // Optional arguments are substrings, only benchmarks whose name contains one of them are run.
+    std::vector<smidi_bench::benchmark_entry> benchmarks = smidi_bench::registered_benchmarks();
+    std::sort(benchmarks.begin(), benchmarks.end());
+
+    smidi_bench::reporter reporter(std::cout);
+    for (const smidi_bench::benchmark_entry& benchmark : benchmarks)
+    {
+        bool selected = (argc <= 1);
+        for (int arg_idx = 1; arg_idx < argc; arg_idx++)
+        {
+            selected = selected || benchmark.first.find(argv[arg_idx]) != std::string::npos;
+        }
+
+        if (!selected)
+        {
+            continue;
+        }
+
+        try
+        {
+            benchmark.second(reporter);
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "error: " << benchmark.first << ": " << e.what() << std::endl;
+            return -1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,88 @@
+#ifndef SMIDI_BENCHMARK_H
+#define SMIDI_BENCHMARK_H
+
+#include <algorithm>
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace smidi_bench
+{
+    using clock = std::chrono::steady_clock;
+
+    // Writes one JSON object per line so results can be collected and compared between releases.
+    class reporter
+    {
+      public:
+        using value_list = std::vector<std::pair<std::string, double>>;
+
+        reporter(std::ostream& stream);
+
+        void report(const std::string& name, const value_list& values);
+
+      private:
+        std::ostream& _stream;
+    };
+
+    using benchmark_function = void (*)(reporter&);
+
+    struct registrar
+    {
+        registrar(const char* name, benchmark_function function);
+    };
+
+    template <typename value_type>
+    inline void do_not_optimize(const value_type& value)
+    {
+#if defined(__GNUC__)
+        asm volatile("" : : "r,m"(value) : "memory");
+#else
+        const volatile char* sink = reinterpret_cast<const volatile char*>(&value);
+        (void)*sink;
+#endif
+    }
+
+    // Returns pointer through a volatile, so the compiler cannot track what it points to, e.g. to devirtualize calls.
+    template <typename value_type>
+    inline value_type* opaque_pointer(value_type* pointer)
+    {
+        value_type* volatile hidden = pointer;
+        return hidden;
+    }
+
+    inline double elapsed_ns(clock::time_point begin, clock::time_point end)
+    {
+        return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count());
+    }
+
+    // Runs function(iterations) a few times and returns the fastest time per iteration in nanoseconds.
+    template <typename function_type>
+    double measure_ns_per_op(size_t iterations, function_type&& function)
+    {
+        constexpr size_t repetitions = 5;
+
+        function(std::max<size_t>(iterations / 10, 1));
+
+        double best = 0.0;
+        for (size_t repetition = 0; repetition < repetitions; repetition++)
+        {
+            clock::time_point begin = clock::now();
+            function(iterations);
+            double ns_per_op = elapsed_ns(begin, clock::now()) / static_cast<double>(iterations);
+            best = (repetition == 0) ? ns_per_op : std::min(best, ns_per_op);
+        }
+        return best;
+    }
+
+    // Returns the value at fraction (0..1) of sorted samples.
+    double percentile(const std::vector<double>& sorted_samples, double fraction);
+} // namespace smidi_bench
+
+#define SMIDI_BENCHMARK(name)                                                                                                              \
+    static void name(smidi_bench::reporter& reporter);                                                                                     \
+    static smidi_bench::registrar name##_registrar(#name, &name);                                                                          \
+    static void name(smidi_bench::reporter& reporter)
+
+#endif // SMIDI_BENCHMARK_H
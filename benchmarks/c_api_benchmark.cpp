@@ -0,0 +1,127 @@
+#include "benchmark.h"
+
+#include "smidi/smidi.h"
+
+#include <array>
+#include <memory>
+
+SMIDI_BENCHMARK(c_api)
+{
+    const char* port_names[] = {"bench"};
+    smidi_system* system = smidi_create_loopback_system(port_names, 1);
+    if (system == nullptr)
+    {
+        throw std::runtime_error("Failed to create loopback system.");
+    }
+
+    smidi_output_device* output_device = smidi_system_create_output_device(system, "bench");
+    smidi_input_device* input_device = smidi_system_create_input_device(system, "bench");
+
+    // The C handles are the C++ objects, measure both paths on the same devices.
+    smidi::output_device* cpp_output_device = reinterpret_cast<smidi::output_device*>(output_device);
+    smidi::input_device* cpp_input_device = reinterpret_cast<smidi::input_device*>(input_device);
+
+    const std::array<uint8_t, 3> message = {0xB0, 0x07, 0x64};
+    std::array<uint8_t, 16> buffer = {0};
+
+    constexpr size_t iterations = 1000000;
+    double cpp_ns = smidi_bench::measure_ns_per_op(iterations, [&](size_t iterations) {
+        for (size_t iteration = 0; iteration < iterations; iteration++)
+        {
+            smidi::time_stamp time_stamp = 0;
+            cpp_output_device->send(message.data(), message.size());
+            smidi_bench::do_not_optimize(cpp_input_device->receive(buffer.data(), buffer.size(), &time_stamp));
+        }
+    });
+
+    double c_ns = smidi_bench::measure_ns_per_op(iterations, [&](size_t iterations) {
+        for (size_t iteration = 0; iteration < iterations; iteration++)
+        {
+            smidi_time_stamp time_stamp = 0;
+            smidi_output_device_send_message(output_device, message.data(), static_cast<int>(message.size()));
+            smidi_bench::do_not_optimize(
+                smidi_input_device_recieve_message(input_device, buffer.data(), static_cast<int>(buffer.size()), &time_stamp));
+        }
+    });
+
+    reporter.report("c_api/send_receive", {
+                                              {"cpp_ns_per_message", cpp_ns},
+                                              {"c_ns_per_message", c_ns},
+                                              {"overhead_ns_per_call", (c_ns - cpp_ns) / 2.0},
+                                          });
+
+    double c_try_ns = smidi_bench::measure_ns_per_op(iterations, [&](size_t iterations) {
+        for (size_t iteration = 0; iteration < iterations; iteration++)
+        {
+            smidi_time_stamp time_stamp = 0;
+            int message_size = 0;
+            smidi_output_device_try_send_message(output_device, message.data(), static_cast<int>(message.size()));
+            smidi_bench::do_not_optimize(smidi_input_device_try_receive_message(input_device, buffer.data(), static_cast<int>(buffer.size()),
+                                                                                 &message_size, &time_stamp));
+        }
+    });
+
+    // Polling an empty queue is the common case for a realtime thread.
+    double c_try_empty_ns = smidi_bench::measure_ns_per_op(iterations, [&](size_t iterations) {
+        for (size_t iteration = 0; iteration < iterations; iteration++)
+        {
+            int message_size = 0;
+            smidi_bench::do_not_optimize(
+                smidi_input_device_try_receive_message(input_device, buffer.data(), static_cast<int>(buffer.size()), &message_size, nullptr));
+        }
+    });
+
+    reporter.report("c_api/try_send_receive", {
+                                                  {"c_ns_per_message", c_try_ns},
+                                                  {"c_empty_poll_ns", c_try_empty_ns},
+                                              });
+
+    // A failing send: the int API throws, catches and logs (to a no-op callback here), the result API returns a code.
+    smidi_set_log_callback([](void*, const char*, const char*) {}, nullptr);
+    constexpr size_t error_iterations = 100000;
+    double c_error_ns = smidi_bench::measure_ns_per_op(error_iterations, [&](size_t iterations) {
+        for (size_t iteration = 0; iteration < iterations; iteration++)
+        {
+            smidi_bench::do_not_optimize(smidi_output_device_send_message(output_device, message.data(), 0));
+        }
+    });
+    smidi_set_log_callback(nullptr, nullptr);
+
+    double c_try_error_ns = smidi_bench::measure_ns_per_op(error_iterations, [&](size_t iterations) {
+        for (size_t iteration = 0; iteration < iterations; iteration++)
+        {
+            smidi_bench::do_not_optimize(smidi_output_device_try_send_message(output_device, message.data(), 0));
+        }
+    });
+
+    reporter.report("c_api/failed_send", {
+                                             {"c_ns_per_call", c_error_ns},
+                                             {"c_try_ns_per_call", c_try_error_ns},
+                                         });
+
+    smidi_destroy_input_device(input_device);
+
+    // Without a listener, send is close to free and the wrapper cost dominates.
+    double cpp_send_ns = smidi_bench::measure_ns_per_op(iterations, [&](size_t iterations) {
+        for (size_t iteration = 0; iteration < iterations; iteration++)
+        {
+            smidi_bench::do_not_optimize(cpp_output_device->send(message.data(), message.size()));
+        }
+    });
+
+    double c_send_ns = smidi_bench::measure_ns_per_op(iterations, [&](size_t iterations) {
+        for (size_t iteration = 0; iteration < iterations; iteration++)
+        {
+            smidi_bench::do_not_optimize(smidi_output_device_send_message(output_device, message.data(), static_cast<int>(message.size())));
+        }
+    });
+
+    reporter.report("c_api/send", {
+                                      {"cpp_ns_per_message", cpp_send_ns},
+                                      {"c_ns_per_message", c_send_ns},
+                                      {"overhead_ns_per_call", c_send_ns - cpp_send_ns},
+                                  });
+
+    smidi_destroy_output_device(output_device);
+    smidi_destroy_system(system);
+}
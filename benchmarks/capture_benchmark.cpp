@@ -0,0 +1,201 @@
+#include "benchmark.h"
+
+#include "smidi_ext/smidi_capture.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    using clock = smidi::capture_writer::clock;
+
+    struct logged_event
+    {
+        uint32_t port;
+        clock::time_point time;
+        std::vector<uint8_t> message;
+    };
+
+    // A performance on two ports: notes and their releases, controller sweeps and an occasional patch dump.
+    std::vector<logged_event> make_performance(size_t count, std::mt19937& random)
+    {
+        std::exponential_distribution<double> gap_us(1.0 / 1500.0);
+        std::uniform_int_distribution<int> kind(0, 99);
+        std::uniform_int_distribution<int> byte(0, 0x7F);
+        std::uniform_int_distribution<int> sysex_size(16, 256);
+
+        std::vector<logged_event> events;
+        events.reserve(count);
+        clock::time_point time = clock::now();
+        int controller_value = 0;
+        while (events.size() < count)
+        {
+            time += std::chrono::microseconds(static_cast<int64_t>(gap_us(random)));
+            const uint32_t port = static_cast<uint32_t>(events.size() % 3 == 0);
+            const int event_kind = kind(random);
+            if (event_kind < 60)
+            {
+                const uint8_t key = static_cast<uint8_t>(36 + byte(random) % 48);
+                events.push_back({port, time, {0x90, key, static_cast<uint8_t>(byte(random) | 1)}});
+                events.push_back({port, time + std::chrono::milliseconds(120), {0x80, key, 0x40}});
+            }
+            else if (event_kind < 99)
+            {
+                controller_value = (controller_value + 1) & 0x7F;
+                events.push_back({port, time, {0xB0, 0x01, static_cast<uint8_t>(controller_value)}});
+            }
+            else
+            {
+                std::vector<uint8_t> sysex(static_cast<size_t>(sysex_size(random)));
+                sysex.front() = 0xF0;
+                for (size_t byte_idx = 1; byte_idx + 1 < sysex.size(); byte_idx++)
+                {
+                    sysex[byte_idx] = static_cast<uint8_t>(byte(random));
+                }
+                sysex.back() = 0xF7;
+                events.push_back({port, time, sysex});
+            }
+        }
+        std::stable_sort(events.begin(), events.end(), [](const logged_event& a, const logged_event& b) { return a.time < b.time; });
+        events.resize(count);
+        return events;
+    }
+
+    double capture(const std::string& path, const std::vector<logged_event>& events, const smidi::capture_options& options,
+                   smidi::capture_statistics& statistics)
+    {
+        smidi_bench::clock::time_point begin = smidi_bench::clock::now();
+        {
+            smidi::capture_writer writer(path, options);
+            for (const logged_event& event : events)
+            {
+                writer.write(event.port, event.time, event.message.data(), event.message.size());
+            }
+            writer.close();
+            statistics = writer.statistics();
+        }
+        return smidi_bench::elapsed_ns(begin, smidi_bench::clock::now()) / static_cast<double>(events.size());
+    }
+} // namespace
+
+SMIDI_BENCHMARK(capture)
+{
+    constexpr size_t event_count = 200000;
+    std::mt19937 random(1234);
+    const std::vector<logged_event> events = make_performance(event_count, random);
+    size_t message_bytes = 0;
+    for (const logged_event& event : events)
+    {
+        message_bytes += event.message.size();
+    }
+
+    const std::string path = (std::filesystem::temp_directory_path() / "smidi_capture_benchmark.smcp").string();
+    smidi::capture_options raw_options;
+    raw_options.compress = false;
+    smidi::capture_statistics raw_statistics;
+    const double raw_ns = capture(path, events, raw_options, raw_statistics);
+    smidi::capture_statistics statistics;
+    const double capture_ns = capture(path, events, smidi::capture_options(), statistics);
+
+    // Every event read back must be the one logged, times relative to the first.
+    smidi::capture_reader reader(path);
+    size_t mismatches = 0;
+    size_t read_count = 0;
+    smidi::capture_event event;
+    smidi_bench::clock::time_point begin = smidi_bench::clock::now();
+    while (reader.next(event))
+    {
+        if (read_count >= events.size())
+        {
+            mismatches++;
+            continue;
+        }
+
+        const logged_event& logged = events[read_count++];
+        if (event.port != logged.port || event.time != logged.time - events.front().time ||
+            event.size != logged.message.size() || !std::equal(logged.message.begin(), logged.message.end(), event.data))
+        {
+            mismatches++;
+        }
+    }
+    const double read_ns = smidi_bench::elapsed_ns(begin, smidi_bench::clock::now()) / static_cast<double>(read_count);
+
+    reporter.report("capture/write", {
+                                         {"events", static_cast<double>(statistics.events)},
+                                         {"ns_per_event", capture_ns},
+                                         {"uncompressed_ns_per_event", raw_ns},
+                                         {"message_bytes", static_cast<double>(message_bytes)},
+                                         {"file_bytes", static_cast<double>(statistics.file_bytes)},
+                                         {"uncompressed_file_bytes", static_cast<double>(raw_statistics.file_bytes)},
+                                         {"compression_ratio", static_cast<double>(statistics.encoded_bytes) /
+                                                                   static_cast<double>(statistics.file_bytes)},
+                                     });
+    reporter.report("capture/read", {
+                                        {"events", static_cast<double>(read_count)},
+                                        {"blocks", static_cast<double>(reader.block_count())},
+                                        {"mismatches", static_cast<double>(mismatches)},
+                                        {"ns_per_event", read_ns},
+                                    });
+
+    // As fast as possible into loopback ports with small blocking queues, a consumer per port takes the messages as
+    // they arrive and compares them with the log, the replay waits whenever a consumer falls behind.
+    smidi::device_options input_options = smidi::default_device_options;
+    input_options.queue.capacity = 64;
+    input_options.queue.overflow_policy = SMIDI_OVERFLOW_POLICY_BLOCK;
+    std::unique_ptr<smidi::system> system = smidi::create_loopback_system({"replay_0", "replay_1"});
+    std::vector<std::unique_ptr<smidi::input_device>> inputs;
+    std::vector<std::unique_ptr<smidi::output_device>> outputs;
+    std::vector<smidi::output_device*> output_ptrs;
+    for (const char* name : {"replay_0", "replay_1"})
+    {
+        inputs.push_back(system->create_input_device(name, input_options));
+        outputs.push_back(system->create_output_device(name));
+        output_ptrs.push_back(outputs.back().get());
+    }
+
+    std::vector<size_t> replay_mismatches(inputs.size(), 0);
+    std::vector<std::thread> consumers;
+    for (size_t port_idx = 0; port_idx < inputs.size(); port_idx++)
+    {
+        consumers.emplace_back([&, port_idx]() {
+            std::vector<uint8_t> buffer(1024);
+            for (const logged_event& logged : events)
+            {
+                if (logged.port != port_idx)
+                {
+                    continue;
+                }
+                const size_t size = inputs[port_idx]->receive(buffer.data(), buffer.size(), nullptr);
+                if (size != logged.message.size() || !std::equal(logged.message.begin(), logged.message.end(), buffer.begin()))
+                {
+                    replay_mismatches[port_idx]++;
+                }
+            }
+        });
+    }
+
+    reader.rewind();
+    smidi::replay_options replay_options;
+    replay_options.speed = 0.0;
+    begin = smidi_bench::clock::now();
+    const smidi::replay_statistics replay_statistics = smidi::replay_capture(reader, output_ptrs, replay_options);
+    for (std::thread& consumer : consumers)
+    {
+        consumer.join();
+    }
+    const double replay_ns = smidi_bench::elapsed_ns(begin, smidi_bench::clock::now()) / static_cast<double>(replay_statistics.events);
+
+    reporter.report("capture/replay_loopback", {
+                                                   {"events", static_cast<double>(replay_statistics.events)},
+                                                   {"failed", static_cast<double>(replay_statistics.failed)},
+                                                   {"blocked", static_cast<double>(replay_statistics.blocked)},
+                                                   {"mismatches", static_cast<double>(replay_mismatches[0] + replay_mismatches[1])},
+                                                   {"ns_per_event", replay_ns},
+                                               });
+
+    std::remove(path.c_str());
+}
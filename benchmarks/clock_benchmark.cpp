@@ -0,0 +1,114 @@
+#include "benchmark.h"
+
+#include "smidi_ext/smidi_clock.h"
+
+#include <cmath>
+#include <random>
+
+namespace
+{
+    class null_output_device : public smidi::output_device
+    {
+      public:
+        size_t send(const uint8_t* data, size_t size) override
+        {
+            (void)data;
+            return size;
+        }
+
+        smidi::result try_send(const uint8_t* data, size_t size) noexcept override
+        {
+            (void)data;
+            (void)size;
+            return SMIDI_RESULT_OK;
+        }
+    };
+
+    constexpr double clock_interval_ns(double tempo)
+    {
+        return 60.0e9 / (tempo * smidi::midi_clocks_per_quarter_note);
+    }
+} // namespace
+
+SMIDI_BENCHMARK(clock_master)
+{
+    // Ten minutes at 120 BPM with every wake-up up to 2ms late, as a loaded system delivers them.
+    constexpr double tempo = 120.0;
+    const std::chrono::minutes duration(10);
+    std::mt19937 random(1234);
+    std::uniform_int_distribution<int64_t> lateness_us(0, 2000);
+
+    null_output_device output;
+    smidi::clock_master master(output, {tempo});
+    const smidi::clock_master::clock::time_point start = smidi::clock_master::clock::time_point() + std::chrono::hours(1);
+    master.start(start);
+
+    size_t pumps = 0;
+    smidi::clock_master::clock::time_point now = start;
+    smidi_bench::clock::time_point begin = smidi_bench::clock::now();
+    for (smidi::clock_master::clock::time_point wake = start; wake < start + duration; pumps++)
+    {
+        now = wake;
+        wake = master.pump(now) + std::chrono::microseconds(lateness_us(random));
+    }
+    double pump_ns = smidi_bench::elapsed_ns(begin, smidi_bench::clock::now()) / pumps;
+
+    // The clocks due by the end of the run, against which both loops are compared.
+    const double expected_clocks = std::floor(static_cast<double>(std::chrono::nanoseconds(now - start).count()) / clock_interval_ns(tempo)) + 1;
+
+    // What this replaces: sleep_for(interval) after every clock, each wake-up adds its lateness to all later clocks.
+    random.seed(1234);
+    uint64_t sleep_loop_clocks = 0;
+    for (smidi::clock_master::clock::time_point sleep_now = start; sleep_now <= now;)
+    {
+        sleep_loop_clocks++;
+        sleep_now += std::chrono::nanoseconds(static_cast<int64_t>(clock_interval_ns(tempo))) + std::chrono::microseconds(lateness_us(random));
+    }
+
+    smidi::clock_master_statistics statistics = master.statistics();
+    reporter.report("clock_master/late_wake", {
+                                                  {"expected_clocks", expected_clocks},
+                                                  {"master_clock_error", static_cast<double>(master.position()) - expected_clocks},
+                                                  {"sleep_loop_clock_error", static_cast<double>(sleep_loop_clocks) - expected_clocks},
+                                                  {"max_lateness_us", static_cast<double>(statistics.max_lateness.count()) / 1000.0},
+                                                  {"ns_per_pump", pump_ns},
+                                              });
+}
+
+SMIDI_BENCHMARK(clock_follower)
+{
+    // An external clock at 123.4 BPM with up to 1ms of jitter, time stamped in whole milliseconds like device input.
+    constexpr double tempo = 123.4;
+    constexpr size_t clock_count = 24 * 4 * 64;
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<double> jitter_ns(-1.0e6, 1.0e6);
+
+    std::vector<smidi::clock_follower::clock::time_point> times(clock_count);
+    for (size_t clock_idx = 0; clock_idx < clock_count; clock_idx++)
+    {
+        const double ns = static_cast<double>(clock_idx) * clock_interval_ns(tempo) + jitter_ns(random);
+        times[clock_idx] = smidi::clock_follower::clock::time_point(std::chrono::milliseconds(std::llround(ns / 1.0e6) + 1000));
+    }
+
+    const uint8_t timing_clock[] = {0xF8};
+    smidi::clock_follower follower;
+    smidi_bench::clock::time_point begin = smidi_bench::clock::now();
+    for (size_t clock_idx = 0; clock_idx < clock_count; clock_idx++)
+    {
+        follower.process(timing_clock, sizeof(timing_clock), times[clock_idx]);
+    }
+    double process_ns = smidi_bench::elapsed_ns(begin, smidi_bench::clock::now()) / clock_count;
+
+    // What this replaces: tempo from the interval between the last two clocks.
+    const double last_interval_ns = static_cast<double>(std::chrono::nanoseconds(times[clock_count - 1] - times[clock_count - 2]).count());
+    const double last_interval_tempo = 60.0e9 / (last_interval_ns * smidi::midi_clocks_per_quarter_note);
+
+    smidi::clock_follower_statistics statistics = follower.statistics();
+    reporter.report("clock_follower/jittered", {
+                                                   {"tempo_error_bpm", std::abs(follower.tempo() - tempo)},
+                                                   {"last_interval_tempo_error_bpm", std::abs(last_interval_tempo - tempo)},
+                                                   {"jitter_rms_us", static_cast<double>(statistics.jitter_rms.count()) / 1000.0},
+                                                   {"jitter_max_us", static_cast<double>(statistics.jitter_max.count()) / 1000.0},
+                                                   {"ns_per_clock", process_ns},
+                                               });
+}
@@ -0,0 +1,126 @@
+#include "benchmark.h"
+
+#include "smidi_ext/smidi_dejitter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace
+{
+    struct simulated_event
+    {
+        double true_ns;
+        smidi::time_stamp time_stamp;
+        double arrival_ns;
+    };
+
+    struct error_summary
+    {
+        double rms_us;
+        double max_us;
+    };
+
+    // Deviation of the estimates from the true times, without the constant latency every estimate may carry.
+    error_summary summarize(const std::vector<simulated_event>& events, const std::vector<double>& estimates_ns)
+    {
+        double mean_ns = 0.0;
+        for (size_t event_idx = 0; event_idx < events.size(); event_idx++)
+        {
+            mean_ns += estimates_ns[event_idx] - events[event_idx].true_ns;
+        }
+        mean_ns /= static_cast<double>(events.size());
+
+        double squared_sum = 0.0;
+        double max_ns = 0.0;
+        for (size_t event_idx = 0; event_idx < events.size(); event_idx++)
+        {
+            const double error_ns = estimates_ns[event_idx] - events[event_idx].true_ns - mean_ns;
+            squared_sum += error_ns * error_ns;
+            max_ns = std::max(max_ns, std::abs(error_ns));
+        }
+        return {std::sqrt(squared_sum / static_cast<double>(events.size())) / 1000.0, max_ns / 1000.0};
+    }
+} // namespace
+
+SMIDI_BENCHMARK(dejitter)
+{
+    // Ten minutes of chords played into a DIN to USB interface whose clock runs 80ppm fast. It time stamps in whole
+    // milliseconds and sends in 1ms USB frames, the host thread wakes up to 1ms later per frame and stalls now and then.
+    constexpr double ms = 1.0e6;
+    constexpr double drift = 80.0e-6;
+    constexpr double note_on_wire_ns = 3 * 320.0e3;
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<double> chord_interval_ns(100.0 * ms, 400.0 * ms);
+    std::uniform_int_distribution<int> chord_notes(1, 4);
+    std::exponential_distribution<double> wake_latency_ns(1.0 / (0.4 * ms));
+    std::uniform_real_distribution<double> stall_chance(0.0, 1.0);
+    std::uniform_real_distribution<double> stall_ns(5.0 * ms, 15.0 * ms);
+
+    std::vector<simulated_event> events;
+    double last_frame_ns = -1.0;
+    double frame_arrival_ns = 0.0;
+    for (double chord_ns = 1000.0 * ms; chord_ns < 601000.0 * ms; chord_ns += chord_interval_ns(random))
+    {
+        const int notes = chord_notes(random);
+        for (int note_idx = 0; note_idx < notes; note_idx++)
+        {
+            simulated_event event;
+            event.true_ns = chord_ns + note_idx * note_on_wire_ns;
+            event.time_stamp = static_cast<smidi::time_stamp>(std::floor(event.true_ns * (1.0 + drift) / ms));
+            const double frame_ns = std::ceil(event.true_ns / ms) * ms;
+            if (frame_ns != last_frame_ns)
+            {
+                frame_arrival_ns = frame_ns + wake_latency_ns(random) + (stall_chance(random) < 0.01 ? stall_ns(random) : 0.0);
+                last_frame_ns = frame_ns;
+            }
+            event.arrival_ns = frame_arrival_ns;
+            events.push_back(event);
+        }
+    }
+
+    const smidi::input_dejitter::clock::time_point origin;
+    std::vector<smidi::input_dejitter::clock::time_point> arrivals(events.size());
+    for (size_t event_idx = 0; event_idx < events.size(); event_idx++)
+    {
+        arrivals[event_idx] = origin + std::chrono::nanoseconds(std::llround(events[event_idx].arrival_ns));
+    }
+
+    smidi::input_dejitter dejitter;
+    std::vector<smidi::input_dejitter::clock::time_point> corrected(events.size());
+    smidi_bench::clock::time_point begin = smidi_bench::clock::now();
+    for (size_t event_idx = 0; event_idx < events.size(); event_idx++)
+    {
+        corrected[event_idx] = dejitter.process(events[event_idx].time_stamp, arrivals[event_idx], 3);
+    }
+    double process_ns = smidi_bench::elapsed_ns(begin, smidi_bench::clock::now()) / static_cast<double>(events.size());
+
+    std::vector<double> time_stamp_ns(events.size());
+    std::vector<double> arrival_ns(events.size());
+    std::vector<double> corrected_ns(events.size());
+    for (size_t event_idx = 0; event_idx < events.size(); event_idx++)
+    {
+        time_stamp_ns[event_idx] = static_cast<double>(events[event_idx].time_stamp) * ms;
+        arrival_ns[event_idx] = events[event_idx].arrival_ns;
+        corrected_ns[event_idx] = static_cast<double>(std::chrono::nanoseconds(corrected[event_idx] - origin).count());
+    }
+
+    const error_summary time_stamp_error = summarize(events, time_stamp_ns);
+    const error_summary arrival_error = summarize(events, arrival_ns);
+    const error_summary corrected_error = summarize(events, corrected_ns);
+    smidi::input_dejitter_statistics statistics = dejitter.statistics();
+    reporter.report("dejitter/usb_chords", {
+                                               {"events", static_cast<double>(events.size())},
+                                               {"time_stamp_rms_us", time_stamp_error.rms_us},
+                                               {"time_stamp_max_us", time_stamp_error.max_us},
+                                               {"arrival_rms_us", arrival_error.rms_us},
+                                               {"arrival_max_us", arrival_error.max_us},
+                                               {"dejittered_rms_us", corrected_error.rms_us},
+                                               {"dejittered_max_us", corrected_error.max_us},
+                                               {"drift_ppm", statistics.drift_ppm},
+                                               {"spread", static_cast<double>(statistics.spread)},
+                                               {"outliers", static_cast<double>(statistics.outliers)},
+                                               {"ns_per_event", process_ns},
+                                           });
+}
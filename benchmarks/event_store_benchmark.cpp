@@ -0,0 +1,134 @@
+#include "benchmark.h"
+
+#include "smidi_ext/smidi_event_store.h"
+#include "smidi_ext/smidi_messages.h"
+
+#include <algorithm>
+#include <array>
+#include <variant>
+
+namespace
+{
+    constexpr size_t captured_event_count = 1024 * 1024;
+    // One event every 100us, about 105 seconds of capture.
+    constexpr smidi::time_stamp event_interval_us = 100;
+
+    // Controllers on all channels with some notes and SysEx in between.
+    std::vector<uint8_t> generate_event(size_t event_idx)
+    {
+        uint8_t channel = static_cast<uint8_t>((event_idx / 5) & 0xF);
+        uint8_t value = static_cast<uint8_t>(event_idx & 0x7F);
+        switch (event_idx % 8)
+        {
+        case 0:
+        case 1:
+        case 2:
+        case 3:
+            return {static_cast<uint8_t>(0xB0 | channel), static_cast<uint8_t>((event_idx * 7) % 96), value};
+        case 4:
+            return {static_cast<uint8_t>(0x90 | channel), value, 100};
+        case 5:
+            return {static_cast<uint8_t>(0x80 | channel), value, 0};
+        case 6:
+            return {0xF8};
+        default:
+            return {0xF0, 0x41, 0x10, 0x42, 0x12, value, 0x00, 0xF7};
+        }
+    }
+
+    // What the store replaces: a vector of parsed messages.
+    struct captured_event
+    {
+        smidi::time_stamp time;
+        smidi::message_variant message;
+    };
+} // namespace
+
+SMIDI_BENCHMARK(event_store)
+{
+    smidi::event_store store;
+    std::vector<captured_event> events;
+    events.reserve(captured_event_count);
+
+    smidi_bench::clock::time_point begin = smidi_bench::clock::now();
+    for (size_t event_idx = 0; event_idx < captured_event_count; event_idx++)
+    {
+        std::vector<uint8_t> data = generate_event(event_idx);
+        store.append(static_cast<smidi::time_stamp>(event_idx) * event_interval_us, data.data(), data.size());
+    }
+    double append_ns = smidi_bench::elapsed_ns(begin, smidi_bench::clock::now()) / captured_event_count;
+
+    for (size_t event_idx = 0; event_idx < captured_event_count; event_idx++)
+    {
+        std::vector<uint8_t> data = generate_event(event_idx);
+        events.push_back({static_cast<smidi::time_stamp>(event_idx) * event_interval_us, smidi::message_from_data(data.data(), data.size())});
+    }
+
+    reporter.report("event_store/append", {
+                                              {"events", static_cast<double>(captured_event_count)},
+                                              {"ns_per_event", append_ns},
+                                          });
+
+    // Sustain pedal on channel 4 over the last 30 seconds of the capture.
+    const smidi::time_stamp range_end = static_cast<smidi::time_stamp>(captured_event_count) * event_interval_us;
+    const smidi::time_stamp range_begin = range_end - 30 * 1000 * 1000;
+    const size_t range_events = store.lower_bound(range_end) - store.lower_bound(range_begin);
+    const smidi::event_filter sustain = {0xB3, 0xFF, 64, 0x7F};
+
+    double vector_ns = smidi_bench::measure_ns_per_op(20, [&](size_t iterations) {
+        for (size_t iteration = 0; iteration < iterations; iteration++)
+        {
+            auto first = std::lower_bound(events.begin(), events.end(), range_begin,
+                                          [](const captured_event& event, smidi::time_stamp time) { return event.time < time; });
+            size_t matches = 0;
+            for (auto event = first; event != events.end() && event->time < range_end; ++event)
+            {
+                const smidi::control_change_message* control_change = std::get_if<smidi::control_change_message>(&event->message);
+                matches += control_change != nullptr && control_change->channel() == 3 && control_change->controller() == 64;
+            }
+            smidi_bench::do_not_optimize(matches);
+        }
+    });
+
+    double count_ns = smidi_bench::measure_ns_per_op(20, [&](size_t iterations) {
+        for (size_t iteration = 0; iteration < iterations; iteration++)
+        {
+            smidi_bench::do_not_optimize(store.count(range_begin, range_end, sustain));
+        }
+    });
+
+    std::vector<size_t> indices;
+    double select_ns = smidi_bench::measure_ns_per_op(20, [&](size_t iterations) {
+        for (size_t iteration = 0; iteration < iterations; iteration++)
+        {
+            indices.clear();
+            store.select(range_begin, range_end, sustain, indices);
+            smidi_bench::do_not_optimize(indices.data());
+        }
+    });
+
+    reporter.report("event_store/range_filter", {
+                                                    {"range_events", static_cast<double>(range_events)},
+                                                    {"matches", static_cast<double>(indices.size())},
+                                                    {"vector_ns_per_event", vector_ns / range_events},
+                                                    {"count_ns_per_event", count_ns / range_events},
+                                                    {"select_ns_per_event", select_ns / range_events},
+                                                });
+
+    std::array<smidi::time_stamp, 64> lookup_times;
+    for (size_t lookup_idx = 0; lookup_idx < lookup_times.size(); lookup_idx++)
+    {
+        lookup_times[lookup_idx] = static_cast<smidi::time_stamp>((lookup_idx * 7919) % captured_event_count) * event_interval_us;
+    }
+
+    double lookup_ns = smidi_bench::measure_ns_per_op(100000, [&](size_t iterations) {
+        for (size_t iteration = 0; iteration < iterations; iteration++)
+        {
+            smidi_bench::do_not_optimize(store.lower_bound(lookup_times[iteration % lookup_times.size()]));
+        }
+    });
+
+    reporter.report("event_store/lower_bound", {
+                                                   {"ns_per_lookup", lookup_ns},
+                                               });
+}
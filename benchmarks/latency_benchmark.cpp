@@ -0,0 +1,68 @@
+#include "benchmark.h"
+
+#include "smidi/smidi.h"
+
+#include <array>
+#include <thread>
+
+SMIDI_BENCHMARK(round_trip_latency)
+{
+    // A responder thread echoes every message from "ping" back on "pong".
+    std::unique_ptr<smidi::system> system = smidi::create_loopback_system({"ping", "pong"});
+    std::unique_ptr<smidi::output_device> ping_output = system->create_output_device("ping");
+    std::unique_ptr<smidi::input_device> ping_input = system->create_input_device("ping");
+    std::unique_ptr<smidi::output_device> pong_output = system->create_output_device("pong");
+    std::unique_ptr<smidi::input_device> pong_input = system->create_input_device("pong");
+
+    constexpr size_t warmup_count = 1000;
+    constexpr size_t sample_count = 100000;
+    constexpr uint8_t stop_value = 0x7F;
+
+    std::thread responder([&]() {
+        std::array<uint8_t, 16> buffer = {0};
+        while (true)
+        {
+            size_t size = ping_input->receive(buffer.data(), buffer.size(), nullptr);
+            pong_output->send(buffer.data(), size);
+            if (buffer[1] == stop_value)
+            {
+                return;
+            }
+        }
+    });
+
+    std::vector<double> samples;
+    samples.reserve(sample_count);
+
+    std::array<uint8_t, 3> message = {0xB0, 0x00, 0x00};
+    std::array<uint8_t, 16> buffer = {0};
+    for (size_t sample_idx = 0; sample_idx < warmup_count + sample_count; sample_idx++)
+    {
+        message[2] = static_cast<uint8_t>(sample_idx & 0x7F);
+
+        smidi_bench::clock::time_point begin = smidi_bench::clock::now();
+        ping_output->send(message.data(), message.size());
+        pong_input->receive(buffer.data(), buffer.size(), nullptr);
+        smidi_bench::clock::time_point end = smidi_bench::clock::now();
+
+        if (sample_idx >= warmup_count)
+        {
+            samples.push_back(smidi_bench::elapsed_ns(begin, end));
+        }
+    }
+
+    message[1] = stop_value;
+    ping_output->send(message.data(), message.size());
+    responder.join();
+
+    std::sort(samples.begin(), samples.end());
+    reporter.report("round_trip_latency/loopback", {
+                                                       {"samples", static_cast<double>(samples.size())},
+                                                       {"min_ns", samples.front()},
+                                                       {"p50_ns", smidi_bench::percentile(samples, 0.5)},
+                                                       {"p90_ns", smidi_bench::percentile(samples, 0.9)},
+                                                       {"p99_ns", smidi_bench::percentile(samples, 0.99)},
+                                                       {"p999_ns", smidi_bench::percentile(samples, 0.999)},
+                                                       {"max_ns", samples.back()},
+                                                   });
+}
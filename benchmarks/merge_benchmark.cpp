@@ -0,0 +1,153 @@
+#include "benchmark.h"
+
+#include "smidi_ext/smidi_merge.h"
+
+#include <algorithm>
+#include <array>
+#include <random>
+#include <vector>
+
+namespace
+{
+    using clock = smidi::input_merge::clock;
+
+    struct source_event
+    {
+        size_t source;
+        clock::time_point time;
+        clock::time_point arrival;
+        std::array<uint8_t, 3> message;
+    };
+
+    // Events of source_count controllers with up to 3ms of delivery delay each, in the order they reach the host.
+    std::vector<source_event> make_arrivals(size_t source_count, size_t events_per_source, std::mt19937& random)
+    {
+        std::exponential_distribution<double> gap_us(1.0 / 2000.0);
+        std::uniform_int_distribution<int> delay_us(0, 3000);
+        std::uniform_int_distribution<int> byte(0, 0x7F);
+
+        std::vector<source_event> events;
+        for (size_t source_idx = 0; source_idx < source_count; source_idx++)
+        {
+            clock::time_point time = clock::time_point() + std::chrono::seconds(1);
+            clock::time_point arrival = time;
+            for (size_t event_idx = 0; event_idx < events_per_source; event_idx++)
+            {
+                time += std::chrono::microseconds(static_cast<int64_t>(gap_us(random)) + 1);
+                // A source delivers in order.
+                arrival = std::max(arrival, time + std::chrono::microseconds(delay_us(random)));
+                const uint8_t status = static_cast<uint8_t>(0x90 | (source_idx & 0x0F));
+                events.push_back({source_idx, time, arrival, {status, static_cast<uint8_t>(byte(random)), 0x40}});
+            }
+        }
+
+        std::stable_sort(events.begin(), events.end(), [](const source_event& a, const source_event& b) { return a.arrival < b.arrival; });
+        return events;
+    }
+
+    // Events whose time is before that of an event ahead of them in the stream.
+    template <typename time_function>
+    size_t count_out_of_order(size_t count, time_function time)
+    {
+        size_t out_of_order = 0;
+        clock::time_point latest;
+        for (size_t event_idx = 0; event_idx < count; event_idx++)
+        {
+            if (time(event_idx) < latest)
+            {
+                out_of_order++;
+            }
+            latest = std::max(latest, time(event_idx));
+        }
+        return out_of_order;
+    }
+} // namespace
+
+SMIDI_BENCHMARK(merge)
+{
+    constexpr size_t source_count = 32;
+    constexpr size_t events_per_source = 8192;
+    std::mt19937 random(1234);
+    const std::vector<source_event> arrivals = make_arrivals(source_count, events_per_source, random);
+
+    smidi::input_merge merge(source_count);
+    std::vector<clock::time_point> merged_times;
+    merged_times.reserve(arrivals.size());
+    std::array<uint8_t, 16> buffer = {0};
+    smidi::merged_event event;
+
+    // Every arrival is pushed and the merge drained at its arrival time, as a consumer woken for every message would.
+    smidi_bench::clock::time_point begin = smidi_bench::clock::now();
+    for (const source_event& arrival : arrivals)
+    {
+        merge.push(arrival.source, arrival.message.data(), arrival.message.size(), arrival.time);
+        while (merge.try_pop(arrival.arrival, buffer.data(), buffer.size(), &event) == SMIDI_RESULT_OK)
+        {
+            merged_times.push_back(event.time);
+        }
+    }
+    while (merge.try_pop(clock::time_point::max(), buffer.data(), buffer.size(), &event) == SMIDI_RESULT_OK)
+    {
+        merged_times.push_back(event.time);
+    }
+    double merge_ns = smidi_bench::elapsed_ns(begin, smidi_bench::clock::now()) / static_cast<double>(arrivals.size());
+
+    smidi::input_merge_statistics statistics = merge.statistics();
+    reporter.report("merge/32_sources", {
+                                            {"events", static_cast<double>(arrivals.size())},
+                                            {"merged", static_cast<double>(merged_times.size())},
+                                            {"arrival_order_out_of_order",
+                                             static_cast<double>(count_out_of_order(arrivals.size(), [&](size_t idx) { return arrivals[idx].time; }))},
+                                            {"merged_out_of_order",
+                                             static_cast<double>(count_out_of_order(merged_times.size(), [&](size_t idx) { return merged_times[idx]; }))},
+                                            {"late", static_cast<double>(statistics.late)},
+                                            {"ns_per_event", merge_ns},
+                                        });
+
+    // Eight controllers that each reach the host twice, the second path up to 1ms behind the first.
+    constexpr size_t path_count = 8;
+    std::vector<source_event> redundant = make_arrivals(path_count, events_per_source, random);
+    const size_t original_count = redundant.size();
+    std::uniform_int_distribution<int> path_delay_us(0, 1000);
+    std::array<std::chrono::microseconds, path_count> path_delays;
+    for (std::chrono::microseconds& path_delay : path_delays)
+    {
+        path_delay = std::chrono::microseconds(path_delay_us(random));
+    }
+    for (size_t event_idx = 0; event_idx < original_count; event_idx++)
+    {
+        source_event copy = redundant[event_idx];
+        copy.arrival += path_delays[copy.source];
+        copy.source += path_count;
+        redundant.push_back(copy);
+    }
+    std::stable_sort(redundant.begin(), redundant.end(), [](const source_event& a, const source_event& b) { return a.arrival < b.arrival; });
+
+    smidi::input_merge_options options;
+    options.dedupe = true;
+    smidi::input_merge dedupe_merge(2 * path_count, options);
+    size_t dedupe_merged = 0;
+    begin = smidi_bench::clock::now();
+    for (const source_event& arrival : redundant)
+    {
+        dedupe_merge.push(arrival.source, arrival.message.data(), arrival.message.size(), arrival.time);
+        while (dedupe_merge.try_pop(arrival.arrival, buffer.data(), buffer.size(), &event) == SMIDI_RESULT_OK)
+        {
+            dedupe_merged++;
+        }
+    }
+    while (dedupe_merge.try_pop(clock::time_point::max(), buffer.data(), buffer.size(), &event) == SMIDI_RESULT_OK)
+    {
+        dedupe_merged++;
+    }
+    double dedupe_ns = smidi_bench::elapsed_ns(begin, smidi_bench::clock::now()) / static_cast<double>(redundant.size());
+
+    statistics = dedupe_merge.statistics();
+    reporter.report("merge/dedupe", {
+                                        {"events", static_cast<double>(redundant.size())},
+                                        {"merged", static_cast<double>(dedupe_merged)},
+                                        {"duplicates", static_cast<double>(statistics.duplicates)},
+                                        {"expected_duplicates", static_cast<double>(original_count)},
+                                        {"ns_per_event", dedupe_ns},
+                                    });
+}
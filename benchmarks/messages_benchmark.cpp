@@ -0,0 +1,185 @@
+#include "benchmark.h"
+
+#include "smidi_ext/smidi_event_batch.h"
+#include "smidi_ext/smidi_messages.h"
+
+#include <variant>
+
+namespace
+{
+    // A mix of channel voice, system common and short SysEx messages.
+    std::vector<uint8_t> generate_message_stream(size_t message_count)
+    {
+        std::vector<uint8_t> stream;
+        for (size_t message_idx = 0; message_idx < message_count; message_idx++)
+        {
+            uint8_t channel = static_cast<uint8_t>(message_idx & 0xF);
+            uint8_t value = static_cast<uint8_t>(message_idx & 0x7F);
+            switch (message_idx % 8)
+            {
+            case 0:
+            case 1:
+            case 2:
+                stream.insert(stream.end(), {static_cast<uint8_t>(0xB0 | channel), static_cast<uint8_t>(message_idx % 120), value});
+                break;
+            case 3:
+                stream.insert(stream.end(), {static_cast<uint8_t>(0x90 | channel), value, 100});
+                break;
+            case 4:
+                stream.insert(stream.end(), {static_cast<uint8_t>(0x80 | channel), value, 0});
+                break;
+            case 5:
+                stream.insert(stream.end(), {static_cast<uint8_t>(0xC0 | channel), value});
+                break;
+            case 6:
+                stream.push_back(0xF8);
+                break;
+            case 7:
+                stream.insert(stream.end(), {0xF0, 0x41, 0x10, 0x42, 0x12, value, 0x00, 0xF7});
+                break;
+            }
+        }
+        return stream;
+    }
+
+    constexpr size_t stream_message_count = 64 * 1024;
+} // namespace
+
+SMIDI_BENCHMARK(message_length)
+{
+    std::vector<uint8_t> stream = generate_message_stream(stream_message_count);
+
+    double ns_per_stream = smidi_bench::measure_ns_per_op(20, [&](size_t iterations) {
+        for (size_t iteration = 0; iteration < iterations; iteration++)
+        {
+            size_t offset = 0;
+            while (offset < stream.size())
+            {
+                offset += smidi::message_length(stream.data() + offset, stream.size() - offset);
+            }
+            smidi_bench::do_not_optimize(offset);
+        }
+    });
+
+    double ns_per_message = ns_per_stream / stream_message_count;
+    reporter.report("message_length/mixed", {
+                                                {"ns_per_message", ns_per_message},
+                                                {"messages_per_second", 1e9 / ns_per_message},
+                                                {"bytes_per_second", stream.size() * 1e9 / ns_per_stream},
+                                            });
+}
+
+SMIDI_BENCHMARK(message_from_data)
+{
+    std::vector<uint8_t> stream = generate_message_stream(stream_message_count);
+
+    double ns_per_stream = smidi_bench::measure_ns_per_op(20, [&](size_t iterations) {
+        for (size_t iteration = 0; iteration < iterations; iteration++)
+        {
+            size_t offset = 0;
+            while (offset < stream.size())
+            {
+                size_t length = smidi::message_length(stream.data() + offset, stream.size() - offset);
+                smidi::message_variant message = smidi::message_from_data(stream.data() + offset, length);
+                smidi_bench::do_not_optimize(message);
+                offset += length;
+            }
+        }
+    });
+
+    double ns_per_message = ns_per_stream / stream_message_count;
+    reporter.report("message_from_data/mixed", {
+                                                   {"ns_per_message", ns_per_message},
+                                                   {"messages_per_second", 1e9 / ns_per_message},
+                                               });
+
+    smidi::control_change_message control_change(3, 64, 127);
+    double ns_per_control_change = smidi_bench::measure_ns_per_op(1000000, [&](size_t iterations) {
+        for (size_t iteration = 0; iteration < iterations; iteration++)
+        {
+            smidi::message_variant message = smidi::message_from_data(control_change.data(), control_change.size());
+            smidi_bench::do_not_optimize(message);
+        }
+    });
+
+    reporter.report("message_from_data/control_change", {
+                                                            {"ns_per_message", ns_per_control_change},
+                                                            {"messages_per_second", 1e9 / ns_per_control_change},
+                                                        });
+}
+
+SMIDI_BENCHMARK(decode_messages)
+{
+    std::vector<uint8_t> stream = generate_message_stream(stream_message_count);
+    smidi::event_batch batch(stream_message_count, stream.size());
+
+    double ns_per_stream = smidi_bench::measure_ns_per_op(20, [&](size_t iterations) {
+        for (size_t iteration = 0; iteration < iterations; iteration++)
+        {
+            batch.clear();
+            smidi_bench::do_not_optimize(smidi::decode_messages(stream.data(), stream.size(), 0, batch));
+        }
+    });
+
+    // Counting the note ons of the decoded batch against doing the same on the message_from_data results.
+    const smidi::event_filter note_on_filter = {0x90, 0xF0, 0, 0};
+    double ns_per_count = smidi_bench::measure_ns_per_op(200, [&](size_t iterations) {
+        for (size_t iteration = 0; iteration < iterations; iteration++)
+        {
+            smidi_bench::do_not_optimize(batch.count(note_on_filter));
+        }
+    });
+
+    std::vector<smidi::message_variant> messages;
+    for (size_t offset = 0; offset < stream.size();)
+    {
+        size_t length = smidi::message_length(stream.data() + offset, stream.size() - offset);
+        messages.push_back(smidi::message_from_data(stream.data() + offset, length));
+        offset += length;
+    }
+    double ns_per_variant_count = smidi_bench::measure_ns_per_op(200, [&](size_t iterations) {
+        for (size_t iteration = 0; iteration < iterations; iteration++)
+        {
+            size_t matches = 0;
+            for (const smidi::message_variant& message : messages)
+            {
+                const size_t size = smidi::message_size(message);
+                matches += static_cast<size_t>(size > 0 && smidi::is_note_on_message(smidi::message_data(message)[0]));
+            }
+            smidi_bench::do_not_optimize(matches);
+        }
+    });
+
+    double ns_per_message = ns_per_stream / stream_message_count;
+    reporter.report("decode_messages/mixed", {
+                                                 {"ns_per_message", ns_per_message},
+                                                 {"messages_per_second", 1e9 / ns_per_message},
+                                                 {"bytes_per_second", stream.size() * 1e9 / ns_per_stream},
+                                                 {"count_ns_per_message", ns_per_count / stream_message_count},
+                                                 {"variant_count_ns_per_message", ns_per_variant_count / stream_message_count},
+                                             });
+}
+
+SMIDI_BENCHMARK(system_exclusive_scan)
+{
+    for (size_t payload_size : {64, 4 * 1024, 256 * 1024})
+    {
+        std::vector<uint8_t> message(payload_size + 2, 0x55);
+        message.front() = 0xF0;
+        message.back() = 0xF7;
+
+        size_t iterations = std::max<size_t>((64 * 1024 * 1024) / message.size(), 16);
+        double ns_per_scan = smidi_bench::measure_ns_per_op(iterations, [&](size_t iterations) {
+            for (size_t iteration = 0; iteration < iterations; iteration++)
+            {
+                smidi_bench::do_not_optimize(smidi::system_exlusive_message_length(message.data(), message.size()));
+            }
+        });
+
+        reporter.report("system_exclusive_scan/" + std::to_string(payload_size), {
+                                                                                     {"payload_bytes", static_cast<double>(payload_size)},
+                                                                                     {"ns_per_message", ns_per_scan},
+                                                                                     {"bytes_per_second", message.size() * 1e9 / ns_per_scan},
+                                                                                 });
+    }
+}
@@ -0,0 +1,102 @@
+#include "benchmark.h"
+
+#include "smidi_ext/smidi_mtc.h"
+
+#include <cmath>
+#include <random>
+
+namespace
+{
+    // Keeps the quarter frames so they can be decoded separately.
+    class recording_output_device : public smidi::output_device
+    {
+      public:
+        size_t send(const uint8_t* data, size_t size) override
+        {
+            try_send(data, size);
+            return size;
+        }
+
+        smidi::result try_send(const uint8_t* data, size_t size) noexcept override
+        {
+            if (size == 2 && count < messages.size())
+            {
+                messages[count++] = {data[0], data[1]};
+            }
+            return SMIDI_RESULT_OK;
+        }
+
+        std::vector<std::array<uint8_t, 2>> messages;
+        size_t count = 0;
+    };
+} // namespace
+
+SMIDI_BENCHMARK(mtc)
+{
+    // Ten minutes of 29.97 drop frame time code, 120 quarter frames per second.
+    constexpr smidi::mtc_frame_rate rate = smidi::mtc_frame_rate::fps_29_97_drop;
+    constexpr size_t quarter_frame_count = 10 * 60 * 120;
+    const double quarter_frame_ns = 1.0e9 / (smidi::frames_per_second(rate) * 4);
+
+    recording_output_device output;
+    output.messages.resize(quarter_frame_count);
+
+    smidi::mtc_generator generator(output, {rate});
+    const smidi::smpte_time start_position = {0, 59, 58, 0, rate};
+    generator.locate(start_position);
+
+    const smidi::mtc_generator::clock::time_point start = smidi::mtc_generator::clock::time_point() + std::chrono::hours(1);
+    generator.start(start);
+
+    smidi::mtc_generator::clock::time_point now = start;
+    smidi_bench::clock::time_point begin = smidi_bench::clock::now();
+    while (output.count < quarter_frame_count)
+    {
+        now = generator.pump(now);
+    }
+    double pump_ns = smidi_bench::elapsed_ns(begin, smidi_bench::clock::now()) / quarter_frame_count;
+
+    // Quarter frames arrive up to 1ms early or late, the decoder is asked for the position half a quarter frame after
+    // each one and compared against the true position.
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<double> jitter_ns(-1.0e6, 1.0e6);
+    std::vector<smidi::mtc_decoder::clock::time_point> arrivals(quarter_frame_count);
+    for (size_t quarter_frame = 0; quarter_frame < quarter_frame_count; quarter_frame++)
+    {
+        arrivals[quarter_frame] = start + std::chrono::nanoseconds(std::llround(static_cast<double>(quarter_frame) * quarter_frame_ns + jitter_ns(random)));
+    }
+
+    smidi::mtc_decoder decoder;
+    begin = smidi_bench::clock::now();
+    for (size_t quarter_frame = 0; quarter_frame < quarter_frame_count; quarter_frame++)
+    {
+        decoder.process(output.messages[quarter_frame].data(), 2, arrivals[quarter_frame]);
+    }
+    double process_ns = smidi_bench::elapsed_ns(begin, smidi_bench::clock::now()) / quarter_frame_count;
+
+    decoder.reset();
+    const double start_frame = static_cast<double>(smidi::smpte_to_frames(start_position));
+    double max_error_frames = 0.0;
+    for (size_t quarter_frame = 0; quarter_frame < quarter_frame_count; quarter_frame++)
+    {
+        decoder.process(output.messages[quarter_frame].data(), 2, arrivals[quarter_frame]);
+        if (!decoder.locked())
+        {
+            continue;
+        }
+
+        const double query_ns = (static_cast<double>(quarter_frame) + 0.5) * quarter_frame_ns;
+        const double expected = start_frame + query_ns / (quarter_frame_ns * 4);
+        const double decoded = decoder.frame_position(start + std::chrono::nanoseconds(std::llround(query_ns)));
+        max_error_frames = std::max(max_error_frames, std::abs(decoded - expected));
+    }
+
+    smidi::mtc_decoder_statistics statistics = decoder.statistics();
+    reporter.report("mtc/29.97df", {
+                                       {"quarter_frames", static_cast<double>(quarter_frame_count)},
+                                       {"generator_ns_per_quarter_frame", pump_ns},
+                                       {"decoder_ns_per_quarter_frame", process_ns},
+                                       {"max_error_frames", max_error_frames},
+                                       {"resyncs", static_cast<double>(statistics.resyncs)},
+                                   });
+}
@@ -0,0 +1,105 @@
+#include "benchmark.h"
+
+#include "message_queue.h"
+
+#include <array>
+#include <thread>
+
+SMIDI_BENCHMARK(message_queue)
+{
+    const std::array<uint8_t, 3> message = {0xB0, 0x07, 0x64};
+    std::array<uint8_t, 16> buffer = {0};
+
+    {
+        smidi::message_queue queue;
+        double ns_per_op = smidi_bench::measure_ns_per_op(1000000, [&](size_t iterations) {
+            for (size_t iteration = 0; iteration < iterations; iteration++)
+            {
+                smidi::time_stamp time_stamp = 0;
+                queue.push(message.data(), message.size(), static_cast<smidi::time_stamp>(iteration));
+                smidi_bench::do_not_optimize(queue.pop(buffer.data(), buffer.size(), &time_stamp));
+            }
+        });
+
+        reporter.report("message_queue/push_pop", {
+                                                      {"ns_per_message", ns_per_op},
+                                                      {"messages_per_second", 1e9 / ns_per_op},
+                                                  });
+    }
+
+    {
+        constexpr size_t batch_size = 1024;
+        smidi::message_queue queue;
+        double ns_per_batch = smidi_bench::measure_ns_per_op(1000, [&](size_t iterations) {
+            for (size_t iteration = 0; iteration < iterations; iteration++)
+            {
+                for (size_t message_idx = 0; message_idx < batch_size; message_idx++)
+                {
+                    queue.push(message.data(), message.size(), static_cast<smidi::time_stamp>(message_idx));
+                }
+                for (size_t message_idx = 0; message_idx < batch_size; message_idx++)
+                {
+                    smidi_bench::do_not_optimize(queue.pop(buffer.data(), buffer.size(), nullptr));
+                }
+            }
+        });
+
+        double ns_per_op = ns_per_batch / batch_size;
+        reporter.report("message_queue/push_pop_batch", {
+                                                            {"batch_size", static_cast<double>(batch_size)},
+                                                            {"ns_per_message", ns_per_op},
+                                                            {"messages_per_second", 1e9 / ns_per_op},
+                                                        });
+    }
+
+    {
+        constexpr size_t message_count = 1000000;
+        smidi::message_queue queue({SMIDI_DEFAULT_QUEUE_CAPACITY, SMIDI_OVERFLOW_POLICY_BLOCK});
+
+        smidi_bench::clock::time_point begin = smidi_bench::clock::now();
+        std::thread producer([&]() {
+            for (size_t message_idx = 0; message_idx < message_count; message_idx++)
+            {
+                queue.push(message.data(), message.size(), static_cast<smidi::time_stamp>(message_idx));
+            }
+        });
+        for (size_t message_idx = 0; message_idx < message_count; message_idx++)
+        {
+            smidi_bench::do_not_optimize(queue.pop(buffer.data(), buffer.size(), nullptr));
+        }
+        producer.join();
+
+        double ns_per_op = smidi_bench::elapsed_ns(begin, smidi_bench::clock::now()) / message_count;
+        reporter.report("message_queue/producer_consumer", {
+                                                               {"ns_per_message", ns_per_op},
+                                                               {"messages_per_second", 1e9 / ns_per_op},
+                                                           });
+    }
+
+    // A stalled consumer: every push hits a full queue.
+    const std::pair<const char*, smidi::overflow_policy> policies[] = {
+        {"drop_newest", SMIDI_OVERFLOW_POLICY_DROP_NEWEST},
+        {"drop_oldest", SMIDI_OVERFLOW_POLICY_DROP_OLDEST},
+        {"coalesce", SMIDI_OVERFLOW_POLICY_COALESCE},
+    };
+    for (const auto& policy : policies)
+    {
+        smidi::message_queue queue({SMIDI_DEFAULT_QUEUE_CAPACITY, policy.second});
+        std::array<uint8_t, 3> flood_message = message;
+        double ns_per_op = smidi_bench::measure_ns_per_op(1000000, [&](size_t iterations) {
+            for (size_t iteration = 0; iteration < iterations; iteration++)
+            {
+                flood_message[1] = static_cast<uint8_t>(iteration & 0x7F);
+                queue.push(flood_message.data(), flood_message.size(), static_cast<smidi::time_stamp>(iteration));
+            }
+        });
+
+        smidi::queue_statistics statistics = queue.statistics();
+        reporter.report(std::string("message_queue/overflow_") + policy.first, {
+                                                                                   {"ns_per_message", ns_per_op},
+                                                                                   {"messages_per_second", 1e9 / ns_per_op},
+                                                                                   {"dropped", static_cast<double>(statistics.dropped)},
+                                                                                   {"coalesced", static_cast<double>(statistics.coalesced)},
+                                                                               });
+    }
+}
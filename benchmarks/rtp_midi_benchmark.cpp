@@ -0,0 +1,78 @@
+#include "benchmark.h"
+
+#include "smidi/smidi.h"
+
+#if !defined(_WIN32)
+
+#include <array>
+#include <thread>
+
+SMIDI_BENCHMARK(rtp_midi_throughput)
+{
+    // Two sessions on localhost, bursts of controller messages are sent and read back before the next burst so the
+    // socket buffers never overflow. Packing trades a bounded delay for far fewer packets, which shows in the cost of
+    // send while delivery of each burst waits for the packing interval.
+    constexpr size_t burst_size = 64;
+    constexpr size_t burst_count = 500;
+
+    for (unsigned int packing_interval_us : {0u, static_cast<unsigned int>(SMIDI_DEFAULT_RTP_MIDI_PACKING_INTERVAL_US)})
+    {
+        const char* peers[] = {"127.0.0.1:21930"};
+        smidi::rtp_midi_options sender_options = smidi::default_rtp_midi_options;
+        sender_options.session_name = "sender";
+        sender_options.control_port = 21928;
+        sender_options.peers = peers;
+        sender_options.peer_count = 1;
+        sender_options.packing_interval_us = packing_interval_us;
+
+        smidi::rtp_midi_options receiver_options = smidi::default_rtp_midi_options;
+        receiver_options.session_name = "receiver";
+        receiver_options.control_port = 21930;
+
+        std::unique_ptr<smidi::system> receiver = smidi::create_rtp_midi_system(receiver_options);
+        std::unique_ptr<smidi::system> sender = smidi::create_rtp_midi_system(sender_options);
+        for (size_t attempt = 0; attempt < 500 && (sender->output_devices().empty() || receiver->input_devices().empty()); attempt++)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            sender->refresh();
+            receiver->refresh();
+        }
+        if (sender->output_devices().empty() || receiver->input_devices().empty())
+        {
+            return;
+        }
+
+        std::unique_ptr<smidi::output_device> output = sender->create_output_device("receiver");
+        std::unique_ptr<smidi::input_device> input = receiver->create_input_device("sender");
+
+        std::array<uint8_t, 3> message = {0xB0, 0x01, 0x00};
+        std::array<uint8_t, 16> buffer = {0};
+        double send_ns = 0.0;
+        smidi_bench::clock::time_point begin = smidi_bench::clock::now();
+        for (size_t burst_idx = 0; burst_idx < burst_count; burst_idx++)
+        {
+            smidi_bench::clock::time_point send_begin = smidi_bench::clock::now();
+            for (size_t message_idx = 0; message_idx < burst_size; message_idx++)
+            {
+                message[2] = static_cast<uint8_t>(message_idx & 0x7F);
+                output->send(message.data(), message.size());
+            }
+            send_ns += smidi_bench::elapsed_ns(send_begin, smidi_bench::clock::now());
+
+            for (size_t message_idx = 0; message_idx < burst_size; message_idx++)
+            {
+                input->receive(buffer.data(), buffer.size(), nullptr);
+            }
+        }
+        double total_ns = smidi_bench::elapsed_ns(begin, smidi_bench::clock::now());
+
+        reporter.report("rtp_midi_throughput/packing_" + std::to_string(packing_interval_us) + "us",
+                        {
+                            {"messages", static_cast<double>(burst_size * burst_count)},
+                            {"send_ns_per_message", send_ns / (burst_size * burst_count)},
+                            {"delivery_ns_per_message", total_ns / (burst_size * burst_count)},
+                        });
+    }
+}
+
+#endif
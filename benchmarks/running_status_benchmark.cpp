@@ -0,0 +1,91 @@
+#include "benchmark.h"
+
+#include "running_status.h"
+
+#include <array>
+
+namespace
+{
+    // Dense note and controller traffic on a few channels, with interleaved clock.
+    std::vector<std::array<uint8_t, 3>> generate_dense_messages(size_t message_count)
+    {
+        std::vector<std::array<uint8_t, 3>> messages;
+        for (size_t message_idx = 0; message_idx < message_count; message_idx++)
+        {
+            uint8_t channel = static_cast<uint8_t>((message_idx / 32) & 0x3);
+            uint8_t value = static_cast<uint8_t>(message_idx & 0x7F);
+            if (message_idx % 24 == 0)
+            {
+                messages.push_back({0xF8, 0, 0});
+            }
+            else if ((message_idx / 8) % 2 == 0)
+            {
+                messages.push_back({static_cast<uint8_t>(0x90 | channel), value, 100});
+            }
+            else
+            {
+                messages.push_back({static_cast<uint8_t>(0xB0 | channel), 1, value});
+            }
+        }
+        return messages;
+    }
+
+    size_t message_size(const std::array<uint8_t, 3>& message)
+    {
+        return (message[0] == 0xF8) ? 1 : 3;
+    }
+} // namespace
+
+SMIDI_BENCHMARK(running_status)
+{
+    constexpr size_t message_count = 64 * 1024;
+    std::vector<std::array<uint8_t, 3>> messages = generate_dense_messages(message_count);
+    std::vector<uint8_t> wire(message_count * 3);
+
+    size_t plain_bytes = 0;
+    for (const std::array<uint8_t, 3>& message : messages)
+    {
+        plain_bytes += message_size(message);
+    }
+
+    size_t wire_bytes = 0;
+    double encode_ns = smidi_bench::measure_ns_per_op(20, [&](size_t iterations) {
+        for (size_t iteration = 0; iteration < iterations; iteration++)
+        {
+            smidi::running_status_encoder encoder(64);
+            wire_bytes = 0;
+            for (const std::array<uint8_t, 3>& message : messages)
+            {
+                wire_bytes += encoder.encode(message.data(), message_size(message), wire.data() + wire_bytes);
+            }
+            smidi_bench::do_not_optimize(wire_bytes);
+        }
+    });
+
+    size_t parsed_count = 0;
+    double parse_ns = smidi_bench::measure_ns_per_op(20, [&](size_t iterations) {
+        for (size_t iteration = 0; iteration < iterations; iteration++)
+        {
+            smidi::byte_stream_parser parser;
+            parsed_count = 0;
+            parser.parse(wire.data(), wire_bytes, [&](const uint8_t* data, size_t size) {
+                (void)size;
+                smidi_bench::do_not_optimize(data);
+                parsed_count++;
+            });
+        }
+    });
+
+    if (parsed_count != message_count)
+    {
+        throw std::runtime_error("Running status round trip lost messages.");
+    }
+
+    reporter.report("running_status/dense_note_cc", {
+                                                        {"plain_bytes", static_cast<double>(plain_bytes)},
+                                                        {"wire_bytes", static_cast<double>(wire_bytes)},
+                                                        {"wire_ratio", static_cast<double>(wire_bytes) / plain_bytes},
+                                                        {"encode_ns_per_message", encode_ns / message_count},
+                                                        {"parse_ns_per_message", parse_ns / message_count},
+                                                    });
+}
@@ -0,0 +1,104 @@
+#include "benchmark.h"
+
+#include "smidi_ext/smidi_sequencer.h"
+
+#include <chrono>
+
+namespace
+{
+    // Only counts messages, so the benchmark measures the sequencer alone.
+    class null_output_device : public smidi::output_device
+    {
+      public:
+        size_t send(const uint8_t* data, size_t size) override
+        {
+            (void)data;
+            sent++;
+            return size;
+        }
+
+        smidi::result try_send(const uint8_t* data, size_t size) noexcept override
+        {
+            (void)data;
+            (void)size;
+            sent++;
+            return SMIDI_RESULT_OK;
+        }
+
+        size_t sent = 0;
+    };
+
+    // Sixteenth notes, each a note on and a note off, event_count events in total.
+    smidi::pattern generate_pattern(size_t event_count)
+    {
+        constexpr uint64_t sixteenth = smidi::sequencer_ticks_per_quarter_note / 4;
+
+        const size_t note_count = event_count / 2;
+        smidi::pattern generated(note_count * sixteenth);
+        for (size_t note_idx = 0; note_idx < note_count; note_idx++)
+        {
+            const uint8_t note = static_cast<uint8_t>(36 + note_idx % 48);
+            const uint8_t note_on[3] = {0x90, note, 100};
+            const uint8_t note_off[3] = {0x80, note, 0};
+            generated.add(note_idx * sixteenth, note_on, sizeof(note_on));
+            generated.add(note_idx * sixteenth + sixteenth / 2, note_off, sizeof(note_off));
+        }
+        return generated;
+    }
+
+    // Plays duration of the pattern by pumping every wake_interval of simulated time and returns the time per pump.
+    double measure_pump_ns(const smidi::pattern& played, std::chrono::milliseconds duration, std::chrono::microseconds wake_interval,
+                           smidi::sequencer_statistics& statistics)
+    {
+        null_output_device output;
+        smidi::sequencer sequencer;
+        sequencer.add_track(output, played);
+
+        const smidi::sequencer::clock::time_point start = smidi::sequencer::clock::time_point() + std::chrono::hours(1);
+        sequencer.start(start);
+
+        size_t pumps = 0;
+        smidi_bench::clock::time_point begin = smidi_bench::clock::now();
+        for (smidi::sequencer::clock::time_point now = start; now < start + duration; now += wake_interval)
+        {
+            smidi_bench::do_not_optimize(sequencer.pump(now));
+            pumps++;
+        }
+        double ns = smidi_bench::elapsed_ns(begin, smidi_bench::clock::now());
+
+        statistics = sequencer.statistics();
+        return ns / pumps;
+    }
+} // namespace
+
+SMIDI_BENCHMARK(sequencer)
+{
+    // At 120 BPM a sixteenth is 125ms, so the same ten seconds render the same events whatever the pattern size.
+    for (size_t event_count : {size_t(1000), size_t(1000000)})
+    {
+        const smidi::pattern played = generate_pattern(event_count);
+
+        smidi::sequencer_statistics statistics = {};
+        double pump_ns = measure_pump_ns(played, std::chrono::seconds(10), std::chrono::milliseconds(1), statistics);
+
+        reporter.report("sequencer/pump/" + std::to_string(event_count), {
+                                                                            {"pattern_events", static_cast<double>(event_count)},
+                                                                            {"rendered", static_cast<double>(statistics.rendered)},
+                                                                            {"ns_per_pump", pump_ns},
+                                                                        });
+    }
+
+    // Waking up every 50ms with a 20ms lookahead is always late: the overdue events go out at once and the rest keep
+    // their times, so both runs render the same events up to their last horizon.
+    const smidi::pattern played = generate_pattern(1000);
+    smidi::sequencer_statistics on_time = {};
+    smidi::sequencer_statistics late = {};
+    measure_pump_ns(played, std::chrono::seconds(10), std::chrono::milliseconds(1), on_time);
+    measure_pump_ns(played, std::chrono::seconds(10), std::chrono::milliseconds(50), late);
+
+    reporter.report("sequencer/late_wake", {
+                                               {"on_time_rendered", static_cast<double>(on_time.rendered)},
+                                               {"late_rendered", static_cast<double>(late.rendered)},
+                                               {"late_events", static_cast<double>(late.late)},
+                                           });
+}
@@ -0,0 +1,73 @@
+#include "benchmark.h"
+
+#include "smidi/smidi.h"
+
+#if defined(__linux__)
+
+#include <array>
+#include <system_error>
+
+namespace
+{
+    void measure_latency(smidi_bench::reporter& reporter, const std::string& name, const smidi::device_options& options)
+    {
+        // Publish to receive through the ring, including the futex wakeup of the reader thread. Reader and publisher live
+        // in one process here, across processes the path is the same.
+        std::unique_ptr<smidi::output_device> port = smidi::create_shared_memory_port("smidi_bench shared memory");
+        std::unique_ptr<smidi::system> system = smidi::create_shared_memory_system();
+        std::unique_ptr<smidi::input_device> input = system->create_input_device("smidi_bench shared memory", options);
+
+        constexpr size_t warmup_count = 1000;
+        constexpr size_t sample_count = 100000;
+
+        std::vector<double> samples;
+        samples.reserve(sample_count);
+
+        std::array<uint8_t, 3> message = {0xB0, 0x00, 0x00};
+        std::array<uint8_t, 16> buffer = {0};
+        for (size_t sample_idx = 0; sample_idx < warmup_count + sample_count; sample_idx++)
+        {
+            message[2] = static_cast<uint8_t>(sample_idx & 0x7F);
+
+            smidi_bench::clock::time_point begin = smidi_bench::clock::now();
+            port->send(message.data(), message.size());
+            input->receive(buffer.data(), buffer.size(), nullptr);
+            smidi_bench::clock::time_point end = smidi_bench::clock::now();
+
+            if (sample_idx >= warmup_count)
+            {
+                samples.push_back(smidi_bench::elapsed_ns(begin, end));
+            }
+        }
+
+        std::sort(samples.begin(), samples.end());
+        reporter.report(name, {
+                                  {"samples", static_cast<double>(samples.size())},
+                                  {"min_ns", samples.front()},
+                                  {"p50_ns", smidi_bench::percentile(samples, 0.5)},
+                                  {"p90_ns", smidi_bench::percentile(samples, 0.9)},
+                                  {"p99_ns", smidi_bench::percentile(samples, 0.99)},
+                                  {"max_ns", samples.back()},
+                              });
+    }
+} // namespace
+
+SMIDI_BENCHMARK(shared_memory_latency)
+{
+    measure_latency(reporter, "shared_memory_latency", smidi::default_device_options);
+
+    // The reader thread on SCHED_FIFO with its queue locked, skipped without the privilege for it.
+    smidi::device_options realtime_options = smidi::default_device_options;
+    realtime_options.thread_scheduling = SMIDI_THREAD_SCHEDULING_FIFO;
+    realtime_options.thread_priority = 50;
+    realtime_options.lock_memory = 1;
+    try
+    {
+        measure_latency(reporter, "shared_memory_latency/realtime", realtime_options);
+    }
+    catch (const std::system_error&)
+    {
+    }
+}
+
+#endif
@@ -0,0 +1,74 @@
+#include "benchmark.h"
+
+#include "smidi_ext/smidi_smf.h"
+
+namespace
+{
+    void append_variable_length(std::vector<uint8_t>& data, uint32_t value)
+    {
+        uint8_t bytes[4];
+        size_t count = 0;
+        do
+        {
+            bytes[count++] = static_cast<uint8_t>(value & 0x7F);
+            value >>= 7;
+        } while (value != 0);
+
+        while (count > 0)
+        {
+            count--;
+            data.push_back(static_cast<uint8_t>(bytes[count] | (count > 0 ? 0x80 : 0)));
+        }
+    }
+
+    // A format 1 file of note tracks, half the notes written with running status the way sequencers save them.
+    std::vector<uint8_t> generate_file(size_t track_count, size_t notes_per_track)
+    {
+        std::vector<uint8_t> file = {'M', 'T', 'h', 'd', 0, 0, 0, 6, 0, 1, 0, static_cast<uint8_t>(track_count), 0x01, 0xE0};
+        for (size_t track_idx = 0; track_idx < track_count; track_idx++)
+        {
+            std::vector<uint8_t> events;
+            for (size_t note_idx = 0; note_idx < notes_per_track; note_idx++)
+            {
+                const uint8_t key = static_cast<uint8_t>(36 + note_idx % 48);
+                append_variable_length(events, static_cast<uint32_t>(note_idx % 3 * 60));
+                events.insert(events.end(), {static_cast<uint8_t>(0x90 | track_idx), key, 100});
+                append_variable_length(events, 240);
+                events.insert(events.end(), {key, 0});
+            }
+            events.insert(events.end(), {0x00, 0xFF, 0x2F, 0x00});
+
+            const uint32_t size = static_cast<uint32_t>(events.size());
+            file.insert(file.end(), {'M', 'T', 'r', 'k', static_cast<uint8_t>(size >> 24), static_cast<uint8_t>(size >> 16),
+                                     static_cast<uint8_t>(size >> 8), static_cast<uint8_t>(size)});
+            file.insert(file.end(), events.begin(), events.end());
+        }
+        return file;
+    }
+} // namespace
+
+SMIDI_BENCHMARK(smf_reader)
+{
+    const std::vector<uint8_t> file = generate_file(16, 4096);
+
+    size_t event_count = 0;
+    double ns_per_file = smidi_bench::measure_ns_per_op(50, [&](size_t iterations) {
+        for (size_t iteration = 0; iteration < iterations; iteration++)
+        {
+            smidi::smf_reader reader(file.data(), file.size());
+            smidi::smf_event event;
+            event_count = 0;
+            while (reader.next(event))
+            {
+                event_count++;
+            }
+            smidi_bench::do_not_optimize(event_count);
+        }
+    });
+
+    reporter.report("smf_reader/16_tracks", {
+                                                {"events", static_cast<double>(event_count)},
+                                                {"ns_per_event", ns_per_file / event_count},
+                                                {"bytes_per_second", file.size() * 1e9 / ns_per_file},
+                                            });
+}
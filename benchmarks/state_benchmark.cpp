@@ -0,0 +1,109 @@
+#include "benchmark.h"
+
+#include "smidi_ext/smidi_state.h"
+
+#include <array>
+
+namespace
+{
+    class counting_output_device : public smidi::output_device
+    {
+      public:
+        size_t send(const uint8_t* data, size_t size) override
+        {
+            (void)data;
+            sent++;
+            return size;
+        }
+
+        smidi::result try_send(const uint8_t* data, size_t size) noexcept override
+        {
+            (void)data;
+            (void)size;
+            sent++;
+            return SMIDI_RESULT_OK;
+        }
+
+        size_t sent = 0;
+    };
+
+    // A chord on two channels, a held sustain pedal and a few controllers, as a live performance leaves them.
+    void play(smidi::midi_state_tracker& state)
+    {
+        const std::array<uint8_t, 3> messages[] = {
+            {0xC0, 5, 0},    {0xB0, 7, 100},  {0xB0, 10, 64},  {0xB0, 64, 127}, {0x90, 60, 100}, {0x90, 64, 100},
+            {0x90, 67, 100}, {0x91, 36, 90},  {0x91, 43, 90},  {0x91, 48, 90},  {0xE0, 0, 72},   {0xB1, 1, 40},
+            {0x90, 72, 100}, {0x80, 72, 0},   {0x91, 48, 0},   {0xD1, 30, 0},
+        };
+        for (const std::array<uint8_t, 3>& message : messages)
+        {
+            state.process(message.data(), message.size());
+        }
+    }
+} // namespace
+
+SMIDI_BENCHMARK(state_tracker)
+{
+    counting_output_device output;
+
+    smidi::midi_state_tracker state;
+    play(state);
+    const size_t active_notes = state.active_note_count();
+
+    size_t panic_messages = 0;
+    double panic_ns = smidi_bench::measure_ns_per_op(100000, [&](size_t iterations) {
+        for (size_t iteration = 0; iteration < iterations; iteration++)
+        {
+            smidi::midi_state_tracker copy = state;
+            panic_messages = copy.panic(output);
+        }
+    });
+
+    // What this replaces: a note off for every note on every channel.
+    size_t flood_messages = 0;
+    double flood_ns = smidi_bench::measure_ns_per_op(1000, [&](size_t iterations) {
+        for (size_t iteration = 0; iteration < iterations; iteration++)
+        {
+            flood_messages = 0;
+            for (uint8_t channel = 0; channel < 16; channel++)
+            {
+                for (uint8_t note = 0; note < 128; note++)
+                {
+                    const uint8_t message[] = {static_cast<uint8_t>(0x80 | channel), note, 0};
+                    smidi_bench::do_not_optimize(message);
+                    flood_messages += output.try_send(message, sizeof(message)) == SMIDI_RESULT_OK;
+                }
+            }
+        }
+    });
+
+    reporter.report("state_tracker/panic", {
+                                               {"active_notes", static_cast<double>(active_notes)},
+                                               {"panic_messages", static_cast<double>(panic_messages)},
+                                               {"flood_messages", static_cast<double>(flood_messages)},
+                                               {"panic_ns", panic_ns},
+                                               {"flood_ns", flood_ns},
+                                           });
+
+    size_t chase_messages = 0;
+    double chase_ns = smidi_bench::measure_ns_per_op(100000, [&](size_t iterations) {
+        for (size_t iteration = 0; iteration < iterations; iteration++)
+        {
+            chase_messages = state.chase(output);
+        }
+    });
+
+    const uint8_t note_on[] = {0x90, 60, 100};
+    double process_ns = smidi_bench::measure_ns_per_op(1000000, [&](size_t iterations) {
+        for (size_t iteration = 0; iteration < iterations; iteration++)
+        {
+            state.process(note_on, sizeof(note_on));
+        }
+    });
+
+    reporter.report("state_tracker/chase", {
+                                               {"chase_messages", static_cast<double>(chase_messages)},
+                                               {"chase_ns", chase_ns},
+                                               {"process_ns", process_ns},
+                                           });
+}
@@ -0,0 +1,92 @@
+#include "benchmark.h"
+
+#include "smidi/smidi.h"
+#include "smidi/smidi_static.h"
+
+#include <algorithm>
+#include <array>
+#include <memory>
+
+// The same loopback devices called through the interfaces and through their concrete final types. The difference is the
+// indirect call, plus whatever inlining the direct call allows: empty polls are answered in the header, the rest is
+// inlined across the library boundary with SMIDI_STATIC_BACKEND builds.
+SMIDI_BENCHMARK(static_dispatch)
+{
+    std::unique_ptr<smidi::system> system = smidi::create_loopback_system({"bench"});
+    std::unique_ptr<smidi::loopback::output_device> output_device = smidi::loopback::create_output_device(*system, "bench");
+    std::unique_ptr<smidi::loopback::input_device> input_device = smidi::loopback::create_input_device(*system, "bench");
+
+    // Otherwise the compiler sees the concrete types behind the interface pointers and calls them directly as well.
+    smidi::output_device* virtual_output_device = smidi_bench::opaque_pointer<smidi::output_device>(output_device.get());
+    smidi::input_device* virtual_input_device = smidi_bench::opaque_pointer<smidi::input_device>(input_device.get());
+
+    const std::array<uint8_t, 3> message = {0xB0, 0x07, 0x64};
+    std::array<uint8_t, 16> buffer = {0};
+
+    // The variants alternate so drifting clock speeds and cache state affect both alike, the best round counts.
+    constexpr size_t rounds = 5;
+    constexpr size_t iterations = 1000000;
+
+    double virtual_ns = 0.0;
+    double direct_ns = 0.0;
+    for (size_t round = 0; round < rounds; round++)
+    {
+        double round_virtual_ns = smidi_bench::measure_ns_per_op(iterations, [&](size_t iterations) {
+            for (size_t iteration = 0; iteration < iterations; iteration++)
+            {
+                size_t message_size = 0;
+                smidi_bench::do_not_optimize(virtual_output_device->try_send(message.data(), message.size()));
+                smidi_bench::do_not_optimize(virtual_input_device->try_receive(buffer.data(), buffer.size(), &message_size, nullptr));
+            }
+        });
+
+        double round_direct_ns = smidi_bench::measure_ns_per_op(iterations, [&](size_t iterations) {
+            for (size_t iteration = 0; iteration < iterations; iteration++)
+            {
+                size_t message_size = 0;
+                smidi_bench::do_not_optimize(output_device->try_send(message.data(), message.size()));
+                smidi_bench::do_not_optimize(input_device->try_receive(buffer.data(), buffer.size(), &message_size, nullptr));
+            }
+        });
+
+        virtual_ns = round == 0 ? round_virtual_ns : std::min(virtual_ns, round_virtual_ns);
+        direct_ns = round == 0 ? round_direct_ns : std::min(direct_ns, round_direct_ns);
+    }
+
+    reporter.report("static_dispatch/try_send_receive", {
+                                                            {"virtual_ns_per_message", virtual_ns},
+                                                            {"direct_ns_per_message", direct_ns},
+                                                            {"saved_ns_per_message", virtual_ns - direct_ns},
+                                                        });
+
+    // Polling an empty queue costs little more than the call, so the dispatch is most of it.
+    double virtual_poll_ns = 0.0;
+    double direct_poll_ns = 0.0;
+    for (size_t round = 0; round < rounds; round++)
+    {
+        double round_virtual_ns = smidi_bench::measure_ns_per_op(iterations, [&](size_t iterations) {
+            for (size_t iteration = 0; iteration < iterations; iteration++)
+            {
+                size_t message_size = 0;
+                smidi_bench::do_not_optimize(virtual_input_device->try_receive(buffer.data(), buffer.size(), &message_size, nullptr));
+            }
+        });
+
+        double round_direct_ns = smidi_bench::measure_ns_per_op(iterations, [&](size_t iterations) {
+            for (size_t iteration = 0; iteration < iterations; iteration++)
+            {
+                size_t message_size = 0;
+                smidi_bench::do_not_optimize(input_device->try_receive(buffer.data(), buffer.size(), &message_size, nullptr));
+            }
+        });
+
+        virtual_poll_ns = round == 0 ? round_virtual_ns : std::min(virtual_poll_ns, round_virtual_ns);
+        direct_poll_ns = round == 0 ? round_direct_ns : std::min(direct_poll_ns, round_direct_ns);
+    }
+
+    reporter.report("static_dispatch/empty_poll", {
+                                                      {"virtual_ns_per_poll", virtual_poll_ns},
+                                                      {"direct_ns_per_poll", direct_poll_ns},
+                                                      {"saved_ns_per_poll", virtual_poll_ns - direct_poll_ns},
+                                                  });
+}
@@ -0,0 +1,130 @@
+#include "benchmark.h"
+
+#include "smidi_ext/smidi_sysex.h"
+
+#include <deque>
+
+namespace
+{
+    // Remembers the packet numbers sent so the simulated receiver can answer them.
+    class handshake_output_device : public smidi::output_device
+    {
+      public:
+        size_t send(const uint8_t* data, size_t size) override
+        {
+            try_send(data, size);
+            return size;
+        }
+
+        smidi::result try_send(const uint8_t* data, size_t size) noexcept override
+        {
+            sent.push_back(data[size - 2]);
+            return SMIDI_RESULT_OK;
+        }
+
+        std::deque<uint8_t> sent;
+    };
+
+    // Sample dump data packets: F0 7E <channel> 02 <packet> <120 data bytes> <checksum> F7.
+    std::vector<uint8_t> generate_dump(size_t packet_count)
+    {
+        std::vector<uint8_t> dump;
+        for (size_t packet_idx = 0; packet_idx < packet_count; packet_idx++)
+        {
+            dump.insert(dump.end(), {0xF0, 0x7E, 0x00, 0x02, static_cast<uint8_t>(packet_idx & 0x7F)});
+            for (size_t byte_idx = 0; byte_idx < 120; byte_idx++)
+            {
+                dump.push_back(static_cast<uint8_t>((packet_idx + byte_idx) & 0x7F));
+            }
+            dump.insert(dump.end(), {static_cast<uint8_t>(packet_idx & 0x7F), 0xF7});
+        }
+        return dump;
+    }
+
+    // Simulated time until the receiver acknowledged the whole dump, each reply arrives round_trip after its packet.
+    std::chrono::microseconds simulate_transfer(const std::vector<uint8_t>& dump, size_t window, std::chrono::microseconds round_trip)
+    {
+        handshake_output_device output;
+        smidi::sysex_transfer_options options;
+        options.handshake = smidi::sysex_handshake::sample_dump;
+        options.window = window;
+        smidi::sysex_transfer transfer(output, options);
+        transfer.start(dump.data(), dump.size());
+
+        const smidi::sysex_transfer::clock::time_point start = smidi::sysex_transfer::clock::time_point() + std::chrono::hours(1);
+        smidi::sysex_transfer::clock::time_point now = start;
+        std::deque<std::pair<smidi::sysex_transfer::clock::time_point, uint8_t>> replies;
+        while (transfer.state() == smidi::sysex_transfer_state::sending)
+        {
+            transfer.pump(now);
+            for (; !output.sent.empty(); output.sent.pop_front())
+            {
+                replies.push_back({now + round_trip, output.sent.front()});
+            }
+
+            now = replies.front().first;
+            for (; !replies.empty() && replies.front().first <= now; replies.pop_front())
+            {
+                const uint8_t ack[] = {0xF0, 0x7E, 0x00, 0x7F, replies.front().second, 0xF7};
+                transfer.process(ack, sizeof(ack), now);
+            }
+        }
+        return std::chrono::duration_cast<std::chrono::microseconds>(now - start);
+    }
+} // namespace
+
+SMIDI_BENCHMARK(sysex_transfer)
+{
+    // A 1000 packet sample dump over USB with 2ms between a packet and its ACK.
+    const std::vector<uint8_t> dump = generate_dump(1000);
+    const std::chrono::microseconds round_trip(2000);
+
+    for (size_t window : {size_t(1), size_t(4), size_t(16)})
+    {
+        const std::chrono::microseconds duration = simulate_transfer(dump, window, round_trip);
+        reporter.report("sysex_transfer/window_" + std::to_string(window), {
+                                                                                 {"bytes", static_cast<double>(dump.size())},
+                                                                                 {"transfer_ms", static_cast<double>(duration.count()) / 1000.0},
+                                                                             });
+    }
+}
+
+SMIDI_BENCHMARK(sysex_reassembly)
+{
+    // One 1MB dump arriving in 1024 byte driver buffers.
+    constexpr size_t fragment_size = 1024;
+    std::vector<uint8_t> dump(1024 * 1024, 0x55);
+    dump.front() = 0xF0;
+    dump.back() = 0xF7;
+
+    smidi::sysex_reassembler reassembler;
+    double reassembler_ns = smidi_bench::measure_ns_per_op(20, [&](size_t iterations) {
+        for (size_t iteration = 0; iteration < iterations; iteration++)
+        {
+            for (size_t offset = 0; offset < dump.size(); offset += fragment_size)
+            {
+                reassembler.process(dump.data() + offset, std::min(fragment_size, dump.size() - offset));
+            }
+            smidi_bench::do_not_optimize(reassembler.message());
+        }
+    });
+
+    // What this replaces: a fresh vector per dump, grown as the fragments come in.
+    double vector_ns = smidi_bench::measure_ns_per_op(20, [&](size_t iterations) {
+        for (size_t iteration = 0; iteration < iterations; iteration++)
+        {
+            std::vector<uint8_t> message;
+            for (size_t offset = 0; offset < dump.size(); offset += fragment_size)
+            {
+                message.insert(message.end(), dump.begin() + offset, dump.begin() + std::min(offset + fragment_size, dump.size()));
+            }
+            smidi_bench::do_not_optimize(message.data());
+        }
+    });
+
+    reporter.report("sysex_reassembly/1MB", {
+                                                {"fragments", static_cast<double>(dump.size() / fragment_size)},
+                                                {"reassembler_ns_per_byte", reassembler_ns / dump.size()},
+                                                {"vector_ns_per_byte", vector_ns / dump.size()},
+                                            });
+}
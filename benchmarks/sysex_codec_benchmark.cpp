@@ -0,0 +1,131 @@
+#include "benchmark.h"
+
+#include "smidi_ext/smidi_sysex_codec.h"
+
+#include <random>
+#include <vector>
+
+namespace
+{
+    // What the kernels replace: a byte at a time, as vendor dump code usually does it.
+    size_t scalar_pack_7bit(const uint8_t* data, size_t size, uint8_t* out)
+    {
+        uint8_t* begin = out;
+        for (size_t offset = 0; offset < size; offset += 7)
+        {
+            const size_t count = std::min<size_t>(7, size - offset);
+            uint8_t& top = *out++;
+            top = 0;
+            for (size_t byte_idx = 0; byte_idx < count; byte_idx++)
+            {
+                top |= static_cast<uint8_t>((data[offset + byte_idx] >> 7) << byte_idx);
+                *out++ = data[offset + byte_idx] & 0x7F;
+            }
+        }
+        return static_cast<size_t>(out - begin);
+    }
+
+    size_t scalar_unpack_7bit(const uint8_t* data, size_t size, uint8_t* out)
+    {
+        uint8_t* begin = out;
+        for (size_t offset = 0; offset < size; offset += 8)
+        {
+            const size_t count = std::min<size_t>(8, size - offset);
+            for (size_t byte_idx = 1; byte_idx < count; byte_idx++)
+            {
+                *out++ = static_cast<uint8_t>(data[offset + byte_idx] | (((data[offset] >> (byte_idx - 1)) & 1) << 7));
+            }
+        }
+        return static_cast<size_t>(out - begin);
+    }
+
+    size_t scalar_pack_nibbles(const uint8_t* data, size_t size, uint8_t* out)
+    {
+        for (size_t byte_idx = 0; byte_idx < size; byte_idx++)
+        {
+            out[2 * byte_idx] = data[byte_idx] & 0x0F;
+            out[2 * byte_idx + 1] = data[byte_idx] >> 4;
+        }
+        return 2 * size;
+    }
+
+    uint8_t scalar_sum_checksum(const uint8_t* data, size_t size)
+    {
+        uint8_t sum = 0;
+        for (size_t byte_idx = 0; byte_idx < size; byte_idx++)
+        {
+            sum = static_cast<uint8_t>((sum + data[byte_idx]) & 0x7F);
+        }
+        return static_cast<uint8_t>((0x80 - sum) & 0x7F);
+    }
+
+    template <typename function_type>
+    double ns_per_byte(size_t size, function_type&& function)
+    {
+        return smidi_bench::measure_ns_per_op(50, [&](size_t iterations) {
+                   for (size_t iteration = 0; iteration < iterations; iteration++)
+                   {
+                       smidi_bench::do_not_optimize(function());
+                   }
+               }) /
+               static_cast<double>(size);
+    }
+} // namespace
+
+SMIDI_BENCHMARK(sysex_codec)
+{
+    // A 1MB sample dump.
+    constexpr size_t size = 1024 * 1024;
+    std::mt19937 random(1234);
+    std::vector<uint8_t> samples(size);
+    for (uint8_t& sample : samples)
+    {
+        sample = static_cast<uint8_t>(random());
+    }
+
+    std::vector<uint8_t> packed(smidi::sysex_7bit_packed_size(size));
+    std::vector<uint8_t> scalar_packed(packed.size());
+    std::vector<uint8_t> unpacked(size);
+    std::vector<uint8_t> scalar_unpacked(size);
+
+    const double pack_ns = ns_per_byte(size, [&] { return smidi::pack_sysex_7bit(samples.data(), size, packed.data()); });
+    const double scalar_pack_ns = ns_per_byte(size, [&] { return scalar_pack_7bit(samples.data(), size, scalar_packed.data()); });
+    const double unpack_ns = ns_per_byte(size, [&] { return smidi::unpack_sysex_7bit(packed.data(), packed.size(), unpacked.data()); });
+    const double scalar_unpack_ns =
+        ns_per_byte(size, [&] { return scalar_unpack_7bit(scalar_packed.data(), scalar_packed.size(), scalar_unpacked.data()); });
+
+    reporter.report("sysex_codec/7bit_1MB", {
+                                                {"pack_ns_per_byte", pack_ns},
+                                                {"scalar_pack_ns_per_byte", scalar_pack_ns},
+                                                {"unpack_ns_per_byte", unpack_ns},
+                                                {"scalar_unpack_ns_per_byte", scalar_unpack_ns},
+                                                {"matches_scalar", static_cast<double>(packed == scalar_packed && unpacked == scalar_unpacked)},
+                                                {"round_trip", static_cast<double>(unpacked == samples)},
+                                            });
+
+    std::vector<uint8_t> nibbles(2 * size);
+    std::vector<uint8_t> scalar_nibbles(2 * size);
+    const double nibble_pack_ns = ns_per_byte(size, [&] { return smidi::pack_sysex_nibbles(samples.data(), size, nibbles.data()); });
+    const double scalar_nibble_pack_ns = ns_per_byte(size, [&] { return scalar_pack_nibbles(samples.data(), size, scalar_nibbles.data()); });
+    const double nibble_unpack_ns = ns_per_byte(size, [&] { return smidi::unpack_sysex_nibbles(nibbles.data(), nibbles.size(), unpacked.data()); });
+
+    reporter.report("sysex_codec/nibbles_1MB", {
+                                                   {"pack_ns_per_byte", nibble_pack_ns},
+                                                   {"scalar_pack_ns_per_byte", scalar_nibble_pack_ns},
+                                                   {"unpack_ns_per_byte", nibble_unpack_ns},
+                                                   {"matches_scalar", static_cast<double>(nibbles == scalar_nibbles)},
+                                                   {"round_trip", static_cast<double>(unpacked == samples)},
+                                               });
+
+    const double checksum_ns = ns_per_byte(packed.size(), [&] { return smidi::sysex_sum_checksum(packed.data(), packed.size()); });
+    const double scalar_checksum_ns = ns_per_byte(packed.size(), [&] { return scalar_sum_checksum(packed.data(), packed.size()); });
+    const double xor_checksum_ns = ns_per_byte(packed.size(), [&] { return smidi::sysex_xor_checksum(packed.data(), packed.size()); });
+
+    reporter.report("sysex_codec/checksum_1MB", {
+                                                    {"sum_ns_per_byte", checksum_ns},
+                                                    {"scalar_sum_ns_per_byte", scalar_checksum_ns},
+                                                    {"xor_ns_per_byte", xor_checksum_ns},
+                                                    {"matches_scalar", static_cast<double>(smidi::sysex_sum_checksum(packed.data(), packed.size()) ==
+                                                                                           scalar_sum_checksum(packed.data(), packed.size()))},
+                                                });
+}
@@ -0,0 +1,94 @@
+#include "benchmark.h"
+
+#include "smidi_ext/smidi_ump.h"
+
+SMIDI_BENCHMARK(ump_translation)
+{
+    // Full-rate note, controller and pitch bend traffic across all channels.
+    constexpr size_t message_count = 64 * 1024;
+    std::vector<uint8_t> stream;
+    for (size_t message_idx = 0; message_idx < message_count; message_idx++)
+    {
+        uint8_t channel = static_cast<uint8_t>(message_idx & 0xF);
+        uint8_t value = static_cast<uint8_t>((message_idx * 7) & 0x7F);
+        static const uint8_t statuses[] = {0x90, 0x80, 0xB0, 0xE0};
+        stream.insert(stream.end(), {static_cast<uint8_t>(statuses[message_idx % 4] | channel), value, static_cast<uint8_t>(127 - value)});
+    }
+
+    for (smidi::ump_protocol protocol : {smidi::ump_protocol::midi1, smidi::ump_protocol::midi2})
+    {
+        const char* protocol_name = (protocol == smidi::ump_protocol::midi1) ? "midi1" : "midi2";
+
+        std::vector<uint32_t> words(smidi::midi1_to_ump_translator::max_words(stream.size()));
+        size_t word_count = 0;
+        double to_ump_ns = smidi_bench::measure_ns_per_op(50, [&](size_t iterations) {
+            for (size_t iteration = 0; iteration < iterations; iteration++)
+            {
+                smidi::midi1_to_ump_translator translator(0, protocol);
+                word_count = translator.translate(stream.data(), stream.size(), words.data());
+                smidi_bench::do_not_optimize(word_count);
+            }
+        });
+
+        std::vector<uint8_t> bytes(smidi::ump_to_midi1_translator::max_bytes(word_count));
+        double from_ump_ns = smidi_bench::measure_ns_per_op(50, [&](size_t iterations) {
+            for (size_t iteration = 0; iteration < iterations; iteration++)
+            {
+                smidi::ump_to_midi1_translator translator;
+                smidi_bench::do_not_optimize(translator.translate(words.data(), word_count, bytes.data()));
+            }
+        });
+
+        reporter.report(std::string("ump_translation/") + protocol_name, {
+                                                                             {"words", static_cast<double>(word_count)},
+                                                                             {"midi1_to_ump_ns_per_message", to_ump_ns / message_count},
+                                                                             {"ump_to_midi1_ns_per_message", from_ump_ns / message_count},
+                                                                         });
+    }
+}
+
+SMIDI_BENCHMARK(ump_scaling)
+{
+    constexpr size_t value_count = 64 * 1024;
+    std::vector<uint8_t> values7(value_count);
+    std::vector<uint16_t> values14(value_count);
+    for (size_t value_idx = 0; value_idx < value_count; value_idx++)
+    {
+        values7[value_idx] = static_cast<uint8_t>(value_idx & 0x7F);
+        values14[value_idx] = static_cast<uint16_t>(value_idx & 0x3FFF);
+    }
+    std::vector<uint32_t> values32(value_count);
+
+    double batch_7_to_32_ns = smidi_bench::measure_ns_per_op(200, [&](size_t iterations) {
+        for (size_t iteration = 0; iteration < iterations; iteration++)
+        {
+            smidi::scale_7_to_32(values7.data(), values32.data(), value_count);
+            smidi_bench::do_not_optimize(values32[iteration % value_count]);
+        }
+    });
+
+    double scalar_7_to_32_ns = smidi_bench::measure_ns_per_op(200, [&](size_t iterations) {
+        for (size_t iteration = 0; iteration < iterations; iteration++)
+        {
+            for (size_t value_idx = 0; value_idx < value_count; value_idx++)
+            {
+                values32[value_idx] = smidi::scale_up(values7[value_idx], 7, 32);
+            }
+            smidi_bench::do_not_optimize(values32[iteration % value_count]);
+        }
+    });
+
+    double batch_14_to_32_ns = smidi_bench::measure_ns_per_op(200, [&](size_t iterations) {
+        for (size_t iteration = 0; iteration < iterations; iteration++)
+        {
+            smidi::scale_14_to_32(values14.data(), values32.data(), value_count);
+            smidi_bench::do_not_optimize(values32[iteration % value_count]);
+        }
+    });
+
+    reporter.report("ump_scaling", {
+                                       {"batch_7_to_32_ns_per_value", batch_7_to_32_ns / value_count},
+                                       {"scalar_7_to_32_ns_per_value", scalar_7_to_32_ns / value_count},
+                                       {"batch_14_to_32_ns_per_value", batch_14_to_32_ns / value_count},
+                                   });
+}
@@ -1,6 +1,6 @@
-#ifndef SMIDI_H
-#define SMIDI_H
-
+#ifndef SMIDI_H
+#define SMIDI_H
+
 #if defined(_WIN32) && defined(_SMIDI_DLL_IMPLEMENTATION)
 #define SMIDI_API __declspec(dllexport)
 #elif defined(_WIN32) && defined(SMIDI_DLL)
@@ -9,86 +9,355 @@
 #define SMIDI_API __attribute__((visibility("default")))
 #else
 #define SMIDI_API
-#endif
-
-// SMIDI C API
-#ifdef __cplusplus
-extern "C" {
-#endif // __cplusplus
-
-#define SMIDI_MAX_DEVICE_NAME_LENGTH 256
-
-typedef struct smidi_device_info
-{
-    char name[SMIDI_MAX_DEVICE_NAME_LENGTH];
-    unsigned int manufacturer;
-    unsigned int product;
-    unsigned int driver_major_version;
-    unsigned int driver_minor_version;
-} smidi_device_info;
-
-typedef struct smidi_input_device smidi_input_device;
-typedef struct smidi_output_device smidi_output_device;
-typedef struct smidi_system smidi_system;
-typedef long long smidi_time_stamp;
-
-SMIDI_API smidi_system *smidi_create_system();
-SMIDI_API void smidi_destroy_system(smidi_system* system);
-
-SMIDI_API int smidi_system_get_output_device_count(smidi_system* system);
-SMIDI_API int smidi_system_get_output_device_info(smidi_system* system, int device_info_index, smidi_device_info* out_device_info);
-SMIDI_API smidi_output_device* smidi_system_create_output_device(smidi_system* system, const char *device_name);
-SMIDI_API void smidi_destroy_output_device(smidi_output_device* output_device);
-SMIDI_API int smidi_output_device_send_message(smidi_output_device* output_device, const void* buffer, int buffer_size);
-
-SMIDI_API int smidi_system_get_input_device_count(smidi_system* system);
-SMIDI_API int smidi_system_get_input_device_info(smidi_system* system, int device_info_index, smidi_device_info* out_device_info);
-SMIDI_API smidi_input_device* smidi_system_create_input_device(smidi_system* system, const char *device_name);
-SMIDI_API void smidi_destroy_input_device(smidi_input_device* input_device);
-SMIDI_API int smidi_input_device_recieve_message(smidi_input_device* input_device, void* buffer, int buffer_size, smidi_time_stamp* time_stamp);
-
-#ifdef __cplusplus
-}
-#endif // __cplusplus
-
-// SMIDI C++ API
-#ifdef __cplusplus
-
-#include <chrono>
-#include <memory>
-#include <string>
-#include <vector>
-
-namespace smidi
-{
-    using time_stamp = smidi_time_stamp;
-    using device_info = smidi_device_info;
-
-    class SMIDI_API output_device
-    {
-      public:
-        virtual size_t send(const uint8_t* data, size_t size) = 0;
-    };
-
-    class SMIDI_API input_device
-    {
-      public:
-        virtual size_t receive(uint8_t* data, size_t size, time_stamp* time_stamp) = 0;
-    };
-
-    class SMIDI_API system
-    {
-      public:
-        virtual const std::vector<device_info>& output_devices() const noexcept = 0;
-        virtual std::unique_ptr<output_device> create_output_device(const std::string& name) = 0;
-
-        virtual const std::vector<device_info>& input_devices() const noexcept = 0;
-        virtual std::unique_ptr<input_device> create_input_device(const std::string& name) = 0;
-    };
-
-    SMIDI_API std::unique_ptr<system> create_system();
-} // namespace smidi
-
-#endif // __cplusplus
-
-#endif // SMIDI_H
+#endif
+
+// SMIDI C API
+#ifdef __cplusplus
+extern "C" {
+#endif // __cplusplus
+
+#define SMIDI_MAX_DEVICE_NAME_LENGTH 256
+
+typedef enum smidi_result
+{
+    SMIDI_RESULT_OK,
+    // A NULL device or buffer, or an invalid size.
+    SMIDI_RESULT_INVALID_ARGUMENT,
+    // The input queue is empty.
+    SMIDI_RESULT_NO_MESSAGE,
+    // The next message does not fit the receive buffer, it is left in the queue.
+    SMIDI_RESULT_BUFFER_TOO_SMALL,
+    // The message is larger than the device can carry.
+    SMIDI_RESULT_MESSAGE_TOO_LARGE,
+    // The device was unplugged or its remote session ended.
+    SMIDI_RESULT_DISCONNECTED,
+    SMIDI_RESULT_OUT_OF_MEMORY,
+    // The driver or operating system reported an error.
+    SMIDI_RESULT_DEVICE_ERROR,
+    // A receiving queue was full under SMIDI_OVERFLOW_POLICY_BLOCK, the message was dropped for it instead of waiting.
+    SMIDI_RESULT_WOULD_BLOCK,
+} smidi_result;
+
+// Receives the diagnostics of the C API: the name of the failing function and a description of the error.
+typedef void (*smidi_log_callback)(void* user_data, const char* function, const char* message);
+
+typedef struct smidi_device_info
+{
+    char name[SMIDI_MAX_DEVICE_NAME_LENGTH];
+    unsigned int manufacturer;
+    unsigned int product;
+    unsigned int driver_major_version;
+    unsigned int driver_minor_version;
+} smidi_device_info;
+
+typedef enum smidi_device_change_type
+{
+    SMIDI_DEVICE_CHANGE_ADDED,
+    SMIDI_DEVICE_CHANGE_REMOVED,
+} smidi_device_change_type;
+
+typedef struct smidi_device_change
+{
+    smidi_device_change_type type;
+    // Non-zero for input devices, zero for output devices.
+    int input;
+    smidi_device_info device_info;
+} smidi_device_change;
+
+// Called from a backend thread when devices were plugged or unplugged. Apply the changes with smidi_system_refresh.
+typedef void (*smidi_device_change_callback)(void* user_data);
+
+// Called from the backend thread of an input device after it queued a message, e.g. to wake a consumer waiting in an
+// event loop. Take the message with smidi_input_device_try_receive_message. Also called once when the device is
+// unplugged or closed, receiving then returns SMIDI_RESULT_DISCONNECTED after the queued messages.
+typedef void (*smidi_message_callback)(void* user_data);
+
+// What an input device does with a new message when its queue is full.
+typedef enum smidi_overflow_policy
+{
+    // Wait for the consumer to make room. This stalls the driver callback or reader thread of the device.
+    SMIDI_OVERFLOW_POLICY_BLOCK,
+    SMIDI_OVERFLOW_POLICY_DROP_NEWEST,
+    SMIDI_OVERFLOW_POLICY_DROP_OLDEST,
+    // Control change, pitch bend and pressure messages replace the value of the queued message with the same channel
+    // and controller (or key). Other messages, or ones without a queued match, drop the oldest message.
+    SMIDI_OVERFLOW_POLICY_COALESCE,
+} smidi_overflow_policy;
+
+#define SMIDI_DEFAULT_QUEUE_CAPACITY 4096
+
+typedef struct smidi_queue_options
+{
+    unsigned int capacity;
+    smidi_overflow_policy overflow_policy;
+} smidi_queue_options;
+
+// Scheduling of the thread an input device reads its port on.
+typedef enum smidi_thread_scheduling
+{
+    // The thread keeps the scheduling it was created with.
+    SMIDI_THREAD_SCHEDULING_DEFAULT,
+    // Realtime scheduling at thread_priority: SCHED_FIFO or SCHED_RR on Linux, time critical priority on Windows. Needs
+    // CAP_SYS_NICE or an rtprio limit on Linux.
+    SMIDI_THREAD_SCHEDULING_FIFO,
+    SMIDI_THREAD_SCHEDULING_ROUND_ROBIN,
+} smidi_thread_scheduling;
+
+#define SMIDI_DEFAULT_DEVICE_BUFFER_COUNT 4
+#define SMIDI_DEFAULT_DEVICE_BUFFER_SIZE 1024
+
+// Options applied when a device is opened. Backends use the ones that fit them: WinMM input takes buffer_count driver
+// buffers of buffer_size bytes for SysEx, rawmidi reads buffer_size bytes at a time, and the thread options apply to
+// the reader threads of rawmidi and shared memory inputs and the buffer cleanup thread of WinMM outputs. Loopback, RTP
+// MIDI and the WinMM driver callback have no thread of their own. Running status applies to rawmidi outputs.
+typedef struct smidi_device_options
+{
+    unsigned int buffer_count;
+    unsigned int buffer_size;
+    // The input queue, as with smidi_input_device_set_queue_options.
+    smidi_queue_options queue;
+    smidi_thread_scheduling thread_scheduling;
+    int thread_priority;
+    // Bit mask of the CPUs the thread may run on, zero for all of them.
+    unsigned long long cpu_affinity;
+    // Locks the input queue's slots into memory so receiving never waits for a page fault. Messages longer than a
+    // slot's reserve, i.e. SysEx, grow into memory that is not locked.
+    int lock_memory;
+    // Omit repeated channel voice status bytes on the wire, as smidi_loopback_options does for emulated wires.
+    int running_status;
+    // Maximum number of consecutive messages without a status byte before it is sent again, zero for no limit.
+    unsigned int running_status_refresh_interval;
+} smidi_device_options;
+
+typedef struct smidi_queue_statistics
+{
+    unsigned long long received;
+    unsigned long long dropped;
+    unsigned long long coalesced;
+    unsigned int size;
+    unsigned int high_water_mark;
+} smidi_queue_statistics;
+
+typedef struct smidi_loopback_options
+{
+    // Pass messages between loopback devices as a serialized MIDI 1.0 byte stream, like a DIN cable.
+    int emulate_wire;
+    // Omit repeated channel voice status bytes on the emulated wire.
+    int running_status;
+    // Maximum number of consecutive messages without a status byte before it is sent again, zero for no limit.
+    unsigned int running_status_refresh_interval;
+} smidi_loopback_options;
+
+#define SMIDI_DEFAULT_RTP_MIDI_PORT 5004
+#define SMIDI_DEFAULT_RTP_MIDI_PACKING_INTERVAL_US 1000
+
+typedef struct smidi_rtp_midi_options
+{
+    // Name announced to remote sessions, which list it as their device name.
+    const char* session_name;
+    // UDP control port, the data port is control_port + 1.
+    unsigned short control_port;
+    // Remote sessions to invite, as "host:control_port". Invitations are repeated until accepted and again whenever
+    // the remote session ends. Remote sessions may also invite this one.
+    const char* const* peers;
+    int peer_count;
+    // Messages sent within this many microseconds share one RTP packet, zero sends every message immediately.
+    unsigned int packing_interval_us;
+} smidi_rtp_midi_options;
+
+#define SMIDI_DEFAULT_SHARED_MEMORY_CAPACITY 65536
+
+typedef struct smidi_shared_memory_port_options
+{
+    // Size of the broadcast ring in bytes, a power of two. Readers that fall further behind lose messages.
+    unsigned int capacity;
+} smidi_shared_memory_port_options;
+
+#define SMIDI_DEFAULT_RAWMIDI_DEVICE_DIRECTORY "/dev/snd"
+
+typedef struct smidi_rawmidi_options
+{
+    // Directory holding the midiC*D* device nodes, watched for hotplug. Tests can point it at a scratch directory.
+    const char* device_directory;
+} smidi_rawmidi_options;
+
+typedef struct smidi_input_device smidi_input_device;
+typedef struct smidi_output_device smidi_output_device;
+typedef struct smidi_system smidi_system;
+typedef long long smidi_time_stamp;
+
+SMIDI_API const char* smidi_result_string(smidi_result result);
+// Routes the diagnostics of the C API to callback, NULL restores the default of writing them to stderr. Set it before
+// other threads call into smidi. The try functions report errors only through their result and never log.
+SMIDI_API void smidi_set_log_callback(smidi_log_callback callback, void* user_data);
+
+SMIDI_API smidi_system *smidi_create_system();
+SMIDI_API smidi_system* smidi_create_loopback_system(const char* const* port_names, int port_count);
+SMIDI_API smidi_system* smidi_create_loopback_system_with_options(const char* const* port_names, int port_count,
+                                                                  const smidi_loopback_options* options);
+SMIDI_API smidi_system* smidi_create_rtp_midi_system(const smidi_rtp_midi_options* options);
+SMIDI_API smidi_system* smidi_create_shared_memory_system();
+SMIDI_API smidi_system* smidi_create_rawmidi_system(const smidi_rawmidi_options* options);
+SMIDI_API void smidi_destroy_system(smidi_system* system);
+
+// Applies the device changes since the previous refresh to the device lists. Writes up to max_changes of them to
+// out_changes (which may be NULL) and returns the total number of changes. Open devices are not affected.
+SMIDI_API int smidi_system_refresh(smidi_system* system, smidi_device_change* out_changes, int max_changes);
+// Replaces the hotplug callback, NULL removes it. Once this returns the previous callback is no longer running. The
+// callback must not call this function.
+SMIDI_API int smidi_system_set_device_change_callback(smidi_system* system, smidi_device_change_callback callback, void* user_data);
+
+SMIDI_API int smidi_system_get_output_device_count(smidi_system* system);
+SMIDI_API int smidi_system_get_output_device_info(smidi_system* system, int device_info_index, smidi_device_info* out_device_info);
+SMIDI_API smidi_output_device* smidi_system_create_output_device(smidi_system* system, const char *device_name);
+SMIDI_API smidi_output_device* smidi_system_create_output_device_with_options(smidi_system* system, const char* device_name,
+                                                                              const smidi_device_options* options);
+SMIDI_API void smidi_destroy_output_device(smidi_output_device* output_device);
+SMIDI_API smidi_output_device* smidi_create_shared_memory_port(const char* name, const smidi_shared_memory_port_options* options);
+SMIDI_API int smidi_output_device_send_message(smidi_output_device* output_device, const void* buffer, int buffer_size);
+// Sends the whole message or nothing. Does not allocate once the device has carried a message of the same size, except
+// for SysEx on WinMM which needs a driver buffer per message.
+SMIDI_API smidi_result smidi_output_device_try_send_message(smidi_output_device* output_device, const void* buffer, int buffer_size);
+
+SMIDI_API int smidi_system_get_input_device_count(smidi_system* system);
+SMIDI_API int smidi_system_get_input_device_info(smidi_system* system, int device_info_index, smidi_device_info* out_device_info);
+SMIDI_API smidi_input_device* smidi_system_create_input_device(smidi_system* system, const char *device_name);
+SMIDI_API smidi_input_device* smidi_system_create_input_device_with_options(smidi_system* system, const char* device_name,
+                                                                            const smidi_device_options* options);
+SMIDI_API void smidi_destroy_input_device(smidi_input_device* input_device);
+SMIDI_API int smidi_input_device_recieve_message(smidi_input_device* input_device, void* buffer, int buffer_size, smidi_time_stamp* time_stamp);
+// Takes the next message without waiting for one. out_message_size (which may be NULL) receives the size of the
+// message, also when the result is SMIDI_RESULT_BUFFER_TOO_SMALL.
+SMIDI_API smidi_result smidi_input_device_try_receive_message(smidi_input_device* input_device, void* buffer, int buffer_size,
+                                                              int* out_message_size, smidi_time_stamp* time_stamp);
+SMIDI_API int smidi_input_device_set_queue_options(smidi_input_device* input_device, const smidi_queue_options* options);
+SMIDI_API int smidi_input_device_get_queue_statistics(smidi_input_device* input_device, smidi_queue_statistics* out_statistics);
+// Replaces the message callback, NULL removes it. Once this returns the previous callback is no longer running. The
+// callback must not call this function.
+SMIDI_API int smidi_input_device_set_message_callback(smidi_input_device* input_device, smidi_message_callback callback, void* user_data);
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
+
+// SMIDI C++ API
+#ifdef __cplusplus
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace smidi
+{
+    using result = smidi_result;
+    using time_stamp = smidi_time_stamp;
+    using device_info = smidi_device_info;
+    using device_change_type = smidi_device_change_type;
+    using device_change = smidi_device_change;
+    using device_change_callback = std::function<void()>;
+    using message_callback = std::function<void()>;
+    using overflow_policy = smidi_overflow_policy;
+    using queue_options = smidi_queue_options;
+    using queue_statistics = smidi_queue_statistics;
+    using thread_scheduling = smidi_thread_scheduling;
+    using device_options = smidi_device_options;
+    using loopback_options = smidi_loopback_options;
+    using rtp_midi_options = smidi_rtp_midi_options;
+    using shared_memory_port_options = smidi_shared_memory_port_options;
+    using rawmidi_options = smidi_rawmidi_options;
+
+    constexpr queue_options default_queue_options = {SMIDI_DEFAULT_QUEUE_CAPACITY, SMIDI_OVERFLOW_POLICY_DROP_OLDEST};
+    constexpr device_options default_device_options = {SMIDI_DEFAULT_DEVICE_BUFFER_COUNT, SMIDI_DEFAULT_DEVICE_BUFFER_SIZE,
+                                                       default_queue_options, SMIDI_THREAD_SCHEDULING_DEFAULT, 0, 0, 0, 0, 0};
+    constexpr rtp_midi_options default_rtp_midi_options = {"smidi", SMIDI_DEFAULT_RTP_MIDI_PORT, nullptr, 0,
+                                                           SMIDI_DEFAULT_RTP_MIDI_PACKING_INTERVAL_US};
+    constexpr shared_memory_port_options default_shared_memory_port_options = {SMIDI_DEFAULT_SHARED_MEMORY_CAPACITY};
+    constexpr rawmidi_options default_rawmidi_options = {SMIDI_DEFAULT_RAWMIDI_DEVICE_DIRECTORY};
+
+    class SMIDI_API output_device
+    {
+      public:
+        virtual ~output_device() = default;
+
+        virtual size_t send(const uint8_t* data, size_t size) = 0;
+
+        // Non-throwing send for realtime threads, the whole message is sent when the result is SMIDI_RESULT_OK.
+        virtual result try_send(const uint8_t* data, size_t size) noexcept = 0;
+    };
+
+    class SMIDI_API input_device
+    {
+      public:
+        virtual ~input_device() = default;
+
+        virtual size_t receive(uint8_t* data, size_t size, time_stamp* time_stamp) = 0;
+
+        // Non-blocking, non-throwing receive for realtime threads. message_size (which may be null) receives the size of
+        // the next message, also when the result is SMIDI_RESULT_BUFFER_TOO_SMALL and the message stays queued.
+        virtual result try_receive(uint8_t* data, size_t size, size_t* message_size, time_stamp* time_stamp) noexcept = 0;
+
+        // Messages are queued between the driver and receive, the queue holds at most options.capacity messages.
+        virtual void set_queue_options(const queue_options& options) = 0;
+        virtual queue_statistics get_queue_statistics() const = 0;
+
+        // Called from the backend thread after a message was queued and once more on disconnect, an empty function
+        // removes it. Once this returns the previous callback is no longer running, the callback must not call this
+        // function. Lets event loops and coroutines wait for messages without a blocked receive per device.
+        virtual void set_message_callback(message_callback callback) = 0;
+    };
+
+    class SMIDI_API system
+    {
+      public:
+        virtual ~system() = default;
+
+        virtual const std::vector<device_info>& output_devices() const noexcept = 0;
+        virtual std::unique_ptr<output_device> create_output_device(const std::string& name,
+                                                                    const device_options& options = default_device_options) = 0;
+
+        virtual const std::vector<device_info>& input_devices() const noexcept = 0;
+        virtual std::unique_ptr<input_device> create_input_device(const std::string& name,
+                                                                  const device_options& options = default_device_options) = 0;
+
+        // Device lists only change here. Applies the changes since the previous refresh and returns them, open devices
+        // keep running and devices that were unplugged stop delivering messages.
+        virtual std::vector<device_change> refresh() = 0;
+
+        // Called from a backend thread when refresh() has changes to apply, an empty function removes it. Once this
+        // returns the previous callback is no longer running, the callback must not call this function.
+        virtual void set_device_change_callback(device_change_callback callback) = 0;
+    };
+
+    SMIDI_API std::unique_ptr<system> create_system();
+
+    // In-process system where every port is both an output and an input device. Messages sent to an output port are
+    // delivered to every input device opened on the port with the same name.
+    SMIDI_API std::unique_ptr<system> create_loopback_system(const std::vector<std::string>& port_names);
+    SMIDI_API std::unique_ptr<system> create_loopback_system(const std::vector<std::string>& port_names, const loopback_options& options);
+
+    // RTP-MIDI (AppleMIDI) network session. Every connected remote session is both an output and an input device named
+    // after the remote session. Sessions connecting and disconnecting are reported through the device change callback.
+    // Not available on Windows.
+    SMIDI_API std::unique_ptr<system> create_rtp_midi_system(const rtp_midi_options& options);
+
+    // Publishes a port to other processes on this host through shared memory. Every message sent to the returned device
+    // is broadcast to all readers without blocking on them, e.g. a process owning a hardware input device forwards what
+    // it receives so other processes can share the controller. Only processes of the publishing user can open the
+    // port, readers map it writable. Linux only.
+    SMIDI_API std::unique_ptr<output_device> create_shared_memory_port(
+        const std::string& name, const shared_memory_port_options& options = default_shared_memory_port_options);
+
+    // Lists the shared memory ports published by processes of this user as input devices. Ports come and go with their
+    // publishers, which is reported through the device change callback. Linux only.
+    SMIDI_API std::unique_ptr<system> create_shared_memory_system();
+
+    // ALSA rawmidi device nodes, the native backend of create_system() on Linux. Nodes appearing or disappearing in the
+    // device directory are picked up through inotify without rescanning the directory. Linux only.
+    SMIDI_API std::unique_ptr<system> create_rawmidi_system(const rawmidi_options& options = default_rawmidi_options);
+} // namespace smidi
+
+#endif // __cplusplus
+
+#endif // SMIDI_H
@@ -0,0 +1,164 @@
+#ifndef SMIDI_STATIC_H
+#define SMIDI_STATIC_H
+
+#include "smidi/smidi.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// The concrete device types of the loopback and rawmidi backends. They are final, so sends and receives through them are
+// direct calls the compiler can inline, with link time optimization also across the library boundary, where calls
+// through smidi::output_device and smidi::input_device always go through the vtable.
+//
+// The input devices answer try_receive on an empty queue inline, the common case of a realtime thread polling for input,
+// only a queued message takes the call into the library.
+//
+// Configuring with SMIDI_STATIC_BACKEND set to loopback or rawmidi defines smidi::static_backend as that backend's
+// namespace and builds with link time optimization, so embedded applications written against smidi::static_backend
+// name the one backend they ship with in one place.
+
+namespace smidi
+{
+    class message_queue;
+    class byte_stream_parser;
+    class running_status_encoder;
+
+    namespace loopback
+    {
+        class port;
+        class listener;
+
+        class SMIDI_API output_device final : public smidi::output_device
+        {
+          public:
+            output_device(std::shared_ptr<port> port);
+
+            size_t send(const uint8_t* data, size_t size) override;
+            result try_send(const uint8_t* data, size_t size) noexcept override;
+
+          private:
+            std::shared_ptr<port> _port;
+        };
+
+        class SMIDI_API input_device final : public smidi::input_device
+        {
+          public:
+            input_device(std::shared_ptr<port> port, const device_options& options);
+            virtual ~input_device();
+
+            size_t receive(uint8_t* data, size_t size, time_stamp* time_stamp) override;
+            result try_receive(uint8_t* data, size_t size, size_t* message_size, time_stamp* time_stamp) noexcept override
+            {
+                if (_ready->load(std::memory_order_acquire) == 0)
+                {
+                    return SMIDI_RESULT_NO_MESSAGE;
+                }
+                return try_receive_queued(data, size, message_size, time_stamp);
+            }
+            void set_queue_options(const queue_options& options) override;
+            queue_statistics get_queue_statistics() const override;
+            void set_message_callback(message_callback callback) override;
+
+          private:
+            result try_receive_queued(uint8_t* data, size_t size, size_t* message_size, time_stamp* time_stamp) noexcept;
+
+            std::shared_ptr<port> _port;
+            // Shared with the port, a send that is still pushing to the queue keeps it alive after the device is gone.
+            std::shared_ptr<listener> _listener;
+            // The ready flag of the listener's queue.
+            const std::atomic<uint32_t>* _ready = nullptr;
+        };
+
+        // Open a device of a system returned by create_loopback_system as its concrete type. Throws
+        // std::invalid_argument for systems of other backends.
+        SMIDI_API std::unique_ptr<output_device> create_output_device(smidi::system& system, const std::string& name,
+                                                                      const device_options& options = default_device_options);
+        SMIDI_API std::unique_ptr<input_device> create_input_device(smidi::system& system, const std::string& name,
+                                                                    const device_options& options = default_device_options);
+    } // namespace loopback
+
+#if defined(__linux__)
+    namespace rawmidi
+    {
+        class SMIDI_API output_device final : public smidi::output_device
+        {
+          public:
+            output_device(const std::string& path, const device_options& options);
+            virtual ~output_device();
+
+            size_t send(const uint8_t* data, size_t size) override;
+            result try_send(const uint8_t* data, size_t size) noexcept override;
+
+          private:
+            // Returns zero or the errno of the failed write.
+            int write_message(const uint8_t* data, size_t size) noexcept;
+            int write_all(const uint8_t* data, size_t size) noexcept;
+
+            int _fd = -1;
+
+            // Set with the running_status option, the encoder state and wire buffer are shared by all senders.
+            std::unique_ptr<running_status_encoder> _encoder;
+            std::vector<uint8_t> _wire;
+            std::mutex _mutex;
+        };
+
+        // A reader thread parses the node's byte stream into messages. It stops when the device is unplugged, after
+        // which receive throws and try_receive returns SMIDI_RESULT_DISCONNECTED once the queued messages are taken.
+        class SMIDI_API input_device final : public smidi::input_device
+        {
+          public:
+            input_device(const std::string& path, const device_options& options);
+            virtual ~input_device();
+
+            size_t receive(uint8_t* data, size_t size, time_stamp* time_stamp) override;
+            result try_receive(uint8_t* data, size_t size, size_t* message_size, time_stamp* time_stamp) noexcept override
+            {
+                if (_ready->load(std::memory_order_acquire) == 0)
+                {
+                    return SMIDI_RESULT_NO_MESSAGE;
+                }
+                return try_receive_queued(data, size, message_size, time_stamp);
+            }
+            void set_queue_options(const queue_options& options) override;
+            queue_statistics get_queue_statistics() const override;
+            void set_message_callback(message_callback callback) override;
+
+          private:
+            result try_receive_queued(uint8_t* data, size_t size, size_t* message_size, time_stamp* time_stamp) noexcept;
+
+            void stop();
+            void run();
+
+            int _fd = -1;
+            int _wake_fd = -1;
+            std::chrono::steady_clock::time_point _start_time;
+            std::vector<uint8_t> _buffer;
+            std::unique_ptr<byte_stream_parser> _parser;
+            std::unique_ptr<message_queue> _messages;
+            // The ready flag of _messages.
+            const std::atomic<uint32_t>* _ready = nullptr;
+            std::thread _thread;
+        };
+
+        // Open a device of a system returned by create_rawmidi_system as its concrete type. Throws
+        // std::invalid_argument for systems of other backends.
+        SMIDI_API std::unique_ptr<output_device> create_output_device(smidi::system& system, const std::string& name,
+                                                                      const device_options& options = default_device_options);
+        SMIDI_API std::unique_ptr<input_device> create_input_device(smidi::system& system, const std::string& name,
+                                                                    const device_options& options = default_device_options);
+    } // namespace rawmidi
+#endif
+
+#if defined(SMIDI_STATIC_BACKEND_LOOPBACK)
+    namespace static_backend = loopback;
+#elif defined(SMIDI_STATIC_BACKEND_RAWMIDI)
+    namespace static_backend = rawmidi;
+#endif
+} // namespace smidi
+
+#endif // SMIDI_STATIC_H
@@ -0,0 +1,261 @@
+#ifndef SMIDI_CAPTURE_H
+#define SMIDI_CAPTURE_H
+
+#include "smidi/smidi.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace smidi
+{
+    // Capture logs are a file header followed by blocks and a block index. A block holds the events of about
+    // block_size bytes, each as a varint time delta in nanoseconds, a varint port and a varint size followed by the
+    // raw message, compressed as a whole. The index at the end of the file lists the offset, first time and event
+    // count of every block, a log without one (the capture did not finish) is read up to its last complete block.
+
+    struct capture_options
+    {
+        // Encoded events are collected up to this size before the block is compressed and written.
+        size_t block_size = 64 * 1024;
+        bool compress = true;
+        // Full blocks waiting for the writer thread. Once they are all waiting, write() and receive() wait for the
+        // writer and try_receive() drops the event.
+        size_t pending_blocks = 4;
+    };
+
+    struct capture_statistics
+    {
+        uint64_t events;
+        uint64_t blocks;
+        // Encoded event bytes before compression, and bytes written to the file.
+        uint64_t encoded_bytes;
+        uint64_t file_bytes;
+        // Events that are not in the log: blocks that failed to write, e.g. because the disk is full, and events
+        // try_receive found no free block for. The messages were still received.
+        uint64_t dropped;
+    };
+
+    // Logs messages with their port and arrival time. Encoding an event is a few varints and a copy into the open
+    // block, full blocks are handed to a writer thread that compresses and writes them, so receiving threads never
+    // wait for the disk. Times are logged relative to the first event and never go back, events logged from several
+    // threads are in the order they took the lock.
+    class capture_writer
+    {
+      public:
+        using clock = std::chrono::steady_clock;
+
+        // Throws std::runtime_error if the file cannot be created.
+        capture_writer(const std::string& path, const capture_options& options = capture_options());
+        // Finishes the log, errors are lost, call close() to see them.
+        ~capture_writer();
+
+        capture_writer(const capture_writer&) = delete;
+        capture_writer& operator=(const capture_writer&) = delete;
+
+        void write(uint32_t port, clock::time_point time, const uint8_t* data, size_t size);
+
+        // Receive from device and log the message as arriving on port now.
+        size_t receive(input_device& device, uint32_t port, uint8_t* data, size_t size, time_stamp* time_stamp);
+        result try_receive(input_device& device, uint32_t port, uint8_t* data, size_t size, size_t* message_size,
+                           time_stamp* time_stamp) noexcept;
+
+        // Writes the open block and waits for the writer, so the log is readable up to here even if the process dies.
+        // Throws std::runtime_error if a block failed to write since the log was opened.
+        void flush();
+        // Writes the open block and the index and closes the file. Nothing can be logged after. Throws like flush().
+        void close();
+
+        capture_statistics statistics() const;
+
+      private:
+        struct pending_block
+        {
+            std::vector<uint8_t> data;
+            uint64_t first_time;
+            uint32_t events;
+        };
+
+        // Returns false if the event was not logged because every block is waiting for the writer and wait is false.
+        bool write_event(std::unique_lock<std::mutex>& lock, bool wait, uint32_t port, clock::time_point time, const uint8_t* data,
+                         size_t size);
+        bool queue_block(std::unique_lock<std::mutex>& lock, bool wait);
+        void wait_for_writer(std::unique_lock<std::mutex>& lock);
+        void stop_writer();
+        void run();
+        void write_block(const pending_block& block);
+        void write_bytes(const void* data, size_t size);
+
+        capture_options _options;
+        std::FILE* _file = nullptr;
+
+        bool _started = false;
+        clock::time_point _start_time;
+        uint64_t _last_time = 0;
+
+        std::vector<uint8_t> _block;
+        uint64_t _block_first_time = 0;
+        uint32_t _block_events = 0;
+
+        // A ring of full blocks, their buffers are swapped with the open block so none is allocated once all were used.
+        std::vector<pending_block> _pending;
+        size_t _pending_first = 0;
+        size_t _pending_count = 0;
+        bool _write_failed = false;
+        bool _stopping = false;
+
+        // Only the writer thread uses these while blocks are pending, and close() once none are.
+        uint64_t _file_offset = 0;
+        std::vector<uint8_t> _compressed;
+        std::vector<uint32_t> _hash_table;
+
+        struct index_entry
+        {
+            uint64_t offset;
+            uint64_t first_time;
+            uint32_t events;
+        };
+        std::vector<index_entry> _index;
+
+        capture_statistics _statistics = {};
+        mutable std::mutex _mutex;
+        std::condition_variable _cv;
+        std::thread _thread;
+    };
+
+    struct capture_event
+    {
+        uint32_t port;
+        // Since the first event of the log.
+        std::chrono::nanoseconds time;
+        // Valid until the reader moves to the next block.
+        const uint8_t* data;
+        size_t size;
+    };
+
+    // Reads a capture log in place, from memory or from a file it maps. Throws std::runtime_error for logs that are
+    // not capture logs or whose blocks do not decode.
+    class capture_reader
+    {
+      public:
+        capture_reader(const uint8_t* data, size_t size);
+        explicit capture_reader(const std::string& path);
+        ~capture_reader();
+
+        capture_reader(const capture_reader&) = delete;
+        capture_reader& operator=(const capture_reader&) = delete;
+
+        size_t block_count() const noexcept;
+        uint64_t event_count() const noexcept;
+        // Whether the log ends with its index, false for the logs of captures that did not finish.
+        bool complete() const noexcept;
+
+        // Returns false after the last event.
+        bool next(capture_event& event);
+        // Moves to the first event at or after time, using the block index.
+        void seek(std::chrono::nanoseconds time);
+        void rewind() noexcept;
+
+      private:
+        struct mapping;
+        struct block_entry
+        {
+            uint64_t offset;
+            uint64_t first_time;
+            uint32_t events;
+        };
+
+        void open(const uint8_t* data, size_t size);
+        void load_block(size_t block_idx);
+
+        std::unique_ptr<mapping> _mapping;
+        const uint8_t* _data = nullptr;
+        size_t _size = 0;
+        std::vector<block_entry> _blocks;
+        uint64_t _event_count = 0;
+        bool _complete = false;
+
+        // The block being read, the next one to load, and the position in the decoded events.
+        size_t _next_block = 0;
+        const uint8_t* _events = nullptr;
+        size_t _events_size = 0;
+        size_t _position = 0;
+        uint64_t _time = 0;
+        std::vector<uint8_t> _decoded;
+    };
+
+    struct replay_options
+    {
+        // 1 replays in real time, 2 twice as fast, 0 as fast as possible.
+        double speed = 1.0;
+    };
+
+    struct replay_statistics
+    {
+        uint64_t events;
+        // Events for ports without an output device.
+        uint64_t skipped;
+        // Events an output device did not take for reasons other than a full queue, they are not sent again.
+        uint64_t failed;
+        // Sends that found a receiving queue full (SMIDI_RESULT_WOULD_BLOCK). The event is sent again on the next pump.
+        uint64_t blocked;
+        // Messages sent after they were due because pump was called late, with the largest delay seen.
+        uint64_t late;
+        std::chrono::nanoseconds max_lateness;
+    };
+
+    // Sends the events of a capture log to output devices, outputs[port] for the events of each port. Every message is
+    // sent exactly as logged and in log order, event n is due at the start time plus its log time divided by the
+    // speed, computed from the start each time so late pumps do not add up. An event whose receiving queue is full
+    // holds up the replay until it was sent, pump() returns blocked_retry_interval from now to try again.
+    //
+    // pump() must be called again at the time it returns.
+    class capture_replayer
+    {
+      public:
+        using clock = std::chrono::steady_clock;
+
+        static constexpr std::chrono::microseconds blocked_retry_interval = std::chrono::microseconds(100);
+
+        capture_replayer(capture_reader& reader, const std::vector<output_device*>& outputs,
+                         const replay_options& options = replay_options());
+
+        // Replays from the reader's position, its next event is due at time.
+        void start(clock::time_point time);
+        // Sends what is due at now and returns when the next message is, clock::time_point::max() when done.
+        clock::time_point pump(clock::time_point now);
+        bool finished() const noexcept;
+
+        replay_statistics statistics() const noexcept;
+
+      private:
+        clock::time_point due_time() const;
+
+        capture_reader& _reader;
+        std::vector<output_device*> _outputs;
+        replay_options _options;
+
+        bool _pending = false;
+        // The pending event was due and found its queue full, it is not late again when retried.
+        bool _blocked = false;
+        capture_event _event = {0, std::chrono::nanoseconds(0), nullptr, 0};
+        bool _started = false;
+        clock::time_point _start_time;
+        std::chrono::nanoseconds _first_time;
+
+        replay_statistics _statistics = {0, 0, 0, 0, 0, std::chrono::nanoseconds(0)};
+    };
+
+    // Replays the reader's events from its position to the end, sleeping until each is due.
+    replay_statistics replay_capture(capture_reader& reader, const std::vector<output_device*>& outputs,
+                                     const replay_options& options = replay_options());
+} // namespace smidi
+
+#endif // SMIDI_CAPTURE_H
@@ -0,0 +1,165 @@
+#ifndef SMIDI_CLOCK_H
+#define SMIDI_CLOCK_H
+
+#include "smidi/smidi.h"
+
+#include <chrono>
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace smidi
+{
+    constexpr uint32_t midi_clocks_per_quarter_note = 24;
+    // A song position pointer counts sixteenth notes.
+    constexpr uint32_t midi_clocks_per_song_position = 6;
+
+    struct clock_master_options
+    {
+        double tempo = 120.0;
+    };
+
+    struct clock_master_statistics
+    {
+        uint64_t clocks;
+        uint64_t failed;
+        // Clocks sent after their deadline because pump was called late, with the largest delay seen.
+        uint64_t late;
+        std::chrono::nanoseconds max_lateness;
+    };
+
+    // Sends timing clock and transport messages to an output device. Clock n is due at the tempo anchor plus n clock
+    // intervals, computed from the anchor each time, so neither rounding nor late wake-ups add up: a late pump sends
+    // the overdue clocks at once and the next one is still due on the grid. Tempo changes move the anchor to the next
+    // clock.
+    //
+    // pump() must be called again at the time it returns.
+    class clock_master
+    {
+      public:
+        using clock = std::chrono::steady_clock;
+
+        clock_master(output_device& output, const clock_master_options& options = clock_master_options());
+
+        void set_tempo(double tempo);
+        double tempo() const;
+
+        // Sends start at time followed by the first clock, from song position zero.
+        void start(clock::time_point time);
+        // Sends continue at time and carries on from the current song position.
+        void resume(clock::time_point time);
+        // Sends stop right away.
+        void stop();
+        bool running() const;
+
+        // Sends a song position pointer right away, only while stopped.
+        void set_song_position(uint16_t sixteenths);
+        // Clocks since song position zero.
+        uint64_t position() const;
+
+        // Sends what is due at now and returns when the next message is, clock::time_point::max() while stopped.
+        clock::time_point pump(clock::time_point now);
+
+        clock_master_statistics statistics() const;
+
+      private:
+        clock::time_point deadline(uint64_t clock_idx) const;
+        void begin(clock::time_point time, uint8_t status);
+        void send(const uint8_t* data, size_t size);
+
+        output_device& _output;
+        double _ns_per_clock;
+
+        bool _running = false;
+        // Start or continue waiting for the first clock, zero if none.
+        uint8_t _transport = 0;
+        uint64_t _next_clock = 0;
+        uint64_t _anchor_clock = 0;
+        clock::time_point _anchor_time;
+
+        clock_master_statistics _statistics = {0, 0, 0, std::chrono::nanoseconds(0)};
+        mutable std::mutex _mutex;
+    };
+
+    struct clock_follower_options
+    {
+        // Gains of the alpha-beta loop filter: the share of every timing error that corrects the phase and the clock
+        // interval. A frequency gain near phase_gain^2 / 2 settles without overshoot, smaller gains follow tempo
+        // changes slower and average out more jitter. Right after the filter starts it uses the larger gains of a least
+        // squares fit through the clocks so far, so the first interval does not have to be close.
+        double phase_gain = 0.1;
+        double frequency_gain = 0.005;
+        // Clocks after the first before tempo and phase are reported as locked.
+        uint32_t lock_clocks = 48;
+        // A gap this long means the clock stopped, the filter starts over with the next clock. So do start and stop.
+        std::chrono::milliseconds timeout = std::chrono::milliseconds(500);
+    };
+
+    struct clock_follower_statistics
+    {
+        uint64_t clocks;
+        // Clocks inferred from gaps of whole clock intervals.
+        uint64_t missed;
+        // Deviation of the clocks from the filter's prediction since it locked.
+        std::chrono::nanoseconds jitter_rms;
+        std::chrono::nanoseconds jitter_max;
+    };
+
+    // Follows an external timing clock. The time of every clock is compared against the filter's prediction and the
+    // error corrects phase and clock interval by a fraction, so the estimates settle on the average tempo while
+    // single clocks arriving early or late barely move them. Start, continue, stop and song position pointers drive
+    // the transport and position.
+    //
+    // Device time stamps are milliseconds, which is coarse for clocks 20ms apart at 120 BPM: the filter averages the
+    // quantization out, or messages can be timed on arrival, e.g. from a message callback.
+    class clock_follower
+    {
+      public:
+        using clock = std::chrono::steady_clock;
+
+        explicit clock_follower(const clock_follower_options& options = clock_follower_options());
+
+        // Ignores everything but system real time messages and song position pointers.
+        void process(const uint8_t* data, size_t size, clock::time_point time);
+        void reset();
+
+        bool locked() const;
+        bool running() const;
+        // Zero until two clocks were received.
+        double tempo() const;
+        // Song position in quarter notes at time, interpolated from the last clock.
+        double beat_position(clock::time_point time) const;
+        // Clocks since song position zero.
+        uint64_t position() const;
+
+        clock_follower_statistics statistics() const;
+
+      private:
+        void restart_filter();
+        void process_clock(clock::time_point time);
+
+        clock_follower_options _options;
+
+        bool _running = false;
+        uint64_t _position = 0;
+        // Position of the last clock, the one at _phase_time.
+        uint64_t _clock_position = 0;
+
+        uint64_t _filtered_clocks = 0;
+        // Clocks since the last filtered one that the filter left out.
+        uint64_t _skipped_clocks = 0;
+        // Time stamp of the last clock as received, _phase_time is the filtered one.
+        clock::time_point _last_clock_time;
+        clock::time_point _phase_time;
+        double _ns_per_clock = 0.0;
+        uint32_t _suspect_clocks = 0;
+        uint64_t _suspect_missed = 0;
+
+        clock_follower_statistics _statistics = {0, 0, std::chrono::nanoseconds(0), std::chrono::nanoseconds(0)};
+        double _squared_error_sum = 0.0;
+        uint64_t _error_count = 0;
+        mutable std::mutex _mutex;
+    };
+} // namespace smidi
+
+#endif // SMIDI_CLOCK_H
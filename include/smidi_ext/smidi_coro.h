@@ -0,0 +1,408 @@
+#ifndef SMIDI_CORO_H
+#define SMIDI_CORO_H
+
+// C++20 coroutine layer over input_device::set_message_callback and the non-blocking try_send/try_receive. Header
+// only, so the library itself keeps building as C++17.
+
+#include "smidi/smidi.h"
+
+#if !defined(__cpp_impl_coroutine)
+#error "smidi_coro.h requires C++20 coroutines."
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <queue>
+#include <stddef.h>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+namespace smidi
+{
+    namespace coro
+    {
+        using clock = std::chrono::steady_clock;
+
+        // Resumes suspended coroutines. post is called from any thread, including the backend threads that deliver
+        // messages: an executor that resumes the handle inline runs the coroutine on the backend's own wakeup.
+        class executor
+        {
+          public:
+            virtual ~executor() = default;
+
+            virtual void post(std::coroutine_handle<> handle) = 0;
+            virtual void post_at(clock::time_point time, std::coroutine_handle<> handle) = 0;
+        };
+
+        // Worker threads sharing one ready queue and one timer queue. Coroutines still suspended on the pool when it is
+        // destroyed are never resumed.
+        class thread_pool final : public executor
+        {
+          public:
+            explicit thread_pool(size_t thread_count = std::thread::hardware_concurrency())
+            {
+                for (size_t thread_idx = 0; thread_idx < std::max<size_t>(thread_count, 1); thread_idx++)
+                {
+                    _threads.emplace_back([this]() { run(); });
+                }
+            }
+
+            ~thread_pool() override
+            {
+                {
+                    std::lock_guard<decltype(_mutex)> lock(_mutex);
+                    _stopping = true;
+                }
+                _cv.notify_all();
+
+                for (std::thread& thread : _threads)
+                {
+                    thread.join();
+                }
+            }
+
+            thread_pool(const thread_pool&) = delete;
+            thread_pool& operator=(const thread_pool&) = delete;
+
+            void post(std::coroutine_handle<> handle) override
+            {
+                {
+                    std::lock_guard<decltype(_mutex)> lock(_mutex);
+                    _ready.push_back(handle);
+                }
+                _cv.notify_one();
+            }
+
+            void post_at(clock::time_point time, std::coroutine_handle<> handle) override
+            {
+                {
+                    std::lock_guard<decltype(_mutex)> lock(_mutex);
+                    _timers.push(timer{time, _timer_sequence++, handle});
+                }
+                _cv.notify_one();
+            }
+
+          private:
+            struct timer
+            {
+                clock::time_point time;
+                uint64_t sequence;
+                std::coroutine_handle<> handle;
+
+                // Reversed so the priority queue yields the earliest timer, ties in posting order.
+                bool operator<(const timer& other) const noexcept
+                {
+                    return time != other.time ? time > other.time : sequence > other.sequence;
+                }
+            };
+
+            void run()
+            {
+                std::unique_lock<decltype(_mutex)> lock(_mutex);
+                while (!_stopping)
+                {
+                    clock::time_point now = clock::now();
+                    while (!_timers.empty() && _timers.top().time <= now)
+                    {
+                        _ready.push_back(_timers.top().handle);
+                        _timers.pop();
+                    }
+
+                    if (!_ready.empty())
+                    {
+                        std::coroutine_handle<> handle = _ready.front();
+                        _ready.pop_front();
+                        if (!_ready.empty())
+                        {
+                            _cv.notify_one();
+                        }
+
+                        lock.unlock();
+                        handle.resume();
+                        lock.lock();
+                    }
+                    else if (_timers.empty())
+                    {
+                        _cv.wait(lock);
+                    }
+                    else
+                    {
+                        _cv.wait_until(lock, _timers.top().time);
+                    }
+                }
+            }
+
+            std::mutex _mutex;
+            std::condition_variable _cv;
+            bool _stopping = false;
+            std::deque<std::coroutine_handle<>> _ready;
+            std::priority_queue<timer> _timers;
+            uint64_t _timer_sequence = 0;
+            std::vector<std::thread> _threads;
+        };
+
+        // Fire-and-forget coroutine. It runs on the calling thread until its first suspension and frees itself when it
+        // returns, exceptions escaping it terminate the program.
+        class task
+        {
+          public:
+            struct promise_type
+            {
+                task get_return_object() noexcept
+                {
+                    return task();
+                }
+
+                std::suspend_never initial_suspend() noexcept
+                {
+                    return {};
+                }
+
+                std::suspend_never final_suspend() noexcept
+                {
+                    return {};
+                }
+
+                void return_void() noexcept
+                {
+                }
+
+                void unhandled_exception() noexcept
+                {
+                    std::terminate();
+                }
+            };
+        };
+
+        class schedule_awaiter
+        {
+          public:
+            schedule_awaiter(executor& executor, clock::time_point time) noexcept
+                : _executor(executor)
+                , _time(time)
+            {
+            }
+
+            bool await_ready() const noexcept
+            {
+                return false;
+            }
+
+            void await_suspend(std::coroutine_handle<> handle)
+            {
+                if (_time == clock::time_point::min())
+                {
+                    _executor.post(handle);
+                }
+                else
+                {
+                    _executor.post_at(_time, handle);
+                }
+            }
+
+            void await_resume() const noexcept
+            {
+            }
+
+          private:
+            executor& _executor;
+            clock::time_point _time;
+        };
+
+        // co_await schedule(executor) continues the coroutine on the executor, schedule_at also waits until time.
+        inline schedule_awaiter schedule(executor& executor) noexcept
+        {
+            return schedule_awaiter(executor, clock::time_point::min());
+        }
+
+        inline schedule_awaiter schedule_at(executor& executor, clock::time_point time) noexcept
+        {
+            return schedule_awaiter(executor, time);
+        }
+
+        // Awaitable receive. Owns the message callback of the device for its lifetime, and at most one async_receive
+        // may be pending at a time. Destroying it while a receive is pending leaves that coroutine suspended.
+        class async_input_device
+        {
+          public:
+            class receive_awaiter
+            {
+              public:
+                receive_awaiter(async_input_device& owner, uint8_t* data, size_t size, size_t* message_size,
+                                time_stamp* time_stamp) noexcept
+                    : _owner(owner)
+                    , _data(data)
+                    , _size(size)
+                    , _message_size(message_size)
+                    , _time_stamp(time_stamp)
+                {
+                }
+
+                bool await_ready() noexcept
+                {
+                    return try_receive();
+                }
+
+                bool await_suspend(std::coroutine_handle<> handle) noexcept
+                {
+                    std::lock_guard<decltype(_owner._mutex)> lock(_owner._mutex);
+
+                    // A message queued since await_ready found no waiter to hand it to.
+                    if (try_receive())
+                    {
+                        return false;
+                    }
+
+                    _handle = handle;
+                    _owner._waiter = this;
+                    return true;
+                }
+
+                result await_resume() const noexcept
+                {
+                    return _result;
+                }
+
+              private:
+                friend class async_input_device;
+
+                bool try_receive() noexcept
+                {
+                    _result = _owner._device.try_receive(_data, _size, _message_size, _time_stamp);
+                    return _result != SMIDI_RESULT_NO_MESSAGE;
+                }
+
+                async_input_device& _owner;
+                uint8_t* _data;
+                size_t _size;
+                size_t* _message_size;
+                time_stamp* _time_stamp;
+                result _result = SMIDI_RESULT_NO_MESSAGE;
+                std::coroutine_handle<> _handle;
+            };
+
+            async_input_device(input_device& device, executor& executor)
+                : _device(device)
+                , _executor(executor)
+            {
+                _device.set_message_callback([this]() { on_message(); });
+            }
+
+            ~async_input_device()
+            {
+                _device.set_message_callback(nullptr);
+            }
+
+            async_input_device(const async_input_device&) = delete;
+            async_input_device& operator=(const async_input_device&) = delete;
+
+            // Completes like input_device::try_receive but never with SMIDI_RESULT_NO_MESSAGE. Completes inline if a
+            // message is queued, otherwise the coroutine is resumed on the executor once one arrives or the device disconnects.
+            receive_awaiter async_receive(uint8_t* data, size_t size, size_t* message_size = nullptr,
+                                          time_stamp* time_stamp = nullptr) noexcept
+            {
+                return receive_awaiter(*this, data, size, message_size, time_stamp);
+            }
+
+          private:
+            // Runs on the backend thread, the message is taken there so only a completed receive is posted.
+            void on_message()
+            {
+                std::coroutine_handle<> handle;
+                {
+                    std::lock_guard<decltype(_mutex)> lock(_mutex);
+                    if (_waiter == nullptr || !_waiter->try_receive())
+                    {
+                        return;
+                    }
+
+                    handle = _waiter->_handle;
+                    _waiter = nullptr;
+                }
+                _executor.post(handle);
+            }
+
+            input_device& _device;
+            executor& _executor;
+
+            std::mutex _mutex;
+            receive_awaiter* _waiter = nullptr;
+        };
+
+        // Awaitable timed send, the coroutine sleeps on the executor's timers instead of a thread.
+        class async_output_device
+        {
+          public:
+            class send_awaiter
+            {
+              public:
+                send_awaiter(async_output_device& owner, const uint8_t* data, size_t size, clock::time_point time) noexcept
+                    : _owner(owner)
+                    , _data(data)
+                    , _size(size)
+                    , _time(time)
+                {
+                }
+
+                bool await_ready() noexcept
+                {
+                    if (_time > clock::now())
+                    {
+                        return false;
+                    }
+
+                    _result = _owner._device.try_send(_data, _size);
+                    _sent = true;
+                    return true;
+                }
+
+                void await_suspend(std::coroutine_handle<> handle)
+                {
+                    _owner._executor.post_at(_time, handle);
+                }
+
+                result await_resume() noexcept
+                {
+                    if (!_sent)
+                    {
+                        _result = _owner._device.try_send(_data, _size);
+                    }
+                    return _result;
+                }
+
+              private:
+                async_output_device& _owner;
+                const uint8_t* _data;
+                size_t _size;
+                clock::time_point _time;
+                result _result = SMIDI_RESULT_OK;
+                bool _sent = false;
+            };
+
+            async_output_device(output_device& device, executor& executor) noexcept
+                : _device(device)
+                , _executor(executor)
+            {
+            }
+
+            // Sends at time, or right away if it has passed, and completes with the result of output_device::try_send.
+            // data must stay valid until the send completed.
+            send_awaiter async_send_at(const uint8_t* data, size_t size, clock::time_point time) noexcept
+            {
+                return send_awaiter(*this, data, size, time);
+            }
+
+          private:
+            output_device& _device;
+            executor& _executor;
+        };
+    } // namespace coro
+} // namespace smidi
+
+#endif // SMIDI_CORO_H
@@ -0,0 +1,103 @@
+#ifndef SMIDI_DEJITTER_H
+#define SMIDI_DEJITTER_H
+
+#include "smidi/smidi.h"
+
+#include <chrono>
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace smidi
+{
+    struct input_dejitter_options
+    {
+        // Unit of the device time stamps, milliseconds for every backend.
+        std::chrono::nanoseconds time_stamp_unit = std::chrono::milliseconds(1);
+        // Smallest spacing per byte of the previous message, the byte time of a 5-pin DIN link. Events sharing a time
+        // stamp are spread this far apart, zero keeps them together.
+        std::chrono::nanoseconds byte_time = std::chrono::microseconds(320);
+        // Number of events the model averages over, older events weigh less and less.
+        uint32_t window = 512;
+        // Standard deviation the time stamps in the window must reach before the device clock drift is estimated.
+        std::chrono::nanoseconds drift_span = std::chrono::seconds(1);
+        // Arrivals further off the model do not update it, a run of 16 of them starts the model over.
+        std::chrono::nanoseconds outlier_threshold = std::chrono::milliseconds(20);
+    };
+
+    struct input_dejitter_statistics
+    {
+        uint64_t events;
+        // Events moved later to keep the byte time spacing after the previous one, mostly bursts sharing a time stamp.
+        uint64_t spread;
+        // Arrivals too far off the model to update it, e.g. after the receiving thread stalled.
+        uint64_t outliers;
+        // The model starts over when time stamps go back or arrivals stay off the model.
+        uint64_t resets;
+        // Drift of the device clock against the host clock, positive when the device clock runs slow.
+        double drift_ppm;
+        // Deviation of the arrivals from the model, the jitter that is removed.
+        std::chrono::nanoseconds arrival_jitter_rms;
+    };
+
+    // Turns the device time stamps of an input into smooth host clock times. Device time stamps are coarse and USB
+    // devices deliver bursts of events with the same one, arrival times have the scheduling jitter of the receiving
+    // thread. A running least squares fit of arrival time against time stamp maps every time stamp onto the host clock,
+    // following the drift between the two clocks, and events following closer than the byte time allows are spread to
+    // it, so corrected times never go back.
+    //
+    // Corrected times carry the average delivery latency of the input instead of its jitter, and are as fine as the
+    // time stamps plus the spreading of bursts.
+    class input_dejitter
+    {
+      public:
+        using clock = std::chrono::steady_clock;
+
+        explicit input_dejitter(const input_dejitter_options& options = input_dejitter_options());
+
+        // Corrected time of a message of size bytes time stamped time_stamp by the device that arrived at arrival.
+        clock::time_point process(time_stamp time_stamp, clock::time_point arrival, size_t size);
+        void reset();
+
+        // Receive from device with the arrival time taken on return and the corrected time in time. Accurate as long as
+        // messages are received as they arrive, from a thread blocked in receive or from the message callback.
+        size_t receive(input_device& device, uint8_t* data, size_t size, clock::time_point* time);
+        result try_receive(input_device& device, uint8_t* data, size_t size, size_t* message_size, clock::time_point* time) noexcept;
+
+        input_dejitter_statistics statistics() const;
+
+      private:
+        clock::time_point correct(time_stamp time_stamp, clock::time_point arrival, size_t size) noexcept;
+        void restart(time_stamp time_stamp, clock::time_point arrival) noexcept;
+        double predict(double elapsed_ns) const noexcept;
+        double drift() const noexcept;
+
+        input_dejitter_options _options;
+        double _decay;
+
+        bool _started = false;
+        time_stamp _origin_stamp = 0;
+        time_stamp _last_stamp = 0;
+        clock::time_point _origin_arrival;
+        uint32_t _outlier_run = 0;
+
+        // Exponentially weighted least squares fit of the arrival offset from the nominal device clock (arrival minus
+        // elapsed time stamp time) against elapsed time stamp time, both in nanoseconds since the origin. Means and sums
+        // of weighted deviation products are updated in place, which stays accurate for long runs.
+        double _weight = 0.0;
+        double _mean_elapsed = 0.0;
+        double _mean_offset = 0.0;
+        double _elapsed_square_sum = 0.0;
+        double _product_sum = 0.0;
+
+        clock::time_point _last_time;
+        size_t _last_size = 0;
+
+        input_dejitter_statistics _statistics = {0, 0, 0, 0, 0.0, std::chrono::nanoseconds(0)};
+        double _squared_error_sum = 0.0;
+        uint64_t _error_count = 0;
+        mutable std::mutex _mutex;
+    };
+} // namespace smidi
+
+#endif // SMIDI_DEJITTER_H
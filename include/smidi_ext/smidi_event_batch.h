@@ -0,0 +1,77 @@
+#ifndef SMIDI_EVENT_BATCH_H
+#define SMIDI_EVENT_BATCH_H
+
+#include "smidi/smidi.h"
+#include "smidi_ext/smidi_event_store.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace smidi
+{
+    // Decoded messages as columns, the bulk counterpart of calling message_from_data in a loop. Time stamps, status,
+    // first and second data byte, size and the offset of every message in a byte arena that holds the messages whole.
+    // Columns and arena are sized once when the batch is created and reused after clear(), decoding writes into them
+    // in one pass and never allocates, it stops when the batch is full and reports how far it got.
+    //
+    // The columns are plain arrays of size() entries so filters and statistics can scan them in loops the compiler
+    // vectorizes, count() is one.
+    class event_batch
+    {
+      public:
+        event_batch(size_t event_capacity, size_t arena_capacity);
+
+        size_t size() const noexcept;
+        bool empty() const noexcept;
+        size_t capacity() const noexcept;
+        size_t arena_size() const noexcept;
+        size_t arena_capacity() const noexcept;
+        void clear() noexcept;
+
+        // Adds one message, returns false if the batch has no room for it.
+        bool append(time_stamp time, const uint8_t* data, size_t size);
+
+        const time_stamp* times() const noexcept;
+        const uint8_t* statuses() const noexcept;
+        // Zero for messages without the data byte.
+        const uint8_t* data1() const noexcept;
+        const uint8_t* data2() const noexcept;
+        const uint32_t* sizes() const noexcept;
+        const uint32_t* offsets() const noexcept;
+        const uint8_t* arena() const noexcept;
+
+        // The bytes of message index, sizes()[index] long.
+        const uint8_t* message(size_t index) const;
+
+        // Number of messages that match filter.
+        size_t count(const event_filter& filter) const noexcept;
+
+      private:
+        friend size_t decode_messages(const uint8_t* data, size_t size, time_stamp time, event_batch& batch);
+        friend size_t receive_messages(input_device& device, event_batch& batch);
+
+        void push_column(time_stamp time, const uint8_t* message, size_t size, size_t offset) noexcept;
+
+        std::vector<time_stamp> _times;
+        std::vector<uint8_t> _statuses;
+        std::vector<uint8_t> _data1;
+        std::vector<uint8_t> _data2;
+        std::vector<uint32_t> _sizes;
+        std::vector<uint32_t> _offsets;
+        std::vector<uint8_t> _arena;
+        size_t _size = 0;
+        size_t _arena_size = 0;
+    };
+
+    // Decodes the messages in a byte span, e.g. a file or a capture, into batch with every message stamped time. Each
+    // message starts with its status byte, data bytes without one and undefined status bytes are skipped. Returns the
+    // number of bytes consumed, which stops short of size at an incomplete last message or when the batch is full.
+    size_t decode_messages(const uint8_t* data, size_t size, time_stamp time, event_batch& batch);
+
+    // Moves the device's queued messages into batch with try_receive, straight into the arena. Returns the number of
+    // messages received, it stops when the queue is empty or the next message does not fit.
+    size_t receive_messages(input_device& device, event_batch& batch);
+} // namespace smidi
+
+#endif // SMIDI_EVENT_BATCH_H
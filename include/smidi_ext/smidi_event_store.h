@@ -0,0 +1,80 @@
+#ifndef SMIDI_EVENT_STORE_H
+#define SMIDI_EVENT_STORE_H
+
+#include "smidi/smidi.h"
+
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace smidi
+{
+    // Matches events where (status & status_mask) == status and (data1 & data1_mask) == data1. Messages without data
+    // bytes have a data1 of zero. A zero mask matches anything, e.g. control change 64 on channel 3 is
+    // {0xB2, 0xFF, 64, 0x7F} and every note on is {0x90, 0xF0, 0, 0}.
+    struct event_filter
+    {
+        uint8_t status;
+        uint8_t status_mask;
+        uint8_t data1;
+        uint8_t data1_mask;
+    };
+
+    // Append-only store of timestamped messages kept as columns: time stamps, status, first and second data byte, and
+    // for longer messages (SysEx) an offset into a byte arena. Events live in fixed size chunks that never move once
+    // allocated, with the first time stamp of every chunk as a sparse index, so time range lookups are two binary
+    // searches and filters scan the narrow status and data columns in tight loops the compiler vectorizes.
+    //
+    // Indices count from the oldest retained event, drop_before shifts them.
+    class event_store
+    {
+      public:
+        static constexpr size_t chunk_capacity = 4096;
+
+        event_store();
+        ~event_store();
+
+        event_store(event_store&&) noexcept;
+        event_store& operator=(event_store&&) noexcept;
+
+        // Time stamps must not decrease.
+        void append(time_stamp time, const uint8_t* data, size_t size);
+
+        size_t size() const noexcept;
+        bool empty() const noexcept;
+        void clear() noexcept;
+
+        // Releases the chunks holding only events before time, e.g. to keep the last 30 seconds. Returns the number of
+        // events dropped, which is at most what lies before time.
+        size_t drop_before(time_stamp time) noexcept;
+
+        // Index of the first event at or after time, size() if there is none.
+        size_t lower_bound(time_stamp time) const noexcept;
+
+        time_stamp time(size_t index) const;
+        uint8_t status(size_t index) const;
+        uint8_t data1(size_t index) const;
+        uint8_t data2(size_t index) const;
+        size_t message_size(size_t index) const;
+        // Copies the message to data, which must hold message_size(index) bytes, and returns its size.
+        size_t message(size_t index, uint8_t* data, size_t size) const;
+
+        // Number of events with begin <= time < end that match filter.
+        size_t count(time_stamp begin, time_stamp end, const event_filter& filter) const noexcept;
+        // Appends the indices of the events with begin <= time < end that match filter, in time order.
+        void select(time_stamp begin, time_stamp end, const event_filter& filter, std::vector<size_t>& indices) const;
+
+      private:
+        struct chunk;
+
+        const chunk& chunk_at(size_t index, size_t& offset) const;
+
+        std::vector<std::unique_ptr<chunk>> _chunks;
+        // First time stamp of every chunk, every chunk but the last is full.
+        std::vector<time_stamp> _chunk_times;
+        size_t _size = 0;
+    };
+} // namespace smidi
+
+#endif // SMIDI_EVENT_STORE_H
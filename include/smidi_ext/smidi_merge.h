@@ -0,0 +1,124 @@
+#ifndef SMIDI_MERGE_H
+#define SMIDI_MERGE_H
+
+#include "smidi/smidi.h"
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace smidi
+{
+    struct input_merge_options
+    {
+        // How long an event waits for earlier events of other sources that have not arrived yet.
+        std::chrono::nanoseconds reorder_window = std::chrono::milliseconds(5);
+        // Events every source holds until they are merged.
+        size_t source_capacity = 1024;
+        // Drop messages identical to one of another source released less than dedupe_window before, for inputs that
+        // reach the host on redundant paths.
+        bool dedupe = false;
+        std::chrono::nanoseconds dedupe_window = std::chrono::milliseconds(2);
+    };
+
+    struct input_merge_statistics
+    {
+        uint64_t merged;
+        // Events that arrived after a later event of another source had been released, they are released right away
+        // at the time of that event.
+        uint64_t late;
+        uint64_t duplicates;
+        // Events push() could not add because their source was full.
+        uint64_t overflows;
+    };
+
+    struct merged_event
+    {
+        size_t source;
+        std::chrono::steady_clock::time_point time;
+        size_t size;
+    };
+
+    // Merges the messages of several sources, e.g. one per input device, into one stream ordered by time. Every source
+    // is a bounded single producer, single consumer ring: the thread feeding a source (its receive loop or message
+    // callback) never waits for other sources or for the consumer. The consumer keeps the oldest event of every source
+    // in a heap and releases the earliest one once it is certain no earlier event can follow, because every source has
+    // an event pending or the reorder window since its time has passed.
+    //
+    // Times of a source must not decrease, corrected times from input_dejitter never do. try_pop, next_release_time and
+    // statistics are for one consumer thread.
+    class input_merge
+    {
+      public:
+        using clock = std::chrono::steady_clock;
+
+        input_merge(size_t source_count, const input_merge_options& options = input_merge_options());
+        ~input_merge();
+
+        input_merge(const input_merge&) = delete;
+        input_merge& operator=(const input_merge&) = delete;
+
+        size_t source_count() const noexcept;
+
+        // Adds a message to source, from the one thread feeding it. Returns false if the source is full.
+        bool push(size_t source, const uint8_t* data, size_t size, clock::time_point time);
+
+        // Copies the next message in time order to data if it is released at now. SMIDI_RESULT_NO_MESSAGE if there is
+        // none yet, SMIDI_RESULT_BUFFER_TOO_SMALL keeps it pending with its size in event.
+        result try_pop(clock::time_point now, uint8_t* data, size_t size, merged_event* event) noexcept;
+
+        // When try_pop releases the next message, clock::time_point::max() if no message is pending. Messages pushed in
+        // the meantime may move it earlier.
+        clock::time_point next_release_time() noexcept;
+
+        input_merge_statistics statistics() const;
+
+      private:
+        struct source;
+
+        struct heap_entry
+        {
+            clock::time_point time;
+            size_t source;
+        };
+
+        struct recent_event
+        {
+            clock::time_point time;
+            size_t source;
+            size_t size;
+            uint64_t hash;
+        };
+
+        struct later
+        {
+            bool operator()(const heap_entry& a, const heap_entry& b) const noexcept;
+        };
+
+        void collect() noexcept;
+        void advance(size_t source_idx) noexcept;
+        bool is_duplicate(size_t source_idx, clock::time_point time, const uint8_t* data, size_t size) noexcept;
+
+        input_merge_options _options;
+        std::vector<std::unique_ptr<source>> _sources;
+        // A bit per source whose producer found the ring empty when it pushed, so the consumer only looks at those
+        // instead of every source without an event in the heap.
+        std::unique_ptr<std::atomic<uint64_t>[]> _ready;
+        size_t _ready_words = 0;
+
+        // Consumer side. The heap holds the oldest event of every source that has one, earliest first.
+        std::vector<heap_entry> _heap;
+        std::vector<bool> _in_heap;
+        bool _released = false;
+        clock::time_point _last_time;
+        std::deque<recent_event> _recent;
+
+        input_merge_statistics _statistics = {};
+    };
+} // namespace smidi
+
+#endif // SMIDI_MERGE_H
@@ -0,0 +1,169 @@
+#ifndef SMIDI_MTC_H
+#define SMIDI_MTC_H
+
+#include "smidi/smidi.h"
+
+#include <array>
+#include <chrono>
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace smidi
+{
+    // The SMPTE rates MIDI time code can carry, the values are the rate bits of the hours byte.
+    enum class mtc_frame_rate : uint8_t
+    {
+        fps_24 = 0,
+        fps_25 = 1,
+        // 30000/1001 frames per second, frame numbers 0 and 1 are skipped at every minute but every tenth.
+        fps_29_97_drop = 2,
+        fps_30 = 3,
+    };
+
+    struct smpte_time
+    {
+        uint8_t hours;
+        uint8_t minutes;
+        uint8_t seconds;
+        uint8_t frames;
+        mtc_frame_rate rate;
+    };
+
+    // Size of a full frame message, F0 7F <device> 01 01 hh mm ss ff F7.
+    constexpr size_t mtc_full_frame_size = 10;
+
+    double frames_per_second(mtc_frame_rate rate) noexcept;
+    // Frames since 00:00:00:00, drop frame time codes count the frames that were actually played. The fields are not
+    // range checked, time codes from the wire convert to some frame without failing.
+    uint64_t smpte_to_frames(const smpte_time& time) noexcept;
+    smpte_time smpte_from_frames(uint64_t frames, mtc_frame_rate rate) noexcept;
+
+    // Writes a full frame message for time to data, which must hold mtc_full_frame_size bytes.
+    void make_mtc_full_frame(const smpte_time& time, uint8_t* data, uint8_t device_id = 0x7F);
+    bool is_mtc_full_frame(const uint8_t* data, size_t size) noexcept;
+
+    struct mtc_generator_options
+    {
+        mtc_frame_rate rate = mtc_frame_rate::fps_25;
+        // Device id of the full frame messages, 0x7F addresses all devices.
+        uint8_t device_id = 0x7F;
+    };
+
+    struct mtc_generator_statistics
+    {
+        uint64_t quarter_frames;
+        uint64_t failed;
+        // Quarter frames sent after their deadline because pump was called late, with the largest delay seen.
+        uint64_t late;
+        std::chrono::nanoseconds max_lateness;
+    };
+
+    // Sends MIDI time code to an output device. Quarter frame n is due at the start time plus n quarter frame
+    // intervals, computed from the start each time, so late wake-ups never shift the following quarter frames. Eight
+    // quarter frames spanning two frames carry the time of the frame the first one was sent on.
+    //
+    // pump() must be called again at the time it returns. Nothing allocates after construction.
+    class mtc_generator
+    {
+      public:
+        using clock = std::chrono::steady_clock;
+
+        mtc_generator(output_device& output, const mtc_generator_options& options = mtc_generator_options());
+
+        // Moves to time and sends a full frame message right away, only while stopped.
+        void locate(const smpte_time& time);
+        // Starts sending quarter frames from the current position, its first frame begins at time.
+        void start(clock::time_point time);
+        void stop();
+        bool running() const;
+
+        // Frame of the quarter frame sent next, or the located frame while stopped.
+        smpte_time position() const;
+
+        // Sends the quarter frames due at now and returns when the next one is, clock::time_point::max() while stopped.
+        clock::time_point pump(clock::time_point now);
+
+        mtc_generator_statistics statistics() const;
+
+      private:
+        clock::time_point deadline(uint64_t quarter_frame) const;
+
+        output_device& _output;
+        mtc_generator_options _options;
+        double _ns_per_quarter_frame;
+
+        bool _running = false;
+        uint64_t _start_frame = 0;
+        clock::time_point _start_time;
+        // Quarter frames sent since start.
+        uint64_t _next_quarter_frame = 0;
+        // The time code the current run of eight quarter frames carries.
+        std::array<uint8_t, 8> _pieces = {};
+
+        mtc_generator_statistics _statistics = {0, 0, 0, std::chrono::nanoseconds(0)};
+        mutable std::mutex _mutex;
+    };
+
+    struct mtc_decoder_statistics
+    {
+        uint64_t quarter_frames;
+        uint64_t full_frames;
+        // Quarter frames out of sequence, which restart the assembly of a time code.
+        uint64_t dropouts;
+        // Assembled time codes that did not match the position the quarter frames counted to.
+        uint64_t resyncs;
+    };
+
+    // Reassembles MIDI time code from quarter frames and full frame messages. Once eight quarter frames in order
+    // carried a time code, every further quarter frame moves the position on by a quarter frame and anchors it at its
+    // time, and positions in between are interpolated at the nominal frame rate. Running backwards, the position
+    // follows the quarter frames down and is checked again once they run forwards.
+    //
+    // Nothing allocates, process() costs the same for every message.
+    class mtc_decoder
+    {
+      public:
+        using clock = std::chrono::steady_clock;
+
+        mtc_decoder();
+
+        // Ignores everything but quarter frames and full frame messages.
+        void process(const uint8_t* data, size_t size, clock::time_point time);
+        void reset();
+
+        // True after a time code was received, by quarter frames or a full frame.
+        bool locked() const;
+        // True while quarter frames arrive, at most two frames apart.
+        bool running(clock::time_point time) const;
+        mtc_frame_rate rate() const;
+
+        // Position in frames since 00:00:00:00 at time, with the fraction of the current frame.
+        double frame_position(clock::time_point time) const;
+        smpte_time position(clock::time_point time) const;
+
+        mtc_decoder_statistics statistics() const;
+
+      private:
+        void process_quarter_frame(uint8_t value, clock::time_point time);
+        double quarter_frame_ns() const noexcept;
+
+        std::array<uint8_t, 8> _pieces = {};
+        // Pieces received in order since piece 0.
+        uint32_t _piece_count = 0;
+        int _last_piece = -1;
+        bool _forward = true;
+
+        bool _locked = false;
+        bool _moving = false;
+        mtc_frame_rate _rate = mtc_frame_rate::fps_25;
+        // Quarter frames since 00:00:00:00 at _anchor_time.
+        int64_t _anchor_quarter_frames = 0;
+        clock::time_point _anchor_time;
+
+        mtc_decoder_statistics _statistics = {0, 0, 0, 0};
+        mutable std::mutex _mutex;
+    };
+} // namespace smidi
+
+#endif // SMIDI_MTC_H
@@ -0,0 +1,178 @@
+#ifndef SMIDI_SEQUENCER_H
+#define SMIDI_SEQUENCER_H
+
+#include "smidi/smidi.h"
+
+#include <array>
+#include <bitset>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace smidi
+{
+    constexpr uint32_t sequencer_ticks_per_quarter_note = 960;
+
+    // Clip of messages at tick positions within [0, length).
+    class pattern
+    {
+      public:
+        explicit pattern(uint64_t length);
+
+        // Events at the same tick keep the order they were added in.
+        void add(uint64_t tick, const uint8_t* data, size_t size);
+
+        uint64_t length() const noexcept;
+        size_t size() const noexcept;
+
+      private:
+        friend class sequencer;
+
+        struct event
+        {
+            uint64_t tick;
+            size_t size;
+            std::array<uint8_t, 3> short_data;
+            std::vector<uint8_t> long_data;
+
+            const uint8_t* data() const noexcept;
+        };
+
+        uint64_t _length;
+        std::vector<event> _events;
+    };
+
+    struct sequencer_options
+    {
+        // Events are rendered this far ahead of the current time, changes take effect after it.
+        std::chrono::microseconds lookahead = std::chrono::milliseconds(20);
+        double tempo = 120.0;
+    };
+
+    struct sequencer_statistics
+    {
+        uint64_t rendered;
+        uint64_t sent;
+        // Events whose time had passed when they were rendered, because pump was called too late.
+        uint64_t late;
+        uint64_t failed;
+    };
+
+    // Plays patterns on output devices. pump() renders the events of the next lookahead window in one pass, queues them
+    // in time order and sends the ones that are due. Every track keeps a cursor into its pattern, so the cost of a
+    // window is the events inside it, whatever the pattern size.
+    //
+    // Event times are derived from the tempo map, never accumulated from wake-ups: a late pump sends what is overdue at
+    // once and the following events keep their original times.
+    class sequencer
+    {
+      public:
+        using clock = std::chrono::steady_clock;
+
+        explicit sequencer(const sequencer_options& options = sequencer_options());
+
+        // Returns the track index. The output device must outlive the sequencer.
+        size_t add_track(output_device& output, const pattern& pattern, bool loop = true);
+
+        // Muting or unsoloing a track ends its sounding notes.
+        void set_mute(size_t track, bool mute);
+        void set_solo(size_t track, bool solo);
+
+        // Changes the tempo from the end of the rendered window.
+        void set_tempo(double tempo);
+        // Changes the tempo at tick, which is moved to the end of the rendered window if that is later.
+        void schedule_tempo(uint64_t tick, double tempo);
+
+        // Tick zero plays at time. Restarting while playing ends the sounding notes first.
+        void start(clock::time_point time);
+        // Drops the queued events and ends all sounding notes.
+        void stop();
+        bool playing() const;
+
+        // Renders up to now + lookahead, sends the events due at now and returns when pump needs to be called again.
+        clock::time_point pump(clock::time_point now);
+
+        clock::time_point time_at(uint64_t tick) const;
+        uint64_t tick_at(clock::time_point time) const;
+
+        sequencer_statistics statistics() const;
+
+      private:
+        struct track
+        {
+            track(output_device& output, const pattern& clip, bool loop);
+
+            output_device* output;
+            pattern clip;
+            bool loop;
+            bool mute;
+            bool solo;
+            bool audible;
+
+            size_t next_event;
+            uint64_t loop_start;
+            bool finished;
+
+            // Notes rendered on and not yet off, per channel.
+            std::array<std::bitset<128>, 16> sounding;
+            // Notes sent on and not yet off, what stop() has to end since the rendered events after them are dropped.
+            std::array<std::bitset<128>, 16> sent_sounding;
+        };
+
+        struct tempo_segment
+        {
+            uint64_t tick;
+            double ns_per_tick;
+            clock::time_point time;
+        };
+
+        struct queued_event
+        {
+            clock::time_point time;
+            track* source;
+            size_t size;
+            std::array<uint8_t, 3> short_data;
+            const uint8_t* long_data;
+        };
+
+        struct window_event
+        {
+            uint64_t tick;
+            size_t track;
+            const pattern::event* event;
+        };
+
+        void seek(track& target, uint64_t tick);
+        void advance(track& target);
+        void render(uint64_t end_tick, clock::time_point now);
+        void end_notes(track& target, clock::time_point time);
+        void end_sent_notes();
+        void send(const queued_event& event);
+        void update_audible(clock::time_point time);
+        void insert_tempo(uint64_t tick, double tempo);
+        void rebuild_tempo_times(size_t first_segment);
+        const tempo_segment& segment_for_tick(uint64_t tick) const;
+        clock::time_point time_at_locked(uint64_t tick) const;
+        uint64_t tick_at_locked(clock::time_point time) const;
+
+        sequencer_options _options;
+        // Queued events point into the patterns, tracks never move.
+        std::vector<std::unique_ptr<track>> _tracks;
+        std::vector<tempo_segment> _tempo;
+
+        bool _playing = false;
+        // Everything before this tick has been rendered.
+        uint64_t _rendered_tick = 0;
+        std::vector<window_event> _window;
+        std::deque<queued_event> _queue;
+
+        sequencer_statistics _statistics = {};
+        mutable std::mutex _mutex;
+    };
+} // namespace smidi
+
+#endif // SMIDI_SEQUENCER_H
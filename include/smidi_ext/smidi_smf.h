@@ -0,0 +1,90 @@
+#ifndef SMIDI_SMF_H
+#define SMIDI_SMF_H
+
+#include <array>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace smidi
+{
+    enum class smf_event_type
+    {
+        midi,
+        system_exclusive,
+        meta,
+    };
+
+    // data points into the file, except for MIDI events which are always whole messages with their status byte, also
+    // when the file used running status. MIDI event data is only valid until the next call to smf_reader::next.
+    struct smf_event
+    {
+        size_t track;
+        // Absolute time in the track, in division units.
+        uint64_t tick;
+        smf_event_type type;
+        // The MIDI status byte, 0xF0 or 0xF7 for SysEx, 0xFF for meta events.
+        uint8_t status;
+        uint8_t meta_type;
+        const uint8_t* data;
+        size_t size;
+    };
+
+    struct smf_statistics
+    {
+        uint64_t tracks;
+        uint64_t unknown_chunks;
+        // Chunks running past the end of the file and tracks with events that do not parse or no end of track.
+        uint64_t malformed_chunks;
+    };
+
+    // Reads the events of a Standard MIDI File in place, track after track in file order, without copying the file.
+    // A malformed track is counted and skipped, the next chunk is read as usual.
+    class smf_reader
+    {
+      public:
+        static constexpr uint8_t meta_end_of_track = 0x2F;
+        static constexpr uint8_t meta_tempo = 0x51;
+
+        // Throws std::invalid_argument if data does not start with a header chunk.
+        smf_reader(const uint8_t* data, size_t size);
+
+        uint16_t format() const noexcept;
+        // Number of tracks the header announces, statistics().tracks is the number found.
+        uint16_t track_count() const noexcept;
+        uint16_t division() const noexcept;
+
+        // Returns false after the last event of the file.
+        bool next(smf_event& event);
+
+        smf_statistics statistics() const noexcept;
+
+      private:
+        bool next_in_track(smf_event& event);
+        bool read_variable_length(uint32_t& value) noexcept;
+        void end_track(bool malformed) noexcept;
+
+        const uint8_t* _data = nullptr;
+        size_t _size = 0;
+        uint16_t _format = 0;
+        uint16_t _track_count = 0;
+        uint16_t _division = 0;
+
+        size_t _chunk_offset = 0;
+        bool _in_track = false;
+        // Already counted as malformed.
+        bool _track_malformed = false;
+        size_t _track = 0;
+        size_t _position = 0;
+        size_t _track_end = 0;
+        uint64_t _tick = 0;
+        uint8_t _running_status = 0;
+        std::array<uint8_t, 3> _message = {0};
+
+        smf_statistics _statistics = {};
+    };
+
+    // Microseconds per quarter note of a tempo meta event, 0 for any other event.
+    uint32_t smf_tempo(const smf_event& event) noexcept;
+} // namespace smidi
+
+#endif // SMIDI_SMF_H
@@ -0,0 +1,96 @@
+#ifndef SMIDI_STATE_H
+#define SMIDI_STATE_H
+
+#include "smidi/smidi.h"
+
+#include <array>
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace smidi
+{
+    // Channel state as seen through the messages of one port: sounding notes and sustain pedals, the last value of
+    // every controller, program, pitch bend and channel pressure. Notes are a 128 bit set per channel and a 16 bit mask
+    // tells which channels have any, so the bursts below visit only what is actually set instead of all 16 x 128 notes.
+    //
+    // Not synchronized, state_tracking_output_device wraps it for use from several threads.
+    class midi_state_tracker
+    {
+      public:
+        midi_state_tracker() noexcept;
+
+        // Takes every message sent to or received from the port, messages of other kinds are ignored.
+        void process(const uint8_t* data, size_t size) noexcept;
+        void reset() noexcept;
+
+        bool note_active(uint8_t channel, uint8_t note) const noexcept;
+        size_t active_note_count() const noexcept;
+        // -1 for controllers, programs, pitch bends and pressures that were never set.
+        int controller(uint8_t channel, uint8_t controller) const noexcept;
+        int program(uint8_t channel) const noexcept;
+        int pitch_bend(uint8_t channel) const noexcept;
+        int channel_pressure(uint8_t channel) const noexcept;
+
+        // Sends a note off for every sounding note and releases the pedals that hold notes, then forgets the notes.
+        // Returns the number of messages sent.
+        size_t panic(output_device& output) noexcept;
+
+        // Sends the controllers, programs (after their bank select), pitch bends and channel pressures that were set, to
+        // bring a device joining late up to date. Notes are not restarted, and neither are RPN/NRPN selections and data
+        // entry, which only mean something as a sequence. Returns the number of messages sent.
+        size_t chase(output_device& output) const noexcept;
+
+      private:
+        struct channel_state
+        {
+            std::array<uint64_t, 2> notes;
+            std::array<uint64_t, 2> controllers_set;
+            std::array<uint8_t, 128> controllers;
+            uint16_t pitch_bend;
+            uint8_t program;
+            uint8_t pressure;
+            bool program_set;
+            bool pitch_bend_set;
+            bool pressure_set;
+        };
+
+        void set_note(size_t channel, uint8_t note, bool active) noexcept;
+
+        std::array<channel_state, 16> _channels;
+        // Channels with sounding notes.
+        uint16_t _active_channels = 0;
+    };
+
+    struct state_tracking_options
+    {
+        // Ends the sounding notes when the device is destroyed.
+        bool panic_on_destroy = true;
+    };
+
+    // Output stage that tracks the state of what it sends, so a panic or chase burst can be sent at any time.
+    class state_tracking_output_device final : public output_device
+    {
+      public:
+        state_tracking_output_device(output_device& output, const state_tracking_options& options = state_tracking_options());
+        ~state_tracking_output_device() override;
+
+        size_t send(const uint8_t* data, size_t size) override;
+        result try_send(const uint8_t* data, size_t size) noexcept override;
+
+        size_t panic() noexcept;
+        size_t chase() noexcept;
+
+        // A copy of the tracked state.
+        midi_state_tracker state() const;
+
+      private:
+        output_device& _output;
+        state_tracking_options _options;
+
+        midi_state_tracker _state;
+        mutable std::mutex _mutex;
+    };
+} // namespace smidi
+
+#endif // SMIDI_STATE_H
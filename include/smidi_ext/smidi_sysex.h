@@ -0,0 +1,164 @@
+#ifndef SMIDI_SYSEX_H
+#define SMIDI_SYSEX_H
+
+#include "smidi/smidi.h"
+
+#include <chrono>
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace smidi
+{
+    enum class sysex_handshake
+    {
+        // Packets are only paced by the packet interval.
+        none,
+        // The receiver answers packets with the universal ACK, NAK, WAIT and CANCEL messages of the Sample Dump
+        // Standard, F0 7E <channel> 7F|7E|7C|7D <packet number> F7.
+        sample_dump,
+    };
+
+    struct sysex_transfer_options
+    {
+        // Zero sends every SysEx message of the dump as a packet, otherwise the dump is cut into packets of this many
+        // bytes, for devices that take long messages in pieces.
+        size_t packet_size = 0;
+        // At least this long between two packets, zero sends them back to back.
+        std::chrono::microseconds packet_interval = std::chrono::microseconds(0);
+
+        sysex_handshake handshake = sysex_handshake::none;
+        // Packets sent before the oldest of them is acknowledged.
+        size_t window = 1;
+        // Without a reply for this long, the transfer goes back to the oldest packet not acknowledged.
+        std::chrono::milliseconds reply_timeout = std::chrono::milliseconds(200);
+        // NAKs and timeouts in a row before the transfer fails.
+        uint32_t retry_limit = 3;
+    };
+
+    enum class sysex_transfer_state
+    {
+        idle,
+        sending,
+        done,
+        failed,
+        cancelled,
+    };
+
+    struct sysex_transfer_statistics
+    {
+        uint64_t packets;
+        uint64_t resent;
+        uint64_t naks;
+        uint64_t timeouts;
+    };
+
+    // Sends large SysEx dumps, e.g. firmware or samples, in packets paced by time or by the receiver's handshake. With
+    // a window above one several packets are in flight, a NAK or timeout resends from the packet in question.
+    //
+    // The transfer runs from pump(), which must be called again at the time it returns, replies from the receiver go
+    // to process(). The dump is copied into a buffer kept for the next transfer.
+    class sysex_transfer
+    {
+      public:
+        using clock = std::chrono::steady_clock;
+
+        sysex_transfer(output_device& output, const sysex_transfer_options& options = sysex_transfer_options());
+
+        // Starts sending a dump of one or more complete SysEx messages, only while no other transfer is running.
+        void start(const uint8_t* data, size_t size);
+        void cancel();
+
+        // Takes messages received from the device, handshake replies move the transfer on and the rest is ignored.
+        void process(const uint8_t* data, size_t size, clock::time_point now);
+
+        // Sends the packets due at now and returns when pump needs to be called again, clock::time_point::max() when
+        // it only waits for replies or the transfer is over.
+        clock::time_point pump(clock::time_point now);
+
+        sysex_transfer_state state() const;
+        // Bytes of the dump acknowledged, or sent without a handshake.
+        size_t bytes_done() const;
+        size_t bytes_total() const;
+
+        sysex_transfer_statistics statistics() const;
+
+      private:
+        struct packet
+        {
+            size_t offset;
+            size_t size;
+        };
+
+        void split_packets();
+        void rewind(size_t packet_idx);
+        void fail_or_retry(size_t packet_idx);
+
+        output_device& _output;
+        sysex_transfer_options _options;
+
+        std::vector<uint8_t> _dump;
+        std::vector<packet> _packets;
+        sysex_transfer_state _state = sysex_transfer_state::idle;
+        // Packets before _acknowledged are done, packets before _next were sent.
+        size_t _acknowledged = 0;
+        size_t _next = 0;
+        bool _waiting = false;
+        uint32_t _retries = 0;
+
+        clock::time_point _next_send_time;
+        clock::time_point _reply_deadline;
+
+        sysex_transfer_statistics _statistics = {0, 0, 0, 0};
+        mutable std::mutex _mutex;
+    };
+
+    struct sysex_reassembly_options
+    {
+        // Longer messages are dropped, the buffer never grows beyond this.
+        size_t max_size = 16 * 1024 * 1024;
+    };
+
+    struct sysex_reassembly_statistics
+    {
+        uint64_t messages;
+        uint64_t fragments;
+        // Messages cut off by a new status byte or dropped for their size.
+        uint64_t dropped;
+    };
+
+    // Glues SysEx that arrives in fragments, e.g. from driver buffers smaller than a dump, back into one contiguous
+    // message. A fragment starting with F0 begins a message, fragments of data bytes continue it and F7 ends it. The
+    // buffer grows to the largest message seen and is reused for every message after it.
+    //
+    // Not synchronized, it belongs to the thread receiving from the device.
+    class sysex_reassembler
+    {
+      public:
+        explicit sysex_reassembler(const sysex_reassembly_options& options = sysex_reassembly_options());
+
+        // Returns true when data completed a message, which message() then holds until the next call. Other messages
+        // pass through as the message, any but system real time messages drop an unfinished SysEx message.
+        bool process(const uint8_t* data, size_t size);
+        void reset() noexcept;
+
+        const uint8_t* message() const noexcept;
+        size_t message_size() const noexcept;
+
+        sysex_reassembly_statistics statistics() const noexcept;
+
+      private:
+        sysex_reassembly_options _options;
+
+        std::vector<uint8_t> _buffer;
+        bool _assembling = false;
+        bool _overflowed = false;
+        const uint8_t* _message = nullptr;
+        size_t _message_size = 0;
+
+        sysex_reassembly_statistics _statistics = {0, 0, 0};
+    };
+} // namespace smidi
+
+#endif // SMIDI_SYSEX_H
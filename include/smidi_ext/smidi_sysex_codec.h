@@ -0,0 +1,54 @@
+#ifndef SMIDI_SYSEX_CODEC_H
+#define SMIDI_SYSEX_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace smidi
+{
+    // 8-bit data carried in 7-bit SysEx data bytes. The 7-bit packing sends every group of up to 7 bytes as a byte with
+    // their top bits followed by the 7 bytes without them, 8 bytes for 7. This is how most vendor dumps carry samples,
+    // patches and firmware. The nibble packing sends every byte as two bytes of 4 bits.
+    //
+    // The kernels write straight into the caller's buffer, which must hold the packed or unpacked size. Where the CPU
+    // has them they use SSSE3 or AVX2 (picked at run time) or NEON, otherwise they work on 8 bytes at a time in 64-bit
+    // words. Top bits of the 7-bit input bytes are ignored.
+
+    enum class sysex_7bit_order
+    {
+        // Bit 0 of the top bits byte belongs to the first byte of the group, as with Korg and Sequential.
+        first_in_lsb,
+        // Bit 6 belongs to the first byte of the group.
+        first_in_msb,
+    };
+
+    enum class sysex_nibble_order
+    {
+        low_first,
+        high_first,
+    };
+
+    size_t sysex_7bit_packed_size(size_t size) noexcept;
+    // A trailing top bits byte without data bytes unpacks to nothing.
+    size_t sysex_7bit_unpacked_size(size_t packed_size) noexcept;
+
+    // Return the number of bytes written to out.
+    size_t pack_sysex_7bit(const uint8_t* data, size_t size, uint8_t* out,
+                           sysex_7bit_order order = sysex_7bit_order::first_in_lsb) noexcept;
+    size_t unpack_sysex_7bit(const uint8_t* data, size_t size, uint8_t* out,
+                             sysex_7bit_order order = sysex_7bit_order::first_in_lsb) noexcept;
+
+    // Writes 2 * size bytes. Unpacking writes size / 2 bytes, a trailing odd byte is ignored.
+    size_t pack_sysex_nibbles(const uint8_t* data, size_t size, uint8_t* out,
+                              sysex_nibble_order order = sysex_nibble_order::low_first) noexcept;
+    size_t unpack_sysex_nibbles(const uint8_t* data, size_t size, uint8_t* out,
+                                sysex_nibble_order order = sysex_nibble_order::low_first) noexcept;
+
+    // Roland and Yamaha checksums, the value that makes the bytes and the checksum add up to a multiple of 128. data is
+    // what the checksum covers, e.g. the address and data bytes of a Roland DT1 message.
+    uint8_t sysex_sum_checksum(const uint8_t* data, size_t size) noexcept;
+    // Sample Dump Standard checksums, the XOR of the bytes masked to 7 bits.
+    uint8_t sysex_xor_checksum(const uint8_t* data, size_t size) noexcept;
+} // namespace smidi
+
+#endif // SMIDI_SYSEX_CODEC_H
@@ -0,0 +1,91 @@
+#ifndef SMIDI_THINNING_H
+#define SMIDI_THINNING_H
+
+#include "smidi/smidi.h"
+
+#include <array>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace smidi
+{
+    // A 5-pin DIN link runs at 31250 baud with 10 bits per byte on the wire.
+    constexpr size_t din_bytes_per_second = 31250 / 10;
+
+    struct thinning_options
+    {
+        size_t bytes_per_second = din_bytes_per_second;
+        // Bytes that may be sent back to back after the link has been idle.
+        size_t burst_bytes = 32;
+    };
+
+    struct thinning_statistics
+    {
+        uint64_t sent_messages;
+        uint64_t sent_bytes;
+        uint64_t merged;
+        size_t pending;
+    };
+
+    // Output stage that paces messages to the wire rate of a slow link. Control change, pitch bend and pressure updates
+    // waiting for wire budget are merged last-value-wins per channel and controller (or key), as long as no note,
+    // SysEx or other order-sensitive message was queued after them. Everything else is sent in order, system real time
+    // messages bypass the queue.
+    //
+    // send() queues and sends what the budget allows right away, pump() must be called again at next_send_time() to
+    // drain the rest.
+    class thinning_output_device final : public output_device
+    {
+      public:
+        using clock = std::chrono::steady_clock;
+
+        thinning_output_device(output_device& output, const thinning_options& options = thinning_options());
+
+        size_t send(const uint8_t* data, size_t size) override;
+        result try_send(const uint8_t* data, size_t size) noexcept override;
+
+        // Sends queued messages that fit into the wire budget at now, returns the number of messages sent.
+        size_t pump(clock::time_point now);
+
+        // Time at which the next queued message fits into the budget, clock::time_point::max() if nothing is queued.
+        clock::time_point next_send_time() const;
+
+        thinning_statistics statistics() const;
+
+      private:
+        struct pending_message
+        {
+            std::array<uint8_t, 3> short_data;
+            std::vector<uint8_t> long_data;
+            size_t size;
+
+            const uint8_t* data() const noexcept;
+        };
+
+        void refill(clock::time_point now);
+        void send_to_wire(const uint8_t* data, size_t size);
+
+        output_device& _output;
+        thinning_options _options;
+
+        std::deque<pending_message> _pending;
+        // Sequence numbers count every queued message, the front message has _front_sequence. Mergeable messages
+        // record their sequence per key, a merge is only allowed past the last order-sensitive message.
+        uint64_t _front_sequence = 0;
+        uint64_t _barrier_sequence = 0;
+        std::vector<uint64_t> _key_sequences;
+
+        // Wire budget in bytes, negative while a message larger than the budget is still being paid for.
+        double _budget;
+        clock::time_point _last_refill;
+
+        thinning_statistics _statistics = {};
+        mutable std::mutex _mutex;
+    };
+} // namespace smidi
+
+#endif // SMIDI_THINNING_H
@@ -0,0 +1,206 @@
+#ifndef SMIDI_UMP_H
+#define SMIDI_UMP_H
+
+#include <array>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace smidi
+{
+    // MIDI 2.0 Universal MIDI Packets, 1 to 4 32-bit words with the message type in the top nibble of the first word.
+    enum class ump_message_type : uint8_t
+    {
+        utility = 0x0,
+        system = 0x1,
+        midi1_channel_voice = 0x2,
+        data64 = 0x3,
+        midi2_channel_voice = 0x4,
+        data128 = 0x5,
+        reserved_32_6 = 0x6,
+        reserved_32_7 = 0x7,
+        reserved_64_8 = 0x8,
+        reserved_64_9 = 0x9,
+        reserved_64_a = 0xA,
+        reserved_96_b = 0xB,
+        reserved_96_c = 0xC,
+        flex_data = 0xD,
+        reserved_128_e = 0xE,
+        stream = 0xF,
+    };
+
+    // SysEx7 (data64) and SysEx8 (data128) packet status.
+    enum class ump_data_status : uint8_t
+    {
+        complete = 0x0,
+        start = 0x1,
+        continue_ = 0x2,
+        end = 0x3,
+    };
+
+    constexpr size_t ump_max_words = 4;
+    constexpr size_t ump_system_exclusive7_bytes_per_packet = 6;
+
+    ump_message_type ump_type(uint32_t first_word) noexcept;
+    size_t ump_word_count(ump_message_type type) noexcept;
+    size_t ump_word_count(uint32_t first_word) noexcept;
+    uint8_t ump_group(uint32_t first_word) noexcept;
+
+    class ump_packet
+    {
+      public:
+        ump_packet() noexcept;
+        ump_packet(const uint32_t* words, size_t count) noexcept;
+
+        ump_message_type type() const noexcept;
+        uint8_t group() const noexcept;
+        // Status nibble or byte, depending on the message type (e.g. 0x9 for a note on, 0xF8 for timing clock).
+        uint8_t status() const noexcept;
+        uint8_t channel() const noexcept;
+
+        const uint32_t* data() const noexcept;
+        size_t size() const noexcept;
+
+      private:
+        std::array<uint32_t, ump_max_words> _words;
+    };
+
+    ump_packet make_ump_system_message(uint8_t group, uint8_t status, uint8_t data1, uint8_t data2) noexcept;
+    ump_packet make_ump_midi1_channel_voice_message(uint8_t group, uint8_t status, uint8_t data1, uint8_t data2) noexcept;
+    ump_packet make_ump_midi2_channel_voice_message(uint8_t group, uint8_t status, uint8_t index1, uint8_t index2, uint32_t data) noexcept;
+
+    // Splits a stream of UMP words into packets, packets may be split across calls.
+    class ump_stream_parser
+    {
+      public:
+        // Calls callback(const ump_packet&) for every complete packet.
+        template <typename callback_type>
+        void parse(const uint32_t* words, size_t count, callback_type&& callback)
+        {
+            for (size_t word_idx = 0; word_idx < count; word_idx++)
+            {
+                _words[_word_count++] = words[word_idx];
+                if (_word_count == ump_word_count(_words[0]))
+                {
+                    callback(ump_packet(_words.data(), _word_count));
+                    _word_count = 0;
+                }
+            }
+        }
+
+        void reset() noexcept;
+
+      private:
+        std::array<uint32_t, ump_max_words> _words = {0};
+        size_t _word_count = 0;
+    };
+
+    // Min-center-max value scaling from the MIDI 2.0 specification. Upscaling maps the source center to the destination
+    // center and the source maximum to the destination maximum, downscaling drops the low bits.
+    uint32_t scale_up(uint32_t value, uint8_t source_bits, uint8_t destination_bits) noexcept;
+    uint32_t scale_down(uint32_t value, uint8_t source_bits, uint8_t destination_bits) noexcept;
+
+    // Branch-free batch versions of the common conversions, written so compilers can vectorize them.
+    void scale_7_to_16(const uint8_t* values, uint16_t* out, size_t count) noexcept;
+    void scale_7_to_32(const uint8_t* values, uint32_t* out, size_t count) noexcept;
+    void scale_14_to_32(const uint16_t* values, uint32_t* out, size_t count) noexcept;
+    void scale_16_to_7(const uint16_t* values, uint8_t* out, size_t count) noexcept;
+    void scale_32_to_7(const uint32_t* values, uint8_t* out, size_t count) noexcept;
+    void scale_32_to_14(const uint32_t* values, uint16_t* out, size_t count) noexcept;
+
+    enum class ump_protocol
+    {
+        // Channel voice messages become MIDI 1.0 channel voice packets (type 0x2), values are unchanged.
+        midi1,
+        // Channel voice messages become MIDI 2.0 channel voice packets (type 0x4) with upscaled values. Bank select
+        // is folded into program change and RPN/NRPN data entry sequences become registered/assignable controllers.
+        midi2,
+    };
+
+    // Converts a MIDI 1.0 byte stream (with running status, interleaved real time messages and SysEx split across
+    // calls) into UMP words.
+    class midi1_to_ump_translator
+    {
+      public:
+        midi1_to_ump_translator(uint8_t group = 0, ump_protocol protocol = ump_protocol::midi2) noexcept;
+
+        // Output capacity needed to translate size bytes in the worst case, including messages completed by these bytes
+        // and an unfinished SysEx cut off by them.
+        static constexpr size_t max_words(size_t size) noexcept
+        {
+            return size * 2 + 2;
+        }
+
+        // Translates the bytes into out, which must hold max_words(size) words. Returns the number of words written.
+        size_t translate(const uint8_t* data, size_t size, uint32_t* out) noexcept;
+
+        // Appends the translation to out.
+        void translate(const uint8_t* data, size_t size, std::vector<uint32_t>& out);
+
+        void reset() noexcept;
+
+      private:
+        struct channel_state
+        {
+            uint8_t bank_msb;
+            uint8_t bank_lsb;
+            bool bank_valid;
+            uint8_t parameter_msb;
+            uint8_t parameter_lsb;
+            // 0: none selected, 0x2: registered (RPN), 0x3: assignable (NRPN).
+            uint8_t parameter_status;
+            uint8_t data_msb;
+        };
+
+        size_t translate_message(uint32_t* out) noexcept;
+        size_t translate_midi2_channel_voice(uint32_t* out) noexcept;
+        size_t flush_system_exclusive(ump_data_status status, uint32_t* out) noexcept;
+
+        uint8_t _group;
+        ump_protocol _protocol;
+
+        uint8_t _running_status = 0;
+        uint8_t _message[3] = {0};
+        size_t _message_size = 0;
+
+        bool _in_system_exclusive = false;
+        bool _system_exclusive_started = false;
+        uint8_t _system_exclusive[ump_system_exclusive7_bytes_per_packet] = {0};
+        size_t _system_exclusive_size = 0;
+
+        std::array<channel_state, 16> _channels;
+    };
+
+    // Converts UMP words into a MIDI 1.0 byte stream. MIDI 2.0 channel voice values are downscaled, messages without a
+    // MIDI 1.0 equivalent (per-note controllers, utility, flex data, SysEx8, stream messages...) are skipped.
+    class ump_to_midi1_translator
+    {
+      public:
+        // Output capacity needed to translate count words in the worst case, including a packet started by a previous
+        // call.
+        static constexpr size_t max_bytes(size_t count) noexcept
+        {
+            return (count + ump_max_words - 1) * 6;
+        }
+
+        // Translates the words into out, which must hold max_bytes(count) bytes. Returns the number of bytes written.
+        size_t translate(const uint32_t* words, size_t count, uint8_t* out) noexcept;
+
+        // Appends the translation to out.
+        void translate(const uint32_t* words, size_t count, std::vector<uint8_t>& out);
+
+        // Number of packets skipped because they have no MIDI 1.0 equivalent.
+        uint64_t skipped_packets() const noexcept;
+
+        void reset() noexcept;
+
+      private:
+        size_t translate_packet(const ump_packet& packet, uint8_t* out) noexcept;
+        size_t translate_midi2_channel_voice(const ump_packet& packet, uint8_t* out) noexcept;
+
+        ump_stream_parser _parser;
+        uint64_t _skipped_packets = 0;
+    };
+} // namespace smidi
+
+#endif // SMIDI_UMP_H
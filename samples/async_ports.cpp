@@ -0,0 +1,93 @@
+#include "smidi/smidi.h"
+#include "smidi_ext/smidi_coro.h"
+
+#include <array>
+#include <atomic>
+#include <iostream>
+#include <latch>
+#include <string>
+
+// Serves many loopback ports from two threads: every port has a coroutine sending a note per millisecond and one
+// receiving them, none of them holds a thread while waiting.
+constexpr size_t port_count = 512;
+constexpr size_t messages_per_port = 100;
+
+std::atomic<int64_t> total_lateness_us{0};
+
+smidi::coro::task send_notes(smidi::output_device& device, smidi::coro::executor& executor)
+{
+    smidi::coro::async_output_device output(device, executor);
+
+    const std::array<uint8_t, 3> message = {0x90, 0x3C, 0x40};
+    smidi::coro::clock::time_point time = smidi::coro::clock::now();
+    for (size_t message_idx = 0; message_idx < messages_per_port; message_idx++)
+    {
+        time += std::chrono::milliseconds(1);
+        co_await output.async_send_at(message.data(), message.size(), time);
+
+        auto lateness = smidi::coro::clock::now() - time;
+        total_lateness_us += std::chrono::duration_cast<std::chrono::microseconds>(lateness).count();
+    }
+}
+
+smidi::coro::task receive_notes(smidi::input_device& device, smidi::coro::executor& executor, std::latch& done)
+{
+    smidi::coro::async_input_device input(device, executor);
+
+    std::array<uint8_t, 16> buffer;
+    for (size_t message_idx = 0; message_idx < messages_per_port; message_idx++)
+    {
+        smidi::result result = co_await input.async_receive(buffer.data(), buffer.size());
+        if (result != SMIDI_RESULT_OK)
+        {
+            std::cout << "receive failed: " << smidi_result_string(result) << std::endl;
+        }
+    }
+
+    done.count_down();
+}
+
+int main()
+{
+    try
+    {
+        std::vector<std::string> port_names;
+        for (size_t port_idx = 0; port_idx < port_count; port_idx++)
+        {
+            port_names.push_back("port " + std::to_string(port_idx));
+        }
+        std::unique_ptr<smidi::system> system = smidi::create_loopback_system(port_names);
+
+        std::vector<std::unique_ptr<smidi::output_device>> outputs;
+        std::vector<std::unique_ptr<smidi::input_device>> inputs;
+        for (const std::string& name : port_names)
+        {
+            outputs.push_back(system->create_output_device(name));
+            inputs.push_back(system->create_input_device(name));
+        }
+
+        smidi::coro::thread_pool pool(2);
+        std::latch done(port_count);
+
+        smidi::coro::clock::time_point begin = smidi::coro::clock::now();
+        for (size_t port_idx = 0; port_idx < port_count; port_idx++)
+        {
+            receive_notes(*inputs[port_idx], pool, done);
+            send_notes(*outputs[port_idx], pool);
+        }
+        done.wait();
+        auto elapsed = smidi::coro::clock::now() - begin;
+
+        std::cout << "received " << port_count * messages_per_port << " messages on " << port_count << " ports in "
+                  << std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count() << " ms" << std::endl;
+        std::cout << "average send lateness: " << total_lateness_us / static_cast<int64_t>(port_count * messages_per_port) << " us"
+                  << std::endl;
+    }
+    catch (const std::exception& e)
+    {
+        std::cout << "error: " << e.what() << std::endl;
+        return -1;
+    }
+
+    return 0;
+}
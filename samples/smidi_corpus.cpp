@@ -0,0 +1,536 @@
+#include "smidi_ext/smidi_messages.h"
+#include "smidi_ext/smidi_smf.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <deque>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Scans a directory tree of Standard MIDI Files and reports per-file and aggregate statistics. Directories and files are
+// tasks on a work-stealing pool: every worker pushes the tasks it discovers to the back of its own deque and pops from
+// there, idle workers steal from the front of the others, so one deep directory keeps every core busy.
+//
+// usage: smidi_corpus [-j threads] [-q] directory
+
+namespace
+{
+    namespace fs = std::filesystem;
+
+    // Read-only view of a whole file, the parser reads it in place.
+    class mapped_file
+    {
+      public:
+        mapped_file(const fs::path& path)
+        {
+#if defined(_WIN32)
+            _file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+            if (_file == INVALID_HANDLE_VALUE)
+            {
+                throw std::runtime_error("Failed to open file.");
+            }
+
+            LARGE_INTEGER size;
+            if (!GetFileSizeEx(_file, &size))
+            {
+                CloseHandle(_file);
+                throw std::runtime_error("Failed to read file size.");
+            }
+            _size = static_cast<size_t>(size.QuadPart);
+            if (_size == 0)
+            {
+                return;
+            }
+
+            _mapping = CreateFileMappingW(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            _data = _mapping != nullptr ? static_cast<const uint8_t*>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+            if (_data == nullptr)
+            {
+                close();
+                throw std::runtime_error("Failed to map file.");
+            }
+#else
+            int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0)
+            {
+                throw std::runtime_error("Failed to open file.");
+            }
+
+            struct stat status;
+            if (fstat(fd, &status) != 0)
+            {
+                ::close(fd);
+                throw std::runtime_error("Failed to read file size.");
+            }
+            _size = static_cast<size_t>(status.st_size);
+            if (_size > 0)
+            {
+                void* data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (data == MAP_FAILED)
+                {
+                    ::close(fd);
+                    throw std::runtime_error("Failed to map file.");
+                }
+                madvise(data, _size, MADV_SEQUENTIAL);
+                _data = static_cast<const uint8_t*>(data);
+            }
+            ::close(fd);
+#endif
+        }
+
+        ~mapped_file()
+        {
+            close();
+        }
+
+        mapped_file(const mapped_file&) = delete;
+        mapped_file& operator=(const mapped_file&) = delete;
+
+        const uint8_t* data() const noexcept
+        {
+            return _data;
+        }
+
+        size_t size() const noexcept
+        {
+            return _size;
+        }
+
+      private:
+        void close() noexcept
+        {
+#if defined(_WIN32)
+            if (_data != nullptr)
+            {
+                UnmapViewOfFile(_data);
+            }
+            if (_mapping != nullptr)
+            {
+                CloseHandle(_mapping);
+            }
+            CloseHandle(_file);
+#else
+            if (_data != nullptr)
+            {
+                munmap(const_cast<uint8_t*>(_data), _size);
+            }
+#endif
+            _data = nullptr;
+        }
+
+#if defined(_WIN32)
+        HANDLE _file = INVALID_HANDLE_VALUE;
+        HANDLE _mapping = nullptr;
+#endif
+        const uint8_t* _data = nullptr;
+        size_t _size = 0;
+    };
+
+    struct event_counts
+    {
+        uint64_t note_on = 0;
+        uint64_t note_off = 0;
+        uint64_t polyphonic_key_pressure = 0;
+        uint64_t control_change = 0;
+        uint64_t program_change = 0;
+        uint64_t channel_pressure = 0;
+        uint64_t pitch_bend = 0;
+        uint64_t system_exclusive = 0;
+        uint64_t meta = 0;
+        uint64_t tempo = 0;
+
+        uint64_t total() const noexcept
+        {
+            return note_on + note_off + polyphonic_key_pressure + control_change + program_change + channel_pressure + pitch_bend +
+                   system_exclusive + meta;
+        }
+
+        event_counts& operator+=(const event_counts& other) noexcept
+        {
+            note_on += other.note_on;
+            note_off += other.note_off;
+            polyphonic_key_pressure += other.polyphonic_key_pressure;
+            control_change += other.control_change;
+            program_change += other.program_change;
+            channel_pressure += other.channel_pressure;
+            pitch_bend += other.pitch_bend;
+            system_exclusive += other.system_exclusive;
+            meta += other.meta;
+            tempo += other.tempo;
+            return *this;
+        }
+    };
+
+    struct file_report
+    {
+        std::string path;
+        uint64_t bytes = 0;
+        // Empty if the file parsed.
+        std::string error;
+        uint16_t format = 0;
+        uint16_t division = 0;
+        smidi::smf_statistics statistics = {};
+        event_counts events;
+        uint64_t length_ticks = 0;
+        // Microseconds per quarter note, zero without tempo events.
+        uint32_t min_tempo = 0;
+        uint32_t max_tempo = 0;
+    };
+
+    void count_event(const smidi::smf_event& event, file_report& report)
+    {
+        event_counts& events = report.events;
+        if (event.type == smidi::smf_event_type::system_exclusive)
+        {
+            events.system_exclusive++;
+        }
+        else if (event.type == smidi::smf_event_type::meta)
+        {
+            events.meta++;
+            if (uint32_t tempo = smidi::smf_tempo(event))
+            {
+                events.tempo++;
+                report.min_tempo = report.min_tempo == 0 ? tempo : std::min(report.min_tempo, tempo);
+                report.max_tempo = std::max(report.max_tempo, tempo);
+            }
+        }
+        else if (smidi::is_note_on_message(event.status))
+        {
+            // Note on with velocity zero is the usual running status friendly note off.
+            (event.data[2] != 0 ? events.note_on : events.note_off)++;
+        }
+        else if (smidi::is_note_off_message(event.status))
+        {
+            events.note_off++;
+        }
+        else if (smidi::is_polyphonic_key_pressure_message(event.status))
+        {
+            events.polyphonic_key_pressure++;
+        }
+        else if (smidi::is_control_change_message(event.status))
+        {
+            events.control_change++;
+        }
+        else if (smidi::is_program_change_message(event.status))
+        {
+            events.program_change++;
+        }
+        else if (smidi::is_channel_pressure_message(event.status))
+        {
+            events.channel_pressure++;
+        }
+        else
+        {
+            events.pitch_bend++;
+        }
+        report.length_ticks = std::max(report.length_ticks, event.tick);
+    }
+
+    file_report analyze_file(const fs::path& path)
+    {
+        file_report report;
+        report.path = path.string();
+        try
+        {
+            mapped_file file(path);
+            report.bytes = file.size();
+
+            smidi::smf_reader reader(file.data() != nullptr ? file.data() : reinterpret_cast<const uint8_t*>(""), file.size());
+            report.format = reader.format();
+            report.division = reader.division();
+
+            smidi::smf_event event;
+            while (reader.next(event))
+            {
+                count_event(event, report);
+            }
+            report.statistics = reader.statistics();
+        }
+        catch (const std::exception& e)
+        {
+            report.error = e.what();
+        }
+        return report;
+    }
+
+    bool is_midi_file(const fs::path& path)
+    {
+        std::string extension = path.extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        return extension == ".mid" || extension == ".midi" || extension == ".smf" || extension == ".kar";
+    }
+
+    class work_stealing_scanner
+    {
+      public:
+        work_stealing_scanner(size_t thread_count)
+            : _workers(thread_count)
+        {
+        }
+
+        std::vector<file_report> scan(const fs::path& root)
+        {
+            _pending = 1;
+            _workers[0].tasks.push_back({root, fs::is_directory(root)});
+
+            std::vector<std::thread> threads;
+            for (size_t worker_idx = 0; worker_idx < _workers.size(); worker_idx++)
+            {
+                threads.emplace_back([this, worker_idx]() { run(worker_idx); });
+            }
+            for (std::thread& thread : threads)
+            {
+                thread.join();
+            }
+
+            std::vector<file_report> reports;
+            for (worker& worker : _workers)
+            {
+                std::move(worker.reports.begin(), worker.reports.end(), std::back_inserter(reports));
+            }
+            std::sort(reports.begin(), reports.end(), [](const file_report& a, const file_report& b) { return a.path < b.path; });
+            return reports;
+        }
+
+      private:
+        struct task
+        {
+            fs::path path;
+            bool directory;
+        };
+
+        struct worker
+        {
+            std::mutex mutex;
+            std::deque<task> tasks;
+            std::vector<file_report> reports;
+        };
+
+        void run(size_t worker_idx)
+        {
+            worker& self = _workers[worker_idx];
+            while (_pending.load(std::memory_order_acquire) > 0)
+            {
+                task next;
+                if (!pop(self, next) && !steal(worker_idx, next))
+                {
+                    std::this_thread::yield();
+                    continue;
+                }
+
+                if (next.directory)
+                {
+                    expand(self, next.path);
+                }
+                else
+                {
+                    self.reports.push_back(analyze_file(next.path));
+                }
+                _pending.fetch_sub(1, std::memory_order_acq_rel);
+            }
+        }
+
+        // Newest first from the own deque keeps a directory's files on the worker that listed them.
+        bool pop(worker& self, task& next)
+        {
+            std::lock_guard<decltype(self.mutex)> lock(self.mutex);
+            if (self.tasks.empty())
+            {
+                return false;
+            }
+            next = std::move(self.tasks.back());
+            self.tasks.pop_back();
+            return true;
+        }
+
+        // Oldest first from the others, the oldest tasks tend to be the directories closest to the root.
+        bool steal(size_t worker_idx, task& next)
+        {
+            for (size_t offset = 1; offset < _workers.size(); offset++)
+            {
+                worker& victim = _workers[(worker_idx + offset) % _workers.size()];
+                std::lock_guard<decltype(victim.mutex)> lock(victim.mutex);
+                if (!victim.tasks.empty())
+                {
+                    next = std::move(victim.tasks.front());
+                    victim.tasks.pop_front();
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void expand(worker& self, const fs::path& directory)
+        {
+            std::vector<task> found;
+            std::error_code error;
+            for (fs::directory_iterator iter(directory, fs::directory_options::skip_permission_denied, error), end; !error && iter != end;
+                 iter.increment(error))
+            {
+                if (iter->is_directory(error) && !iter->is_symlink(error))
+                {
+                    found.push_back({iter->path(), true});
+                }
+                else if (iter->is_regular_file(error) && is_midi_file(iter->path()))
+                {
+                    found.push_back({iter->path(), false});
+                }
+            }
+
+            // Counted before they become visible so the pool cannot run dry while they are queued.
+            _pending.fetch_add(found.size(), std::memory_order_acq_rel);
+            std::lock_guard<decltype(self.mutex)> lock(self.mutex);
+            std::move(found.begin(), found.end(), std::back_inserter(self.tasks));
+        }
+
+        std::vector<worker> _workers;
+        std::atomic<size_t> _pending{0};
+    };
+
+    double tempo_to_bpm(uint32_t tempo)
+    {
+        return tempo != 0 ? 60000000.0 / tempo : 0.0;
+    }
+
+    void print_report(const file_report& report)
+    {
+        std::cout << report.path << "\t";
+        if (!report.error.empty())
+        {
+            std::cout << "error: " << report.error << std::endl;
+            return;
+        }
+
+        const event_counts& events = report.events;
+        std::cout << "format " << report.format << ", tracks " << report.statistics.tracks << ", events " << events.total() << " (notes "
+                  << events.note_on << "/" << events.note_off << ", cc " << events.control_change << ", program " << events.program_change
+                  << ", pressure " << events.polyphonic_key_pressure + events.channel_pressure << ", bend " << events.pitch_bend
+                  << ", sysex " << events.system_exclusive << ", meta " << events.meta << ")";
+        if (report.max_tempo != 0)
+        {
+            std::cout << ", bpm " << tempo_to_bpm(report.max_tempo) << "-" << tempo_to_bpm(report.min_tempo);
+        }
+        if (report.statistics.malformed_chunks != 0)
+        {
+            std::cout << ", malformed chunks " << report.statistics.malformed_chunks;
+        }
+        std::cout << std::endl;
+    }
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    size_t thread_count = std::max(1u, std::thread::hardware_concurrency());
+    bool quiet = false;
+    fs::path root;
+    for (int arg_idx = 1; arg_idx < argc; arg_idx++)
+    {
+        const std::string arg = argv[arg_idx];
+        if (arg == "-j" && arg_idx + 1 < argc)
+        {
+            thread_count = std::max<size_t>(1, std::stoul(argv[++arg_idx]));
+        }
+        else if (arg == "-q")
+        {
+            quiet = true;
+        }
+        else
+        {
+            root = arg;
+        }
+    }
+
+    if (root.empty())
+    {
+        std::cout << "usage: smidi_corpus [-j threads] [-q] directory" << std::endl;
+        return -1;
+    }
+
+    try
+    {
+        const auto start = std::chrono::steady_clock::now();
+        work_stealing_scanner scanner(thread_count);
+        std::vector<file_report> reports = scanner.scan(root);
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        event_counts events;
+        uint64_t bytes = 0;
+        uint64_t failed_files = 0;
+        uint64_t malformed_files = 0;
+        uint64_t malformed_chunks = 0;
+        uint64_t tracks = 0;
+        uint32_t min_tempo = std::numeric_limits<uint32_t>::max();
+        uint32_t max_tempo = 0;
+        for (const file_report& report : reports)
+        {
+            if (!quiet)
+            {
+                print_report(report);
+            }
+
+            bytes += report.bytes;
+            if (!report.error.empty())
+            {
+                failed_files++;
+                continue;
+            }
+
+            events += report.events;
+            tracks += report.statistics.tracks;
+            malformed_chunks += report.statistics.malformed_chunks;
+            malformed_files += report.statistics.malformed_chunks != 0 ? 1 : 0;
+            if (report.max_tempo != 0)
+            {
+                min_tempo = std::min(min_tempo, report.min_tempo);
+                max_tempo = std::max(max_tempo, report.max_tempo);
+            }
+        }
+
+        std::cout << std::endl << "files: " << reports.size() << " (" << failed_files << " unreadable, " << malformed_files
+                  << " with malformed chunks)" << std::endl;
+        std::cout << "tracks: " << tracks << ", malformed chunks: " << malformed_chunks << std::endl;
+        std::cout << "events: " << events.total() << std::endl;
+        std::cout << "  note on: " << events.note_on << std::endl;
+        std::cout << "  note off: " << events.note_off << std::endl;
+        std::cout << "  polyphonic key pressure: " << events.polyphonic_key_pressure << std::endl;
+        std::cout << "  control change: " << events.control_change << std::endl;
+        std::cout << "  program change: " << events.program_change << std::endl;
+        std::cout << "  channel pressure: " << events.channel_pressure << std::endl;
+        std::cout << "  pitch bend: " << events.pitch_bend << std::endl;
+        std::cout << "  sysex: " << events.system_exclusive << std::endl;
+        std::cout << "  meta: " << events.meta << " (tempo " << events.tempo << ")" << std::endl;
+        if (max_tempo != 0)
+        {
+            std::cout << "tempo range: " << tempo_to_bpm(max_tempo) << " - " << tempo_to_bpm(min_tempo) << " bpm" << std::endl;
+        }
+        std::cout << std::fixed << std::setprecision(2) << "scanned " << bytes / (1024.0 * 1024.0) << " MB in " << seconds << " s on "
+                  << thread_count << " threads (" << reports.size() / seconds << " files/s, " << bytes / (1024.0 * 1024.0) / seconds
+                  << " MB/s)" << std::endl;
+    }
+    catch (const std::exception& e)
+    {
+        std::cout << "error: " << e.what() << std::endl;
+        return -1;
+    }
+
+    return 0;
+}
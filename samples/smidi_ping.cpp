@@ -0,0 +1,460 @@
+#include "smidi/smidi.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Measures round-trip latency and jitter: tagged probes go out on an output device and are matched on an input device,
+// connected by a loopback cable or a virtual port. Probes are either SysEx carrying a 28-bit sequence number or control
+// changes carrying its low 7 bits, for devices that filter SysEx.
+//
+// usage: smidi_ping [-l] [-o output] [-i input] [-n count] [-p interval_us] [-m sysex|cc] [-r report_s] [-w timeout_ms]
+//                   [-R priority]
+//   -l  ping the in-process loopback port instead of devices
+//   -R  run the input's reader thread with SCHED_FIFO at priority
+
+namespace
+{
+    using clock = std::chrono::steady_clock;
+
+    // F0 7D (non-commercial) 's' 'p' <4 x 7 bits of sequence> F7.
+    constexpr std::array<uint8_t, 4> sysex_tag = {0xF0, 0x7D, 's', 'p'};
+    constexpr size_t sysex_probe_size = 9;
+    // Control change 102 (undefined) on channel 16.
+    constexpr uint8_t cc_status = 0xBF;
+    constexpr uint8_t cc_controller = 102;
+    constexpr size_t cc_window = 128;
+
+    enum class probe_mode
+    {
+        sysex,
+        cc,
+    };
+
+    struct settings
+    {
+        bool loopback = false;
+        std::string output_name;
+        std::string input_name;
+        size_t count = 10000;
+        std::chrono::microseconds interval{1000};
+        probe_mode mode = probe_mode::sysex;
+        std::chrono::seconds report_interval{10};
+        std::chrono::milliseconds timeout{1000};
+        int priority = 0;
+    };
+
+    size_t make_probe(probe_mode mode, uint32_t sequence, uint8_t* data)
+    {
+        if (mode == probe_mode::cc)
+        {
+            data[0] = cc_status;
+            data[1] = cc_controller;
+            data[2] = static_cast<uint8_t>(sequence & 0x7F);
+            return 3;
+        }
+
+        std::copy(sysex_tag.begin(), sysex_tag.end(), data);
+        for (size_t byte_idx = 0; byte_idx < 4; byte_idx++)
+        {
+            data[sysex_tag.size() + byte_idx] = static_cast<uint8_t>((sequence >> (7 * (3 - byte_idx))) & 0x7F);
+        }
+        data[sysex_probe_size - 1] = 0xF7;
+        return sysex_probe_size;
+    }
+
+    double percentile(const std::vector<double>& sorted, double fraction)
+    {
+        const size_t index = std::min(sorted.size() - 1, static_cast<size_t>(fraction * (sorted.size() - 1) + 0.5));
+        return sorted[index];
+    }
+
+    struct summary
+    {
+        size_t count = 0;
+        double min = 0.0;
+        double median = 0.0;
+        double p99 = 0.0;
+        double p999 = 0.0;
+        double max = 0.0;
+        double mean = 0.0;
+        double stddev = 0.0;
+        // Mean difference between consecutive round trips, as RFC 3550 measures jitter.
+        double jitter = 0.0;
+    };
+
+    // Round trips in microseconds, in arrival order.
+    summary summarize(const std::vector<double>& round_trips)
+    {
+        summary result;
+        result.count = round_trips.size();
+        if (round_trips.empty())
+        {
+            return result;
+        }
+
+        double sum = 0.0;
+        double jitter_sum = 0.0;
+        for (size_t sample_idx = 0; sample_idx < round_trips.size(); sample_idx++)
+        {
+            sum += round_trips[sample_idx];
+            if (sample_idx > 0)
+            {
+                jitter_sum += std::abs(round_trips[sample_idx] - round_trips[sample_idx - 1]);
+            }
+        }
+        result.mean = sum / round_trips.size();
+        result.jitter = round_trips.size() > 1 ? jitter_sum / (round_trips.size() - 1) : 0.0;
+
+        double variance = 0.0;
+        for (double round_trip : round_trips)
+        {
+            variance += (round_trip - result.mean) * (round_trip - result.mean);
+        }
+        result.stddev = std::sqrt(variance / round_trips.size());
+
+        std::vector<double> sorted = round_trips;
+        std::sort(sorted.begin(), sorted.end());
+        result.min = sorted.front();
+        result.median = percentile(sorted, 0.5);
+        result.p99 = percentile(sorted, 0.99);
+        result.p999 = percentile(sorted, 0.999);
+        result.max = sorted.back();
+        return result;
+    }
+
+    std::ostream& operator<<(std::ostream& stream, const summary& result)
+    {
+        return stream << std::fixed << std::setprecision(1) << "min " << result.min << " median " << result.median << " p99 " << result.p99
+                      << " p99.9 " << result.p999 << " max " << result.max << " us, stddev " << result.stddev << " jitter "
+                      << result.jitter << " us";
+    }
+
+    // Matches probes coming back on the input, called from the input's backend thread.
+    class probe_tracker
+    {
+      public:
+        probe_tracker(probe_mode mode, size_t count)
+            : _mode(mode)
+            , _sent(count)
+            , _received(count, false)
+        {
+            _round_trips.reserve(count);
+        }
+
+        void on_sent(uint32_t sequence, clock::time_point time)
+        {
+            std::lock_guard<decltype(_mutex)> lock(_mutex);
+            _sent[sequence] = time;
+            _sent_count = sequence + 1;
+        }
+
+        void on_received(const uint8_t* data, size_t size, clock::time_point time)
+        {
+            std::lock_guard<decltype(_mutex)> lock(_mutex);
+            uint32_t sequence = 0;
+            if (!match(data, size, sequence))
+            {
+                _unmatched++;
+                return;
+            }
+
+            if (_received[sequence])
+            {
+                _duplicates++;
+                return;
+            }
+
+            _received[sequence] = true;
+            _round_trips.push_back(std::chrono::duration<double, std::micro>(time - _sent[sequence]).count());
+        }
+
+        // Round trips received since the previous call.
+        std::vector<double> take_window()
+        {
+            std::lock_guard<decltype(_mutex)> lock(_mutex);
+            std::vector<double> window(_round_trips.begin() + _window_begin, _round_trips.end());
+            _window_begin = _round_trips.size();
+            return window;
+        }
+
+        std::vector<double> round_trips() const
+        {
+            std::lock_guard<decltype(_mutex)> lock(_mutex);
+            return _round_trips;
+        }
+
+        size_t unmatched() const
+        {
+            std::lock_guard<decltype(_mutex)> lock(_mutex);
+            return _unmatched;
+        }
+
+        size_t duplicates() const
+        {
+            std::lock_guard<decltype(_mutex)> lock(_mutex);
+            return _duplicates;
+        }
+
+      private:
+        bool match(const uint8_t* data, size_t size, uint32_t& sequence) const
+        {
+            if (_mode == probe_mode::cc)
+            {
+                if (size != 3 || data[0] != cc_status || data[1] != cc_controller || _sent_count == 0)
+                {
+                    return false;
+                }
+
+                // The newest probe with these low bits, the sender keeps fewer than 128 probes in flight.
+                const uint32_t last = static_cast<uint32_t>(_sent_count - 1);
+                const uint32_t back = (last - data[2]) & 0x7F;
+                if (back > last)
+                {
+                    return false;
+                }
+                sequence = last - back;
+                return true;
+            }
+
+            if (size != sysex_probe_size || !std::equal(sysex_tag.begin(), sysex_tag.end(), data))
+            {
+                return false;
+            }
+
+            sequence = 0;
+            for (size_t byte_idx = 0; byte_idx < 4; byte_idx++)
+            {
+                sequence = (sequence << 7) | (data[sysex_tag.size() + byte_idx] & 0x7F);
+            }
+            return sequence < _sent_count;
+        }
+
+        probe_mode _mode;
+        std::vector<clock::time_point> _sent;
+        std::vector<bool> _received;
+        size_t _sent_count = 0;
+        std::vector<double> _round_trips;
+        size_t _window_begin = 0;
+        size_t _unmatched = 0;
+        size_t _duplicates = 0;
+        mutable std::mutex _mutex;
+    };
+
+    bool parse_arguments(int argc, char* argv[], settings& settings)
+    {
+        for (int arg_idx = 1; arg_idx < argc; arg_idx++)
+        {
+            const std::string arg = argv[arg_idx];
+            if (arg == "-l")
+            {
+                settings.loopback = true;
+                continue;
+            }
+
+            if (arg_idx + 1 >= argc)
+            {
+                return false;
+            }
+
+            const std::string value = argv[++arg_idx];
+            if (arg == "-o")
+            {
+                settings.output_name = value;
+            }
+            else if (arg == "-i")
+            {
+                settings.input_name = value;
+            }
+            else if (arg == "-n")
+            {
+                settings.count = std::stoul(value);
+            }
+            else if (arg == "-p")
+            {
+                settings.interval = std::chrono::microseconds(std::stoul(value));
+            }
+            else if (arg == "-m" && (value == "sysex" || value == "cc"))
+            {
+                settings.mode = value == "cc" ? probe_mode::cc : probe_mode::sysex;
+            }
+            else if (arg == "-r")
+            {
+                settings.report_interval = std::chrono::seconds(std::max(1ul, std::stoul(value)));
+            }
+            else if (arg == "-w")
+            {
+                settings.timeout = std::chrono::milliseconds(std::stoul(value));
+            }
+            else if (arg == "-R")
+            {
+                settings.priority = std::stoi(value);
+            }
+            else
+            {
+                return false;
+            }
+        }
+
+        if (settings.count == 0 || settings.count >= (1u << 28))
+        {
+            return false;
+        }
+
+        if (settings.output_name.empty())
+        {
+            settings.output_name = settings.input_name;
+        }
+        if (settings.input_name.empty())
+        {
+            settings.input_name = settings.output_name;
+        }
+        return settings.loopback || !settings.output_name.empty();
+    }
+
+    void print_devices(const smidi::system& system)
+    {
+        std::cout << "output devices:" << std::endl;
+        for (const smidi::device_info& device : system.output_devices())
+        {
+            std::cout << "  " << device.name << std::endl;
+        }
+        std::cout << "input devices:" << std::endl;
+        for (const smidi::device_info& device : system.input_devices())
+        {
+            std::cout << "  " << device.name << std::endl;
+        }
+    }
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    settings settings;
+    if (!parse_arguments(argc, argv, settings))
+    {
+        std::cout << "usage: smidi_ping [-l] [-o output] [-i input] [-n count] [-p interval_us] [-m sysex|cc] [-r report_s] [-w timeout_ms]"
+                  << " [-R priority]" << std::endl;
+        if (argc == 1)
+        {
+            try
+            {
+                print_devices(*smidi::create_system());
+            }
+            catch (const std::exception&)
+            {
+            }
+        }
+        return -1;
+    }
+
+    try
+    {
+        std::unique_ptr<smidi::system> system;
+        if (settings.loopback)
+        {
+            settings.output_name = settings.input_name = "smidi_ping";
+            system = smidi::create_loopback_system({settings.output_name});
+        }
+        else
+        {
+            system = smidi::create_system();
+        }
+
+        smidi::device_options input_options = smidi::default_device_options;
+        if (settings.priority > 0)
+        {
+            input_options.thread_scheduling = SMIDI_THREAD_SCHEDULING_FIFO;
+            input_options.thread_priority = settings.priority;
+            input_options.lock_memory = 1;
+        }
+
+        std::unique_ptr<smidi::output_device> output = system->create_output_device(settings.output_name);
+        std::unique_ptr<smidi::input_device> input = system->create_input_device(settings.input_name, input_options);
+
+        probe_tracker tracker(settings.mode, settings.count);
+        smidi::input_device* input_ptr = input.get();
+        input->set_message_callback([&tracker, input_ptr]() {
+            std::array<uint8_t, 256> buffer;
+            size_t size = 0;
+            while (true)
+            {
+                smidi::result result = input_ptr->try_receive(buffer.data(), buffer.size(), &size, nullptr);
+                if (result == SMIDI_RESULT_BUFFER_TOO_SMALL)
+                {
+                    // Too long to be a probe, it only counts as another message.
+                    std::vector<uint8_t> discard(size);
+                    if (input_ptr->try_receive(discard.data(), discard.size(), nullptr, nullptr) == SMIDI_RESULT_OK)
+                    {
+                        tracker.on_received(discard.data(), discard.size(), clock::now());
+                    }
+                    continue;
+                }
+
+                if (result != SMIDI_RESULT_OK)
+                {
+                    return;
+                }
+
+                // Arrival is taken here rather than from the millisecond device time stamps.
+                tracker.on_received(buffer.data(), size, clock::now());
+            }
+        });
+
+        // Control change probes only carry 7 bits, so the sender waits for the window to drain.
+        if (settings.mode == probe_mode::cc && settings.interval * cc_window < settings.timeout)
+        {
+            settings.interval = std::chrono::duration_cast<std::chrono::microseconds>(settings.timeout) / cc_window + std::chrono::microseconds(1);
+            std::cout << "cc probes: interval raised to " << settings.interval.count() << " us to keep sequence numbers unique" << std::endl;
+        }
+
+        std::cout << "pinging " << settings.output_name << " -> " << settings.input_name << " with " << settings.count << " "
+                  << (settings.mode == probe_mode::cc ? "cc" : "sysex") << " probes every " << settings.interval.count() << " us" << std::endl;
+
+        const clock::time_point start = clock::now();
+        clock::time_point next_send = start;
+        clock::time_point next_report = start + settings.report_interval;
+        std::array<uint8_t, sysex_probe_size> probe;
+        for (uint32_t sequence = 0; sequence < settings.count; sequence++)
+        {
+            std::this_thread::sleep_until(next_send);
+            const size_t size = make_probe(settings.mode, sequence, probe.data());
+            tracker.on_sent(sequence, clock::now());
+            output->send(probe.data(), size);
+            next_send += settings.interval;
+
+            if (clock::now() >= next_report)
+            {
+                std::vector<double> window = tracker.take_window();
+                std::cout << "[" << std::chrono::duration_cast<std::chrono::seconds>(clock::now() - start).count() << " s] "
+                          << window.size() << " probes: " << summarize(window) << std::endl;
+                next_report += settings.report_interval;
+            }
+        }
+        std::this_thread::sleep_for(settings.timeout);
+        input->set_message_callback(nullptr);
+
+        std::vector<double> round_trips = tracker.round_trips();
+        summary result = summarize(round_trips);
+        std::cout << std::endl << "sent " << settings.count << ", received " << round_trips.size() << ", lost "
+                  << settings.count - round_trips.size() << ", duplicates " << tracker.duplicates() << ", other messages "
+                  << tracker.unmatched() << std::endl;
+        if (!round_trips.empty())
+        {
+            std::cout << "round trip: " << result << std::endl;
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cout << "error: " << e.what() << std::endl;
+        return -1;
+    }
+
+    return 0;
+}
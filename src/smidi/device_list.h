@@ -0,0 +1,100 @@
+#ifndef SMIDI_DEVICE_LIST_H
+#define SMIDI_DEVICE_LIST_H
+
+#include "smidi/smidi.h"
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+namespace smidi
+{
+    inline device_info make_device_info(const std::string& name)
+    {
+        device_info info;
+        memset(&info, 0, sizeof(info));
+        memcpy(info.name, name.data(), std::min(sizeof(info.name) - 1, name.size()));
+        return info;
+    }
+
+    inline bool same_device(const device_info& a, const device_info& b) noexcept
+    {
+        return strncmp(a.name, b.name, sizeof(a.name)) == 0 && a.manufacturer == b.manufacturer && a.product == b.product;
+    }
+
+    inline device_change make_device_change(device_change_type type, bool input, const device_info& info)
+    {
+        device_change change;
+        change.type = type;
+        change.input = input ? 1 : 0;
+        change.device_info = info;
+        return change;
+    }
+
+    // Appends the differences between two enumerations to changes. Devices with identical info are matched in order, so
+    // plugging a second unit of the same model reports one addition.
+    inline void diff_device_lists(const std::vector<device_info>& previous, const std::vector<device_info>& current, bool input,
+                                  std::vector<device_change>& changes)
+    {
+        std::vector<bool> matched(current.size(), false);
+        for (const device_info& old_device : previous)
+        {
+            bool found = false;
+            for (size_t device_idx = 0; device_idx < current.size(); device_idx++)
+            {
+                if (!matched[device_idx] && same_device(old_device, current[device_idx]))
+                {
+                    matched[device_idx] = true;
+                    found = true;
+                    break;
+                }
+            }
+
+            if (!found)
+            {
+                changes.push_back(make_device_change(SMIDI_DEVICE_CHANGE_REMOVED, input, old_device));
+            }
+        }
+
+        for (size_t device_idx = 0; device_idx < current.size(); device_idx++)
+        {
+            if (!matched[device_idx])
+            {
+                changes.push_back(make_device_change(SMIDI_DEVICE_CHANGE_ADDED, input, current[device_idx]));
+            }
+        }
+    }
+
+    // Holds the device change callback of a system, notify may be called from any backend thread.
+    class device_change_notifier
+    {
+      public:
+        void set_callback(device_change_callback callback)
+        {
+            std::lock_guard<decltype(_mutex)> lock(_mutex);
+            _callback = std::move(callback);
+        }
+
+        bool has_callback() const
+        {
+            std::lock_guard<decltype(_mutex)> lock(_mutex);
+            return static_cast<bool>(_callback);
+        }
+
+        void notify() const
+        {
+            std::lock_guard<decltype(_mutex)> lock(_mutex);
+            if (_callback)
+            {
+                _callback();
+            }
+        }
+
+      private:
+        mutable std::mutex _mutex;
+        device_change_callback _callback;
+    };
+} // namespace smidi
+
+#endif // SMIDI_DEVICE_LIST_H
@@ -0,0 +1,195 @@
+#ifndef SMIDI_DEVICE_OPTIONS_H
+#define SMIDI_DEVICE_OPTIONS_H
+
+#include "smidi/smidi.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace smidi
+{
+    inline void validate_device_options(const device_options& options)
+    {
+        if (options.buffer_count == 0)
+        {
+            throw std::invalid_argument("Invalid device buffer count.");
+        }
+
+        if (options.buffer_size == 0)
+        {
+            throw std::invalid_argument("Invalid device buffer size.");
+        }
+
+        if (options.queue.capacity == 0)
+        {
+            throw std::invalid_argument("Invalid queue capacity.");
+        }
+    }
+
+    // Applies the scheduling and affinity options to a backend's thread, throws std::system_error if the system refuses
+    // them, typically for lack of privilege.
+    inline void apply_thread_options(std::thread& thread, const device_options& options)
+    {
+#if defined(_WIN32)
+        HANDLE handle = static_cast<HANDLE>(thread.native_handle());
+        // Windows has no per-thread realtime policy, both map to the highest priority of the process' class.
+        if (options.thread_scheduling != SMIDI_THREAD_SCHEDULING_DEFAULT && !SetThreadPriority(handle, THREAD_PRIORITY_TIME_CRITICAL))
+        {
+            throw std::system_error(static_cast<int>(GetLastError()), std::system_category(), "Failed to set thread priority");
+        }
+
+        if (options.cpu_affinity != 0 && SetThreadAffinityMask(handle, static_cast<DWORD_PTR>(options.cpu_affinity)) == 0)
+        {
+            throw std::system_error(static_cast<int>(GetLastError()), std::system_category(), "Failed to set thread affinity");
+        }
+#else
+        if (options.thread_scheduling != SMIDI_THREAD_SCHEDULING_DEFAULT)
+        {
+            const int policy = options.thread_scheduling == SMIDI_THREAD_SCHEDULING_FIFO ? SCHED_FIFO : SCHED_RR;
+            sched_param param = {};
+            param.sched_priority = options.thread_priority;
+            int error = pthread_setschedparam(thread.native_handle(), policy, &param);
+            if (error != 0)
+            {
+                throw std::system_error(error, std::generic_category(), "Failed to set thread scheduling");
+            }
+        }
+
+#if defined(__linux__)
+        if (options.cpu_affinity != 0)
+        {
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            for (int cpu = 0; cpu < 64; cpu++)
+            {
+                if ((options.cpu_affinity >> cpu) & 1)
+                {
+                    CPU_SET(cpu, &cpus);
+                }
+            }
+            int error = pthread_setaffinity_np(thread.native_handle(), sizeof(cpus), &cpus);
+            if (error != 0)
+            {
+                throw std::system_error(error, std::generic_category(), "Failed to set thread affinity");
+            }
+        }
+#endif
+#endif
+    }
+
+    // Page-granular memory locking. mlock does not count, so the buffers are merged into page runs before locking and
+    // the same runs are unlocked as a whole.
+    class memory_lock
+    {
+      public:
+        memory_lock() = default;
+        memory_lock(const memory_lock&) = delete;
+        memory_lock& operator=(const memory_lock&) = delete;
+
+        ~memory_lock()
+        {
+            unlock();
+        }
+
+        void lock(std::vector<std::pair<const void*, size_t>> buffers)
+        {
+            unlock();
+
+            const uintptr_t page = page_size();
+            std::vector<std::pair<uintptr_t, uintptr_t>> pages;
+            for (const auto& buffer : buffers)
+            {
+                if (buffer.second > 0)
+                {
+                    const uintptr_t begin = reinterpret_cast<uintptr_t>(buffer.first);
+                    pages.emplace_back(begin / page * page, (begin + buffer.second + page - 1) / page * page);
+                }
+            }
+            std::sort(pages.begin(), pages.end());
+
+            for (const auto& run : pages)
+            {
+                if (!_runs.empty() && run.first <= _runs.back().second)
+                {
+                    _runs.back().second = std::max(_runs.back().second, run.second);
+                }
+                else
+                {
+                    _runs.push_back(run);
+                }
+            }
+
+            for (size_t run_idx = 0; run_idx < _runs.size(); run_idx++)
+            {
+                void* address = reinterpret_cast<void*>(_runs[run_idx].first);
+                const size_t size = _runs[run_idx].second - _runs[run_idx].first;
+#if defined(_WIN32)
+                const bool locked = VirtualLock(address, size) != 0;
+                const int error = locked ? 0 : static_cast<int>(GetLastError());
+#else
+                const bool locked = mlock(address, size) == 0;
+                const int error = locked ? 0 : errno;
+#endif
+                if (!locked)
+                {
+                    _runs.resize(run_idx);
+                    unlock();
+#if defined(_WIN32)
+                    throw std::system_error(error, std::system_category(), "Failed to lock memory");
+#else
+                    throw std::system_error(error, std::generic_category(), "Failed to lock memory");
+#endif
+                }
+            }
+        }
+
+        void unlock() noexcept
+        {
+            for (const auto& run : _runs)
+            {
+                void* address = reinterpret_cast<void*>(run.first);
+#if defined(_WIN32)
+                VirtualUnlock(address, run.second - run.first);
+#else
+                munlock(address, run.second - run.first);
+#endif
+            }
+            _runs.clear();
+        }
+
+      private:
+        static uintptr_t page_size()
+        {
+#if defined(_WIN32)
+            SYSTEM_INFO info;
+            GetSystemInfo(&info);
+            return info.dwPageSize;
+#else
+            return static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+#endif
+        }
+
+        std::vector<std::pair<uintptr_t, uintptr_t>> _runs;
+    };
+} // namespace smidi
+
+#endif // SMIDI_DEVICE_OPTIONS_H
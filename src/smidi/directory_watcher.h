@@ -0,0 +1,115 @@
+#ifndef SMIDI_DIRECTORY_WATCHER_H
+#define SMIDI_DIRECTORY_WATCHER_H
+
+#if defined(__linux__)
+
+#include <functional>
+#include <poll.h>
+#include <stdint.h>
+#include <string>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <thread>
+#include <unistd.h>
+
+namespace smidi
+{
+    // Reports entries created or removed in a directory from a watcher thread, using inotify. Watching is best effort:
+    // if the directory does not exist or inotify is unavailable, watching() is false and no events are reported.
+    class directory_watcher
+    {
+      public:
+        // Calls on_event(name, mask) for every inotify event matching mask, where mask is a combination of IN_* flags.
+        // When the kernel's event queue overflowed events were lost, on_event is called with an empty name and
+        // IN_Q_OVERFLOW and the directory has to be scanned again.
+        directory_watcher(const std::string& directory, uint32_t mask, std::function<void(const std::string&, uint32_t)> on_event)
+            : _on_event(std::move(on_event))
+        {
+            _inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+            _wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            if (_inotify_fd < 0 || _wake_fd < 0 || inotify_add_watch(_inotify_fd, directory.c_str(), mask) < 0)
+            {
+                close_all();
+                return;
+            }
+
+            _thread = std::thread([this]() { run(); });
+        }
+
+        ~directory_watcher()
+        {
+            if (_thread.joinable())
+            {
+                const uint64_t value = 1;
+                ssize_t written = write(_wake_fd, &value, sizeof(value));
+                (void)written;
+                _thread.join();
+            }
+            close_all();
+        }
+
+        directory_watcher(const directory_watcher&) = delete;
+        directory_watcher& operator=(const directory_watcher&) = delete;
+
+        bool watching() const noexcept
+        {
+            return _thread.joinable();
+        }
+
+      private:
+        void run()
+        {
+            alignas(inotify_event) char buffer[4096];
+            while (true)
+            {
+                pollfd fds[2] = {
+                    {_inotify_fd, POLLIN, 0},
+                    {_wake_fd, POLLIN, 0},
+                };
+                if (poll(fds, 2, -1) < 0 || (fds[1].revents & POLLIN) != 0)
+                {
+                    return;
+                }
+
+                ssize_t size;
+                while ((size = read(_inotify_fd, buffer, sizeof(buffer))) > 0)
+                {
+                    for (ssize_t offset = 0; offset < size;)
+                    {
+                        const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+                        if ((event->mask & IN_Q_OVERFLOW) != 0)
+                        {
+                            _on_event(std::string(), IN_Q_OVERFLOW);
+                        }
+                        else if (event->len > 0)
+                        {
+                            _on_event(event->name, event->mask);
+                        }
+                        offset += sizeof(inotify_event) + event->len;
+                    }
+                }
+            }
+        }
+
+        void close_all() noexcept
+        {
+            for (int* fd : {&_inotify_fd, &_wake_fd})
+            {
+                if (*fd >= 0)
+                {
+                    close(*fd);
+                    *fd = -1;
+                }
+            }
+        }
+
+        std::function<void(const std::string&, uint32_t)> _on_event;
+        int _inotify_fd = -1;
+        int _wake_fd = -1;
+        std::thread _thread;
+    };
+} // namespace smidi
+
+#endif
+
+#endif // SMIDI_DIRECTORY_WATCHER_H
@@ -0,0 +1,385 @@
+#include "smidi/smidi.h"
+#include "smidi/smidi_static.h"
+
+#include "device_list.h"
+#include "device_options.h"
+#include "message_queue.h"
+#include "running_status.h"
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace smidi
+{
+    namespace loopback
+    {
+        // The receiving end of an input device. Ports push to it outside their lock, so a sender waiting for room in
+        // one queue does not hold up other senders or devices opening and closing.
+        class listener
+        {
+          public:
+            listener(const device_options& options)
+                : _start_time(std::chrono::steady_clock::now())
+                , _messages(options.queue)
+            {
+                if (options.lock_memory)
+                {
+                    _messages.lock_memory();
+                }
+            }
+
+            // Returns false if the queue was full under the block policy and wait is false, the message is dropped then.
+            bool push(const uint8_t* data, size_t size, bool wait)
+            {
+                // Milliseconds since the device was opened, matching the resolution of the native backends.
+                auto elapsed = std::chrono::steady_clock::now() - _start_time;
+                time_stamp stamp = std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+                if (!wait)
+                {
+                    return _messages.try_push(data, size, stamp);
+                }
+
+                _messages.push(data, size, stamp);
+                return true;
+            }
+
+            message_queue& messages()
+            {
+                return _messages;
+            }
+
+            // Only called with the port's wire lock held.
+            byte_stream_parser& parser()
+            {
+                return _parser;
+            }
+
+          private:
+            std::chrono::steady_clock::time_point _start_time;
+            message_queue _messages;
+            byte_stream_parser _parser;
+        };
+
+        using shared_listener_ptr = std::shared_ptr<listener>;
+
+        class port
+        {
+          public:
+            port(const loopback_options& options)
+                : _options(options)
+                , _encoder(options.running_status_refresh_interval)
+                , _listeners(std::make_shared<listener_list>())
+            {
+            }
+
+            // The list is replaced, never changed, so deliver can take it under the lock and use it after.
+            void attach(shared_listener_ptr listener)
+            {
+                std::lock_guard<decltype(_mutex)> lock(_mutex);
+                auto listeners = std::make_shared<listener_list>(*_listeners);
+                listeners->push_back(std::move(listener));
+                _listeners = std::move(listeners);
+            }
+
+            void detach(const listener* listener)
+            {
+                std::lock_guard<decltype(_mutex)> lock(_mutex);
+                auto listeners = std::make_shared<listener_list>(*_listeners);
+                listeners->erase(std::remove_if(listeners->begin(), listeners->end(),
+                                                [listener](const shared_listener_ptr& attached) { return attached.get() == listener; }),
+                                 listeners->end());
+                _listeners = std::move(listeners);
+            }
+
+            // Returns false if a listener dropped the message because wait is false and its queue was full under the
+            // block policy. The other listeners still receive it.
+            bool deliver(const uint8_t* data, size_t size, bool wait);
+
+          private:
+            using listener_list = std::vector<shared_listener_ptr>;
+
+            // A message a listener's parser took off the wire, its bytes are at offset in _parsed_bytes.
+            struct parsed_message
+            {
+                listener* target;
+                size_t offset;
+                size_t size;
+            };
+
+            loopback_options _options;
+
+            // Only used to emulate the wire, with _wire_mutex held. The buffers grow to the largest delivery and are
+            // reused after.
+            std::mutex _wire_mutex;
+            running_status_encoder _encoder;
+            std::vector<uint8_t> _wire_bytes;
+            std::vector<uint8_t> _parsed_bytes;
+            std::vector<parsed_message> _parsed;
+
+            std::mutex _mutex;
+            std::shared_ptr<const listener_list> _listeners;
+        };
+
+        using shared_port_ptr = std::shared_ptr<port>;
+
+        output_device::output_device(shared_port_ptr port)
+            : _port(port)
+        {
+        }
+
+        size_t output_device::send(const uint8_t* data, size_t size)
+        {
+            if (data == nullptr)
+            {
+                throw std::invalid_argument("NULL buffer.");
+            }
+
+            if (size == 0)
+            {
+                throw std::invalid_argument("Invalid buffer size.");
+            }
+
+            _port->deliver(data, size, true);
+            return size;
+        }
+
+        result output_device::try_send(const uint8_t* data, size_t size) noexcept
+        {
+            if (data == nullptr || size == 0)
+            {
+                return SMIDI_RESULT_INVALID_ARGUMENT;
+            }
+
+            try
+            {
+                return _port->deliver(data, size, false) ? SMIDI_RESULT_OK : SMIDI_RESULT_WOULD_BLOCK;
+            }
+            catch (const std::bad_alloc&)
+            {
+                // Only until the queues of the listeners have slots for messages of this size.
+                return SMIDI_RESULT_OUT_OF_MEMORY;
+            }
+            catch (...)
+            {
+                return SMIDI_RESULT_DEVICE_ERROR;
+            }
+        }
+
+        input_device::input_device(shared_port_ptr port, const device_options& options)
+            : _port(port)
+            , _listener(std::make_shared<listener>(options))
+            , _ready(&_listener->messages().ready())
+        {
+            _port->attach(_listener);
+        }
+
+        input_device::~input_device()
+        {
+            _listener->messages().close();
+            _port->detach(_listener.get());
+        }
+
+        size_t input_device::receive(uint8_t* data, size_t size, time_stamp* time_stamp)
+        {
+            return _listener->messages().pop(data, size, time_stamp);
+        }
+
+        result input_device::try_receive_queued(uint8_t* data, size_t size, size_t* message_size, time_stamp* time_stamp) noexcept
+        {
+            return _listener->messages().try_pop(data, size, message_size, time_stamp);
+        }
+
+        void input_device::set_queue_options(const queue_options& options)
+        {
+            _listener->messages().set_options(options);
+        }
+
+        queue_statistics input_device::get_queue_statistics() const
+        {
+            return _listener->messages().statistics();
+        }
+
+        void input_device::set_message_callback(message_callback callback)
+        {
+            _listener->messages().set_callback(std::move(callback));
+        }
+
+        bool port::deliver(const uint8_t* data, size_t size, bool wait)
+        {
+            std::shared_ptr<const listener_list> listeners;
+            {
+                std::lock_guard<decltype(_mutex)> lock(_mutex);
+                listeners = _listeners;
+            }
+
+            // Pushing may wait for room under the block policy, the port's lock is not held for it.
+            bool delivered = true;
+            if (!_options.emulate_wire)
+            {
+                for (const shared_listener_ptr& listener : *listeners)
+                {
+                    delivered &= listener->push(data, size, wait);
+                }
+                return delivered;
+            }
+
+            // Every writer shares the wire, so running status is tracked per port and the wire is taken until the
+            // parsed messages are pushed, like a sender waiting for room would hold up a real one. That also keeps the
+            // wire bytes of concurrent senders apart.
+            std::lock_guard<decltype(_wire_mutex)> lock(_wire_mutex);
+            _wire_bytes.resize(size);
+            size_t wire_size = size;
+            if (_options.running_status)
+            {
+                wire_size = _encoder.encode(data, size, _wire_bytes.data());
+            }
+            else
+            {
+                std::copy(data, data + size, _wire_bytes.begin());
+            }
+
+            _parsed_bytes.clear();
+            _parsed.clear();
+            for (const shared_listener_ptr& listener : *listeners)
+            {
+                listener->parser().parse(_wire_bytes.data(), wire_size, [&](const uint8_t* message, size_t message_size) {
+                    _parsed.push_back({listener.get(), _parsed_bytes.size(), message_size});
+                    _parsed_bytes.insert(_parsed_bytes.end(), message, message + message_size);
+                });
+            }
+
+            for (const parsed_message& message : _parsed)
+            {
+                delivered &= message.target->push(_parsed_bytes.data() + message.offset, message.size, wait);
+            }
+            return delivered;
+        }
+
+        class system final : public smidi::system
+        {
+          public:
+            system(const std::vector<std::string>& port_names, const loopback_options& options)
+            {
+                for (const std::string& name : port_names)
+                {
+                    if (name.empty() || name.size() >= SMIDI_MAX_DEVICE_NAME_LENGTH)
+                    {
+                        throw std::invalid_argument("Invalid loopback port name.");
+                    }
+
+                    if (!_ports.emplace(name, std::make_shared<port>(options)).second)
+                    {
+                        throw std::invalid_argument("Duplicate loopback port name.");
+                    }
+
+                    _devices.push_back(make_device_info(name));
+                }
+            }
+
+            const std::vector<device_info>& output_devices() const noexcept override
+            {
+                return _devices;
+            }
+
+            // Loopback devices have no driver buffers or threads, only the queue options apply.
+            std::unique_ptr<smidi::output_device> create_output_device(const std::string& name, const device_options& options) override
+            {
+                return open_output_device(name, options);
+            }
+
+            std::unique_ptr<loopback::output_device> open_output_device(const std::string& name, const device_options& options) const
+            {
+                validate_device_options(options);
+                return std::make_unique<loopback::output_device>(find_port(name));
+            }
+
+            const std::vector<device_info>& input_devices() const noexcept override
+            {
+                return _devices;
+            }
+
+            std::unique_ptr<smidi::input_device> create_input_device(const std::string& name, const device_options& options) override
+            {
+                return open_input_device(name, options);
+            }
+
+            std::unique_ptr<loopback::input_device> open_input_device(const std::string& name, const device_options& options) const
+            {
+                validate_device_options(options);
+                return std::make_unique<loopback::input_device>(find_port(name), options);
+            }
+
+            // Loopback ports are fixed when the system is created.
+            std::vector<device_change> refresh() override
+            {
+                return {};
+            }
+
+            void set_device_change_callback(device_change_callback callback) override
+            {
+                (void)callback;
+            }
+
+          private:
+            shared_port_ptr find_port(const std::string& name) const
+            {
+                auto iter = _ports.find(name);
+                if (iter == _ports.end())
+                {
+                    throw std::invalid_argument("no device with provided name.");
+                }
+                return iter->second;
+            }
+
+            std::vector<device_info> _devices;
+            std::map<std::string, shared_port_ptr> _ports;
+        };
+
+        namespace
+        {
+            system& as_loopback_system(smidi::system& system)
+            {
+                auto* loopback_system = dynamic_cast<loopback::system*>(&system);
+                if (loopback_system == nullptr)
+                {
+                    throw std::invalid_argument("Not a loopback system.");
+                }
+                return *loopback_system;
+            }
+        } // namespace
+
+        std::unique_ptr<output_device> create_output_device(smidi::system& system, const std::string& name, const device_options& options)
+        {
+            return as_loopback_system(system).open_output_device(name, options);
+        }
+
+        std::unique_ptr<input_device> create_input_device(smidi::system& system, const std::string& name, const device_options& options)
+        {
+            return as_loopback_system(system).open_input_device(name, options);
+        }
+    } // namespace loopback
+
+    std::unique_ptr<system> create_loopback_system(const std::vector<std::string>& port_names)
+    {
+        return create_loopback_system(port_names, loopback_options{});
+    }
+
+    std::unique_ptr<system> create_loopback_system(const std::vector<std::string>& port_names, const loopback_options& options)
+    {
+        return std::make_unique<loopback::system>(port_names, options);
+    }
+
+#if !defined(_WIN32) && !defined(__linux__)
+    // No native backend is available on this platform yet, expose a single loopback port so applications still run.
+    std::unique_ptr<system> create_system()
+    {
+        return create_loopback_system({"smidi loopback"});
+    }
+#endif
+} // namespace smidi
@@ -0,0 +1,400 @@
+#ifndef SMIDI_MESSAGE_QUEUE_H
+#define SMIDI_MESSAGE_QUEUE_H
+
+#include "smidi/smidi.h"
+
+#include "device_options.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace smidi
+{
+    // Bounded queue of timestamped messages shared between a backend's producer (driver callback or reader thread) and
+    // the consumer calling input_device::receive. Message storage is a ring of reusable slots, once every slot has
+    // held a message of a given size pushing does not allocate.
+    class message_queue
+    {
+      public:
+        message_queue(const queue_options& options = default_queue_options)
+        {
+            set_options(options);
+        }
+
+        void set_options(const queue_options& options)
+        {
+            if (options.capacity == 0)
+            {
+                throw std::invalid_argument("Invalid queue capacity.");
+            }
+
+            {
+                std::lock_guard<decltype(_mutex)> lock(_mutex);
+
+                std::vector<slot> ring(options.capacity);
+                while (_count > options.capacity)
+                {
+                    drop_front();
+                }
+                for (size_t slot_idx = 0; slot_idx < _count; slot_idx++)
+                {
+                    ring[slot_idx] = std::move(_ring[ring_index(slot_idx)]);
+                }
+
+                _ring = std::move(ring);
+                _head = 0;
+                _options = options;
+
+                _coalesce_sequences.clear();
+                if (_options.overflow_policy == SMIDI_OVERFLOW_POLICY_COALESCE)
+                {
+                    _coalesce_sequences.resize(coalesce_key_count, no_sequence);
+                }
+
+                if (_memory_locked)
+                {
+                    lock_ring();
+                }
+            }
+            _space_cv.notify_all();
+        }
+
+        // Locks the ring into memory, with room for a locked_slot_reserve byte message in every slot, and keeps it
+        // locked across set_options. Longer messages grow their slot into memory that is not locked.
+        void lock_memory()
+        {
+            std::lock_guard<decltype(_mutex)> lock(_mutex);
+            lock_ring();
+            _memory_locked = true;
+        }
+
+        // Called after every push that queued a message and once the queue is closed, from the producer's thread.
+        void set_callback(message_callback callback)
+        {
+            std::lock_guard<decltype(_callback_mutex)> lock(_callback_mutex);
+            _callback = std::move(callback);
+            _has_callback.store(static_cast<bool>(_callback), std::memory_order_release);
+        }
+
+        queue_statistics statistics() const
+        {
+            std::lock_guard<decltype(_mutex)> lock(_mutex);
+            queue_statistics statistics = _statistics;
+            statistics.size = static_cast<unsigned int>(_count);
+            return statistics;
+        }
+
+        void push(const uint8_t* data, size_t size, time_stamp time_stamp)
+        {
+            enqueue(data, size, time_stamp, true);
+        }
+
+        // Push for producers that must not wait. Under the block policy a message that finds the queue full is dropped
+        // and false is returned, the other policies handle it as push does.
+        bool try_push(const uint8_t* data, size_t size, time_stamp time_stamp)
+        {
+            return enqueue(data, size, time_stamp, false);
+        }
+
+        // Blocks until a message is available. If data is null, the size of the next message is returned and the
+        // message is left in the queue. Throws std::runtime_error once the queue is closed and drained.
+        size_t pop(uint8_t* data, size_t size, time_stamp* time_stamp)
+        {
+            size_t message_size = 0;
+            {
+                std::unique_lock<decltype(_mutex)> unique_lock(_mutex);
+                _cv.wait(unique_lock, [this]() { return _count > 0 || _closed; });
+                if (_count == 0)
+                {
+                    throw std::runtime_error("Device disconnected.");
+                }
+
+                const slot& front = _ring[_head];
+                message_size = front.data.size();
+                if (data == nullptr)
+                {
+                    return message_size;
+                }
+
+                if (size < message_size)
+                {
+                    throw std::invalid_argument("Buffer size is not large enough.");
+                }
+
+                std::copy(front.data.begin(), front.data.end(), data);
+                if (time_stamp != nullptr)
+                {
+                    *time_stamp = front.stamp;
+                }
+
+                pop_front();
+            }
+            _space_cv.notify_one();
+
+            return message_size;
+        }
+
+        // Non-blocking pop for input_device::try_receive, a message that does not fit is left in the queue.
+        result try_pop(uint8_t* data, size_t size, size_t* message_size, time_stamp* time_stamp) noexcept
+        {
+            {
+                std::lock_guard<decltype(_mutex)> lock(_mutex);
+                if (_count == 0)
+                {
+                    return _closed ? SMIDI_RESULT_DISCONNECTED : SMIDI_RESULT_NO_MESSAGE;
+                }
+
+                const slot& front = _ring[_head];
+                if (message_size != nullptr)
+                {
+                    *message_size = front.data.size();
+                }
+
+                if (data == nullptr || size < front.data.size())
+                {
+                    return SMIDI_RESULT_BUFFER_TOO_SMALL;
+                }
+
+                std::copy(front.data.begin(), front.data.end(), data);
+                if (time_stamp != nullptr)
+                {
+                    *time_stamp = front.stamp;
+                }
+
+                pop_front();
+            }
+            _space_cv.notify_one();
+
+            return SMIDI_RESULT_OK;
+        }
+
+        // Called when the producer goes away, e.g. the device was unplugged. Wakes any producer blocked on a full queue
+        // and further pushes are dropped. Consumers get the messages still queued, then pop throws and try_pop returns
+        // SMIDI_RESULT_DISCONNECTED. The callback runs once more so consumers waiting on it learn about the disconnect.
+        void close()
+        {
+            {
+                std::lock_guard<decltype(_mutex)> lock(_mutex);
+                if (_closed)
+                {
+                    return;
+                }
+                _closed = true;
+                _ready.store(1, std::memory_order_release);
+            }
+            _space_cv.notify_all();
+            _cv.notify_all();
+            run_callback();
+        }
+
+        size_t size() const
+        {
+            std::lock_guard<decltype(_mutex)> lock(_mutex);
+            return _count;
+        }
+
+        // Non-zero while a message is queued or the queue is closed, i.e. while try_pop has something to say besides
+        // SMIDI_RESULT_NO_MESSAGE. Devices poll it without the lock to answer empty polls inline.
+        const std::atomic<uint32_t>& ready() const noexcept
+        {
+            return _ready;
+        }
+
+      private:
+        struct slot
+        {
+            std::vector<uint8_t> data;
+            smidi::time_stamp stamp = 0;
+        };
+
+        static constexpr size_t locked_slot_reserve = 32;
+        static constexpr size_t no_key = static_cast<size_t>(-1);
+        static constexpr uint64_t no_sequence = static_cast<uint64_t>(-1);
+
+        // Control change: 16 channels x 128 controllers, polyphonic key pressure: 16 channels x 128 keys, then 16
+        // channel pressure and 16 pitch bend keys.
+        static constexpr size_t poly_pressure_key_base = 16 * 128;
+        static constexpr size_t channel_pressure_key_base = poly_pressure_key_base + 16 * 128;
+        static constexpr size_t pitch_bend_key_base = channel_pressure_key_base + 16;
+        static constexpr size_t coalesce_key_count = pitch_bend_key_base + 16;
+
+        static size_t coalesce_key(const uint8_t* data, size_t size)
+        {
+            if (size < 2)
+            {
+                return no_key;
+            }
+
+            size_t channel = data[0] & 0xF;
+            switch (data[0] & 0xF0)
+            {
+            case 0xB0:
+                return channel * 128 + (data[1] & 0x7F);
+            case 0xA0:
+                return poly_pressure_key_base + channel * 128 + (data[1] & 0x7F);
+            case 0xD0:
+                return channel_pressure_key_base + channel;
+            case 0xE0:
+                return pitch_bend_key_base + channel;
+            default:
+                return no_key;
+            }
+        }
+
+        // Replaces the value of the queued message with the same key, the queued message keeps its position and time
+        // stamp so the queue stays in time order.
+        bool coalesce(size_t key, const uint8_t* data, size_t size)
+        {
+            if (key == no_key)
+            {
+                return false;
+            }
+
+            uint64_t sequence = _coalesce_sequences[key];
+            if (sequence == no_sequence || sequence < _front_sequence)
+            {
+                return false;
+            }
+
+            slot& queued = _ring[ring_index(static_cast<size_t>(sequence - _front_sequence))];
+            queued.data.assign(data, data + size);
+            return true;
+        }
+
+        bool enqueue(const uint8_t* data, size_t size, time_stamp time_stamp, bool wait)
+        {
+            {
+                std::unique_lock<decltype(_mutex)> unique_lock(_mutex);
+                _statistics.received++;
+                if (_closed)
+                {
+                    _statistics.dropped++;
+                    return true;
+                }
+
+                size_t key = coalesce_key(data, size);
+                if (_count == _ring.size())
+                {
+                    if (_options.overflow_policy == SMIDI_OVERFLOW_POLICY_BLOCK)
+                    {
+                        if (!wait)
+                        {
+                            _statistics.dropped++;
+                            return false;
+                        }
+
+                        _space_cv.wait(unique_lock, [this]() { return _closed || _count < _ring.size(); });
+                        if (_closed)
+                        {
+                            _statistics.dropped++;
+                            return true;
+                        }
+                    }
+                    else if (_options.overflow_policy == SMIDI_OVERFLOW_POLICY_DROP_NEWEST)
+                    {
+                        _statistics.dropped++;
+                        return true;
+                    }
+                    else if (_options.overflow_policy == SMIDI_OVERFLOW_POLICY_COALESCE && coalesce(key, data, size))
+                    {
+                        _statistics.coalesced++;
+                        return true;
+                    }
+                    else
+                    {
+                        drop_front();
+                    }
+                }
+
+                slot& back = _ring[ring_index(_count)];
+                back.data.assign(data, data + size);
+                back.stamp = time_stamp;
+                if (key != no_key && !_coalesce_sequences.empty())
+                {
+                    _coalesce_sequences[key] = _front_sequence + _count;
+                }
+
+                _count++;
+                _ready.store(1, std::memory_order_release);
+                _statistics.high_water_mark = std::max(_statistics.high_water_mark, static_cast<unsigned int>(_count));
+            }
+            _cv.notify_one();
+            run_callback();
+            return true;
+        }
+
+        void run_callback()
+        {
+            if (_has_callback.load(std::memory_order_acquire))
+            {
+                std::lock_guard<decltype(_callback_mutex)> lock(_callback_mutex);
+                if (_callback)
+                {
+                    _callback();
+                }
+            }
+        }
+
+        void lock_ring()
+        {
+            std::vector<std::pair<const void*, size_t>> buffers;
+            buffers.emplace_back(_ring.data(), _ring.size() * sizeof(slot));
+            buffers.emplace_back(_coalesce_sequences.data(), _coalesce_sequences.size() * sizeof(uint64_t));
+            for (slot& ring_slot : _ring)
+            {
+                ring_slot.data.reserve(locked_slot_reserve);
+                buffers.emplace_back(ring_slot.data.data(), ring_slot.data.capacity());
+            }
+            _memory_lock.lock(std::move(buffers));
+        }
+
+        size_t ring_index(size_t offset) const
+        {
+            return (_head + offset) % _ring.size();
+        }
+
+        void pop_front()
+        {
+            _head = ring_index(1);
+            _front_sequence++;
+            _count--;
+            _ready.store(_count > 0 || _closed ? 1 : 0, std::memory_order_release);
+        }
+
+        void drop_front()
+        {
+            pop_front();
+            _statistics.dropped++;
+        }
+
+        queue_options _options = default_queue_options;
+        std::vector<slot> _ring;
+        size_t _head = 0;
+        size_t _count = 0;
+        bool _closed = false;
+        std::atomic<uint32_t> _ready{0};
+
+        // Sequence numbers count every message that entered the queue, the front message has _front_sequence.
+        uint64_t _front_sequence = 0;
+        std::vector<uint64_t> _coalesce_sequences;
+
+        bool _memory_locked = false;
+        memory_lock _memory_lock;
+
+        queue_statistics _statistics = {};
+        mutable std::mutex _mutex;
+        std::condition_variable _cv;
+        std::condition_variable _space_cv;
+
+        std::mutex _callback_mutex;
+        std::atomic<bool> _has_callback{false};
+        message_callback _callback;
+    };
+} // namespace smidi
+
+#endif // SMIDI_MESSAGE_QUEUE_H
@@ -0,0 +1,550 @@
+#include "smidi/smidi.h"
+#include "smidi/smidi_static.h"
+
+#include <stdexcept>
+
+#if defined(__linux__)
+
+#include "device_list.h"
+#include "device_options.h"
+#include "directory_watcher.h"
+#include "message_queue.h"
+#include "running_status.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <mutex>
+#include <new>
+#include <poll.h>
+#include <sound/asound.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace smidi
+{
+    namespace rawmidi
+    {
+        namespace
+        {
+            // ALSA names rawmidi nodes midiC<card>D<device>.
+            bool parse_node_name(const std::string& file, unsigned int& card, unsigned int& device) noexcept
+            {
+                char trailing = 0;
+                return file.compare(0, 5, "midiC") == 0 && sscanf(file.c_str(), "midiC%uD%u%c", &card, &device, &trailing) == 2;
+            }
+
+            bool is_node_name(const std::string& file) noexcept
+            {
+                unsigned int card = 0;
+                unsigned int device = 0;
+                return parse_node_name(file, card, device);
+            }
+
+            // Names the device after the driver, e.g. "UM-ONE MIDI 1 (hw:1,0)". Nodes that cannot be queried (busy, no
+            // permission, or not a rawmidi device at all) are named after their file.
+            device_info probe_node(const std::string& path, const std::string& file)
+            {
+                unsigned int card = 0;
+                unsigned int device = 0;
+                parse_node_name(file, card, device);
+
+                int fd = open(path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+                if (fd >= 0)
+                {
+                    snd_rawmidi_info info;
+                    memset(&info, 0, sizeof(info));
+                    int result = ioctl(fd, SNDRV_RAWMIDI_IOCTL_INFO, &info);
+                    close(fd);
+                    if (result == 0 && info.name[0] != 0)
+                    {
+                        std::string name(reinterpret_cast<const char*>(info.name), strnlen(reinterpret_cast<const char*>(info.name), sizeof(info.name)));
+                        return make_device_info(name + " (hw:" + std::to_string(card) + "," + std::to_string(device) + ")");
+                    }
+                }
+
+                return make_device_info(file);
+            }
+        } // namespace
+
+        output_device::output_device(const std::string& path, const device_options& options)
+        {
+            if (options.running_status)
+            {
+                _encoder = std::make_unique<running_status_encoder>(options.running_status_refresh_interval);
+            }
+
+            _fd = open(path.c_str(), O_WRONLY | O_CLOEXEC);
+            if (_fd < 0)
+            {
+                throw std::runtime_error("Failed to open " + path + ": " + strerror(errno));
+            }
+        }
+
+        output_device::~output_device()
+        {
+            close(_fd);
+        }
+
+        size_t output_device::send(const uint8_t* data, size_t size)
+        {
+            if (data == nullptr)
+            {
+                throw std::invalid_argument("NULL buffer.");
+            }
+
+            if (size == 0)
+            {
+                throw std::invalid_argument("Invalid buffer size.");
+            }
+
+            int error = write_message(data, size);
+            if (error == ENOMEM)
+            {
+                throw std::bad_alloc();
+            }
+            if (error != 0)
+            {
+                throw std::runtime_error(std::string("Failed to write to rawmidi device: ") + strerror(error));
+            }
+            return size;
+        }
+
+        result output_device::try_send(const uint8_t* data, size_t size) noexcept
+        {
+            if (data == nullptr || size == 0)
+            {
+                return SMIDI_RESULT_INVALID_ARGUMENT;
+            }
+
+            int error = write_message(data, size);
+            if (error == ENOMEM)
+            {
+                return SMIDI_RESULT_OUT_OF_MEMORY;
+            }
+            if (error != 0)
+            {
+                return error == ENODEV ? SMIDI_RESULT_DISCONNECTED : SMIDI_RESULT_DEVICE_ERROR;
+            }
+            return SMIDI_RESULT_OK;
+        }
+
+        int output_device::write_message(const uint8_t* data, size_t size) noexcept
+        {
+            if (!_encoder)
+            {
+                return write_all(data, size);
+            }
+
+            // Encoding and writing are one step so concurrent senders cannot leave the device's running status behind
+            // the encoder's.
+            std::lock_guard<decltype(_mutex)> lock(_mutex);
+            if (_wire.size() < size)
+            {
+                try
+                {
+                    _wire.resize(size);
+                }
+                catch (const std::bad_alloc&)
+                {
+                    return ENOMEM;
+                }
+            }
+
+            size_t wire_size = _encoder->encode(data, size, _wire.data());
+            int error = write_all(_wire.data(), wire_size);
+            if (error != 0)
+            {
+                // Part of the message may be lost, send the next status byte in full.
+                _encoder->reset();
+            }
+            return error;
+        }
+
+        int output_device::write_all(const uint8_t* data, size_t size) noexcept
+        {
+            size_t written = 0;
+            while (written < size)
+            {
+                ssize_t result = write(_fd, data + written, size - written);
+                if (result < 0)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+                    return errno;
+                }
+                written += static_cast<size_t>(result);
+            }
+            return 0;
+        }
+
+        input_device::input_device(const std::string& path, const device_options& options)
+            : _start_time(std::chrono::steady_clock::now())
+            , _buffer(options.buffer_size)
+            , _parser(std::make_unique<byte_stream_parser>())
+            , _messages(std::make_unique<message_queue>(options.queue))
+            , _ready(&_messages->ready())
+        {
+            if (options.lock_memory)
+            {
+                _messages->lock_memory();
+            }
+
+            _fd = open(path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+            if (_fd < 0)
+            {
+                throw std::runtime_error("Failed to open " + path + ": " + strerror(errno));
+            }
+
+            _wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            if (_wake_fd < 0)
+            {
+                int error = errno;
+                close(_fd);
+                throw std::runtime_error(std::string("Failed to create rawmidi wake event: ") + strerror(error));
+            }
+
+            _thread = std::thread([this]() { run(); });
+            try
+            {
+                apply_thread_options(_thread, options);
+            }
+            catch (...)
+            {
+                stop();
+                throw;
+            }
+        }
+
+        input_device::~input_device()
+        {
+            stop();
+        }
+
+        size_t input_device::receive(uint8_t* data, size_t size, time_stamp* time_stamp)
+        {
+            return _messages->pop(data, size, time_stamp);
+        }
+
+        result input_device::try_receive_queued(uint8_t* data, size_t size, size_t* message_size, time_stamp* time_stamp) noexcept
+        {
+            return _messages->try_pop(data, size, message_size, time_stamp);
+        }
+
+        void input_device::set_queue_options(const queue_options& options)
+        {
+            _messages->set_options(options);
+        }
+
+        queue_statistics input_device::get_queue_statistics() const
+        {
+            return _messages->statistics();
+        }
+
+        void input_device::set_message_callback(message_callback callback)
+        {
+            _messages->set_callback(std::move(callback));
+        }
+
+        void input_device::stop()
+        {
+            const uint64_t value = 1;
+            ssize_t written = write(_wake_fd, &value, sizeof(value));
+            (void)written;
+            _thread.join();
+            _messages->close();
+            close(_wake_fd);
+            close(_fd);
+        }
+
+        void input_device::run()
+        {
+            while (true)
+            {
+                pollfd fds[2] = {
+                    {_fd, POLLIN, 0},
+                    {_wake_fd, POLLIN, 0},
+                };
+                if (poll(fds, 2, -1) < 0)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+                    break;
+                }
+
+                if ((fds[1].revents & POLLIN) != 0)
+                {
+                    return;
+                }
+
+                if ((fds[0].revents & (POLLERR | POLLNVAL)) != 0)
+                {
+                    break;
+                }
+
+                ssize_t size = read(_fd, _buffer.data(), _buffer.size());
+                if (size < 0 && (errno == EAGAIN || errno == EINTR))
+                {
+                    continue;
+                }
+                if (size <= 0)
+                {
+                    // Unplugged.
+                    break;
+                }
+
+                // Milliseconds since the device was opened, matching the resolution of the native backends.
+                auto elapsed = std::chrono::steady_clock::now() - _start_time;
+                time_stamp stamp = std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+                _parser->parse(_buffer.data(), static_cast<size_t>(size),
+                               [this, stamp](const uint8_t* message, size_t message_size) { _messages->push(message, message_size, stamp); });
+            }
+
+            // The device is gone, receivers get what was queued and then the disconnect instead of waiting forever.
+            _messages->close();
+        }
+
+        class system final : public smidi::system
+        {
+          public:
+            system(const rawmidi_options& options)
+                : _directory(options.device_directory != nullptr ? options.device_directory : "")
+                , _watcher(_directory, IN_CREATE | IN_ATTRIB | IN_DELETE | IN_MOVED_TO | IN_MOVED_FROM,
+                           [this](const std::string& file, uint32_t mask) { on_directory_event(file, mask); })
+            {
+                if (_directory.empty())
+                {
+                    throw std::invalid_argument("Invalid rawmidi device directory.");
+                }
+
+                for (const std::string& file : scan_directory())
+                {
+                    add_node(file);
+                }
+            }
+
+            const std::vector<device_info>& output_devices() const noexcept override
+            {
+                return _devices;
+            }
+
+            // Outputs write from the caller's thread, only the validation and running status apply to them.
+            std::unique_ptr<smidi::output_device> create_output_device(const std::string& name, const device_options& options) override
+            {
+                return open_output_device(name, options);
+            }
+
+            std::unique_ptr<rawmidi::output_device> open_output_device(const std::string& name, const device_options& options) const
+            {
+                validate_device_options(options);
+                return std::make_unique<rawmidi::output_device>(find_path(name), options);
+            }
+
+            const std::vector<device_info>& input_devices() const noexcept override
+            {
+                return _devices;
+            }
+
+            std::unique_ptr<smidi::input_device> create_input_device(const std::string& name, const device_options& options) override
+            {
+                return open_input_device(name, options);
+            }
+
+            std::unique_ptr<rawmidi::input_device> open_input_device(const std::string& name, const device_options& options) const
+            {
+                validate_device_options(options);
+                return std::make_unique<rawmidi::input_device>(find_path(name), options);
+            }
+
+            // With the directory watched only the nodes named in the queued events are probed, otherwise, or after the
+            // watcher lost events, the directory is scanned again.
+            std::vector<device_change> refresh() override
+            {
+                std::vector<std::pair<std::string, bool>> events;
+                bool rescan = !_watcher.watching();
+                if (!rescan)
+                {
+                    std::lock_guard<decltype(_events_mutex)> lock(_events_mutex);
+                    events.swap(_events);
+                    rescan = _rescan;
+                    _rescan = false;
+                }
+
+                if (rescan)
+                {
+                    events.clear();
+                    std::vector<std::string> files = scan_directory();
+                    for (const std::string& file : _files)
+                    {
+                        if (std::find(files.begin(), files.end(), file) == files.end())
+                        {
+                            events.emplace_back(file, false);
+                        }
+                    }
+                    for (const std::string& file : files)
+                    {
+                        events.emplace_back(file, true);
+                    }
+                }
+
+                std::vector<device_change> changes;
+                for (const auto& event : events)
+                {
+                    auto iter = std::find(_files.begin(), _files.end(), event.first);
+                    if (event.second && iter == _files.end() && access((_directory + "/" + event.first).c_str(), F_OK) == 0)
+                    {
+                        add_node(event.first);
+                        changes.push_back(make_device_change(SMIDI_DEVICE_CHANGE_ADDED, false, _devices.back()));
+                        changes.push_back(make_device_change(SMIDI_DEVICE_CHANGE_ADDED, true, _devices.back()));
+                    }
+                    else if (!event.second && iter != _files.end())
+                    {
+                        size_t node_idx = static_cast<size_t>(iter - _files.begin());
+                        changes.push_back(make_device_change(SMIDI_DEVICE_CHANGE_REMOVED, false, _devices[node_idx]));
+                        changes.push_back(make_device_change(SMIDI_DEVICE_CHANGE_REMOVED, true, _devices[node_idx]));
+                        _files.erase(iter);
+                        _devices.erase(_devices.begin() + node_idx);
+                    }
+                }
+                return changes;
+            }
+
+            void set_device_change_callback(device_change_callback callback) override
+            {
+                _notifier.set_callback(std::move(callback));
+            }
+
+          private:
+            void on_directory_event(const std::string& file, uint32_t mask)
+            {
+                if ((mask & IN_Q_OVERFLOW) != 0)
+                {
+                    std::lock_guard<decltype(_events_mutex)> lock(_events_mutex);
+                    _rescan = true;
+                }
+                else if (is_node_name(file))
+                {
+                    std::lock_guard<decltype(_events_mutex)> lock(_events_mutex);
+                    _events.emplace_back(file, (mask & (IN_DELETE | IN_MOVED_FROM)) == 0);
+                }
+                else
+                {
+                    return;
+                }
+                _notifier.notify();
+            }
+
+            std::vector<std::string> scan_directory() const
+            {
+                std::vector<std::string> files;
+                DIR* directory = opendir(_directory.c_str());
+                if (directory == nullptr)
+                {
+                    return files;
+                }
+
+                while (dirent* entry = readdir(directory))
+                {
+                    if (is_node_name(entry->d_name))
+                    {
+                        files.push_back(entry->d_name);
+                    }
+                }
+                closedir(directory);
+
+                std::sort(files.begin(), files.end());
+                return files;
+            }
+
+            void add_node(const std::string& file)
+            {
+                _files.push_back(file);
+                _devices.push_back(probe_node(_directory + "/" + file, file));
+            }
+
+            std::string find_path(const std::string& name) const
+            {
+                for (size_t node_idx = 0; node_idx < _devices.size(); node_idx++)
+                {
+                    if (_devices[node_idx].name == name)
+                    {
+                        return _directory + "/" + _files[node_idx];
+                    }
+                }
+                throw std::invalid_argument("no device with provided name.");
+            }
+
+            std::string _directory;
+
+            // Parallel lists, every node is both an output and an input device.
+            std::vector<std::string> _files;
+            std::vector<device_info> _devices;
+
+            std::mutex _events_mutex;
+            // Node file name and whether it appeared (true) or went away (false), in arrival order.
+            std::vector<std::pair<std::string, bool>> _events;
+            // The watcher lost events, the next refresh scans the directory.
+            bool _rescan = false;
+            device_change_notifier _notifier;
+            // Last member, its thread stops before the state it reports into goes away.
+            directory_watcher _watcher;
+        };
+
+        namespace
+        {
+            system& as_rawmidi_system(smidi::system& system)
+            {
+                auto* rawmidi_system = dynamic_cast<rawmidi::system*>(&system);
+                if (rawmidi_system == nullptr)
+                {
+                    throw std::invalid_argument("Not a rawmidi system.");
+                }
+                return *rawmidi_system;
+            }
+        } // namespace
+
+        std::unique_ptr<output_device> create_output_device(smidi::system& system, const std::string& name, const device_options& options)
+        {
+            return as_rawmidi_system(system).open_output_device(name, options);
+        }
+
+        std::unique_ptr<input_device> create_input_device(smidi::system& system, const std::string& name, const device_options& options)
+        {
+            return as_rawmidi_system(system).open_input_device(name, options);
+        }
+    } // namespace rawmidi
+
+    std::unique_ptr<system> create_rawmidi_system(const rawmidi_options& options)
+    {
+        return std::make_unique<rawmidi::system>(options);
+    }
+
+    std::unique_ptr<system> create_system()
+    {
+        return create_rawmidi_system(default_rawmidi_options);
+    }
+} // namespace smidi
+
+#else
+
+namespace smidi
+{
+    std::unique_ptr<system> create_rawmidi_system(const rawmidi_options& options)
+    {
+        (void)options;
+        throw std::runtime_error("rawmidi is not supported on this platform.");
+    }
+} // namespace smidi
+
+#endif
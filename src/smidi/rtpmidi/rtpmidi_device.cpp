@@ -0,0 +1,1561 @@
+#include "smidi/smidi.h"
+
+#include <stdexcept>
+
+#if !defined(_WIN32)
+
+#include "device_list.h"
+#include "device_options.h"
+#include "message_queue.h"
+#include "rtpmidi_journal.h"
+#include "running_status.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <mutex>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <random>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace smidi
+{
+    namespace rtpmidi
+    {
+        namespace
+        {
+            // AppleMIDI session commands, sent on both the control and data ports with a 0xFFFF signature.
+            constexpr uint16_t session_signature = 0xFFFF;
+            constexpr uint16_t command_invitation = 0x494E;        // IN
+            constexpr uint16_t command_invitation_accepted = 0x4F4B; // OK
+            constexpr uint16_t command_invitation_rejected = 0x4E4F; // NO
+            constexpr uint16_t command_end_session = 0x4259;       // BY
+            constexpr uint16_t command_synchronization = 0x434B;   // CK
+            constexpr uint16_t command_receiver_feedback = 0x5253; // RS
+            constexpr uint32_t protocol_version = 2;
+
+            constexpr uint8_t rtp_version = 0x80;
+            constexpr uint8_t rtp_payload_type = 0x61;
+            constexpr size_t rtp_header_size = 12;
+
+            // Keeps packets below a typical Ethernet MTU once IP and UDP headers are added.
+            constexpr size_t max_packet_size = 1400;
+            constexpr size_t max_midi_list_size = 1024;
+
+            constexpr uint8_t command_flag_long_header = 0x80;
+            constexpr uint8_t command_flag_journal = 0x40;
+            constexpr uint8_t command_flag_first_delta_time = 0x20;
+
+            using clock = std::chrono::steady_clock;
+            // Session clocks (RTP and CK timestamps) tick at 10 kHz.
+            using ticks = std::chrono::duration<int64_t, std::ratio<1, 10000>>;
+
+            constexpr auto invitation_interval = std::chrono::seconds(1);
+            constexpr auto rejected_invitation_interval = std::chrono::seconds(5);
+            constexpr auto initial_synchronization_interval = std::chrono::milliseconds(1500);
+            constexpr auto synchronization_interval = std::chrono::seconds(10);
+            constexpr int initial_synchronization_count = 6;
+            constexpr auto receiver_feedback_interval = std::chrono::seconds(1);
+            constexpr auto session_timeout = std::chrono::seconds(60);
+            constexpr auto idle_poll_interval = std::chrono::milliseconds(50);
+
+            void write_u16(std::vector<uint8_t>& out, uint16_t value)
+            {
+                out.push_back(static_cast<uint8_t>(value >> 8));
+                out.push_back(static_cast<uint8_t>(value));
+            }
+
+            void write_u32(std::vector<uint8_t>& out, uint32_t value)
+            {
+                write_u16(out, static_cast<uint16_t>(value >> 16));
+                write_u16(out, static_cast<uint16_t>(value));
+            }
+
+            void write_u64(std::vector<uint8_t>& out, uint64_t value)
+            {
+                write_u32(out, static_cast<uint32_t>(value >> 32));
+                write_u32(out, static_cast<uint32_t>(value));
+            }
+
+            uint16_t read_u16(const uint8_t* data) noexcept
+            {
+                return static_cast<uint16_t>((data[0] << 8) | data[1]);
+            }
+
+            uint32_t read_u32(const uint8_t* data) noexcept
+            {
+                return (static_cast<uint32_t>(read_u16(data)) << 16) | read_u16(data + 2);
+            }
+
+            uint64_t read_u64(const uint8_t* data) noexcept
+            {
+                return (static_cast<uint64_t>(read_u32(data)) << 32) | read_u32(data + 4);
+            }
+
+            // MIDI list delta times use the SMF variable length encoding, at most 4 bytes.
+            void write_delta_time(std::vector<uint8_t>& out, uint32_t delta_time)
+            {
+                delta_time = std::min<uint32_t>(delta_time, 0x0FFFFFFF);
+                uint8_t bytes[4];
+                size_t count = 0;
+                do
+                {
+                    bytes[count++] = delta_time & 0x7F;
+                    delta_time >>= 7;
+                } while (delta_time != 0);
+
+                while (count > 0)
+                {
+                    count--;
+                    out.push_back(static_cast<uint8_t>(bytes[count] | (count > 0 ? 0x80 : 0x00)));
+                }
+            }
+
+            bool read_delta_time(const uint8_t* data, size_t size, size_t& offset, uint32_t& delta_time) noexcept
+            {
+                delta_time = 0;
+                for (size_t byte_idx = 0; byte_idx < 4 && offset < size; byte_idx++)
+                {
+                    uint8_t byte = data[offset++];
+                    delta_time = (delta_time << 7) | (byte & 0x7F);
+                    if ((byte & 0x80) == 0)
+                    {
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            bool same_address(const sockaddr_in& a, const sockaddr_in& b) noexcept
+            {
+                return a.sin_addr.s_addr == b.sin_addr.s_addr && a.sin_port == b.sin_port;
+            }
+
+            sockaddr_in with_port_offset(sockaddr_in address, int offset) noexcept
+            {
+                address.sin_port = htons(static_cast<uint16_t>(ntohs(address.sin_port) + offset));
+                return address;
+            }
+
+            sockaddr_in resolve_peer(const std::string& peer)
+            {
+                std::string host = peer;
+                std::string port = std::to_string(SMIDI_DEFAULT_RTP_MIDI_PORT);
+                size_t separator = peer.rfind(':');
+                if (separator != std::string::npos)
+                {
+                    host = peer.substr(0, separator);
+                    port = peer.substr(separator + 1);
+                }
+
+                addrinfo hints;
+                memset(&hints, 0, sizeof(hints));
+                hints.ai_family = AF_INET;
+                hints.ai_socktype = SOCK_DGRAM;
+
+                addrinfo* result = nullptr;
+                if (host.empty() || getaddrinfo(host.c_str(), port.c_str(), &hints, &result) != 0 || result == nullptr)
+                {
+                    throw std::invalid_argument("Unable to resolve RTP-MIDI peer " + peer + ".");
+                }
+
+                sockaddr_in address;
+                memcpy(&address, result->ai_addr, sizeof(address));
+                freeaddrinfo(result);
+                return address;
+            }
+
+            int open_socket(uint16_t port)
+            {
+                int fd = socket(AF_INET, SOCK_DGRAM, 0);
+                if (fd < 0)
+                {
+                    throw std::runtime_error(std::string("Failed to create RTP-MIDI socket: ") + strerror(errno));
+                }
+
+                sockaddr_in address;
+                memset(&address, 0, sizeof(address));
+                address.sin_family = AF_INET;
+                address.sin_addr.s_addr = htonl(INADDR_ANY);
+                address.sin_port = htons(port);
+                if (bind(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0)
+                {
+                    int error = errno;
+                    close(fd);
+                    throw std::runtime_error("Failed to bind RTP-MIDI port " + std::to_string(port) + ": " + strerror(error));
+                }
+
+                fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+                return fd;
+            }
+        } // namespace
+
+        // Sockets shared by the system and every session, kept alive by devices that outlive the system.
+        class transport
+        {
+          public:
+            transport(uint16_t control_port)
+            {
+                control_socket = open_socket(control_port);
+                try
+                {
+                    data_socket = open_socket(static_cast<uint16_t>(control_port + 1));
+                    if (pipe(wake_pipe) != 0)
+                    {
+                        throw std::runtime_error(std::string("Failed to create RTP-MIDI wake pipe: ") + strerror(errno));
+                    }
+                }
+                catch (...)
+                {
+                    close_all();
+                    throw;
+                }
+
+                for (int fd : wake_pipe)
+                {
+                    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+                }
+            }
+
+            ~transport()
+            {
+                close_all();
+            }
+
+            void send(int fd, const sockaddr_in& address, const std::vector<uint8_t>& packet) const noexcept
+            {
+                sendto(fd, packet.data(), packet.size(), 0, reinterpret_cast<const sockaddr*>(&address), sizeof(address));
+            }
+
+            // Wakes the network thread, e.g. when a session has a packet waiting for its packing interval.
+            void wake() const noexcept
+            {
+                const uint8_t byte = 0;
+                ssize_t written = write(wake_pipe[1], &byte, 1);
+                (void)written;
+            }
+
+            int control_socket = -1;
+            int data_socket = -1;
+            int wake_pipe[2] = {-1, -1};
+
+          private:
+            void close_all() noexcept
+            {
+                for (int fd : {control_socket, data_socket, wake_pipe[0], wake_pipe[1]})
+                {
+                    if (fd >= 0)
+                    {
+                        close(fd);
+                    }
+                }
+            }
+        };
+
+        using shared_transport_ptr = std::shared_ptr<transport>;
+
+        struct local_session
+        {
+            std::string name;
+            uint32_t ssrc;
+            clock::time_point epoch;
+            std::chrono::microseconds packing_interval;
+        };
+
+        // The receiving end of an input device, shared by the device and the sessions it listens to.
+        class listener
+        {
+          public:
+            listener(int64_t open_ticks, const device_options& options)
+                : _open_ticks(open_ticks)
+                , _messages(options.queue)
+            {
+                if (options.lock_memory)
+                {
+                    _messages.lock_memory();
+                }
+            }
+
+            // local_ticks is when the message was sent, translated to the local session clock.
+            void push(const uint8_t* data, size_t size, int64_t local_ticks)
+            {
+                // Milliseconds since the device was opened, matching the resolution of the native backends.
+                int64_t elapsed = std::max<int64_t>(0, local_ticks - _open_ticks);
+                _messages.push(data, size, std::chrono::duration_cast<std::chrono::milliseconds>(ticks(elapsed)).count());
+            }
+
+            message_queue& messages()
+            {
+                return _messages;
+            }
+
+          private:
+            int64_t _open_ticks;
+            message_queue _messages;
+        };
+
+        using shared_listener_ptr = std::shared_ptr<listener>;
+        using listener_list = std::vector<shared_listener_ptr>;
+
+        // The messages of one packet with the listeners they go to. A session fills it under its lock and the socket
+        // thread pushes after releasing every lock, so message callbacks can send on any session and a consumer under
+        // the block overflow policy only stalls the socket thread, not senders or devices opening and closing. Reused
+        // for every packet, it stops allocating once it has grown.
+        class received_messages
+        {
+          public:
+            void add(const uint8_t* data, size_t size, int64_t local_ticks)
+            {
+                _messages.push_back({_bytes.size(), size, local_ticks});
+                _bytes.insert(_bytes.end(), data, data + size);
+            }
+
+            void set_listeners(std::shared_ptr<const listener_list> listeners)
+            {
+                _listeners = std::move(listeners);
+            }
+
+            void push()
+            {
+                if (_listeners != nullptr)
+                {
+                    for (const message& received : _messages)
+                    {
+                        for (const shared_listener_ptr& listener : *_listeners)
+                        {
+                            listener->push(_bytes.data() + received.offset, received.size, received.local_ticks);
+                        }
+                    }
+                }
+
+                _bytes.clear();
+                _messages.clear();
+                _listeners.reset();
+            }
+
+          private:
+            struct message
+            {
+                size_t offset;
+                size_t size;
+                int64_t local_ticks;
+            };
+
+            std::vector<uint8_t> _bytes;
+            std::vector<message> _messages;
+            std::shared_ptr<const listener_list> _listeners;
+        };
+
+        enum class session_state
+        {
+            inviting_control,
+            inviting_data,
+            connected,
+            closed,
+        };
+
+        // One remote session. Sessions created for configured peers are persistent and invite the peer again when it
+        // goes away, sessions accepted from remote invitations close when the peer ends them.
+        class session
+        {
+          public:
+            session(shared_transport_ptr transport, const local_session& local, const sockaddr_in& control_address, bool persistent)
+                : _transport(transport)
+                , _local(local)
+                , _control_address(control_address)
+                , _data_address(with_port_offset(control_address, 1))
+                , _persistent(persistent)
+            {
+                std::random_device random;
+                _next_sequence = (random() & 0x7FFF) + 2;
+                _journal.set_checkpoint(_next_sequence - 1);
+            }
+
+            // Initiator side, invitations are repeated by update() until the peer accepts them.
+            void invite(clock::time_point now)
+            {
+                std::lock_guard<decltype(_mutex)> lock(_mutex);
+                _initiator = true;
+                _state = session_state::inviting_control;
+                _token = std::random_device()();
+                _next_invitation = now;
+            }
+
+            // Responder side, called for an invitation received on the control port.
+            void accept(uint32_t token, uint32_t remote_ssrc, const std::string& remote_name, clock::time_point now)
+            {
+                std::lock_guard<decltype(_mutex)> lock(_mutex);
+                _initiator = false;
+                _token = token;
+                _remote_ssrc = remote_ssrc;
+                _remote_name = remote_name;
+                _state = session_state::inviting_data;
+                _last_heard = now;
+                send_session_command(_transport->control_socket, _control_address, command_invitation_accepted);
+            }
+
+            void on_invitation_data(uint32_t token, const sockaddr_in& from, clock::time_point now)
+            {
+                std::lock_guard<decltype(_mutex)> lock(_mutex);
+                if (_initiator)
+                {
+                    return;
+                }
+
+                _token = token;
+                _data_address = from;
+                send_session_command(_transport->data_socket, _data_address, command_invitation_accepted);
+                if (_state != session_state::connected)
+                {
+                    connect(now);
+                }
+            }
+
+            void on_invitation_accepted(bool data_port, uint32_t remote_ssrc, const std::string& remote_name, clock::time_point now)
+            {
+                std::lock_guard<decltype(_mutex)> lock(_mutex);
+                if (!data_port && _state == session_state::inviting_control)
+                {
+                    _remote_ssrc = remote_ssrc;
+                    _remote_name = remote_name;
+                    _state = session_state::inviting_data;
+                    send_invitation(now);
+                }
+                else if (data_port && _state == session_state::inviting_data && remote_ssrc == _remote_ssrc)
+                {
+                    connect(now);
+                    _next_synchronization = now;
+                }
+            }
+
+            void on_invitation_rejected(clock::time_point now)
+            {
+                std::lock_guard<decltype(_mutex)> lock(_mutex);
+                if (_initiator && _state != session_state::connected)
+                {
+                    _state = session_state::inviting_control;
+                    _next_invitation = now + rejected_invitation_interval;
+                }
+            }
+
+            void on_end_session(clock::time_point now)
+            {
+                std::lock_guard<decltype(_mutex)> lock(_mutex);
+                disconnect(now);
+            }
+
+            // Sends BY to the peer, used when the local system shuts down.
+            void end()
+            {
+                std::lock_guard<decltype(_mutex)> lock(_mutex);
+                if (_state == session_state::connected || _state == session_state::inviting_data)
+                {
+                    send_session_command(_transport->control_socket, _control_address, command_end_session);
+                }
+                _state = session_state::closed;
+            }
+
+            void on_synchronization(const uint8_t* data, size_t size, clock::time_point now)
+            {
+                if (size < 36)
+                {
+                    return;
+                }
+
+                std::lock_guard<decltype(_mutex)> lock(_mutex);
+                const uint8_t count = data[8];
+                uint64_t timestamps[3] = {read_u64(data + 12), read_u64(data + 20), read_u64(data + 28)};
+                const uint64_t local_time = static_cast<uint64_t>(now_ticks(now));
+                _last_heard = now;
+
+                if (count == 0)
+                {
+                    timestamps[1] = local_time;
+                    send_synchronization(1, timestamps);
+                }
+                else if (count == 1)
+                {
+                    // Initiator: the remote clock read timestamps[1] halfway through the round trip.
+                    timestamps[2] = local_time;
+                    send_synchronization(2, timestamps);
+                    _clock_offset = static_cast<int64_t>(timestamps[1]) - static_cast<int64_t>((timestamps[0] + timestamps[2]) / 2);
+                    _synchronized = true;
+                }
+                else if (count == 2)
+                {
+                    // Responder: timestamps[0] and [2] are on the initiator's clock, [1] is ours.
+                    _clock_offset = static_cast<int64_t>((timestamps[0] + timestamps[2]) / 2) - static_cast<int64_t>(timestamps[1]);
+                    _synchronized = true;
+                }
+            }
+
+            void on_receiver_feedback(uint16_t sequence)
+            {
+                std::lock_guard<decltype(_mutex)> lock(_mutex);
+                const uint32_t last_sent = _next_sequence - 1;
+                const uint32_t acknowledged = last_sent - static_cast<uint16_t>(static_cast<uint16_t>(last_sent) - sequence);
+                if (acknowledged > _acknowledged_sequence && acknowledged <= last_sent)
+                {
+                    _acknowledged_sequence = acknowledged;
+                    _journal.set_checkpoint(acknowledged);
+                }
+            }
+
+            // Collects the messages of the packet, including those recovered from its journal, into received.
+            void on_rtp_packet(const uint8_t* data, size_t size, clock::time_point now, received_messages& received);
+
+            // Returns false if the session is not connected.
+            bool send(const uint8_t* data, size_t size)
+            {
+                std::lock_guard<decltype(_mutex)> lock(_mutex);
+                if (_state != session_state::connected)
+                {
+                    return false;
+                }
+
+                clock::time_point now = clock::now();
+                _send_parser.parse(data, size, [this, now](const uint8_t* message, size_t message_size) { queue_message(message, message_size, now); });
+                if (_local.packing_interval.count() == 0)
+                {
+                    flush();
+                }
+                return true;
+            }
+
+            // Runs the timers of the session and returns when it next needs attention.
+            clock::time_point update(clock::time_point now)
+            {
+                std::lock_guard<decltype(_mutex)> lock(_mutex);
+                clock::time_point next = now + idle_poll_interval;
+
+                if (_state == session_state::inviting_control || (_initiator && _state == session_state::inviting_data))
+                {
+                    if (now >= _next_invitation)
+                    {
+                        if (_state == session_state::inviting_data)
+                        {
+                            // The data port never answered, start over.
+                            _state = session_state::inviting_control;
+                        }
+                        send_invitation(now);
+                    }
+                    return std::min(next, _next_invitation);
+                }
+
+                if (_state != session_state::connected)
+                {
+                    return next;
+                }
+
+                if (now - _last_heard > session_timeout)
+                {
+                    disconnect(now);
+                    return next;
+                }
+
+                if (_initiator && now >= _next_synchronization)
+                {
+                    uint64_t timestamps[3] = {static_cast<uint64_t>(now_ticks(now)), 0, 0};
+                    send_synchronization(0, timestamps);
+                    _synchronization_count++;
+                    _next_synchronization =
+                        now + (_synchronization_count < initial_synchronization_count ? initial_synchronization_interval : synchronization_interval);
+                }
+                if (_initiator)
+                {
+                    next = std::min(next, _next_synchronization);
+                }
+
+                if (_feedback_due && now >= _next_feedback)
+                {
+                    std::vector<uint8_t> packet;
+                    write_u16(packet, session_signature);
+                    write_u16(packet, command_receiver_feedback);
+                    write_u32(packet, _local.ssrc);
+                    write_u16(packet, _last_received_sequence);
+                    write_u16(packet, 0);
+                    _transport->send(_transport->control_socket, _control_address, packet);
+                    _feedback_due = false;
+                    _next_feedback = now + receiver_feedback_interval;
+                }
+
+                if (!_pending_list.empty())
+                {
+                    clock::time_point flush_time = _pending_time + _local.packing_interval;
+                    if (now >= flush_time)
+                    {
+                        flush();
+                    }
+                    else
+                    {
+                        next = std::min(next, flush_time);
+                    }
+                }
+
+                return next;
+            }
+
+            // The list is replaced, never changed, so received messages can take it under the lock and use it after.
+            void attach(shared_listener_ptr listener)
+            {
+                std::lock_guard<decltype(_mutex)> lock(_mutex);
+                auto listeners = std::make_shared<listener_list>(*_listeners);
+                listeners->push_back(std::move(listener));
+                _listeners = std::move(listeners);
+            }
+
+            void detach(const listener* listener)
+            {
+                std::lock_guard<decltype(_mutex)> lock(_mutex);
+                auto listeners = std::make_shared<listener_list>(*_listeners);
+                listeners->erase(std::remove_if(listeners->begin(), listeners->end(),
+                                                [listener](const shared_listener_ptr& attached) { return attached.get() == listener; }),
+                                 listeners->end());
+                _listeners = std::move(listeners);
+            }
+
+            int64_t now_ticks(clock::time_point now) const noexcept
+            {
+                return std::chrono::duration_cast<ticks>(now - _local.epoch).count();
+            }
+
+            bool is_connected() const
+            {
+                std::lock_guard<decltype(_mutex)> lock(_mutex);
+                return _state == session_state::connected;
+            }
+
+            bool is_closed() const
+            {
+                std::lock_guard<decltype(_mutex)> lock(_mutex);
+                return _state == session_state::closed;
+            }
+
+            bool is_persistent() const noexcept
+            {
+                return _persistent;
+            }
+
+            bool is_inviting() const
+            {
+                std::lock_guard<decltype(_mutex)> lock(_mutex);
+                return _initiator && _state != session_state::connected && _state != session_state::closed;
+            }
+
+            uint32_t token() const
+            {
+                std::lock_guard<decltype(_mutex)> lock(_mutex);
+                return _token;
+            }
+
+            uint32_t remote_ssrc() const
+            {
+                std::lock_guard<decltype(_mutex)> lock(_mutex);
+                return _remote_ssrc;
+            }
+
+            std::string remote_name() const
+            {
+                std::lock_guard<decltype(_mutex)> lock(_mutex);
+                return _remote_name;
+            }
+
+            const sockaddr_in& control_address() const noexcept
+            {
+                return _control_address;
+            }
+
+          private:
+            void connect(clock::time_point now)
+            {
+                _state = session_state::connected;
+                _last_heard = now;
+                _synchronization_count = 0;
+                _synchronized = false;
+                _received_any = false;
+                _receive_sysex.clear();
+            }
+
+            void disconnect(clock::time_point now)
+            {
+                _pending_list.clear();
+                _receiver_journal = journal_receiver();
+                if (_persistent)
+                {
+                    _initiator = true;
+                    _state = session_state::inviting_control;
+                    _token = std::random_device()();
+                    _next_invitation = now + invitation_interval;
+                }
+                else
+                {
+                    _state = session_state::closed;
+                }
+            }
+
+            void send_session_command(int fd, const sockaddr_in& address, uint16_t command)
+            {
+                std::vector<uint8_t> packet;
+                write_u16(packet, session_signature);
+                write_u16(packet, command);
+                write_u32(packet, protocol_version);
+                write_u32(packet, _token);
+                write_u32(packet, _local.ssrc);
+                if (command == command_invitation || command == command_invitation_accepted)
+                {
+                    packet.insert(packet.end(), _local.name.begin(), _local.name.end());
+                    packet.push_back(0);
+                }
+                _transport->send(fd, address, packet);
+            }
+
+            void send_invitation(clock::time_point now)
+            {
+                if (_state == session_state::inviting_control)
+                {
+                    send_session_command(_transport->control_socket, _control_address, command_invitation);
+                }
+                else
+                {
+                    send_session_command(_transport->data_socket, _data_address, command_invitation);
+                }
+                _next_invitation = now + invitation_interval;
+            }
+
+            void send_synchronization(uint8_t count, const uint64_t (&timestamps)[3])
+            {
+                std::vector<uint8_t> packet;
+                write_u16(packet, session_signature);
+                write_u16(packet, command_synchronization);
+                write_u32(packet, _local.ssrc);
+                packet.push_back(count);
+                packet.insert(packet.end(), 3, 0);
+                for (uint64_t timestamp : timestamps)
+                {
+                    write_u64(packet, timestamp);
+                }
+                _transport->send(_transport->data_socket, _data_address, packet);
+            }
+
+            void queue_message(const uint8_t* data, size_t size, clock::time_point now)
+            {
+                if (size + 5 > max_midi_list_size)
+                {
+                    send_system_exclusive_segments(data, size, now);
+                    return;
+                }
+
+                if (_pending_list.size() + size + 4 > max_midi_list_size)
+                {
+                    flush();
+                }
+
+                if (_pending_list.empty())
+                {
+                    _pending_time = now;
+                    _pending_timestamp = static_cast<uint32_t>(now_ticks(now));
+                    _encoder.reset();
+                    if (_local.packing_interval.count() != 0)
+                    {
+                        _transport->wake();
+                    }
+                }
+                else
+                {
+                    write_delta_time(_pending_list, static_cast<uint32_t>(now_ticks(now)) - _pending_timestamp);
+                }
+
+                // Running status is allowed within a MIDI list, the first command of every packet carries its status.
+                size_t offset = _pending_list.size();
+                _pending_list.resize(offset + size);
+                _pending_list.resize(offset + _encoder.encode(data, size, _pending_list.data() + offset));
+                _journal.update(_next_sequence, data, size);
+            }
+
+            // SysEx too large for one packet is split into segments: F0 ... F0, F7 ... F0, F7 ... F7.
+            void send_system_exclusive_segments(const uint8_t* data, size_t size, clock::time_point now)
+            {
+                flush();
+
+                const size_t segment_size = max_midi_list_size - 2;
+                size_t offset = 1;
+                const size_t end = size - 1;
+                while (offset < end)
+                {
+                    size_t count = std::min(segment_size, end - offset);
+                    _pending_time = now;
+                    _pending_timestamp = static_cast<uint32_t>(now_ticks(now));
+                    _pending_list.push_back(offset == 1 ? 0xF0 : 0xF7);
+                    _pending_list.insert(_pending_list.end(), data + offset, data + offset + count);
+                    offset += count;
+                    _pending_list.push_back(offset == end ? 0xF7 : 0xF0);
+                    flush();
+                }
+                _encoder.reset();
+            }
+
+            void flush()
+            {
+                if (_pending_list.empty())
+                {
+                    return;
+                }
+
+                const uint32_t sequence = _next_sequence++;
+
+                _packet.clear();
+                _packet.push_back(rtp_version);
+                _packet.push_back(rtp_payload_type);
+                write_u16(_packet, static_cast<uint16_t>(sequence));
+                write_u32(_packet, _pending_timestamp);
+                write_u32(_packet, _local.ssrc);
+
+                const size_t list_size = _pending_list.size();
+                const bool long_header = list_size > 0x0F;
+                size_t command_header = _packet.size();
+                if (long_header)
+                {
+                    _packet.push_back(static_cast<uint8_t>(command_flag_long_header | ((list_size >> 8) & 0x0F)));
+                    _packet.push_back(static_cast<uint8_t>(list_size));
+                }
+                else
+                {
+                    _packet.push_back(static_cast<uint8_t>(list_size));
+                }
+                _packet.insert(_packet.end(), _pending_list.begin(), _pending_list.end());
+
+                if (_journal.encode(sequence, _packet, max_packet_size - _packet.size()))
+                {
+                    _packet[command_header] |= command_flag_journal;
+                }
+
+                _transport->send(_transport->data_socket, _data_address, _packet);
+                _pending_list.clear();
+            }
+
+            void deliver(const uint8_t* data, size_t size, int64_t local_ticks, received_messages& received);
+            void parse_midi_list(const uint8_t* data, size_t size, bool first_delta_time, int64_t timestamp, received_messages& received);
+            int64_t to_local_ticks(uint32_t timestamp, clock::time_point now) const noexcept;
+
+            shared_transport_ptr _transport;
+            const local_session _local;
+            sockaddr_in _control_address;
+            sockaddr_in _data_address;
+            const bool _persistent;
+
+            mutable std::mutex _mutex;
+            session_state _state = session_state::closed;
+            bool _initiator = false;
+            uint32_t _token = 0;
+            uint32_t _remote_ssrc = 0;
+            std::string _remote_name;
+            clock::time_point _next_invitation;
+            clock::time_point _last_heard;
+
+            int _synchronization_count = 0;
+            clock::time_point _next_synchronization;
+            bool _synchronized = false;
+            // Remote session clock minus the local one, in ticks.
+            int64_t _clock_offset = 0;
+
+            // Output path.
+            byte_stream_parser _send_parser;
+            running_status_encoder _encoder;
+            std::vector<uint8_t> _pending_list;
+            clock::time_point _pending_time;
+            uint32_t _pending_timestamp = 0;
+            std::vector<uint8_t> _packet;
+            uint32_t _next_sequence = 1;
+            uint32_t _acknowledged_sequence = 0;
+            journal_sender _journal;
+
+            // Input path.
+            bool _received_any = false;
+            uint16_t _expected_sequence = 0;
+            uint16_t _last_received_sequence = 0;
+            bool _feedback_due = false;
+            clock::time_point _next_feedback;
+            journal_receiver _receiver_journal;
+            std::vector<uint8_t> _receive_sysex;
+            std::shared_ptr<const listener_list> _listeners = std::make_shared<listener_list>();
+        };
+
+        using shared_session_ptr = std::shared_ptr<session>;
+
+        class output_device final : public smidi::output_device
+        {
+          public:
+            output_device(shared_session_ptr session)
+                : _session(session)
+            {
+            }
+
+            size_t send(const uint8_t* data, size_t size) override
+            {
+                if (data == nullptr)
+                {
+                    throw std::invalid_argument("NULL buffer.");
+                }
+
+                if (size == 0)
+                {
+                    throw std::invalid_argument("Invalid buffer size.");
+                }
+
+                if (!_session->send(data, size))
+                {
+                    throw std::runtime_error("RTP-MIDI session is not connected.");
+                }
+                return size;
+            }
+
+            result try_send(const uint8_t* data, size_t size) noexcept override
+            {
+                if (data == nullptr || size == 0)
+                {
+                    return SMIDI_RESULT_INVALID_ARGUMENT;
+                }
+
+                try
+                {
+                    return _session->send(data, size) ? SMIDI_RESULT_OK : SMIDI_RESULT_DISCONNECTED;
+                }
+                catch (const std::bad_alloc&)
+                {
+                    // Only until the packet and journal buffers have grown to their working size.
+                    return SMIDI_RESULT_OUT_OF_MEMORY;
+                }
+            }
+
+          private:
+            shared_session_ptr _session;
+        };
+
+        class input_device final : public smidi::input_device
+        {
+          public:
+            input_device(shared_session_ptr session, const device_options& options)
+                : _session(session)
+                , _listener(std::make_shared<listener>(session->now_ticks(clock::now()), options))
+            {
+                _session->attach(_listener);
+            }
+
+            virtual ~input_device()
+            {
+                _listener->messages().close();
+                _session->detach(_listener.get());
+            }
+
+            size_t receive(uint8_t* data, size_t size, time_stamp* time_stamp) override
+            {
+                return _listener->messages().pop(data, size, time_stamp);
+            }
+
+            result try_receive(uint8_t* data, size_t size, size_t* message_size, time_stamp* time_stamp) noexcept override
+            {
+                return _listener->messages().try_pop(data, size, message_size, time_stamp);
+            }
+
+            void set_queue_options(const queue_options& options) override
+            {
+                _listener->messages().set_options(options);
+            }
+
+            queue_statistics get_queue_statistics() const override
+            {
+                return _listener->messages().statistics();
+            }
+
+            void set_message_callback(message_callback callback) override
+            {
+                _listener->messages().set_callback(std::move(callback));
+            }
+
+          private:
+            shared_session_ptr _session;
+            // The socket thread may still be pushing to a detached listener, it keeps the listener alive until it is done.
+            shared_listener_ptr _listener;
+        };
+
+        void session::deliver(const uint8_t* data, size_t size, int64_t local_ticks, received_messages& received)
+        {
+            _receiver_journal.update(data, size);
+            received.add(data, size, local_ticks);
+        }
+
+        int64_t session::to_local_ticks(uint32_t timestamp, clock::time_point now) const noexcept
+        {
+            const int64_t local_now = now_ticks(now);
+            if (!_synchronized)
+            {
+                return local_now;
+            }
+
+            // RTP timestamps are the low 32 bits of the sender's clock, extend them around the current remote time.
+            const int64_t remote_now = local_now + _clock_offset;
+            const int32_t age = static_cast<int32_t>(static_cast<uint32_t>(remote_now) - timestamp);
+            return std::min(local_now, remote_now - age - _clock_offset);
+        }
+
+        void session::on_rtp_packet(const uint8_t* data, size_t size, clock::time_point now, received_messages& received)
+        {
+            std::lock_guard<decltype(_mutex)> lock(_mutex);
+            if (_state != session_state::connected || size < rtp_header_size + 1 || (data[0] & 0xC0) != rtp_version ||
+                (data[1] & 0x7F) != rtp_payload_type || read_u32(data + 8) != _remote_ssrc)
+            {
+                return;
+            }
+            _last_heard = now;
+
+            const uint16_t sequence = read_u16(data + 2);
+            const uint32_t timestamp = read_u32(data + 4);
+
+            size_t offset = rtp_header_size + ((data[0] & 0x0F) * 4);
+            if (offset >= size)
+            {
+                return;
+            }
+
+            const uint8_t flags = data[offset];
+            size_t list_size = flags & 0x0F;
+            offset++;
+            if (flags & command_flag_long_header)
+            {
+                if (offset >= size)
+                {
+                    return;
+                }
+                list_size = (list_size << 8) | data[offset++];
+            }
+            if (offset + list_size > size)
+            {
+                return;
+            }
+
+            bool lost = false;
+            if (_received_any)
+            {
+                int16_t distance = static_cast<int16_t>(sequence - _expected_sequence);
+                if (distance < 0)
+                {
+                    // Duplicate or reordered packet, its contents were already recovered from a journal.
+                    return;
+                }
+                lost = distance > 0;
+            }
+            _received_any = true;
+            _expected_sequence = static_cast<uint16_t>(sequence + 1);
+            _last_received_sequence = sequence;
+            _feedback_due = true;
+
+            const int64_t packet_ticks = to_local_ticks(timestamp, now);
+            const uint8_t* list = data + offset;
+            received.set_listeners(_listeners);
+            offset += list_size;
+
+            if (lost && (flags & command_flag_journal) && offset < size)
+            {
+                _receive_sysex.clear();
+                _receiver_journal.recover(data + offset, size - offset, [&](const uint8_t* message, size_t message_size) {
+                    received.add(message, message_size, packet_ticks);
+                });
+            }
+
+            // Phantom status (P flag, running status carried over from the previous packet) is not generated by AppleMIDI
+            // peers, every list starts without running status.
+            parse_midi_list(list, list_size, (flags & command_flag_first_delta_time) != 0, packet_ticks, received);
+        }
+
+        void session::parse_midi_list(const uint8_t* data, size_t size, bool first_delta_time, int64_t timestamp, received_messages& received)
+        {
+            size_t offset = 0;
+            uint8_t running_status = 0;
+            int64_t delta_total = 0;
+            for (size_t command_idx = 0; offset < size; command_idx++)
+            {
+                if (command_idx > 0 || first_delta_time)
+                {
+                    uint32_t delta_time = 0;
+                    if (!read_delta_time(data, size, offset, delta_time) || offset >= size)
+                    {
+                        return;
+                    }
+                    delta_total += delta_time;
+                }
+                const int64_t message_ticks = timestamp + delta_total;
+
+                uint8_t status = data[offset];
+                if (is_status_byte(status))
+                {
+                    offset++;
+                }
+                else if (running_status != 0)
+                {
+                    status = running_status;
+                }
+                else
+                {
+                    return;
+                }
+
+                if (status == 0xF0 || status == 0xF7)
+                {
+                    size_t end = offset;
+                    while (end < size && !is_status_byte(data[end]))
+                    {
+                        end++;
+                    }
+                    if (end >= size)
+                    {
+                        return;
+                    }
+
+                    const uint8_t terminator = data[end];
+                    if (status == 0xF0)
+                    {
+                        _receive_sysex.assign(1, 0xF0);
+                    }
+                    if (!_receive_sysex.empty())
+                    {
+                        _receive_sysex.insert(_receive_sysex.end(), data + offset, data + end);
+                        if (terminator == 0xF7)
+                        {
+                            _receive_sysex.push_back(0xF7);
+                            deliver(_receive_sysex.data(), _receive_sysex.size(), message_ticks, received);
+                            _receive_sysex.clear();
+                        }
+                        else if (terminator != 0xF0)
+                        {
+                            // F4 cancels the SysEx.
+                            _receive_sysex.clear();
+                        }
+                    }
+                    offset = end + 1;
+                    running_status = 0;
+                    continue;
+                }
+
+                if (is_real_time_status(status))
+                {
+                    deliver(&status, 1, message_ticks, received);
+                    continue;
+                }
+
+                const size_t data_size = data_byte_count(status);
+                if (offset + data_size > size)
+                {
+                    return;
+                }
+
+                uint8_t message[3] = {status, 0, 0};
+                memcpy(message + 1, data + offset, data_size);
+                offset += data_size;
+                deliver(message, data_size + 1, message_ticks, received);
+                running_status = is_channel_voice_status(status) ? status : 0;
+            }
+        }
+
+        class system final : public smidi::system
+        {
+          public:
+            system(const rtp_midi_options& options)
+            {
+                if (options.session_name == nullptr || options.session_name[0] == '\0')
+                {
+                    throw std::invalid_argument("Invalid RTP-MIDI session name.");
+                }
+
+                if (options.control_port == 0 || options.control_port == 0xFFFF)
+                {
+                    throw std::invalid_argument("Invalid RTP-MIDI control port.");
+                }
+
+                if (options.peer_count < 0 || (options.peer_count > 0 && options.peers == nullptr))
+                {
+                    throw std::invalid_argument("Invalid RTP-MIDI peer list.");
+                }
+
+                _local.name = options.session_name;
+                _local.ssrc = std::random_device()();
+                _local.epoch = clock::now();
+                _local.packing_interval = std::chrono::microseconds(options.packing_interval_us);
+
+                std::vector<sockaddr_in> peer_addresses;
+                for (int peer_idx = 0; peer_idx < options.peer_count; peer_idx++)
+                {
+                    if (options.peers[peer_idx] == nullptr)
+                    {
+                        throw std::invalid_argument("Invalid RTP-MIDI peer list.");
+                    }
+                    peer_addresses.push_back(resolve_peer(options.peers[peer_idx]));
+                }
+
+                _transport = std::make_shared<transport>(options.control_port);
+
+                for (const sockaddr_in& address : peer_addresses)
+                {
+                    shared_session_ptr peer = std::make_shared<session>(_transport, _local, address, true);
+                    peer->invite(_local.epoch);
+                    _sessions.push_back(peer);
+                }
+
+                _running = true;
+                _thread = std::thread([this]() { run(); });
+            }
+
+            virtual ~system()
+            {
+                _running = false;
+                _transport->wake();
+                _thread.join();
+
+                for (const shared_session_ptr& session : _sessions)
+                {
+                    session->end();
+                }
+            }
+
+            const std::vector<device_info>& output_devices() const noexcept override
+            {
+                return _devices;
+            }
+
+            // Sessions share the system's socket thread, the thread options do not apply to a single device.
+            std::unique_ptr<smidi::output_device> create_output_device(const std::string& name, const device_options& options) override
+            {
+                validate_device_options(options);
+                return std::make_unique<rtpmidi::output_device>(find_session(name));
+            }
+
+            const std::vector<device_info>& input_devices() const noexcept override
+            {
+                return _devices;
+            }
+
+            std::unique_ptr<smidi::input_device> create_input_device(const std::string& name, const device_options& options) override
+            {
+                validate_device_options(options);
+                return std::make_unique<rtpmidi::input_device>(find_session(name), options);
+            }
+
+            std::vector<device_change> refresh() override
+            {
+                std::vector<device_info> devices;
+                {
+                    std::lock_guard<decltype(_mutex)> lock(_mutex);
+                    devices = connected_devices();
+                }
+
+                // Every session is both an output and an input device.
+                std::vector<device_change> changes;
+                diff_device_lists(_devices, devices, false, changes);
+                diff_device_lists(_devices, devices, true, changes);
+                _devices = std::move(devices);
+                return changes;
+            }
+
+            void set_device_change_callback(device_change_callback callback) override
+            {
+                _notifier.set_callback(std::move(callback));
+            }
+
+          private:
+            // Must be called with _mutex held.
+            std::vector<device_info> connected_devices() const
+            {
+                std::vector<device_info> devices;
+                for (const shared_session_ptr& session : _sessions)
+                {
+                    if (session->is_connected())
+                    {
+                        devices.push_back(make_device_info(session->remote_name()));
+                    }
+                }
+                return devices;
+            }
+
+            shared_session_ptr find_session(const std::string& name) const
+            {
+                std::lock_guard<decltype(_mutex)> lock(_mutex);
+                for (const shared_session_ptr& session : _sessions)
+                {
+                    if (session->is_connected() && session->remote_name() == name)
+                    {
+                        return session;
+                    }
+                }
+                throw std::invalid_argument("no device with provided name.");
+            }
+
+            void run()
+            {
+                std::vector<uint8_t> buffer(65536);
+                std::vector<device_info> announced_devices;
+                while (_running)
+                {
+                    clock::time_point now = clock::now();
+                    clock::time_point next = now + idle_poll_interval;
+                    bool devices_changed = false;
+                    {
+                        std::lock_guard<decltype(_mutex)> lock(_mutex);
+                        for (const shared_session_ptr& session : _sessions)
+                        {
+                            next = std::min(next, session->update(now));
+                        }
+                        _sessions.erase(std::remove_if(_sessions.begin(), _sessions.end(),
+                                                       [](const shared_session_ptr& session) { return session->is_closed(); }),
+                                        _sessions.end());
+
+                        std::vector<device_info> devices = connected_devices();
+                        std::vector<device_change> changes;
+                        diff_device_lists(announced_devices, devices, false, changes);
+                        devices_changed = !changes.empty();
+                        announced_devices = std::move(devices);
+                    }
+
+                    if (devices_changed)
+                    {
+                        _notifier.notify();
+                    }
+
+                    auto timeout = std::chrono::duration_cast<std::chrono::milliseconds>(next - clock::now());
+                    pollfd fds[3] = {
+                        {_transport->control_socket, POLLIN, 0},
+                        {_transport->data_socket, POLLIN, 0},
+                        {_transport->wake_pipe[0], POLLIN, 0},
+                    };
+                    if (poll(fds, 3, static_cast<int>(std::max<int64_t>(0, timeout.count()))) <= 0)
+                    {
+                        continue;
+                    }
+
+                    if (fds[2].revents & POLLIN)
+                    {
+                        while (read(_transport->wake_pipe[0], buffer.data(), buffer.size()) > 0)
+                        {
+                        }
+                    }
+
+                    for (size_t fd_idx = 0; fd_idx < 2; fd_idx++)
+                    {
+                        if ((fds[fd_idx].revents & POLLIN) == 0)
+                        {
+                            continue;
+                        }
+
+                        while (true)
+                        {
+                            sockaddr_in from;
+                            socklen_t from_size = sizeof(from);
+                            ssize_t received = recvfrom(fds[fd_idx].fd, buffer.data(), buffer.size(), 0, reinterpret_cast<sockaddr*>(&from), &from_size);
+                            if (received <= 0)
+                            {
+                                break;
+                            }
+                            on_packet(fd_idx == 1, buffer.data(), static_cast<size_t>(received), from, clock::now());
+                        }
+                    }
+                }
+            }
+
+            shared_session_ptr find_session_by_ssrc(uint32_t ssrc) const
+            {
+                for (const shared_session_ptr& session : _sessions)
+                {
+                    if (session->remote_ssrc() == ssrc && !session->is_closed())
+                    {
+                        return session;
+                    }
+                }
+                return nullptr;
+            }
+
+            void on_packet(bool data_port, const uint8_t* data, size_t size, const sockaddr_in& from, clock::time_point now)
+            {
+                shared_session_ptr session;
+                {
+                    std::lock_guard<decltype(_mutex)> lock(_mutex);
+                    if (size >= 4 && read_u16(data) == session_signature)
+                    {
+                        on_session_command(data_port, data, size, from, now);
+                        return;
+                    }
+
+                    if (!data_port || size < rtp_header_size)
+                    {
+                        return;
+                    }
+                    session = find_session_by_ssrc(read_u32(data + 8));
+                }
+
+                if (session != nullptr)
+                {
+                    session->on_rtp_packet(data, size, now, _received);
+                    _received.push();
+                }
+            }
+
+            void on_session_command(bool data_port, const uint8_t* data, size_t size, const sockaddr_in& from, clock::time_point now)
+            {
+                const uint16_t command = read_u16(data + 2);
+                if (command == command_synchronization || command == command_receiver_feedback)
+                {
+                    if (size < 12)
+                    {
+                        return;
+                    }
+                    shared_session_ptr session = find_session_by_ssrc(read_u32(data + 4));
+                    if (session == nullptr)
+                    {
+                        return;
+                    }
+                    if (command == command_synchronization)
+                    {
+                        session->on_synchronization(data, size, now);
+                    }
+                    else
+                    {
+                        session->on_receiver_feedback(read_u16(data + 8));
+                    }
+                    return;
+                }
+
+                if (size < 16 || read_u32(data + 4) != protocol_version)
+                {
+                    return;
+                }
+                const uint32_t token = read_u32(data + 8);
+                const uint32_t ssrc = read_u32(data + 12);
+                std::string name;
+                if (size > 16)
+                {
+                    const char* name_begin = reinterpret_cast<const char*>(data + 16);
+                    name.assign(name_begin, strnlen(name_begin, size - 16));
+                }
+                name = name.substr(0, SMIDI_MAX_DEVICE_NAME_LENGTH - 1);
+
+                switch (command)
+                {
+                case command_invitation:
+                    on_invitation(data_port, token, ssrc, name, from, now);
+                    break;
+
+                case command_invitation_accepted:
+                case command_invitation_rejected:
+                    for (const shared_session_ptr& session : _sessions)
+                    {
+                        if (session->is_inviting() && session->token() == token)
+                        {
+                            if (command == command_invitation_accepted)
+                            {
+                                session->on_invitation_accepted(data_port, ssrc, name, now);
+                            }
+                            else
+                            {
+                                session->on_invitation_rejected(now);
+                            }
+                        }
+                    }
+                    break;
+
+                case command_end_session:
+                    if (shared_session_ptr session = find_session_by_ssrc(ssrc))
+                    {
+                        session->on_end_session(now);
+                    }
+                    break;
+
+                default:
+                    break;
+                }
+            }
+
+            void on_invitation(bool data_port, uint32_t token, uint32_t ssrc, const std::string& name, const sockaddr_in& from, clock::time_point now)
+            {
+                if (data_port)
+                {
+                    if (shared_session_ptr session = find_session_by_ssrc(ssrc))
+                    {
+                        session->on_invitation_data(token, from, now);
+                    }
+                    return;
+                }
+
+                shared_session_ptr session = find_session_by_ssrc(ssrc);
+                if (session == nullptr)
+                {
+                    for (const shared_session_ptr& candidate : _sessions)
+                    {
+                        if (same_address(candidate->control_address(), from))
+                        {
+                            session = candidate;
+                            break;
+                        }
+                    }
+                }
+
+                if (session != nullptr && session->is_inviting() && _local.ssrc < ssrc)
+                {
+                    // Both sides invited each other, the invitation from the lower SSRC wins.
+                    std::vector<uint8_t> packet;
+                    write_u16(packet, session_signature);
+                    write_u16(packet, command_invitation_rejected);
+                    write_u32(packet, protocol_version);
+                    write_u32(packet, token);
+                    write_u32(packet, _local.ssrc);
+                    _transport->send(_transport->control_socket, from, packet);
+                    return;
+                }
+
+                if (session == nullptr)
+                {
+                    session = std::make_shared<rtpmidi::session>(_transport, _local, from, false);
+                    _sessions.push_back(session);
+                }
+                session->accept(token, ssrc, name, now);
+            }
+
+            local_session _local;
+            shared_transport_ptr _transport;
+
+            mutable std::mutex _mutex;
+            std::vector<shared_session_ptr> _sessions;
+            std::vector<device_info> _devices;
+            device_change_notifier _notifier;
+
+            // Only used by the socket thread.
+            received_messages _received;
+
+            std::atomic<bool> _running;
+            std::thread _thread;
+        };
+    } // namespace rtpmidi
+
+    std::unique_ptr<system> create_rtp_midi_system(const rtp_midi_options& options)
+    {
+        return std::make_unique<rtpmidi::system>(options);
+    }
+} // namespace smidi
+
+#else
+
+namespace smidi
+{
+    std::unique_ptr<system> create_rtp_midi_system(const rtp_midi_options& options)
+    {
+        (void)options;
+        throw std::runtime_error("RTP-MIDI is not supported on this platform.");
+    }
+} // namespace smidi
+
+#endif
@@ -0,0 +1,561 @@
+#include "rtpmidi_journal.h"
+
+#include <algorithm>
+
+namespace smidi
+{
+    namespace rtpmidi
+    {
+        namespace
+        {
+            constexpr uint8_t chapter_p = 0x80;
+            constexpr uint8_t chapter_c = 0x40;
+            constexpr uint8_t chapter_m = 0x20;
+            constexpr uint8_t chapter_w = 0x10;
+            constexpr uint8_t chapter_n = 0x08;
+
+            constexpr size_t journal_header_size = 3;
+            constexpr size_t channel_header_size = 3;
+            constexpr size_t max_channel_journal_size = 0x3FF;
+            constexpr size_t max_note_logs = 127;
+
+            bool test_bit(const std::array<uint64_t, 2>& bits, uint8_t idx) noexcept
+            {
+                return (bits[idx >> 6] >> (idx & 63)) & 1;
+            }
+
+            void set_bit(std::array<uint64_t, 2>& bits, uint8_t idx, bool value) noexcept
+            {
+                uint64_t mask = uint64_t(1) << (idx & 63);
+                bits[idx >> 6] = value ? (bits[idx >> 6] | mask) : (bits[idx >> 6] & ~mask);
+            }
+
+            // Sequence numbers are extended to 32 bits by the session, zero is reserved for "never changed". The journal of
+            // a packet covers the changes from the checkpoint up to, but not including, the packet itself.
+            bool in_journal(uint32_t item_sequence, uint32_t checkpoint, uint32_t sequence) noexcept
+            {
+                return item_sequence != 0 && item_sequence >= checkpoint && item_sequence < sequence;
+            }
+        } // namespace
+
+        void channel_state::update(const uint8_t* data, size_t size) noexcept
+        {
+            if (size < 2)
+            {
+                return;
+            }
+
+            switch (data[0] & 0xF0)
+            {
+            case 0x80:
+                set_bit(notes_on, data[1] & 0x7F, false);
+                break;
+
+            case 0x90:
+                if (size >= 3)
+                {
+                    set_bit(notes_on, data[1] & 0x7F, data[2] != 0);
+                }
+                break;
+
+            case 0xB0:
+                if (size >= 3)
+                {
+                    uint8_t controller = data[1] & 0x7F;
+                    controllers[controller] = data[2] & 0x7F;
+                    set_bit(controllers_valid, controller, true);
+                    if (controller == 0)
+                    {
+                        bank_msb = data[2] & 0x7F;
+                    }
+                    else if (controller == 32)
+                    {
+                        bank_lsb = data[2] & 0x7F;
+                    }
+                    else if (controller == 123)
+                    {
+                        notes_on = {0, 0};
+                    }
+                }
+                break;
+
+            case 0xC0:
+                program = data[1] & 0x7F;
+                program_valid = true;
+                break;
+
+            case 0xE0:
+                if (size >= 3)
+                {
+                    pitch_wheel = static_cast<uint16_t>((data[1] & 0x7F) | ((data[2] & 0x7F) << 7));
+                    pitch_wheel_valid = true;
+                }
+                break;
+
+            default:
+                break;
+            }
+        }
+
+        void channel_state::reset() noexcept
+        {
+            *this = channel_state();
+        }
+
+        bool channel_state::note_on(uint8_t note) const noexcept
+        {
+            return test_bit(notes_on, note & 0x7F);
+        }
+
+        bool journal_sender::encode(uint32_t sequence, std::vector<uint8_t>& out, size_t max_size) const
+        {
+            const size_t start = out.size();
+            out.resize(start + journal_header_size);
+
+            size_t channel_count = 0;
+            for (size_t channel_idx = 0; channel_idx < _channels.size(); channel_idx++)
+            {
+                // The channel's last change may be in the packet itself, its earlier changes still belong to the journal
+                // and encode_channel checks every item.
+                const uint32_t channel_sequence = _channels[channel_idx].sequence;
+                if (channel_sequence == 0 || channel_sequence < _checkpoint)
+                {
+                    continue;
+                }
+
+                if (encode_channel(channel_idx, sequence, out))
+                {
+                    channel_count++;
+                }
+            }
+
+            if (channel_count == 0 || out.size() - start > max_size)
+            {
+                out.resize(start);
+                return false;
+            }
+
+            // S = 0, Y = 0 (no system journal), A = 1, H = 0, TOTCHAN, then the checkpoint sequence number.
+            const uint16_t checkpoint = static_cast<uint16_t>(_checkpoint);
+            out[start + 0] = static_cast<uint8_t>(0x20 | (channel_count - 1));
+            out[start + 1] = static_cast<uint8_t>(checkpoint >> 8);
+            out[start + 2] = static_cast<uint8_t>(checkpoint);
+            return true;
+        }
+
+        bool journal_sender::encode_channel(size_t channel_idx, uint32_t sequence, std::vector<uint8_t>& out) const
+        {
+            const channel& state = _channels[channel_idx];
+            const size_t start = out.size();
+            out.resize(start + channel_header_size);
+            uint8_t chapters = 0;
+
+            if (in_journal(state.program_sequence, _checkpoint, sequence))
+            {
+                chapters |= chapter_p;
+                out.push_back(state.program & 0x7F);
+                // B = 1 when the bank select values are meaningful.
+                out.push_back(static_cast<uint8_t>((state.bank_valid ? 0x80 : 0x00) | (state.bank_msb & 0x7F)));
+                out.push_back(state.bank_lsb & 0x7F);
+            }
+
+            size_t controller_header = out.size();
+            size_t controller_count = 0;
+            for (size_t controller = 0; controller < state.controllers.size(); controller++)
+            {
+                if (!in_journal(state.controller_sequences[controller], _checkpoint, sequence))
+                {
+                    continue;
+                }
+
+                if (controller_count == 0)
+                {
+                    out.push_back(0);
+                }
+                out.push_back(static_cast<uint8_t>(controller));
+                out.push_back(state.controllers[controller] & 0x7F);
+                controller_count++;
+            }
+            if (controller_count > 0)
+            {
+                chapters |= chapter_c;
+                out[controller_header] = static_cast<uint8_t>(controller_count - 1);
+            }
+
+            if (in_journal(state.pitch_wheel_sequence, _checkpoint, sequence))
+            {
+                chapters |= chapter_w;
+                out.push_back(state.pitch_wheel & 0x7F);
+                out.push_back((state.pitch_wheel >> 7) & 0x7F);
+            }
+
+            std::array<uint8_t, 16> off_bits = {0};
+            uint8_t off_low = 16;
+            uint8_t off_high = 0;
+            size_t note_header = out.size();
+            size_t note_count = 0;
+            for (size_t note = 0; note < state.note_velocities.size(); note++)
+            {
+                if (!in_journal(state.note_sequences[note], _checkpoint, sequence))
+                {
+                    continue;
+                }
+
+                if (state.note_velocities[note] == 0)
+                {
+                    uint8_t octet = static_cast<uint8_t>(note >> 3);
+                    off_bits[octet] |= static_cast<uint8_t>(0x80 >> (note & 7));
+                    off_low = std::min(off_low, octet);
+                    off_high = std::max(off_high, octet);
+                    continue;
+                }
+
+                if (note_count == max_note_logs)
+                {
+                    continue;
+                }
+
+                if (note_count == 0)
+                {
+                    out.resize(out.size() + 2);
+                }
+                // Y = 1, the note is still worth playing when recovered.
+                out.push_back(static_cast<uint8_t>(note));
+                out.push_back(static_cast<uint8_t>(0x80 | state.note_velocities[note]));
+                note_count++;
+            }
+            if (off_low <= off_high && note_count == 0)
+            {
+                out.resize(out.size() + 2);
+            }
+            if (note_count > 0 || off_low <= off_high)
+            {
+                chapters |= chapter_n;
+                if (off_low > off_high)
+                {
+                    // LOW > HIGH means no OFFBITS octets. LOW = 15, HIGH = 0 is reserved for 128 note logs.
+                    off_low = 1;
+                    off_high = 0;
+                }
+                out[note_header + 0] = static_cast<uint8_t>(note_count);
+                out[note_header + 1] = static_cast<uint8_t>((off_low << 4) | off_high);
+                for (uint8_t octet = off_low; octet <= off_high && off_low <= off_high; octet++)
+                {
+                    out.push_back(off_bits[octet]);
+                }
+            }
+
+            const size_t length = out.size() - start;
+            if (chapters == 0 || length > max_channel_journal_size)
+            {
+                out.resize(start);
+                return false;
+            }
+
+            // S = 0, CHAN, H = 0, LENGTH, then the chapter table of contents.
+            out[start + 0] = static_cast<uint8_t>((channel_idx << 3) | ((length >> 8) & 0x03));
+            out[start + 1] = static_cast<uint8_t>(length);
+            out[start + 2] = chapters;
+            return true;
+        }
+
+        void journal_sender::update(uint32_t sequence, const uint8_t* data, size_t size) noexcept
+        {
+            if (size < 2 || data[0] < 0x80 || data[0] >= 0xF0)
+            {
+                return;
+            }
+
+            channel& state = _channels[data[0] & 0x0F];
+            switch (data[0] & 0xF0)
+            {
+            case 0x80:
+                state.note_velocities[data[1] & 0x7F] = 0;
+                state.note_sequences[data[1] & 0x7F] = sequence;
+                break;
+
+            case 0x90:
+                if (size < 3)
+                {
+                    return;
+                }
+                state.note_velocities[data[1] & 0x7F] = data[2] & 0x7F;
+                state.note_sequences[data[1] & 0x7F] = sequence;
+                break;
+
+            case 0xB0:
+                if (size < 3)
+                {
+                    return;
+                }
+                state.controllers[data[1] & 0x7F] = data[2] & 0x7F;
+                state.controller_sequences[data[1] & 0x7F] = sequence;
+                if ((data[1] & 0x7F) == 0)
+                {
+                    state.bank_msb = data[2] & 0x7F;
+                    state.bank_valid = true;
+                }
+                else if ((data[1] & 0x7F) == 32)
+                {
+                    state.bank_lsb = data[2] & 0x7F;
+                    state.bank_valid = true;
+                }
+                break;
+
+            case 0xC0:
+                state.program = data[1] & 0x7F;
+                state.program_sequence = sequence;
+                break;
+
+            case 0xE0:
+                if (size < 3)
+                {
+                    return;
+                }
+                state.pitch_wheel = static_cast<uint16_t>((data[1] & 0x7F) | ((data[2] & 0x7F) << 7));
+                state.pitch_wheel_sequence = sequence;
+                break;
+
+            default:
+                // Poly and channel pressure are not journalled.
+                return;
+            }
+
+            state.sequence = sequence;
+        }
+
+        void journal_sender::set_checkpoint(uint32_t sequence) noexcept
+        {
+            // Everything up to and including the acknowledged packet is known to the receiver.
+            _checkpoint = sequence + 1;
+        }
+
+        void journal_receiver::update(const uint8_t* data, size_t size) noexcept
+        {
+            if (size < 2 || data[0] < 0x80 || data[0] >= 0xF0)
+            {
+                return;
+            }
+            _channels[data[0] & 0x0F].update(data, size);
+        }
+
+        size_t journal_receiver::journal_size(const uint8_t* data, size_t size) noexcept
+        {
+            if (size < journal_header_size)
+            {
+                return 0;
+            }
+
+            const uint8_t header = data[0];
+            size_t offset = journal_header_size;
+
+            // Y: system journal, its length is in the low 10 bits of its first two bytes.
+            if (header & 0x40)
+            {
+                if (offset + 2 > size)
+                {
+                    return 0;
+                }
+                size_t system_length = ((data[offset] & 0x03) << 8) | data[offset + 1];
+                if (system_length < 2)
+                {
+                    return 0;
+                }
+                offset += system_length;
+            }
+
+            if (header & 0x20)
+            {
+                size_t channel_count = (header & 0x0F) + 1;
+                for (size_t channel_idx = 0; channel_idx < channel_count; channel_idx++)
+                {
+                    if (offset + channel_header_size > size)
+                    {
+                        return 0;
+                    }
+                    size_t length = ((data[offset] & 0x03) << 8) | data[offset + 1];
+                    if (length < channel_header_size)
+                    {
+                        return 0;
+                    }
+                    offset += length;
+                }
+            }
+
+            return offset <= size ? offset : 0;
+        }
+
+        size_t journal_receiver::recover(const uint8_t* data, size_t size, const recovery_callback& callback)
+        {
+            const size_t journal_length = journal_size(data, size);
+            if (journal_length == 0)
+            {
+                return 0;
+            }
+
+            const uint8_t header = data[0];
+            size_t offset = journal_header_size;
+            if (header & 0x40)
+            {
+                // System chapters are not generated by this implementation and are skipped.
+                offset += ((data[offset] & 0x03) << 8) | data[offset + 1];
+            }
+
+            if (header & 0x20)
+            {
+                size_t channel_count = (header & 0x0F) + 1;
+                for (size_t channel_idx = 0; channel_idx < channel_count; channel_idx++)
+                {
+                    size_t length = ((data[offset] & 0x03) << 8) | data[offset + 1];
+                    uint8_t channel = (data[offset] >> 3) & 0x0F;
+                    uint8_t chapters = data[offset + 2];
+                    recover_channel(channel, chapters, data + offset + channel_header_size, length - channel_header_size, callback);
+                    offset += length;
+                }
+            }
+
+            return journal_length;
+        }
+
+        void journal_receiver::recover_channel(uint8_t channel, uint8_t chapters, const uint8_t* data, size_t size,
+                                               const recovery_callback& callback)
+        {
+            channel_state& state = _channels[channel];
+            size_t offset = 0;
+
+            auto emit = [&](uint8_t status, uint8_t data1, uint8_t data2, size_t message_size) {
+                const uint8_t message[3] = {static_cast<uint8_t>(status | channel), data1, data2};
+                state.update(message, message_size);
+                callback(message, message_size);
+            };
+
+            if (chapters & chapter_p)
+            {
+                if (offset + 3 > size)
+                {
+                    return;
+                }
+                uint8_t program = data[offset] & 0x7F;
+                bool bank_valid = (data[offset + 1] & 0x80) != 0;
+                uint8_t bank_msb = data[offset + 1] & 0x7F;
+                uint8_t bank_lsb = data[offset + 2] & 0x7F;
+                offset += 3;
+
+                bool bank_differs = bank_valid && (bank_msb != state.bank_msb || bank_lsb != state.bank_lsb);
+                if (bank_differs)
+                {
+                    emit(0xB0, 0, bank_msb, 3);
+                    emit(0xB0, 32, bank_lsb, 3);
+                }
+                if (bank_differs || !state.program_valid || state.program != program)
+                {
+                    emit(0xC0, program, 0, 2);
+                }
+            }
+
+            if (chapters & chapter_c)
+            {
+                if (offset + 1 > size)
+                {
+                    return;
+                }
+                size_t log_count = (data[offset] & 0x7F) + 1;
+                offset++;
+                for (size_t log_idx = 0; log_idx < log_count; log_idx++, offset += 2)
+                {
+                    if (offset + 2 > size)
+                    {
+                        return;
+                    }
+                    uint8_t controller = data[offset] & 0x7F;
+                    uint8_t value = data[offset + 1] & 0x7F;
+                    // A = 1 logs carry toggle or count tools that are not generated by this implementation.
+                    if ((data[offset + 1] & 0x80) != 0)
+                    {
+                        continue;
+                    }
+                    if (!test_bit(state.controllers_valid, controller) || state.controllers[controller] != value)
+                    {
+                        emit(0xB0, controller, value, 3);
+                    }
+                }
+            }
+
+            if (chapters & chapter_m)
+            {
+                // Parameter system chapter, its length is in the low 10 bits of the header.
+                if (offset + 2 > size)
+                {
+                    return;
+                }
+                offset += ((data[offset] & 0x03) << 8) | data[offset + 1];
+            }
+
+            if (chapters & chapter_w)
+            {
+                if (offset + 2 > size)
+                {
+                    return;
+                }
+                uint16_t pitch_wheel = static_cast<uint16_t>((data[offset] & 0x7F) | ((data[offset + 1] & 0x7F) << 7));
+                offset += 2;
+                if (!state.pitch_wheel_valid || state.pitch_wheel != pitch_wheel)
+                {
+                    emit(0xE0, pitch_wheel & 0x7F, (pitch_wheel >> 7) & 0x7F, 3);
+                }
+            }
+
+            if (chapters & chapter_n)
+            {
+                if (offset + 2 > size)
+                {
+                    return;
+                }
+                size_t log_count = data[offset] & 0x7F;
+                uint8_t off_low = data[offset + 1] >> 4;
+                uint8_t off_high = data[offset + 1] & 0x0F;
+                if (log_count == 127 && off_low == 15 && off_high == 0)
+                {
+                    log_count = 128;
+                }
+                offset += 2;
+
+                // Note offs first so a retriggered note ends up sounding.
+                size_t off_offset = offset + log_count * 2;
+                for (uint8_t octet = off_low; octet <= off_high && off_low <= off_high; octet++, off_offset++)
+                {
+                    if (off_offset >= size)
+                    {
+                        return;
+                    }
+                    for (uint8_t bit = 0; bit < 8; bit++)
+                    {
+                        uint8_t note = static_cast<uint8_t>(octet * 8 + bit);
+                        if ((data[off_offset] & (0x80 >> bit)) != 0 && state.note_on(note))
+                        {
+                            emit(0x80, note, 0x40, 3);
+                        }
+                    }
+                }
+
+                for (size_t log_idx = 0; log_idx < log_count; log_idx++, offset += 2)
+                {
+                    if (offset + 2 > size)
+                    {
+                        return;
+                    }
+                    uint8_t note = data[offset] & 0x7F;
+                    uint8_t velocity = data[offset + 1] & 0x7F;
+                    bool play = (data[offset + 1] & 0x80) != 0;
+                    if (play && velocity != 0 && !state.note_on(note))
+                    {
+                        emit(0x90, note, velocity, 3);
+                    }
+                }
+            }
+
+            // Chapters E (note extras), T (channel aftertouch) and A (poly aftertouch) carry nothing this receiver
+            // tracks, they are ignored.
+        }
+    } // namespace rtpmidi
+} // namespace smidi
@@ -0,0 +1,104 @@
+#ifndef SMIDI_RTPMIDI_JOURNAL_H
+#define SMIDI_RTPMIDI_JOURNAL_H
+
+#include <array>
+#include <functional>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace smidi
+{
+    namespace rtpmidi
+    {
+        // Recovery journal (RFC 6295) support for the channel chapters P (program change), C (control change),
+        // W (pitch wheel) and N (note on/off). The journal of every packet describes the stream state changed since the
+        // checkpoint packet, which is the last packet the receiver acknowledged with an RS command.
+
+        using recovery_callback = std::function<void(const uint8_t* data, size_t size)>;
+
+        // Receiver side view of the channel state, used to decide which journal entries differ from what was heard.
+        class channel_state
+        {
+          public:
+            void update(const uint8_t* data, size_t size) noexcept;
+            void reset() noexcept;
+
+            bool note_on(uint8_t note) const noexcept;
+
+            std::array<uint64_t, 2> notes_on = {0, 0};
+            std::array<uint8_t, 128> controllers = {0};
+            std::array<uint64_t, 2> controllers_valid = {0, 0};
+            uint8_t program = 0;
+            uint8_t bank_msb = 0;
+            uint8_t bank_lsb = 0;
+            bool program_valid = false;
+            uint16_t pitch_wheel = 0x2000;
+            bool pitch_wheel_valid = false;
+        };
+
+        class journal_sender
+        {
+          public:
+            // Appends the journal for the packet with extended sequence number sequence to out, limited to max_size
+            // bytes. Returns false (and leaves out untouched) when there is nothing to journal or it does not fit.
+            bool encode(uint32_t sequence, std::vector<uint8_t>& out, size_t max_size) const;
+
+            // Records a command sent in the packet with extended sequence number sequence.
+            void update(uint32_t sequence, const uint8_t* data, size_t size) noexcept;
+
+            // The receiver acknowledged every packet up to and including sequence. Sessions also set it to the sequence
+            // number preceding their first packet. Extended sequence numbers must be greater than zero.
+            void set_checkpoint(uint32_t sequence) noexcept;
+
+          private:
+            struct channel
+            {
+                // Extended sequence number of the last change of each item, zero for never changed.
+                uint32_t program_sequence = 0;
+                uint8_t program = 0;
+                uint8_t bank_msb = 0;
+                uint8_t bank_lsb = 0;
+                bool bank_valid = false;
+
+                std::array<uint32_t, 128> controller_sequences = {0};
+                std::array<uint8_t, 128> controllers = {0};
+
+                uint32_t pitch_wheel_sequence = 0;
+                uint16_t pitch_wheel = 0;
+
+                std::array<uint32_t, 128> note_sequences = {0};
+                std::array<uint8_t, 128> note_velocities = {0};
+
+                uint32_t sequence = 0;
+            };
+
+            bool encode_channel(size_t channel_idx, uint32_t sequence, std::vector<uint8_t>& out) const;
+
+            std::array<channel, 16> _channels;
+            // First packet not acknowledged by the receiver, the journal covers every change from there on.
+            uint32_t _checkpoint = 1;
+        };
+
+        class journal_receiver
+        {
+          public:
+            // Tracks a command received from the stream.
+            void update(const uint8_t* data, size_t size) noexcept;
+
+            // Parses a journal and emits the commands needed to bring the receiver state in line with it. Returns the
+            // number of journal bytes consumed, zero if the journal is malformed.
+            size_t recover(const uint8_t* data, size_t size, const recovery_callback& callback);
+
+            // Size of a journal without acting on it.
+            static size_t journal_size(const uint8_t* data, size_t size) noexcept;
+
+          private:
+            void recover_channel(uint8_t channel, uint8_t chapters, const uint8_t* data, size_t size, const recovery_callback& callback);
+
+            std::array<channel_state, 16> _channels;
+        };
+    } // namespace rtpmidi
+} // namespace smidi
+
+#endif // SMIDI_RTPMIDI_JOURNAL_H
@@ -0,0 +1,222 @@
+#ifndef SMIDI_RUNNING_STATUS_H
+#define SMIDI_RUNNING_STATUS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace smidi
+{
+    // Byte stream helpers for serial-like transports (DIN, rawmidi, tty) following the MIDI 1.0 rules:
+    //  - channel voice messages may omit their status byte when it matches the previous channel voice status,
+    //  - system common messages (including SysEx) cancel running status,
+    //  - system real time messages may appear anywhere, even inside other messages, and leave running status alone.
+    inline bool is_status_byte(uint8_t byte) noexcept
+    {
+        return (byte & 0x80) != 0;
+    }
+
+    inline bool is_channel_voice_status(uint8_t status) noexcept
+    {
+        return status >= 0x80 && status < 0xF0;
+    }
+
+    inline bool is_real_time_status(uint8_t status) noexcept
+    {
+        return status >= 0xF8;
+    }
+
+    // Number of data bytes following a status byte, SysEx is variable length and reported as zero.
+    inline size_t data_byte_count(uint8_t status) noexcept
+    {
+        switch (status & 0xF0)
+        {
+        case 0x80:
+        case 0x90:
+        case 0xA0:
+        case 0xB0:
+        case 0xE0:
+            return 2;
+        case 0xC0:
+        case 0xD0:
+            return 1;
+        default:
+            break;
+        }
+
+        switch (status)
+        {
+        case 0xF1:
+        case 0xF3:
+            return 1;
+        case 0xF2:
+            return 2;
+        default:
+            return 0;
+        }
+    }
+
+    class running_status_encoder
+    {
+      public:
+        // refresh_interval is the maximum number of consecutive messages sent without a status byte, after which the
+        // status is sent again so receivers joining mid-stream can lock on. Zero disables refreshing.
+        explicit running_status_encoder(size_t refresh_interval = 0) noexcept
+            : _refresh_interval(refresh_interval)
+        {
+        }
+
+        // Writes the wire representation of one complete message to out, which must hold at least size bytes. Returns
+        // the number of bytes written.
+        size_t encode(const uint8_t* data, size_t size, uint8_t* out) noexcept
+        {
+            if (size == 0)
+            {
+                return 0;
+            }
+
+            const uint8_t status = data[0];
+            size_t skip = 0;
+            if (is_channel_voice_status(status))
+            {
+                bool refresh_due = _refresh_interval != 0 && _omitted_count >= _refresh_interval;
+                if (status == _running_status && !refresh_due)
+                {
+                    skip = 1;
+                    _omitted_count++;
+                }
+                else
+                {
+                    _running_status = status;
+                    _omitted_count = 0;
+                }
+            }
+            else if (!is_real_time_status(status))
+            {
+                reset();
+            }
+
+            for (size_t byte_idx = skip; byte_idx < size; byte_idx++)
+            {
+                out[byte_idx - skip] = data[byte_idx];
+            }
+            return size - skip;
+        }
+
+        // Forces the next channel voice message to carry its status byte, e.g. after the link was interrupted.
+        void reset() noexcept
+        {
+            _running_status = 0;
+            _omitted_count = 0;
+        }
+
+      private:
+        size_t _refresh_interval;
+        uint8_t _running_status = 0;
+        size_t _omitted_count = 0;
+    };
+
+    // Splits a MIDI 1.0 byte stream back into complete messages with explicit status bytes.
+    class byte_stream_parser
+    {
+      public:
+        // Calls callback(const uint8_t* data, size_t size) for every complete message in the bytes.
+        template <typename callback_type>
+        void parse(const uint8_t* data, size_t size, callback_type&& callback)
+        {
+            for (size_t byte_idx = 0; byte_idx < size; byte_idx++)
+            {
+                const uint8_t byte = data[byte_idx];
+
+                if (is_real_time_status(byte))
+                {
+                    callback(&byte, 1);
+                    continue;
+                }
+
+                if (_in_system_exclusive)
+                {
+                    if (byte == 0xF7 || !is_status_byte(byte))
+                    {
+                        _system_exclusive.push_back(byte);
+                    }
+                    if (byte == 0xF7)
+                    {
+                        _in_system_exclusive = false;
+                        callback(_system_exclusive.data(), _system_exclusive.size());
+                        continue;
+                    }
+                    if (!is_status_byte(byte))
+                    {
+                        continue;
+                    }
+
+                    // Any other status byte terminates an unfinished SysEx, which is discarded.
+                    _in_system_exclusive = false;
+                }
+
+                if (is_status_byte(byte))
+                {
+                    begin_message(byte, callback);
+                }
+                else if (_running_status != 0)
+                {
+                    if (_message_size == 0)
+                    {
+                        // Running status, the data byte starts a new message.
+                        _message[_message_size++] = _running_status;
+                    }
+                    _message[_message_size++] = byte;
+                    complete_message(callback);
+                }
+            }
+        }
+
+      private:
+        template <typename callback_type>
+        void begin_message(uint8_t status, callback_type&& callback)
+        {
+            _message_size = 0;
+
+            if (status == 0xF0)
+            {
+                _running_status = 0;
+                _in_system_exclusive = true;
+                _system_exclusive.clear();
+                _system_exclusive.push_back(status);
+                return;
+            }
+
+            // System common messages cancel running status but still collect their own data bytes.
+            _running_status = status;
+            _message[_message_size++] = status;
+            complete_message(callback);
+        }
+
+        template <typename callback_type>
+        void complete_message(callback_type&& callback)
+        {
+            const uint8_t status = _message[0];
+            if (_message_size < data_byte_count(status) + 1)
+            {
+                return;
+            }
+
+            callback(_message, _message_size);
+            _message_size = 0;
+            if (!is_channel_voice_status(status))
+            {
+                _running_status = 0;
+            }
+        }
+
+        uint8_t _running_status = 0;
+        uint8_t _message[3] = {0};
+        size_t _message_size = 0;
+
+        bool _in_system_exclusive = false;
+        std::vector<uint8_t> _system_exclusive;
+    };
+} // namespace smidi
+
+#endif // SMIDI_RUNNING_STATUS_H
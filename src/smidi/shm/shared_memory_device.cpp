@@ -0,0 +1,672 @@
+#include "smidi/smidi.h"
+
+#include <stdexcept>
+
+#if defined(__linux__)
+
+#include "device_list.h"
+#include "device_options.h"
+#include "directory_watcher.h"
+#include "message_queue.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <mutex>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace smidi
+{
+    namespace shm
+    {
+        namespace
+        {
+            constexpr uint32_t segment_magic = 0x534D4944; // SMID
+            constexpr uint32_t segment_version = 1;
+            constexpr const char* segment_prefix = "smidi.";
+            constexpr const char* segment_directory = "/dev/shm";
+
+            // Records are 8 byte aligned, a record that does not fit before the end of the ring is preceded by a padding
+            // record and written at the start.
+            constexpr uint32_t padding_record = 0xFFFFFFFF;
+            constexpr size_t record_alignment = 8;
+
+            constexpr auto reader_wait_timeout = std::chrono::milliseconds(100);
+
+            static_assert(std::atomic<uint64_t>::is_always_lock_free, "Shared memory rings need lock-free 64-bit atomics.");
+            static_assert(std::atomic<uint32_t>::is_always_lock_free, "Shared memory rings need lock-free 32-bit atomics.");
+
+            // Layout of the start of every segment, followed by the ring. Shared between processes, so only lock-free
+            // atomics and plain data.
+            struct segment_header
+            {
+                uint32_t magic;
+                uint32_t version;
+                uint32_t capacity;
+                int32_t owner_pid;
+                char name[SMIDI_MAX_DEVICE_NAME_LENGTH];
+
+                // Total bytes reserved by the producer, advanced before a record is written.
+                std::atomic<uint64_t> reserve_position;
+                // Total bytes published, advanced after a record is written.
+                std::atomic<uint64_t> write_position;
+                // Futex word, bumped on every publish and when the port closes.
+                std::atomic<uint32_t> publish_sequence;
+                std::atomic<uint32_t> waiters;
+                std::atomic<uint32_t> closed;
+            };
+
+            struct record_header
+            {
+                uint32_t size;
+                uint32_t reserved;
+                // Producer CLOCK_MONOTONIC time in nanoseconds, comparable across processes.
+                int64_t time_ns;
+            };
+
+            constexpr size_t ring_offset = (sizeof(segment_header) + record_alignment - 1) & ~(record_alignment - 1);
+
+            size_t aligned_record_size(size_t size) noexcept
+            {
+                return (sizeof(record_header) + size + record_alignment - 1) & ~(record_alignment - 1);
+            }
+
+            int64_t monotonic_ns() noexcept
+            {
+                return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+            }
+
+            void futex_wait(std::atomic<uint32_t>* word, uint32_t expected, std::chrono::milliseconds timeout) noexcept
+            {
+                timespec duration;
+                duration.tv_sec = static_cast<time_t>(timeout.count() / 1000);
+                duration.tv_nsec = static_cast<long>((timeout.count() % 1000) * 1000000);
+                syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT, expected, &duration, nullptr, 0);
+            }
+
+            void futex_wake_all(std::atomic<uint32_t>* word) noexcept
+            {
+                syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+            }
+
+            // Port names become shm object names, '/' is not allowed in them.
+            std::string segment_name(const std::string& name)
+            {
+                std::string result = std::string("/") + segment_prefix;
+                for (char c : name)
+                {
+                    result.push_back(c == '/' ? '_' : c);
+                }
+                return result;
+            }
+
+            bool owner_alive(const segment_header* header) noexcept
+            {
+                return header->closed.load(std::memory_order_acquire) == 0 && (kill(header->owner_pid, 0) == 0 || errno == EPERM);
+            }
+
+            // Maps an existing segment, returns nullptr if it is not a valid smidi port. Enumeration only needs to read
+            // the header.
+            segment_header* map_segment(const std::string& object_name, size_t& mapped_size, bool writable = true)
+            {
+                int fd = shm_open(object_name.c_str(), writable ? O_RDWR : O_RDONLY, 0);
+                if (fd < 0)
+                {
+                    return nullptr;
+                }
+
+                struct stat status;
+                if (fstat(fd, &status) != 0 || static_cast<size_t>(status.st_size) < ring_offset)
+                {
+                    close(fd);
+                    return nullptr;
+                }
+
+                mapped_size = static_cast<size_t>(status.st_size);
+                void* memory = mmap(nullptr, mapped_size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+                close(fd);
+                if (memory == MAP_FAILED)
+                {
+                    return nullptr;
+                }
+
+                segment_header* header = static_cast<segment_header*>(memory);
+                // Readers index the ring with capacity - 1 as a mask.
+                if (header->magic != segment_magic || header->version != segment_version || ring_offset + header->capacity != mapped_size ||
+                    header->capacity == 0 || (header->capacity & (header->capacity - 1)) != 0)
+                {
+                    munmap(memory, mapped_size);
+                    return nullptr;
+                }
+                return header;
+            }
+
+            uint8_t* ring_data(segment_header* header) noexcept
+            {
+                return reinterpret_cast<uint8_t*>(header) + ring_offset;
+            }
+        } // namespace
+
+        // Single producer side of a port, owned by the process that publishes it.
+        class output_device final : public smidi::output_device
+        {
+          public:
+            output_device(const std::string& name, const shared_memory_port_options& options)
+                : _object_name(segment_name(name))
+            {
+                if (name.empty() || name.size() >= SMIDI_MAX_DEVICE_NAME_LENGTH)
+                {
+                    throw std::invalid_argument("Invalid shared memory port name.");
+                }
+
+                if (options.capacity < 1024 || (options.capacity & (options.capacity - 1)) != 0)
+                {
+                    throw std::invalid_argument("Shared memory port capacity must be a power of two of at least 1024 bytes.");
+                }
+
+                // Take over segments left behind by a process that exited without closing its port.
+                size_t existing_size = 0;
+                if (segment_header* existing = map_segment(_object_name, existing_size))
+                {
+                    bool alive = owner_alive(existing);
+                    munmap(existing, existing_size);
+                    if (alive)
+                    {
+                        throw std::invalid_argument("A shared memory port with this name is already published.");
+                    }
+                    shm_unlink(_object_name.c_str());
+                }
+
+                // The segment is built under a private name and linked into place once its header is complete, so
+                // watching systems are told about it, and enumerate it, only when it is ready. Readers map it writable
+                // to register as waiters, so it is only opened to the publisher's user: others could corrupt the ring.
+                static std::atomic<uint32_t> staging_counter{0};
+                std::string staging_name = "/smidi-staging." + std::to_string(getpid()) + "." + std::to_string(staging_counter++);
+                int fd = shm_open(staging_name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+                if (fd < 0)
+                {
+                    throw std::runtime_error(std::string("Failed to create shared memory port: ") + strerror(errno));
+                }
+
+                _capacity = options.capacity;
+                _mapped_size = ring_offset + _capacity;
+                if (ftruncate(fd, static_cast<off_t>(_mapped_size)) != 0)
+                {
+                    int error = errno;
+                    close(fd);
+                    shm_unlink(staging_name.c_str());
+                    throw std::runtime_error(std::string("Failed to size shared memory port: ") + strerror(error));
+                }
+
+                void* memory = mmap(nullptr, _mapped_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+                close(fd);
+                if (memory == MAP_FAILED)
+                {
+                    int error = errno;
+                    shm_unlink(staging_name.c_str());
+                    throw std::runtime_error(std::string("Failed to map shared memory port: ") + strerror(error));
+                }
+
+                // The segment is zero filled, atomics start at zero.
+                _header = static_cast<segment_header*>(memory);
+                _header->version = segment_version;
+                _header->capacity = options.capacity;
+                _header->owner_pid = getpid();
+                memcpy(_header->name, name.data(), name.size());
+                _header->magic = segment_magic;
+
+                // link fails if another process published the same name in the meantime.
+                int result = link((segment_directory + staging_name).c_str(), (segment_directory + _object_name).c_str());
+                int error = errno;
+                shm_unlink(staging_name.c_str());
+                if (result != 0)
+                {
+                    munmap(memory, _mapped_size);
+                    if (error == EEXIST)
+                    {
+                        throw std::invalid_argument("A shared memory port with this name is already published.");
+                    }
+                    throw std::runtime_error(std::string("Failed to publish shared memory port: ") + strerror(error));
+                }
+            }
+
+            virtual ~output_device()
+            {
+                _header->closed.store(1, std::memory_order_release);
+                _header->publish_sequence.fetch_add(1, std::memory_order_release);
+                futex_wake_all(&_header->publish_sequence);
+
+                // Readers keep their mapping until they close, unlinking only removes the name.
+                shm_unlink(_object_name.c_str());
+                munmap(_header, _mapped_size);
+            }
+
+            size_t send(const uint8_t* data, size_t size) override
+            {
+                if (data == nullptr)
+                {
+                    throw std::invalid_argument("NULL buffer.");
+                }
+
+                if (size == 0)
+                {
+                    throw std::invalid_argument("Invalid buffer size.");
+                }
+
+                if (aligned_record_size(size) > _capacity / 2)
+                {
+                    throw std::invalid_argument("Message too large for the shared memory port.");
+                }
+
+                publish(data, size);
+                return size;
+            }
+
+            result try_send(const uint8_t* data, size_t size) noexcept override
+            {
+                if (data == nullptr || size == 0)
+                {
+                    return SMIDI_RESULT_INVALID_ARGUMENT;
+                }
+
+                if (aligned_record_size(size) > _capacity / 2)
+                {
+                    return SMIDI_RESULT_MESSAGE_TOO_LARGE;
+                }
+
+                publish(data, size);
+                return SMIDI_RESULT_OK;
+            }
+
+          private:
+            void publish(const uint8_t* data, size_t size) noexcept
+            {
+                const size_t capacity = _capacity;
+                const size_t record_size = aligned_record_size(size);
+
+                std::lock_guard<decltype(_mutex)> lock(_mutex);
+                uint64_t position = _header->write_position.load(std::memory_order_relaxed);
+                size_t offset = static_cast<size_t>(position & (capacity - 1));
+                size_t padding = (offset + record_size > capacity) ? capacity - offset : 0;
+
+                // Claim the bytes first so readers copying a record that is about to be overwritten notice it.
+                const uint64_t end = position + padding + record_size;
+                _header->reserve_position.store(end, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_release);
+
+                uint8_t* ring = ring_data(_header);
+                if (padding != 0)
+                {
+                    const uint32_t marker = padding_record;
+                    memcpy(ring + offset, &marker, sizeof(marker));
+                    offset = 0;
+                }
+
+                record_header record;
+                record.size = static_cast<uint32_t>(size);
+                record.reserved = 0;
+                record.time_ns = monotonic_ns();
+                memcpy(ring + offset, &record, sizeof(record));
+                memcpy(ring + offset + sizeof(record), data, size);
+
+                // Sequentially consistent with the reader's registration as a waiter: either the reader sees the new
+                // sequence and does not sleep, or this sees the waiter and wakes it.
+                _header->write_position.store(end, std::memory_order_release);
+                _header->publish_sequence.fetch_add(1, std::memory_order_seq_cst);
+                if (_header->waiters.load(std::memory_order_seq_cst) != 0)
+                {
+                    futex_wake_all(&_header->publish_sequence);
+                }
+            }
+
+            std::string _object_name;
+            segment_header* _header = nullptr;
+            size_t _mapped_size = 0;
+            // Readers can write the mapping, the capacity in the header is not trusted after creation.
+            size_t _capacity = 0;
+            // Serializes threads of the owning process, the ring itself has a single producer.
+            std::mutex _mutex;
+        };
+
+        // Reader side, a thread copies records from the ring into the device's message queue. Readers never slow the
+        // producer down, a reader that falls a full ring behind skips ahead and counts the lost messages as dropped.
+        class input_device final : public smidi::input_device
+        {
+          public:
+            input_device(segment_header* header, size_t mapped_size, const device_options& options)
+                : _header(header)
+                , _mapped_size(mapped_size)
+                , _capacity(mapped_size - ring_offset)
+                , _open_ns(monotonic_ns())
+                , _read_position(header->write_position.load(std::memory_order_acquire))
+            {
+                try
+                {
+                    _messages.set_options(options.queue);
+                    if (options.lock_memory)
+                    {
+                        _messages.lock_memory();
+                    }
+                }
+                catch (...)
+                {
+                    munmap(_header, _mapped_size);
+                    throw;
+                }
+
+                _thread = std::thread([this]() { run(); });
+                try
+                {
+                    apply_thread_options(_thread, options);
+                }
+                catch (...)
+                {
+                    stop();
+                    throw;
+                }
+            }
+
+            virtual ~input_device()
+            {
+                stop();
+            }
+
+            size_t receive(uint8_t* data, size_t size, time_stamp* time_stamp) override
+            {
+                return _messages.pop(data, size, time_stamp);
+            }
+
+            result try_receive(uint8_t* data, size_t size, size_t* message_size, time_stamp* time_stamp) noexcept override
+            {
+                return _messages.try_pop(data, size, message_size, time_stamp);
+            }
+
+            void set_queue_options(const queue_options& options) override
+            {
+                _messages.set_options(options);
+            }
+
+            queue_statistics get_queue_statistics() const override
+            {
+                queue_statistics statistics = _messages.statistics();
+                statistics.dropped += _overrun_count.load(std::memory_order_relaxed);
+                return statistics;
+            }
+
+            void set_message_callback(message_callback callback) override
+            {
+                _messages.set_callback(std::move(callback));
+            }
+
+          private:
+            void stop()
+            {
+                _running = false;
+                _header->publish_sequence.fetch_add(1, std::memory_order_release);
+                futex_wake_all(&_header->publish_sequence);
+                _thread.join();
+                _messages.close();
+                munmap(_header, _mapped_size);
+            }
+
+            void run()
+            {
+                std::vector<uint8_t> message;
+                while (_running)
+                {
+                    const uint32_t sequence = _header->publish_sequence.load(std::memory_order_acquire);
+                    if (!read_available(message) && _running)
+                    {
+                        if (_header->closed.load(std::memory_order_acquire) != 0)
+                        {
+                            return;
+                        }
+
+                        // The sequence is read again after registering, see publish.
+                        _header->waiters.fetch_add(1, std::memory_order_seq_cst);
+                        if (_header->publish_sequence.load(std::memory_order_seq_cst) == sequence)
+                        {
+                            futex_wait(&_header->publish_sequence, sequence, reader_wait_timeout);
+                        }
+                        _header->waiters.fetch_sub(1, std::memory_order_acq_rel);
+                    }
+                }
+            }
+
+            // Copies every published record into the queue, returns false if there was nothing to read.
+            bool read_available(std::vector<uint8_t>& message)
+            {
+                const size_t capacity = _capacity;
+                const uint8_t* ring = ring_data(_header);
+                const uint64_t write_position = _header->write_position.load(std::memory_order_acquire);
+                if (write_position == _read_position)
+                {
+                    return false;
+                }
+
+                while (_read_position < write_position)
+                {
+                    if (write_position - _read_position > capacity)
+                    {
+                        resynchronize();
+                        return true;
+                    }
+
+                    size_t offset = static_cast<size_t>(_read_position & (capacity - 1));
+                    uint32_t size = 0;
+                    memcpy(&size, ring + offset, sizeof(size));
+                    if (size == padding_record)
+                    {
+                        if (!still_valid(_read_position))
+                        {
+                            resynchronize();
+                            return true;
+                        }
+                        _read_position += capacity - offset;
+                        continue;
+                    }
+
+                    record_header record;
+                    memcpy(&record, ring + offset, sizeof(record));
+                    size_t record_size = aligned_record_size(record.size);
+                    if (record.size == 0 || offset + record_size > capacity)
+                    {
+                        // Torn header, the producer lapped this reader.
+                        resynchronize();
+                        return true;
+                    }
+                    message.resize(record.size);
+                    memcpy(message.data(), ring + offset + sizeof(record), record.size);
+
+                    if (!still_valid(_read_position))
+                    {
+                        resynchronize();
+                        return true;
+                    }
+                    _read_position += record_size;
+
+                    // Milliseconds since the device was opened, matching the resolution of the native backends.
+                    int64_t elapsed_ns = std::max<int64_t>(0, record.time_ns - _open_ns);
+                    _messages.push(message.data(), message.size(), elapsed_ns / 1000000);
+                }
+                return true;
+            }
+
+            // The bytes at position were not overwritten while they were being copied.
+            bool still_valid(uint64_t position) const noexcept
+            {
+                std::atomic_thread_fence(std::memory_order_acquire);
+                return _header->reserve_position.load(std::memory_order_relaxed) - position <= _capacity;
+            }
+
+            void resynchronize() noexcept
+            {
+                _overrun_count.fetch_add(1, std::memory_order_relaxed);
+                _read_position = _header->write_position.load(std::memory_order_acquire);
+            }
+
+            segment_header* _header;
+            size_t _mapped_size;
+            // Validated against the mapping when it was mapped, the header can change under a reader.
+            size_t _capacity;
+            int64_t _open_ns;
+            uint64_t _read_position;
+            std::atomic<bool> _running{true};
+            std::atomic<uint64_t> _overrun_count{0};
+            message_queue _messages;
+            std::thread _thread;
+        };
+
+        class system final : public smidi::system
+        {
+          public:
+            system()
+                : _input_devices(enumerate_ports())
+                , _watcher(segment_directory, IN_CREATE | IN_DELETE | IN_MOVED_TO | IN_MOVED_FROM,
+                           [this](const std::string& name, uint32_t mask) {
+                               if ((mask & IN_Q_OVERFLOW) != 0 || name.compare(0, strlen(segment_prefix), segment_prefix) == 0)
+                               {
+                                   _notifier.notify();
+                               }
+                           })
+            {
+            }
+
+            const std::vector<device_info>& output_devices() const noexcept override
+            {
+                return _no_devices;
+            }
+
+            std::unique_ptr<smidi::output_device> create_output_device(const std::string& name, const device_options& options) override
+            {
+                (void)name;
+                (void)options;
+                throw std::invalid_argument("Shared memory ports are published with create_shared_memory_port.");
+            }
+
+            const std::vector<device_info>& input_devices() const noexcept override
+            {
+                return _input_devices;
+            }
+
+            std::unique_ptr<smidi::input_device> create_input_device(const std::string& name, const device_options& options) override
+            {
+                validate_device_options(options);
+
+                size_t mapped_size = 0;
+                segment_header* header = map_segment(segment_name(name), mapped_size);
+                if (header == nullptr)
+                {
+                    throw std::invalid_argument("no device with provided name.");
+                }
+
+                if (!owner_alive(header) || strncmp(header->name, name.c_str(), sizeof(header->name)) != 0)
+                {
+                    munmap(header, mapped_size);
+                    throw std::invalid_argument("no device with provided name.");
+                }
+
+                return std::make_unique<shm::input_device>(header, mapped_size, options);
+            }
+
+            // The shm directory holds few entries, rescanning it is cheaper than tracking ports individually.
+            std::vector<device_change> refresh() override
+            {
+                std::vector<device_info> devices = enumerate_ports();
+                std::vector<device_change> changes;
+                diff_device_lists(_input_devices, devices, true, changes);
+                _input_devices = std::move(devices);
+                return changes;
+            }
+
+            void set_device_change_callback(device_change_callback callback) override
+            {
+                _notifier.set_callback(std::move(callback));
+            }
+
+          private:
+            static std::vector<device_info> enumerate_ports()
+            {
+                std::vector<device_info> devices;
+                DIR* directory = opendir(segment_directory);
+                if (directory == nullptr)
+                {
+                    return devices;
+                }
+
+                while (dirent* entry = readdir(directory))
+                {
+                    if (strncmp(entry->d_name, segment_prefix, strlen(segment_prefix)) != 0)
+                    {
+                        continue;
+                    }
+
+                    size_t mapped_size = 0;
+                    segment_header* header = map_segment(std::string("/") + entry->d_name, mapped_size, false);
+                    if (header == nullptr)
+                    {
+                        continue;
+                    }
+
+                    if (owner_alive(header))
+                    {
+                        device_info info;
+                        memset(&info, 0, sizeof(info));
+                        memcpy(info.name, header->name, sizeof(info.name) - 1);
+                        devices.push_back(info);
+                    }
+                    munmap(header, mapped_size);
+                }
+                closedir(directory);
+                return devices;
+            }
+
+            std::vector<device_info> _no_devices;
+            std::vector<device_info> _input_devices;
+            device_change_notifier _notifier;
+            // Last member, its thread stops before the notifier goes away.
+            directory_watcher _watcher;
+        };
+    } // namespace shm
+
+    std::unique_ptr<output_device> create_shared_memory_port(const std::string& name, const shared_memory_port_options& options)
+    {
+        return std::make_unique<shm::output_device>(name, options);
+    }
+
+    std::unique_ptr<system> create_shared_memory_system()
+    {
+        return std::make_unique<shm::system>();
+    }
+} // namespace smidi
+
+#else
+
+namespace smidi
+{
+    std::unique_ptr<output_device> create_shared_memory_port(const std::string& name, const shared_memory_port_options& options)
+    {
+        (void)name;
+        (void)options;
+        throw std::runtime_error("Shared memory ports are not supported on this platform.");
+    }
+
+    std::unique_ptr<system> create_shared_memory_system()
+    {
+        throw std::runtime_error("Shared memory ports are not supported on this platform.");
+    }
+} // namespace smidi
+
+#endif
@@ -1,281 +1,653 @@
-#include "smidi/smidi.h"
-
-#include <algorithm>
-#include <assert.h>
-#include <iostream>
-
-// C API
-#define SMIDI_LOG_ERROR(msg) std::cerr << "SMIDI ERROR: " << __func__ << ": " << msg << std::endl
-
-smidi_system* smidi_create_system()
-{
-    try
-    {
-        std::unique_ptr<smidi::system> system = smidi::create_system();
-        return reinterpret_cast<smidi_system*>(system.release());
-    }
-    catch (const std::exception& e)
-    {
-        SMIDI_LOG_ERROR(e.what());
-        return nullptr;
-    }
-}
-
-void smidi_destroy_system(smidi_system* system)
-{
-    if (system == nullptr)
-    {
-        SMIDI_LOG_ERROR("NULL system.");
-        return;
-    }
-
-    smidi::system* sys = reinterpret_cast<smidi::system*>(system);
-    try
-    {
-        delete sys;
-    }
-    catch (const std::exception& e)
-    {
-        SMIDI_LOG_ERROR(e.what());
-    }
-}
-
-int smidi_system_get_output_device_count(smidi_system* system)
-{
-    if (system == nullptr)
-    {
-        return 0;
-    }
-
-    smidi::system* sys = reinterpret_cast<smidi::system*>(system);
-    try
-    {
-        size_t output_device_count = sys->output_devices().size();
-        assert(output_device_count < std::numeric_limits<int>::max());
-        return static_cast<int>(output_device_count);
-    }
-    catch (const std::exception& e)
-    {
-        SMIDI_LOG_ERROR(e.what());
-        return 0;
-    }
-}
-
-int smidi_system_get_output_device_info(smidi_system* system, int device_info_index, smidi_device_info* out_device_info)
-{
-    if (system == nullptr)
-    {
-        SMIDI_LOG_ERROR("NULL system.");
-        return 0;
-    }
-
-    smidi::system* sys = reinterpret_cast<smidi::system*>(system);
-
-    try
-    {
-        if (device_info_index < 0 || static_cast<size_t>(device_info_index) >= sys->output_devices().size())
-        {
-            SMIDI_LOG_ERROR("Invalid output device index.");
-            return 0;
-        }
-
-        memcpy(out_device_info, &sys->output_devices()[device_info_index], sizeof(smidi_device_info));
-        return 1;
-    }
-    catch (const std::exception& e)
-    {
-        SMIDI_LOG_ERROR(e.what());
-        return 0;
-    }
-}
-
-smidi_output_device* smidi_system_create_output_device(smidi_system* system, const char* device_name)
-{
-    if (system == nullptr)
-    {
-        SMIDI_LOG_ERROR("NULL system.");
-        return nullptr;
-    }
-
-    smidi::system* sys = reinterpret_cast<smidi::system*>(system);
-
-    try
-    {
-        std::unique_ptr<smidi::output_device> output_device = sys->create_output_device(device_name);
-        return reinterpret_cast<smidi_output_device*>(output_device.release());
-    }
-    catch (const std::exception& e)
-    {
-        SMIDI_LOG_ERROR(e.what());
-        return nullptr;
-    }
-}
-
-void smidi_destroy_output_device(smidi_output_device* output_device)
-{
-    if (output_device == nullptr)
-    {
-        SMIDI_LOG_ERROR("NULL output device.");
-        return;
-    }
-
-    smidi::output_device* dev = reinterpret_cast<smidi::output_device*>(output_device);
-
-    try
-    {
-        delete dev;
-    }
-    catch (const std::exception& e)
-    {
-        SMIDI_LOG_ERROR(e.what());
-    }
-}
-
-int smidi_output_device_send_message(smidi_output_device* output_device, const void* buffer, int buffer_size)
-{
-    if (output_device == nullptr)
-    {
-        SMIDI_LOG_ERROR("NULL output device.");
-        return 0;
-    }
-
-    if (buffer_size < 0)
-    {
-        SMIDI_LOG_ERROR("Invalid buffer size.");
-        return 0;
-    }
-
-    smidi::output_device* dev = reinterpret_cast<smidi::output_device*>(output_device);
-
-    try
-    {
-        size_t result = dev->send(static_cast<const uint8_t*>(buffer), static_cast<size_t>(buffer_size));
-        assert(result < std::numeric_limits<int>::max());
-        return static_cast<int>(result);
-    }
-    catch (const std::exception& e)
-    {
-        SMIDI_LOG_ERROR(e.what());
-        return 0;
-    }
-}
-
-int smidi_system_get_input_device_count(smidi_system* system)
-{
-    if (system == nullptr)
-    {
-        SMIDI_LOG_ERROR("NULL system.");
-        return 0;
-    }
-
-    smidi::system* sys = reinterpret_cast<smidi::system*>(system);
-
-    try
-    {
-        size_t input_device_count = sys->input_devices().size();
-        assert(input_device_count < std::numeric_limits<int>::max());
-        return static_cast<int>(input_device_count);
-    }
-    catch (const std::exception& e)
-    {
-        SMIDI_LOG_ERROR(e.what());
-        return 0;
-    }
-}
-
-int smidi_system_get_input_device_info(smidi_system* system, int device_info_index, smidi_device_info* out_device_info)
-{
-    if (system == nullptr)
-    {
-        SMIDI_LOG_ERROR("NULL system.");
-        return 0;
-    }
-
-    smidi::system* sys = reinterpret_cast<smidi::system*>(system);
-
-    try
-    {
-        if (device_info_index < 0 || static_cast<size_t>(device_info_index) >= sys->input_devices().size())
-        {
-            SMIDI_LOG_ERROR("Invalid input device index.");
-            return 0;
-        }
-
-        memcpy(out_device_info, &sys->input_devices()[device_info_index], sizeof(smidi_device_info));
-        return 1;
-    }
-    catch (const std::exception& e)
-    {
-        SMIDI_LOG_ERROR(e.what());
-        return 0;
-    }
-}
-
-smidi_input_device* smidi_system_create_input_device(smidi_system* system, const char* device_name)
-{
-    if (system == nullptr)
-    {
-        SMIDI_LOG_ERROR("NULL system.");
-        return nullptr;
-    }
-
-    smidi::system* sys = reinterpret_cast<smidi::system*>(system);
-
-    try
-    {
-        std::unique_ptr<smidi::input_device> input_device = sys->create_input_device(device_name);
-        return reinterpret_cast<smidi_input_device*>(input_device.release());
-    }
-    catch (const std::exception& e)
-    {
-        SMIDI_LOG_ERROR(e.what());
-        return nullptr;
-    }
-}
-
-void smidi_destroy_input_device(smidi_input_device* input_device)
-{
-    if (input_device == nullptr)
-    {
-        SMIDI_LOG_ERROR("NULL input device.");
-        return;
-    }
-
-    try
-    {
-        smidi::input_device* dev = reinterpret_cast<smidi::input_device*>(input_device);
-        delete dev;
-    }
-    catch (const std::exception& e)
-    {
-        SMIDI_LOG_ERROR(e.what());
-    }
-}
-
-int smidi_input_device_recieve_message(smidi_input_device* input_device, void* buffer, int buffer_size, smidi_time_stamp* time_stamp)
-{
-    if (input_device == nullptr)
-    {
-        SMIDI_LOG_ERROR("NULL input device.");
-        return 0;
-    }
-
-    if (buffer_size < 0)
-    {
-        SMIDI_LOG_ERROR("Invalid buffer size.");
-        return 0;
-    }
-
-    smidi::input_device* dev = reinterpret_cast<smidi::input_device*>(input_device);
-    try
-    {
-        size_t result = dev->receive(static_cast<uint8_t*>(buffer), static_cast<size_t>(buffer_size), time_stamp);
-        assert(result < std::numeric_limits<int>::max());
-        return static_cast<int>(result);
-    }
-    catch (const std::exception& e)
-    {
-        SMIDI_LOG_ERROR(e.what());
-        return 0;
-    }
-}
+#include "smidi/smidi.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+// C API
+namespace
+{
+    std::atomic<smidi_log_callback> log_callback{nullptr};
+    std::atomic<void*> log_user_data{nullptr};
+
+    void log_error(const char* function, const char* message) noexcept
+    {
+        smidi_log_callback callback = log_callback.load(std::memory_order_acquire);
+        if (callback != nullptr)
+        {
+            callback(log_user_data.load(std::memory_order_relaxed), function, message);
+        }
+        else
+        {
+            fprintf(stderr, "SMIDI ERROR: %s: %s\n", function, message);
+        }
+    }
+} // namespace
+
+#define SMIDI_LOG_ERROR(msg) log_error(__func__, msg)
+
+const char* smidi_result_string(smidi_result result)
+{
+    switch (result)
+    {
+    case SMIDI_RESULT_OK:
+        return "Success.";
+    case SMIDI_RESULT_INVALID_ARGUMENT:
+        return "Invalid argument.";
+    case SMIDI_RESULT_NO_MESSAGE:
+        return "No message available.";
+    case SMIDI_RESULT_BUFFER_TOO_SMALL:
+        return "Buffer size is not large enough.";
+    case SMIDI_RESULT_MESSAGE_TOO_LARGE:
+        return "Message too large for the device.";
+    case SMIDI_RESULT_DISCONNECTED:
+        return "Device disconnected.";
+    case SMIDI_RESULT_OUT_OF_MEMORY:
+        return "Out of memory.";
+    case SMIDI_RESULT_DEVICE_ERROR:
+        return "Device error.";
+    case SMIDI_RESULT_WOULD_BLOCK:
+        return "Receiving queue is full.";
+    default:
+        return "Unknown result.";
+    }
+}
+
+void smidi_set_log_callback(smidi_log_callback callback, void* user_data)
+{
+    log_user_data.store(user_data, std::memory_order_relaxed);
+    log_callback.store(callback, std::memory_order_release);
+}
+
+smidi_system* smidi_create_system()
+{
+    try
+    {
+        std::unique_ptr<smidi::system> system = smidi::create_system();
+        return reinterpret_cast<smidi_system*>(system.release());
+    }
+    catch (const std::exception& e)
+    {
+        SMIDI_LOG_ERROR(e.what());
+        return nullptr;
+    }
+}
+
+smidi_system* smidi_create_loopback_system(const char* const* port_names, int port_count)
+{
+    smidi_loopback_options options = {};
+    return smidi_create_loopback_system_with_options(port_names, port_count, &options);
+}
+
+smidi_system* smidi_create_loopback_system_with_options(const char* const* port_names, int port_count, const smidi_loopback_options* options)
+{
+    if (port_names == nullptr && port_count > 0)
+    {
+        SMIDI_LOG_ERROR("NULL port names.");
+        return nullptr;
+    }
+
+    for (int port_idx = 0; port_idx < port_count; port_idx++)
+    {
+        if (port_names[port_idx] == nullptr)
+        {
+            SMIDI_LOG_ERROR("NULL port name.");
+            return nullptr;
+        }
+    }
+
+    if (options == nullptr)
+    {
+        SMIDI_LOG_ERROR("NULL loopback options.");
+        return nullptr;
+    }
+
+    try
+    {
+        std::vector<std::string> names(port_names, port_names + std::max(port_count, 0));
+        std::unique_ptr<smidi::system> system = smidi::create_loopback_system(names, *options);
+        return reinterpret_cast<smidi_system*>(system.release());
+    }
+    catch (const std::exception& e)
+    {
+        SMIDI_LOG_ERROR(e.what());
+        return nullptr;
+    }
+}
+
+smidi_system* smidi_create_rtp_midi_system(const smidi_rtp_midi_options* options)
+{
+    if (options == nullptr)
+    {
+        SMIDI_LOG_ERROR("NULL RTP-MIDI options.");
+        return nullptr;
+    }
+
+    try
+    {
+        std::unique_ptr<smidi::system> system = smidi::create_rtp_midi_system(*options);
+        return reinterpret_cast<smidi_system*>(system.release());
+    }
+    catch (const std::exception& e)
+    {
+        SMIDI_LOG_ERROR(e.what());
+        return nullptr;
+    }
+}
+
+smidi_system* smidi_create_shared_memory_system()
+{
+    try
+    {
+        std::unique_ptr<smidi::system> system = smidi::create_shared_memory_system();
+        return reinterpret_cast<smidi_system*>(system.release());
+    }
+    catch (const std::exception& e)
+    {
+        SMIDI_LOG_ERROR(e.what());
+        return nullptr;
+    }
+}
+
+smidi_system* smidi_create_rawmidi_system(const smidi_rawmidi_options* options)
+{
+    if (options == nullptr)
+    {
+        SMIDI_LOG_ERROR("NULL rawmidi options.");
+        return nullptr;
+    }
+
+    try
+    {
+        std::unique_ptr<smidi::system> system = smidi::create_rawmidi_system(*options);
+        return reinterpret_cast<smidi_system*>(system.release());
+    }
+    catch (const std::exception& e)
+    {
+        SMIDI_LOG_ERROR(e.what());
+        return nullptr;
+    }
+}
+
+void smidi_destroy_system(smidi_system* system)
+{
+    if (system == nullptr)
+    {
+        SMIDI_LOG_ERROR("NULL system.");
+        return;
+    }
+
+    smidi::system* sys = reinterpret_cast<smidi::system*>(system);
+    try
+    {
+        delete sys;
+    }
+    catch (const std::exception& e)
+    {
+        SMIDI_LOG_ERROR(e.what());
+    }
+}
+
+int smidi_system_refresh(smidi_system* system, smidi_device_change* out_changes, int max_changes)
+{
+    if (system == nullptr)
+    {
+        SMIDI_LOG_ERROR("NULL system.");
+        return 0;
+    }
+
+    smidi::system* sys = reinterpret_cast<smidi::system*>(system);
+
+    try
+    {
+        std::vector<smidi::device_change> changes = sys->refresh();
+        if (out_changes != nullptr && max_changes > 0)
+        {
+            size_t copy_count = std::min(changes.size(), static_cast<size_t>(max_changes));
+            std::copy(changes.begin(), changes.begin() + copy_count, out_changes);
+        }
+        assert(changes.size() < std::numeric_limits<int>::max());
+        return static_cast<int>(changes.size());
+    }
+    catch (const std::exception& e)
+    {
+        SMIDI_LOG_ERROR(e.what());
+        return 0;
+    }
+}
+
+int smidi_system_set_device_change_callback(smidi_system* system, smidi_device_change_callback callback, void* user_data)
+{
+    if (system == nullptr)
+    {
+        SMIDI_LOG_ERROR("NULL system.");
+        return 0;
+    }
+
+    smidi::system* sys = reinterpret_cast<smidi::system*>(system);
+
+    try
+    {
+        if (callback == nullptr)
+        {
+            sys->set_device_change_callback(nullptr);
+        }
+        else
+        {
+            sys->set_device_change_callback([callback, user_data]() { callback(user_data); });
+        }
+        return 1;
+    }
+    catch (const std::exception& e)
+    {
+        SMIDI_LOG_ERROR(e.what());
+        return 0;
+    }
+}
+
+int smidi_system_get_output_device_count(smidi_system* system)
+{
+    if (system == nullptr)
+    {
+        return 0;
+    }
+
+    smidi::system* sys = reinterpret_cast<smidi::system*>(system);
+    try
+    {
+        size_t output_device_count = sys->output_devices().size();
+        assert(output_device_count < std::numeric_limits<int>::max());
+        return static_cast<int>(output_device_count);
+    }
+    catch (const std::exception& e)
+    {
+        SMIDI_LOG_ERROR(e.what());
+        return 0;
+    }
+}
+
+int smidi_system_get_output_device_info(smidi_system* system, int device_info_index, smidi_device_info* out_device_info)
+{
+    if (system == nullptr)
+    {
+        SMIDI_LOG_ERROR("NULL system.");
+        return 0;
+    }
+
+    smidi::system* sys = reinterpret_cast<smidi::system*>(system);
+
+    try
+    {
+        if (device_info_index < 0 || static_cast<size_t>(device_info_index) >= sys->output_devices().size())
+        {
+            SMIDI_LOG_ERROR("Invalid output device index.");
+            return 0;
+        }
+
+        memcpy(out_device_info, &sys->output_devices()[device_info_index], sizeof(smidi_device_info));
+        return 1;
+    }
+    catch (const std::exception& e)
+    {
+        SMIDI_LOG_ERROR(e.what());
+        return 0;
+    }
+}
+
+smidi_output_device* smidi_system_create_output_device(smidi_system* system, const char* device_name)
+{
+    smidi_device_options options = smidi::default_device_options;
+    return smidi_system_create_output_device_with_options(system, device_name, &options);
+}
+
+smidi_output_device* smidi_system_create_output_device_with_options(smidi_system* system, const char* device_name,
+                                                                    const smidi_device_options* options)
+{
+    if (system == nullptr)
+    {
+        SMIDI_LOG_ERROR("NULL system.");
+        return nullptr;
+    }
+
+    if (options == nullptr)
+    {
+        SMIDI_LOG_ERROR("NULL device options.");
+        return nullptr;
+    }
+
+    smidi::system* sys = reinterpret_cast<smidi::system*>(system);
+
+    try
+    {
+        std::unique_ptr<smidi::output_device> output_device = sys->create_output_device(device_name, *options);
+        return reinterpret_cast<smidi_output_device*>(output_device.release());
+    }
+    catch (const std::exception& e)
+    {
+        SMIDI_LOG_ERROR(e.what());
+        return nullptr;
+    }
+}
+
+void smidi_destroy_output_device(smidi_output_device* output_device)
+{
+    if (output_device == nullptr)
+    {
+        SMIDI_LOG_ERROR("NULL output device.");
+        return;
+    }
+
+    smidi::output_device* dev = reinterpret_cast<smidi::output_device*>(output_device);
+
+    try
+    {
+        delete dev;
+    }
+    catch (const std::exception& e)
+    {
+        SMIDI_LOG_ERROR(e.what());
+    }
+}
+
+smidi_output_device* smidi_create_shared_memory_port(const char* name, const smidi_shared_memory_port_options* options)
+{
+    if (name == nullptr)
+    {
+        SMIDI_LOG_ERROR("NULL port name.");
+        return nullptr;
+    }
+
+    if (options == nullptr)
+    {
+        SMIDI_LOG_ERROR("NULL shared memory port options.");
+        return nullptr;
+    }
+
+    try
+    {
+        std::unique_ptr<smidi::output_device> device = smidi::create_shared_memory_port(name, *options);
+        return reinterpret_cast<smidi_output_device*>(device.release());
+    }
+    catch (const std::exception& e)
+    {
+        SMIDI_LOG_ERROR(e.what());
+        return nullptr;
+    }
+}
+
+int smidi_output_device_send_message(smidi_output_device* output_device, const void* buffer, int buffer_size)
+{
+    if (output_device == nullptr)
+    {
+        SMIDI_LOG_ERROR("NULL output device.");
+        return 0;
+    }
+
+    if (buffer_size < 0)
+    {
+        SMIDI_LOG_ERROR("Invalid buffer size.");
+        return 0;
+    }
+
+    smidi::output_device* dev = reinterpret_cast<smidi::output_device*>(output_device);
+
+    try
+    {
+        size_t result = dev->send(static_cast<const uint8_t*>(buffer), static_cast<size_t>(buffer_size));
+        assert(result < std::numeric_limits<int>::max());
+        return static_cast<int>(result);
+    }
+    catch (const std::exception& e)
+    {
+        SMIDI_LOG_ERROR(e.what());
+        return 0;
+    }
+}
+
+smidi_result smidi_output_device_try_send_message(smidi_output_device* output_device, const void* buffer, int buffer_size)
+{
+    if (output_device == nullptr || buffer_size <= 0)
+    {
+        return SMIDI_RESULT_INVALID_ARGUMENT;
+    }
+
+    smidi::output_device* dev = reinterpret_cast<smidi::output_device*>(output_device);
+    return dev->try_send(static_cast<const uint8_t*>(buffer), static_cast<size_t>(buffer_size));
+}
+
+int smidi_system_get_input_device_count(smidi_system* system)
+{
+    if (system == nullptr)
+    {
+        SMIDI_LOG_ERROR("NULL system.");
+        return 0;
+    }
+
+    smidi::system* sys = reinterpret_cast<smidi::system*>(system);
+
+    try
+    {
+        size_t input_device_count = sys->input_devices().size();
+        assert(input_device_count < std::numeric_limits<int>::max());
+        return static_cast<int>(input_device_count);
+    }
+    catch (const std::exception& e)
+    {
+        SMIDI_LOG_ERROR(e.what());
+        return 0;
+    }
+}
+
+int smidi_system_get_input_device_info(smidi_system* system, int device_info_index, smidi_device_info* out_device_info)
+{
+    if (system == nullptr)
+    {
+        SMIDI_LOG_ERROR("NULL system.");
+        return 0;
+    }
+
+    smidi::system* sys = reinterpret_cast<smidi::system*>(system);
+
+    try
+    {
+        if (device_info_index < 0 || static_cast<size_t>(device_info_index) >= sys->input_devices().size())
+        {
+            SMIDI_LOG_ERROR("Invalid input device index.");
+            return 0;
+        }
+
+        memcpy(out_device_info, &sys->input_devices()[device_info_index], sizeof(smidi_device_info));
+        return 1;
+    }
+    catch (const std::exception& e)
+    {
+        SMIDI_LOG_ERROR(e.what());
+        return 0;
+    }
+}
+
+smidi_input_device* smidi_system_create_input_device(smidi_system* system, const char* device_name)
+{
+    smidi_device_options options = smidi::default_device_options;
+    return smidi_system_create_input_device_with_options(system, device_name, &options);
+}
+
+smidi_input_device* smidi_system_create_input_device_with_options(smidi_system* system, const char* device_name,
+                                                                  const smidi_device_options* options)
+{
+    if (system == nullptr)
+    {
+        SMIDI_LOG_ERROR("NULL system.");
+        return nullptr;
+    }
+
+    if (options == nullptr)
+    {
+        SMIDI_LOG_ERROR("NULL device options.");
+        return nullptr;
+    }
+
+    smidi::system* sys = reinterpret_cast<smidi::system*>(system);
+
+    try
+    {
+        std::unique_ptr<smidi::input_device> input_device = sys->create_input_device(device_name, *options);
+        return reinterpret_cast<smidi_input_device*>(input_device.release());
+    }
+    catch (const std::exception& e)
+    {
+        SMIDI_LOG_ERROR(e.what());
+        return nullptr;
+    }
+}
+
+void smidi_destroy_input_device(smidi_input_device* input_device)
+{
+    if (input_device == nullptr)
+    {
+        SMIDI_LOG_ERROR("NULL input device.");
+        return;
+    }
+
+    try
+    {
+        smidi::input_device* dev = reinterpret_cast<smidi::input_device*>(input_device);
+        delete dev;
+    }
+    catch (const std::exception& e)
+    {
+        SMIDI_LOG_ERROR(e.what());
+    }
+}
+
+int smidi_input_device_recieve_message(smidi_input_device* input_device, void* buffer, int buffer_size, smidi_time_stamp* time_stamp)
+{
+    if (input_device == nullptr)
+    {
+        SMIDI_LOG_ERROR("NULL input device.");
+        return 0;
+    }
+
+    if (buffer_size < 0)
+    {
+        SMIDI_LOG_ERROR("Invalid buffer size.");
+        return 0;
+    }
+
+    smidi::input_device* dev = reinterpret_cast<smidi::input_device*>(input_device);
+    try
+    {
+        size_t result = dev->receive(static_cast<uint8_t*>(buffer), static_cast<size_t>(buffer_size), time_stamp);
+        assert(result < std::numeric_limits<int>::max());
+        return static_cast<int>(result);
+    }
+    catch (const std::exception& e)
+    {
+        SMIDI_LOG_ERROR(e.what());
+        return 0;
+    }
+}
+
+smidi_result smidi_input_device_try_receive_message(smidi_input_device* input_device, void* buffer, int buffer_size,
+                                                    int* out_message_size, smidi_time_stamp* time_stamp)
+{
+    if (input_device == nullptr || buffer_size < 0)
+    {
+        return SMIDI_RESULT_INVALID_ARGUMENT;
+    }
+
+    smidi::input_device* dev = reinterpret_cast<smidi::input_device*>(input_device);
+    size_t message_size = 0;
+    smidi_result result = dev->try_receive(static_cast<uint8_t*>(buffer), static_cast<size_t>(buffer_size), &message_size, time_stamp);
+    if (out_message_size != nullptr)
+    {
+        assert(message_size < std::numeric_limits<int>::max());
+        *out_message_size = static_cast<int>(message_size);
+    }
+    return result;
+}
+
+int smidi_input_device_set_queue_options(smidi_input_device* input_device, const smidi_queue_options* options)
+{
+    if (input_device == nullptr)
+    {
+        SMIDI_LOG_ERROR("NULL input device.");
+        return 0;
+    }
+
+    if (options == nullptr)
+    {
+        SMIDI_LOG_ERROR("NULL queue options.");
+        return 0;
+    }
+
+    smidi::input_device* dev = reinterpret_cast<smidi::input_device*>(input_device);
+    try
+    {
+        dev->set_queue_options(*options);
+        return 1;
+    }
+    catch (const std::exception& e)
+    {
+        SMIDI_LOG_ERROR(e.what());
+        return 0;
+    }
+}
+
+int smidi_input_device_get_queue_statistics(smidi_input_device* input_device, smidi_queue_statistics* out_statistics)
+{
+    if (input_device == nullptr)
+    {
+        SMIDI_LOG_ERROR("NULL input device.");
+        return 0;
+    }
+
+    if (out_statistics == nullptr)
+    {
+        SMIDI_LOG_ERROR("NULL queue statistics.");
+        return 0;
+    }
+
+    smidi::input_device* dev = reinterpret_cast<smidi::input_device*>(input_device);
+    try
+    {
+        *out_statistics = dev->get_queue_statistics();
+        return 1;
+    }
+    catch (const std::exception& e)
+    {
+        SMIDI_LOG_ERROR(e.what());
+        return 0;
+    }
+}
+
+int smidi_input_device_set_message_callback(smidi_input_device* input_device, smidi_message_callback callback, void* user_data)
+{
+    if (input_device == nullptr)
+    {
+        SMIDI_LOG_ERROR("NULL input device.");
+        return 0;
+    }
+
+    smidi::input_device* dev = reinterpret_cast<smidi::input_device*>(input_device);
+    try
+    {
+        if (callback == nullptr)
+        {
+            dev->set_message_callback(nullptr);
+        }
+        else
+        {
+            dev->set_message_callback([callback, user_data]() { callback(user_data); });
+        }
+        return 1;
+    }
+    catch (const std::exception& e)
+    {
+        SMIDI_LOG_ERROR(e.what());
+        return 0;
+    }
+}
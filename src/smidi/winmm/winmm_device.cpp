@@ -1,462 +1,635 @@
-#include "smidi/smidi.h"
-
-#include <array>
-#include <assert.h>
-#include <chrono>
-#include <condition_variable>
-#include <cstring>
-#include <deque>
-#include <list>
-#include <mutex>
-#include <optional>
-#include <system_error>
-#include <thread>
-#include <type_traits>
-
-#define NOMINMAX
-#include <windows.h>
-
-#include <Mmsystem.h>
-
-namespace smidi
-{
-    namespace winmm
-    {
-        void check_midi_return_value(MMRESULT value)
-        {
-            if (value != MMSYSERR_NOERROR)
-            {
-                throw std::system_error(std::error_code(value, std::system_category()));
-            }
-        }
-
-        using shared_midi_out_ptr = std::shared_ptr<std::remove_pointer<HMIDIOUT>::type>;
-        using shared_midi_in_ptr = std::shared_ptr<std::remove_pointer<HMIDIIN>::type>;
-
-        class buffer
-        {
-          public:
-            buffer(const uint8_t* initial_data, size_t size, DWORD_PTR user, DWORD flags)
-                : _data(size)
-            {
-                if (initial_data)
-                {
-                    memcpy(_data.data(), initial_data, size);
-                }
-
-                _header.lpData = reinterpret_cast<LPSTR>(_data.data());
-                _header.dwBufferLength = size;
-                _header.dwUser = user;
-                _header.dwFlags = flags;
-            }
-
-            virtual ~buffer() = default;
-
-            MIDIHDR& header() noexcept
-            {
-                return _header;
-            }
-
-            const MIDIHDR& header() const noexcept
-            {
-                return _header;
-            }
-
-            uint8_t* data() noexcept
-            {
-                return _data.data();
-            }
-
-            const uint8_t* data() const noexcept
-            {
-                return _data.data();
-            }
-
-            size_t size() const noexcept
-            {
-                return _data.size();
-            }
-
-          private:
-            MIDIHDR _header = {0};
-            std::vector<uint8_t> _data;
-        };
-
-        class output_buffer : public buffer
-        {
-          public:
-            output_buffer(shared_midi_out_ptr midi, const uint8_t* input_data, size_t size)
-                : buffer(input_data, size, 0, 0)
-                , _midi(midi)
-            {
-                check_midi_return_value(midiOutPrepareHeader(_midi.get(), &header(), sizeof(decltype(header()))));
-            }
-
-            virtual ~output_buffer()
-            {
-                check_midi_return_value(unprepare_header());
-            }
-
-            MMRESULT unprepare_header()
-            {
-                MMRESULT result = MMSYSERR_NOERROR;
-                if (_midi)
-                {
-                    result = midiOutUnprepareHeader(_midi.get(), &header(), sizeof(decltype(header())));
-                }
-                if (result == MMSYSERR_NOERROR)
-                {
-                    _midi = nullptr;
-                }
-                return result;
-            }
-
-          private:
-            shared_midi_out_ptr _midi;
-        };
-
-        struct input_buffer : public buffer
-        {
-          public:
-            input_buffer(shared_midi_in_ptr midi, size_t size)
-                : buffer(nullptr, size, reinterpret_cast<DWORD_PTR>(this), 0)
-                , _midi(midi)
-            {
-                check_midi_return_value(midiInPrepareHeader(_midi.get(), &header(), sizeof(decltype(header()))));
-            }
-
-            virtual ~input_buffer()
-            {
-                check_midi_return_value(midiInUnprepareHeader(_midi.get(), &header(), sizeof(decltype(header()))));
-            }
-
-          private:
-            shared_midi_in_ptr _midi;
-        };
-
-        class output_device final : public smidi::output_device
-        {
-          public:
-            output_device(UINT index)
-            {
-                HMIDIOUT midi_out = nullptr;
-                check_midi_return_value(
-                    midiOutOpen(&midi_out, index, static_cast<DWORD_PTR>(NULL), static_cast<DWORD_PTR>(NULL), CALLBACK_NULL));
-                _midi_out.reset(midi_out, [](HMIDIOUT midi_out) {
-                    midiOutReset(midi_out);
-                    midiOutClose(midi_out);
-                });
-
-                _buffer_cleanup_thread = std::thread(std::bind(&output_device::cleanup_buffers, this));
-            }
-
-            virtual ~output_device()
-            {
-                _destroy_cleanup_thread = true;
-                _pending_cleanup_buffers_cv.notify_one();
-                _buffer_cleanup_thread.join();
-            }
-
-            size_t send(const uint8_t* data, size_t size) override
-            {
-                if (data == nullptr)
-                {
-                    throw std::invalid_argument("NULL buffer.");
-                }
-
-                if (size == 0)
-                {
-                    throw std::invalid_argument("Invalid buffer size.");
-                }
-
-                constexpr uint8_t system_exclusive_message_status = 0xF0;
-                if (data[0] == system_exclusive_message_status)
-                {
-                    send_buffered_message(data, size);
-                }
-                else
-                {
-                    send_single_message(data, size);
-                }
-
-                return size;
-            }
-
-          private:
-            void cleanup_buffers()
-            {
-                using namespace std::chrono_literals;
-
-                while (true)
-                {
-                    std::unique_lock<decltype(_pending_cleanup_buffers_mutex)> unique_lock(_pending_cleanup_buffers_mutex);
-                    _pending_cleanup_buffers_cv.wait_for(unique_lock, 10ms);
-
-                    if (_destroy_cleanup_thread)
-                    {
-                        return;
-                    }
-
-                    while (!_pending_cleanup_buffers.empty())
-                    {
-                        output_buffer* pending_cleanup_buffer = _pending_cleanup_buffers.front().get();
-                        MMRESULT result = pending_cleanup_buffer->unprepare_header();
-                        if (result == MIDIERR_STILLPLAYING)
-                        {
-                            continue;
-                        }
-                        check_midi_return_value(result);
-
-                        _pending_cleanup_buffers.pop_front();
-                    }
-                }
-            }
-
-            void send_buffered_message(const uint8_t* data, size_t size)
-            {
-                std::unique_ptr<output_buffer> message = std::make_unique<output_buffer>(_midi_out, data, size);
-                check_midi_return_value(midiOutLongMsg(_midi_out.get(), &message->header(), sizeof(decltype(message->header()))));
-
-                {
-                    std::lock_guard<decltype(_pending_cleanup_buffers_mutex)> lock(_pending_cleanup_buffers_mutex);
-                    _pending_cleanup_buffers.push_back(std::move(message));
-                }
-                _pending_cleanup_buffers_cv.notify_one();
-            }
-
-            void send_single_message(const uint8_t* data, size_t size)
-            {
-                assert(size > 0 && size <= 3);
-                assert(sizeof(DWORD) == 4);
-
-                DWORD message = 0;
-                memcpy(&message, data, size);
-
-                check_midi_return_value(midiOutShortMsg(_midi_out.get(), message));
-            }
-
-            shared_midi_out_ptr _midi_out;
-
-            std::thread _buffer_cleanup_thread;
-            bool _destroy_cleanup_thread = false;
-            std::list<std::unique_ptr<output_buffer>> _pending_cleanup_buffers;
-            std::mutex _pending_cleanup_buffers_mutex;
-            std::condition_variable _pending_cleanup_buffers_cv;
-        };
-
-        class input_device final : public smidi::input_device
-        {
-          public:
-            input_device(UINT index)
-            {
-                HMIDIIN midi_in = nullptr;
-                check_midi_return_value(midiInOpen(&midi_in, index, reinterpret_cast<DWORD_PTR>(&midi_input_proc),
-                                                   reinterpret_cast<DWORD_PTR>(this), CALLBACK_FUNCTION));
-                _midi_in.reset(midi_in, [](HMIDIIN midi_in) {
-                    midiInReset(midi_in);
-                    midiInClose(midi_in);
-                });
-
-                for (std::unique_ptr<input_buffer>& buffer : _input_buffers)
-                {
-                    buffer = std::make_unique<input_buffer>(_midi_in, buffer_size);
-                    check_midi_return_value(midiInAddBuffer(_midi_in.get(), &buffer->header(), sizeof(decltype(buffer->header()))));
-                }
-
-                check_midi_return_value(midiInStart(_midi_in.get()));
-            }
-
-            virtual ~input_device() {}
-
-            size_t receive(uint8_t* data, size_t size, time_stamp* time_stamp) override
-            {
-                std::unique_lock<decltype(_messages_mutex)> unique_lock(_messages_mutex);
-                _messages_cv.wait(unique_lock, [this]() { return !_messages.empty(); });
-
-                assert(!_messages.empty());
-
-                if (data != nullptr)
-                {
-                    timestamped_message message = std::move(_messages.front());
-                    _messages.pop_front();
-
-                    if (size < message.first.size())
-                    {
-                        throw std::invalid_argument("Buffer size is not large enough.");
-                    }
-                    std::copy(message.first.begin(), message.first.end(), data);
-
-                    if (time_stamp != nullptr)
-                    {
-                        *time_stamp = message.second;
-                    }
-
-                    return message.first.size();
-                }
-                else
-                {
-                    // Just return the message size if data is null
-                    return _messages.front().first.size();
-                }
-            }
-
-          private:
-            static void CALLBACK midi_input_proc(HMIDIIN midi_in, UINT message, DWORD_PTR instance, DWORD_PTR param1, DWORD_PTR param2)
-            {
-                input_device* device = reinterpret_cast<input_device*>(instance);
-                device->on_message(message, param1, param2);
-            }
-
-            void on_message(UINT message, DWORD_PTR param1, DWORD_PTR param2)
-            {
-                std::vector<uint8_t> data;
-                if (message == MIM_DATA)
-                {
-                    const uint8_t* midi_message = reinterpret_cast<uint8_t*>(&param1);
-                    size_t message_size = sizeof(param1);
-                    data.resize(message_size);
-                    memcpy(data.data(), &param1, message_size);
-                }
-                else if (message == MIM_LONGDATA || message == MIM_LONGERROR)
-                {
-                    MIDIHDR& header = *reinterpret_cast<MIDIHDR*>(param1);
-                    data.resize(header.dwBytesRecorded);
-                    memcpy(data.data(), header.lpData, header.dwBytesRecorded);
-
-                    // requeue the buffer
-                    if (header.dwBytesRecorded > 0)
-                    {
-                        check_midi_return_value(midiInAddBuffer(_midi_in.get(), &header, sizeof(header)));
-                    }
-                }
-
-                if (!data.empty())
-                {
-                    std::lock_guard<decltype(_messages_mutex)> lock(_messages_mutex);
-
-                    if (!_first_time_stamp.has_value())
-                    {
-                        _first_time_stamp = time_stamp(param2);
-                    }
-
-                    timestamped_message message{
-                        data,
-                        time_stamp(param2) - _first_time_stamp.value(),
-                    };
-
-                    _messages.push_back(message);
-                }
-
-                _messages_cv.notify_one();
-            }
-
-            shared_midi_in_ptr _midi_in;
-
-            static constexpr size_t buffer_count = 4;
-            static constexpr size_t buffer_size = 1024;
-            std::array<std::unique_ptr<input_buffer>, buffer_count> _input_buffers;
-
-            using timestamped_message = std::pair<std::vector<uint8_t>, time_stamp>;
-            std::deque<timestamped_message> _messages;
-            std::optional<time_stamp> _first_time_stamp;
-            std::mutex _messages_mutex;
-            std::condition_variable _messages_cv;
-        };
-
-        template <typename caps_type>
-        device_info generate_device_info(const caps_type& caps)
-        {
-            device_info info;
-            memset(info.name, 0, sizeof(info.name));
-            memcpy(info.name, caps.szPname, std::min(sizeof(info.name), sizeof(caps.szPname)));
-            info.name[sizeof(info.name) - 1] = 0;
-            info.manufacturer = caps.wMid;
-            info.product = caps.wPid;
-            info.driver_major_version = (caps.vDriverVersion >> 8) & 0xFF;
-            info.driver_minor_version = caps.vDriverVersion & 0xFF;
-            return info;
-        }
-
-        std::vector<device_info> generate_output_device_list()
-        {
-            std::vector<device_info> devices;
-
-            UINT devices_count = midiOutGetNumDevs();
-            for (UINT device_idx = 0; device_idx < devices_count; device_idx++)
-            {
-                MIDIOUTCAPS caps = {0};
-                check_midi_return_value(midiOutGetDevCaps(static_cast<UINT_PTR>(device_idx), &caps, sizeof(caps)));
-                devices.push_back(generate_device_info(caps));
-            }
-
-            return std::move(devices);
-        }
-
-        std::vector<device_info> generate_input_device_list()
-        {
-            std::vector<device_info> devices;
-
-            UINT devices_count = midiInGetNumDevs();
-            for (UINT device_idx = 0; device_idx < devices_count; device_idx++)
-            {
-                MIDIINCAPS caps = {0};
-                check_midi_return_value(midiInGetDevCaps(static_cast<UINT_PTR>(device_idx), &caps, sizeof(caps)));
-                devices.push_back(generate_device_info(caps));
-            }
-
-            return std::move(devices);
-        }
-
-        UINT find_device_index(const std::vector<device_info>& devices, const std::string& name)
-        {
-            for (UINT device_idx = 0; device_idx < devices.size(); device_idx++)
-            {
-                if (devices[device_idx].name == name)
-                {
-                    return device_idx;
-                }
-            }
-
-            throw std::exception("no device with provided name.");
-        }
-
-        class system final : public smidi::system
-        {
-          public:
-            system()
-                : _output_devices(std::move(generate_output_device_list()))
-                , _input_devices(std::move(generate_input_device_list()))
-            {
-            }
-
-            const std::vector<device_info>& output_devices() const noexcept override
-            {
-                return _output_devices;
-            }
-
-            std::unique_ptr<smidi::output_device> create_output_device(const std::string& name) override
-            {
-                return std::make_unique<winmm::output_device>(find_device_index(_output_devices, name));
-            }
-
-            const std::vector<device_info>& input_devices() const noexcept
-            {
-                return _input_devices;
-            }
-
-            std::unique_ptr<smidi::input_device> create_input_device(const std::string& name)
-            {
-                return std::make_unique<winmm::input_device>(find_device_index(_input_devices, name));
-            }
-
-          private:
-            const std::vector<device_info> _output_devices;
-            const std::vector<device_info> _input_devices;
-        };
-    } // namespace winmm
-
-    std::unique_ptr<system> create_system()
-    {
-        return std::make_unique<winmm::system>();
-    }
-} // namespace smidi
+#include "smidi/smidi.h"
+
+#include "device_list.h"
+#include "device_options.h"
+#include "message_queue.h"
+
+#include <assert.h>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+
+#define NOMINMAX
+#include <windows.h>
+
+#include <Mmsystem.h>
+
+namespace smidi
+{
+    namespace winmm
+    {
+        void check_midi_return_value(MMRESULT value)
+        {
+            if (value != MMSYSERR_NOERROR)
+            {
+                throw std::system_error(std::error_code(value, std::system_category()));
+            }
+        }
+
+        result to_result(MMRESULT value) noexcept
+        {
+            switch (value)
+            {
+            case MMSYSERR_NOERROR:
+                return SMIDI_RESULT_OK;
+            case MMSYSERR_NODRIVER:
+            case MMSYSERR_BADDEVICEID:
+                return SMIDI_RESULT_DISCONNECTED;
+            case MMSYSERR_NOMEM:
+                return SMIDI_RESULT_OUT_OF_MEMORY;
+            default:
+                return SMIDI_RESULT_DEVICE_ERROR;
+            }
+        }
+
+        using shared_midi_out_ptr = std::shared_ptr<std::remove_pointer<HMIDIOUT>::type>;
+        using shared_midi_in_ptr = std::shared_ptr<std::remove_pointer<HMIDIIN>::type>;
+
+        class buffer
+        {
+          public:
+            buffer(const uint8_t* initial_data, size_t size, DWORD_PTR user, DWORD flags)
+                : _data(size)
+            {
+                if (initial_data)
+                {
+                    memcpy(_data.data(), initial_data, size);
+                }
+
+                _header.lpData = reinterpret_cast<LPSTR>(_data.data());
+                _header.dwBufferLength = size;
+                _header.dwUser = user;
+                _header.dwFlags = flags;
+            }
+
+            virtual ~buffer() = default;
+
+            MIDIHDR& header() noexcept
+            {
+                return _header;
+            }
+
+            const MIDIHDR& header() const noexcept
+            {
+                return _header;
+            }
+
+            uint8_t* data() noexcept
+            {
+                return _data.data();
+            }
+
+            const uint8_t* data() const noexcept
+            {
+                return _data.data();
+            }
+
+            size_t size() const noexcept
+            {
+                return _data.size();
+            }
+
+          private:
+            MIDIHDR _header = {0};
+            std::vector<uint8_t> _data;
+        };
+
+        class output_buffer : public buffer
+        {
+          public:
+            output_buffer(shared_midi_out_ptr midi, const uint8_t* input_data, size_t size)
+                : buffer(input_data, size, 0, 0)
+                , _midi(midi)
+            {
+                check_midi_return_value(midiOutPrepareHeader(_midi.get(), &header(), sizeof(decltype(header()))));
+            }
+
+            virtual ~output_buffer()
+            {
+                check_midi_return_value(unprepare_header());
+            }
+
+            MMRESULT unprepare_header()
+            {
+                MMRESULT result = MMSYSERR_NOERROR;
+                if (_midi)
+                {
+                    result = midiOutUnprepareHeader(_midi.get(), &header(), sizeof(decltype(header())));
+                }
+                if (result == MMSYSERR_NOERROR)
+                {
+                    _midi = nullptr;
+                }
+                return result;
+            }
+
+          private:
+            shared_midi_out_ptr _midi;
+        };
+
+        struct input_buffer : public buffer
+        {
+          public:
+            input_buffer(shared_midi_in_ptr midi, size_t size)
+                : buffer(nullptr, size, reinterpret_cast<DWORD_PTR>(this), 0)
+                , _midi(midi)
+            {
+                check_midi_return_value(midiInPrepareHeader(_midi.get(), &header(), sizeof(decltype(header()))));
+            }
+
+            virtual ~input_buffer()
+            {
+                check_midi_return_value(midiInUnprepareHeader(_midi.get(), &header(), sizeof(decltype(header()))));
+            }
+
+          private:
+            shared_midi_in_ptr _midi;
+        };
+
+        class output_device final : public smidi::output_device
+        {
+          public:
+            output_device(UINT index, const device_options& options)
+            {
+                HMIDIOUT midi_out = nullptr;
+                check_midi_return_value(
+                    midiOutOpen(&midi_out, index, static_cast<DWORD_PTR>(NULL), static_cast<DWORD_PTR>(NULL), CALLBACK_NULL));
+                _midi_out.reset(midi_out, [](HMIDIOUT midi_out) {
+                    midiOutReset(midi_out);
+                    midiOutClose(midi_out);
+                });
+
+                _buffer_cleanup_thread = std::thread(std::bind(&output_device::cleanup_buffers, this));
+                try
+                {
+                    apply_thread_options(_buffer_cleanup_thread, options);
+                }
+                catch (...)
+                {
+                    stop_cleanup_thread();
+                    throw;
+                }
+            }
+
+            virtual ~output_device()
+            {
+                stop_cleanup_thread();
+            }
+
+            size_t send(const uint8_t* data, size_t size) override
+            {
+                if (data == nullptr)
+                {
+                    throw std::invalid_argument("NULL buffer.");
+                }
+
+                if (size == 0)
+                {
+                    throw std::invalid_argument("Invalid buffer size.");
+                }
+
+                constexpr uint8_t system_exclusive_message_status = 0xF0;
+                if (data[0] == system_exclusive_message_status)
+                {
+                    send_buffered_message(data, size);
+                }
+                else
+                {
+                    send_single_message(data, size);
+                }
+
+                return size;
+            }
+
+            result try_send(const uint8_t* data, size_t size) noexcept override
+            {
+                if (data == nullptr || size == 0)
+                {
+                    return SMIDI_RESULT_INVALID_ARGUMENT;
+                }
+
+                constexpr uint8_t system_exclusive_message_status = 0xF0;
+                if (data[0] != system_exclusive_message_status)
+                {
+                    if (size > sizeof(DWORD) - 1)
+                    {
+                        return SMIDI_RESULT_MESSAGE_TOO_LARGE;
+                    }
+
+                    DWORD message = 0;
+                    memcpy(&message, data, size);
+                    return to_result(midiOutShortMsg(_midi_out.get(), message));
+                }
+
+                // SysEx goes through a prepared buffer that is allocated per message.
+                try
+                {
+                    send_buffered_message(data, size);
+                    return SMIDI_RESULT_OK;
+                }
+                catch (const std::system_error& e)
+                {
+                    return to_result(static_cast<MMRESULT>(e.code().value()));
+                }
+                catch (const std::bad_alloc&)
+                {
+                    return SMIDI_RESULT_OUT_OF_MEMORY;
+                }
+            }
+
+          private:
+            void stop_cleanup_thread()
+            {
+                _destroy_cleanup_thread = true;
+                _pending_cleanup_buffers_cv.notify_one();
+                _buffer_cleanup_thread.join();
+            }
+
+            void cleanup_buffers()
+            {
+                using namespace std::chrono_literals;
+
+                while (true)
+                {
+                    std::unique_lock<decltype(_pending_cleanup_buffers_mutex)> unique_lock(_pending_cleanup_buffers_mutex);
+                    _pending_cleanup_buffers_cv.wait_for(unique_lock, 10ms);
+
+                    if (_destroy_cleanup_thread)
+                    {
+                        return;
+                    }
+
+                    while (!_pending_cleanup_buffers.empty())
+                    {
+                        output_buffer* pending_cleanup_buffer = _pending_cleanup_buffers.front().get();
+                        MMRESULT result = pending_cleanup_buffer->unprepare_header();
+                        if (result == MIDIERR_STILLPLAYING)
+                        {
+                            continue;
+                        }
+                        check_midi_return_value(result);
+
+                        _pending_cleanup_buffers.pop_front();
+                    }
+                }
+            }
+
+            void send_buffered_message(const uint8_t* data, size_t size)
+            {
+                std::unique_ptr<output_buffer> message = std::make_unique<output_buffer>(_midi_out, data, size);
+                check_midi_return_value(midiOutLongMsg(_midi_out.get(), &message->header(), sizeof(decltype(message->header()))));
+
+                {
+                    std::lock_guard<decltype(_pending_cleanup_buffers_mutex)> lock(_pending_cleanup_buffers_mutex);
+                    _pending_cleanup_buffers.push_back(std::move(message));
+                }
+                _pending_cleanup_buffers_cv.notify_one();
+            }
+
+            void send_single_message(const uint8_t* data, size_t size)
+            {
+                assert(size > 0 && size <= 3);
+                assert(sizeof(DWORD) == 4);
+
+                DWORD message = 0;
+                memcpy(&message, data, size);
+
+                check_midi_return_value(midiOutShortMsg(_midi_out.get(), message));
+            }
+
+            shared_midi_out_ptr _midi_out;
+
+            std::thread _buffer_cleanup_thread;
+            bool _destroy_cleanup_thread = false;
+            std::list<std::unique_ptr<output_buffer>> _pending_cleanup_buffers;
+            std::mutex _pending_cleanup_buffers_mutex;
+            std::condition_variable _pending_cleanup_buffers_cv;
+        };
+
+        class input_device final : public smidi::input_device
+        {
+          public:
+            input_device(UINT index, const device_options& options)
+                : _input_buffers(options.buffer_count)
+                , _messages(options.queue)
+            {
+                if (options.lock_memory)
+                {
+                    _messages.lock_memory();
+                }
+
+                HMIDIIN midi_in = nullptr;
+                check_midi_return_value(midiInOpen(&midi_in, index, reinterpret_cast<DWORD_PTR>(&midi_input_proc),
+                                                   reinterpret_cast<DWORD_PTR>(this), CALLBACK_FUNCTION));
+                _midi_in.reset(midi_in, [](HMIDIIN midi_in) {
+                    midiInReset(midi_in);
+                    midiInClose(midi_in);
+                });
+
+                for (std::unique_ptr<input_buffer>& buffer : _input_buffers)
+                {
+                    buffer = std::make_unique<input_buffer>(_midi_in, options.buffer_size);
+                    check_midi_return_value(midiInAddBuffer(_midi_in.get(), &buffer->header(), sizeof(decltype(buffer->header()))));
+                }
+
+                check_midi_return_value(midiInStart(_midi_in.get()));
+            }
+
+            virtual ~input_device()
+            {
+                _messages.close();
+            }
+
+            size_t receive(uint8_t* data, size_t size, time_stamp* time_stamp) override
+            {
+                return _messages.pop(data, size, time_stamp);
+            }
+
+            result try_receive(uint8_t* data, size_t size, size_t* message_size, time_stamp* time_stamp) noexcept override
+            {
+                return _messages.try_pop(data, size, message_size, time_stamp);
+            }
+
+            void set_queue_options(const queue_options& options) override
+            {
+                _messages.set_options(options);
+            }
+
+            queue_statistics get_queue_statistics() const override
+            {
+                return _messages.statistics();
+            }
+
+            void set_message_callback(message_callback callback) override
+            {
+                _messages.set_callback(std::move(callback));
+            }
+
+          private:
+            static void CALLBACK midi_input_proc(HMIDIIN midi_in, UINT message, DWORD_PTR instance, DWORD_PTR param1, DWORD_PTR param2)
+            {
+                input_device* device = reinterpret_cast<input_device*>(instance);
+                device->on_message(message, param1, param2);
+            }
+
+            void on_message(UINT message, DWORD_PTR param1, DWORD_PTR param2)
+            {
+                std::vector<uint8_t> data;
+                if (message == MIM_DATA)
+                {
+                    const uint8_t* midi_message = reinterpret_cast<uint8_t*>(&param1);
+                    size_t message_size = sizeof(param1);
+                    data.resize(message_size);
+                    memcpy(data.data(), &param1, message_size);
+                }
+                else if (message == MIM_LONGDATA || message == MIM_LONGERROR)
+                {
+                    MIDIHDR& header = *reinterpret_cast<MIDIHDR*>(param1);
+                    const uint8_t* recorded = reinterpret_cast<const uint8_t*>(header.lpData);
+                    const size_t recorded_size = header.dwBytesRecorded;
+
+                    // SysEx longer than an input buffer arrives in several, the pieces are collected until the one
+                    // ending the message. The buffer keeps its capacity for the next dump. An invalid message drops
+                    // what was collected so far.
+                    bool complete = false;
+                    if (message == MIM_LONGERROR)
+                    {
+                        _long_message.clear();
+                    }
+                    else if (recorded_size > 0)
+                    {
+                        _long_message.insert(_long_message.end(), recorded, recorded + recorded_size);
+                        complete = recorded[recorded_size - 1] == 0xF7;
+                    }
+
+                    // requeue the buffer
+                    if (recorded_size > 0)
+                    {
+                        check_midi_return_value(midiInAddBuffer(_midi_in.get(), &header, sizeof(header)));
+                    }
+
+                    if (complete)
+                    {
+                        push_message(_long_message.data(), _long_message.size(), param2);
+                        _long_message.clear();
+                    }
+                }
+
+                if (!data.empty())
+                {
+                    push_message(data.data(), data.size(), param2);
+                }
+            }
+
+            void push_message(const uint8_t* data, size_t size, DWORD_PTR param2)
+            {
+                if (!_first_time_stamp.has_value())
+                {
+                    _first_time_stamp = time_stamp(param2);
+                }
+
+                _messages.push(data, size, time_stamp(param2) - _first_time_stamp.value());
+            }
+
+            shared_midi_in_ptr _midi_in;
+
+            std::vector<std::unique_ptr<input_buffer>> _input_buffers;
+            std::vector<uint8_t> _long_message;
+
+            message_queue _messages;
+            std::optional<time_stamp> _first_time_stamp;
+        };
+
+        template <typename caps_type>
+        device_info generate_device_info(const caps_type& caps)
+        {
+            device_info info;
+            memset(info.name, 0, sizeof(info.name));
+            memcpy(info.name, caps.szPname, std::min(sizeof(info.name), sizeof(caps.szPname)));
+            info.name[sizeof(info.name) - 1] = 0;
+            info.manufacturer = caps.wMid;
+            info.product = caps.wPid;
+            info.driver_major_version = (caps.vDriverVersion >> 8) & 0xFF;
+            info.driver_minor_version = caps.vDriverVersion & 0xFF;
+            return info;
+        }
+
+        std::vector<device_info> generate_output_device_list()
+        {
+            std::vector<device_info> devices;
+
+            UINT devices_count = midiOutGetNumDevs();
+            for (UINT device_idx = 0; device_idx < devices_count; device_idx++)
+            {
+                MIDIOUTCAPS caps = {0};
+                check_midi_return_value(midiOutGetDevCaps(static_cast<UINT_PTR>(device_idx), &caps, sizeof(caps)));
+                devices.push_back(generate_device_info(caps));
+            }
+
+            return std::move(devices);
+        }
+
+        std::vector<device_info> generate_input_device_list()
+        {
+            std::vector<device_info> devices;
+
+            UINT devices_count = midiInGetNumDevs();
+            for (UINT device_idx = 0; device_idx < devices_count; device_idx++)
+            {
+                MIDIINCAPS caps = {0};
+                check_midi_return_value(midiInGetDevCaps(static_cast<UINT_PTR>(device_idx), &caps, sizeof(caps)));
+                devices.push_back(generate_device_info(caps));
+            }
+
+            return std::move(devices);
+        }
+
+        UINT find_device_index(const std::vector<device_info>& devices, const std::string& name)
+        {
+            for (UINT device_idx = 0; device_idx < devices.size(); device_idx++)
+            {
+                if (devices[device_idx].name == name)
+                {
+                    return device_idx;
+                }
+            }
+
+            throw std::exception("no device with provided name.");
+        }
+
+        class system final : public smidi::system
+        {
+          public:
+            system()
+                : _output_devices(std::move(generate_output_device_list()))
+                , _input_devices(std::move(generate_input_device_list()))
+            {
+            }
+
+            virtual ~system()
+            {
+                stop_watcher();
+            }
+
+            const std::vector<device_info>& output_devices() const noexcept override
+            {
+                return _output_devices;
+            }
+
+            std::unique_ptr<smidi::output_device> create_output_device(const std::string& name, const device_options& options) override
+            {
+                validate_device_options(options);
+                return std::make_unique<winmm::output_device>(find_device_index(_output_devices, name), options);
+            }
+
+            const std::vector<device_info>& input_devices() const noexcept
+            {
+                return _input_devices;
+            }
+
+            // Input is delivered on the driver's callback thread, which the thread options cannot reach.
+            std::unique_ptr<smidi::input_device> create_input_device(const std::string& name, const device_options& options)
+            {
+                validate_device_options(options);
+                return std::make_unique<winmm::input_device>(find_device_index(_input_devices, name), options);
+            }
+
+            // WinMM device indices shift when devices come and go, the lists are enumerated again and compared. Open
+            // devices hold their own handles and are not affected.
+            std::vector<device_change> refresh() override
+            {
+                std::vector<device_info> output_devices = generate_output_device_list();
+                std::vector<device_info> input_devices = generate_input_device_list();
+
+                std::vector<device_change> changes;
+                diff_device_lists(_output_devices, output_devices, false, changes);
+                diff_device_lists(_input_devices, input_devices, true, changes);
+                _output_devices = std::move(output_devices);
+                _input_devices = std::move(input_devices);
+                return changes;
+            }
+
+            // WinMM only announces device changes to windows, a watcher thread polls the device lists instead while a
+            // callback is set.
+            void set_device_change_callback(device_change_callback callback) override
+            {
+                stop_watcher();
+                _notifier.set_callback(std::move(callback));
+                if (_notifier.has_callback())
+                {
+                    _watcher_running = true;
+                    _watcher = std::thread([this, output_devices = _output_devices, input_devices = _input_devices]() mutable {
+                        watch(std::move(output_devices), std::move(input_devices));
+                    });
+                }
+            }
+
+          private:
+            // Compares against the lists last seen by the watcher, refresh() is left to the application's thread.
+            void watch(std::vector<device_info> output_devices, std::vector<device_info> input_devices)
+            {
+                std::unique_lock<std::mutex> lock(_watcher_mutex);
+                while (!_watcher_cv.wait_for(lock, watch_interval, [this]() { return !_watcher_running; }))
+                {
+                    try
+                    {
+                        std::vector<device_info> new_output_devices = generate_output_device_list();
+                        std::vector<device_info> new_input_devices = generate_input_device_list();
+
+                        std::vector<device_change> changes;
+                        diff_device_lists(output_devices, new_output_devices, false, changes);
+                        diff_device_lists(input_devices, new_input_devices, true, changes);
+                        output_devices = std::move(new_output_devices);
+                        input_devices = std::move(new_input_devices);
+
+                        if (!changes.empty())
+                        {
+                            _notifier.notify();
+                        }
+                    }
+                    catch (const std::exception&)
+                    {
+                        // Devices disappearing mid-enumeration, try again on the next interval.
+                    }
+                }
+            }
+
+            void stop_watcher()
+            {
+                if (!_watcher.joinable())
+                {
+                    return;
+                }
+
+                {
+                    std::lock_guard<std::mutex> lock(_watcher_mutex);
+                    _watcher_running = false;
+                }
+                _watcher_cv.notify_all();
+                _watcher.join();
+            }
+
+            static constexpr std::chrono::milliseconds watch_interval{1000};
+
+            std::vector<device_info> _output_devices;
+            std::vector<device_info> _input_devices;
+
+            device_change_notifier _notifier;
+            std::mutex _watcher_mutex;
+            std::condition_variable _watcher_cv;
+            bool _watcher_running = false;
+            std::thread _watcher;
+        };
+    } // namespace winmm
+
+    std::unique_ptr<system> create_system()
+    {
+        return std::make_unique<winmm::system>();
+    }
+} // namespace smidi
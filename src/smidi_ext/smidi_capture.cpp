@@ -0,0 +1,985 @@
+#include "smidi_ext/smidi_capture.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace smidi
+{
+    namespace
+    {
+        constexpr uint32_t capture_version = 1;
+        constexpr size_t file_header_size = 8;
+        constexpr size_t block_header_size = 28;
+        constexpr size_t index_entry_size = 20;
+        constexpr size_t index_header_size = 8;
+        constexpr size_t trailer_size = 12;
+        constexpr uint32_t block_compressed = 1;
+
+        void put_u32(uint8_t* data, uint32_t value) noexcept
+        {
+            for (size_t byte_idx = 0; byte_idx < 4; byte_idx++)
+            {
+                data[byte_idx] = static_cast<uint8_t>(value >> (8 * byte_idx));
+            }
+        }
+
+        void put_u64(uint8_t* data, uint64_t value) noexcept
+        {
+            for (size_t byte_idx = 0; byte_idx < 8; byte_idx++)
+            {
+                data[byte_idx] = static_cast<uint8_t>(value >> (8 * byte_idx));
+            }
+        }
+
+        uint32_t get_u32(const uint8_t* data) noexcept
+        {
+            uint32_t value = 0;
+            for (size_t byte_idx = 0; byte_idx < 4; byte_idx++)
+            {
+                value |= static_cast<uint32_t>(data[byte_idx]) << (8 * byte_idx);
+            }
+            return value;
+        }
+
+        uint64_t get_u64(const uint8_t* data) noexcept
+        {
+            uint64_t value = 0;
+            for (size_t byte_idx = 0; byte_idx < 8; byte_idx++)
+            {
+                value |= static_cast<uint64_t>(data[byte_idx]) << (8 * byte_idx);
+            }
+            return value;
+        }
+
+        void put_varint(std::vector<uint8_t>& data, uint64_t value)
+        {
+            while (value >= 0x80)
+            {
+                data.push_back(static_cast<uint8_t>(value | 0x80));
+                value >>= 7;
+            }
+            data.push_back(static_cast<uint8_t>(value));
+        }
+
+        bool get_varint(const uint8_t* data, size_t size, size_t& position, uint64_t& value) noexcept
+        {
+            value = 0;
+            for (unsigned int shift = 0; shift < 64 && position < size; shift += 7)
+            {
+                const uint8_t byte = data[position++];
+                value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+                if ((byte & 0x80) == 0)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // Blocks are compressed with a byte oriented LZ77 in the layout of LZ4 blocks: a token with the literal count
+        // and match length in its nibbles, extended by 255 valued bytes, the literals, and a two byte match offset.
+        // Encoded MIDI repeats status bytes, controller numbers and whole messages, which is what it finds.
+        constexpr size_t min_match = 4;
+        constexpr size_t hash_bits = 12;
+        constexpr size_t max_offset = 65535;
+
+        void put_length(std::vector<uint8_t>& output, size_t length)
+        {
+            while (length >= 255)
+            {
+                output.push_back(255);
+                length -= 255;
+            }
+            output.push_back(static_cast<uint8_t>(length));
+        }
+
+        void put_sequence(std::vector<uint8_t>& output, const uint8_t* literals, size_t literal_count, size_t offset, size_t match_length)
+        {
+            const size_t match_code = match_length >= min_match ? match_length - min_match : 0;
+            output.push_back(static_cast<uint8_t>((std::min<size_t>(literal_count, 15) << 4) | std::min<size_t>(match_code, 15)));
+            if (literal_count >= 15)
+            {
+                put_length(output, literal_count - 15);
+            }
+            output.insert(output.end(), literals, literals + literal_count);
+            if (match_length == 0)
+            {
+                return;
+            }
+
+            output.push_back(static_cast<uint8_t>(offset));
+            output.push_back(static_cast<uint8_t>(offset >> 8));
+            if (match_code >= 15)
+            {
+                put_length(output, match_code - 15);
+            }
+        }
+
+        uint32_t read_u32(const uint8_t* data) noexcept
+        {
+            uint32_t value;
+            memcpy(&value, data, sizeof(value));
+            return value;
+        }
+
+        void compress(const uint8_t* input, size_t size, std::vector<uint8_t>& output, std::vector<uint32_t>& table)
+        {
+            output.clear();
+            table.assign(size_t(1) << hash_bits, UINT32_MAX);
+
+            size_t anchor = 0;
+            size_t position = 0;
+            while (position + min_match <= size)
+            {
+                const uint32_t sequence = read_u32(input + position);
+                const size_t hash = (sequence * 2654435761u) >> (32 - hash_bits);
+                const uint32_t candidate = table[hash];
+                table[hash] = static_cast<uint32_t>(position);
+
+                if (candidate == UINT32_MAX || position - candidate > max_offset || read_u32(input + candidate) != sequence)
+                {
+                    position++;
+                    continue;
+                }
+
+                size_t match_length = min_match;
+                while (position + match_length < size && input[candidate + match_length] == input[position + match_length])
+                {
+                    match_length++;
+                }
+                put_sequence(output, input + anchor, position - anchor, position - candidate, match_length);
+                position += match_length;
+                anchor = position;
+            }
+
+            // The last sequence is literals only, also when there are none.
+            put_sequence(output, input + anchor, size - anchor, 0, 0);
+        }
+
+        bool get_length(const uint8_t* input, size_t size, size_t& position, size_t& length) noexcept
+        {
+            while (position < size)
+            {
+                const uint8_t byte = input[position++];
+                length += byte;
+                if (byte != 255)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // Throws std::runtime_error unless input decompresses to exactly output.size() bytes.
+        void decompress(const uint8_t* input, size_t size, std::vector<uint8_t>& output)
+        {
+            const size_t output_size = output.size();
+            size_t out = 0;
+            size_t position = 0;
+            while (position < size)
+            {
+                const uint8_t token = input[position++];
+                size_t literal_count = token >> 4;
+                if ((literal_count == 15 && !get_length(input, size, position, literal_count)) || literal_count > size - position ||
+                    literal_count > output_size - out)
+                {
+                    throw std::runtime_error("Corrupt capture block.");
+                }
+                memcpy(output.data() + out, input + position, literal_count);
+                position += literal_count;
+                out += literal_count;
+                if (position == size)
+                {
+                    break;
+                }
+
+                if (size - position < 2)
+                {
+                    throw std::runtime_error("Corrupt capture block.");
+                }
+                const size_t offset = input[position] | (static_cast<size_t>(input[position + 1]) << 8);
+                position += 2;
+                size_t match_length = token & 0x0F;
+                if ((match_length == 15 && !get_length(input, size, position, match_length)) || offset == 0 || offset > out ||
+                    match_length + min_match > output_size - out)
+                {
+                    throw std::runtime_error("Corrupt capture block.");
+                }
+                match_length += min_match;
+
+                // Matches may overlap what they copy, byte by byte repeats the pattern.
+                for (size_t byte_idx = 0; byte_idx < match_length; byte_idx++, out++)
+                {
+                    output[out] = output[out - offset];
+                }
+            }
+
+            if (out != output_size)
+            {
+                throw std::runtime_error("Corrupt capture block.");
+            }
+        }
+    } // namespace
+
+    capture_writer::capture_writer(const std::string& path, const capture_options& options)
+        : _options(options)
+    {
+        if (options.block_size == 0 || options.block_size > UINT32_MAX / 2)
+        {
+            throw std::invalid_argument("Invalid capture block size.");
+        }
+
+        if (options.pending_blocks == 0)
+        {
+            throw std::invalid_argument("Invalid capture pending block count.");
+        }
+
+        _block.reserve(options.block_size + 64);
+        _pending.resize(options.pending_blocks);
+        for (pending_block& block : _pending)
+        {
+            block.data.reserve(options.block_size + 64);
+        }
+
+        _file = std::fopen(path.c_str(), "wb");
+        if (_file == nullptr)
+        {
+            throw std::runtime_error("Failed to create " + path + ".");
+        }
+
+        uint8_t header[file_header_size];
+        memcpy(header, "SMCP", 4);
+        put_u32(header + 4, capture_version);
+        try
+        {
+            write_bytes(header, sizeof(header));
+            _statistics.file_bytes = _file_offset;
+            _thread = std::thread([this]() { run(); });
+        }
+        catch (...)
+        {
+            std::fclose(_file);
+            throw;
+        }
+    }
+
+    capture_writer::~capture_writer()
+    {
+        try
+        {
+            close();
+        }
+        catch (...)
+        {
+        }
+
+        stop_writer();
+        if (_file != nullptr)
+        {
+            std::fclose(_file);
+        }
+    }
+
+    void capture_writer::write(uint32_t port, clock::time_point time, const uint8_t* data, size_t size)
+    {
+        if (data == nullptr)
+        {
+            throw std::invalid_argument("NULL buffer.");
+        }
+
+        if (size == 0)
+        {
+            throw std::invalid_argument("Invalid buffer size.");
+        }
+
+        std::unique_lock<decltype(_mutex)> lock(_mutex);
+        write_event(lock, true, port, time, data, size);
+    }
+
+    size_t capture_writer::receive(input_device& device, uint32_t port, uint8_t* data, size_t size, time_stamp* time_stamp)
+    {
+        const size_t message_size = device.receive(data, size, time_stamp);
+        std::unique_lock<decltype(_mutex)> lock(_mutex);
+        write_event(lock, true, port, clock::now(), data, message_size);
+        return message_size;
+    }
+
+    result capture_writer::try_receive(input_device& device, uint32_t port, uint8_t* data, size_t size, size_t* message_size,
+                                       time_stamp* time_stamp) noexcept
+    {
+        size_t received_size = 0;
+        const result received = device.try_receive(data, size, &received_size, time_stamp);
+        if (message_size != nullptr)
+        {
+            *message_size = received_size;
+        }
+        if (received != SMIDI_RESULT_OK)
+        {
+            return received;
+        }
+
+        std::unique_lock<decltype(_mutex)> lock(_mutex);
+        try
+        {
+            if (!write_event(lock, false, port, clock::now(), data, received_size))
+            {
+                _statistics.dropped++;
+            }
+        }
+        catch (...)
+        {
+            _statistics.dropped++;
+        }
+        return SMIDI_RESULT_OK;
+    }
+
+    void capture_writer::flush()
+    {
+        std::unique_lock<decltype(_mutex)> lock(_mutex);
+        if (_file == nullptr)
+        {
+            return;
+        }
+
+        wait_for_writer(lock);
+        if (std::fflush(_file) != 0 || _write_failed)
+        {
+            throw std::runtime_error("Failed to write capture log.");
+        }
+    }
+
+    void capture_writer::close()
+    {
+        {
+            std::unique_lock<decltype(_mutex)> lock(_mutex);
+            if (_file == nullptr)
+            {
+                return;
+            }
+
+            wait_for_writer(lock);
+
+            const uint64_t index_offset = _file_offset;
+            std::vector<uint8_t> index(index_header_size + _index.size() * index_entry_size + trailer_size);
+            memcpy(index.data(), "SMCI", 4);
+            put_u32(index.data() + 4, static_cast<uint32_t>(_index.size()));
+            uint8_t* entry = index.data() + index_header_size;
+            for (const index_entry& block : _index)
+            {
+                put_u64(entry, block.offset);
+                put_u64(entry + 8, block.first_time);
+                put_u32(entry + 16, block.events);
+                entry += index_entry_size;
+            }
+            put_u64(entry, index_offset);
+            memcpy(entry + 8, "SMCE", 4);
+            write_bytes(index.data(), index.size());
+            _statistics.file_bytes = _file_offset;
+
+            const int result = std::fclose(_file);
+            _file = nullptr;
+            if (result != 0 || _write_failed)
+            {
+                throw std::runtime_error("Failed to write capture log.");
+            }
+        }
+        stop_writer();
+    }
+
+    capture_statistics capture_writer::statistics() const
+    {
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        return _statistics;
+    }
+
+    bool capture_writer::write_event(std::unique_lock<std::mutex>& lock, bool wait, uint32_t port, clock::time_point time,
+                                     const uint8_t* data, size_t size)
+    {
+        if (_file == nullptr)
+        {
+            throw std::runtime_error("Capture log is closed.");
+        }
+
+        // The writer was behind when the block filled up.
+        if (_block.size() >= _options.block_size && !queue_block(lock, wait))
+        {
+            return false;
+        }
+
+        if (!_started)
+        {
+            _started = true;
+            _start_time = time;
+        }
+
+        // Threads take the lock in a different order than they took their times, the log stays in lock order.
+        const uint64_t log_time = std::max<uint64_t>(
+            time > _start_time ? static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(time - _start_time).count()) : 0,
+            _last_time);
+        if (_block_events == 0)
+        {
+            _block_first_time = log_time;
+        }
+
+        const size_t encoded_size = _block.size();
+        put_varint(_block, log_time - (_block_events == 0 ? _block_first_time : _last_time));
+        put_varint(_block, port);
+        put_varint(_block, size);
+        _block.insert(_block.end(), data, data + size);
+
+        _last_time = log_time;
+        _block_events++;
+        _statistics.events++;
+        _statistics.encoded_bytes += _block.size() - encoded_size;
+
+        if (_block.size() >= _options.block_size)
+        {
+            queue_block(lock, false);
+        }
+        return true;
+    }
+
+    // Hands the open block to the writer thread. Returns false if every block is pending and wait is false.
+    bool capture_writer::queue_block(std::unique_lock<std::mutex>& lock, bool wait)
+    {
+        if (_pending_count == _pending.size())
+        {
+            if (!wait)
+            {
+                return false;
+            }
+            _cv.wait(lock, [this]() { return _pending_count < _pending.size(); });
+        }
+
+        pending_block& block = _pending[(_pending_first + _pending_count) % _pending.size()];
+        block.data.swap(_block);
+        block.first_time = _block_first_time;
+        block.events = _block_events;
+        _block_events = 0;
+        _pending_count++;
+        _cv.notify_all();
+        return true;
+    }
+
+    // Queues the open block and waits until the writer wrote everything, the file is then not in use by it.
+    void capture_writer::wait_for_writer(std::unique_lock<std::mutex>& lock)
+    {
+        if (_block_events > 0)
+        {
+            queue_block(lock, true);
+        }
+        _cv.wait(lock, [this]() { return _pending_count == 0; });
+    }
+
+    void capture_writer::stop_writer()
+    {
+        {
+            std::lock_guard<decltype(_mutex)> lock(_mutex);
+            _stopping = true;
+        }
+        _cv.notify_all();
+        if (_thread.joinable())
+        {
+            _thread.join();
+        }
+    }
+
+    void capture_writer::run()
+    {
+        std::unique_lock<decltype(_mutex)> lock(_mutex);
+        while (true)
+        {
+            _cv.wait(lock, [this]() { return _pending_count > 0 || _stopping; });
+            if (_pending_count == 0)
+            {
+                return;
+            }
+
+            // The block stays counted as pending while it is written, so its buffer is not reused.
+            pending_block& block = _pending[_pending_first];
+            lock.unlock();
+            bool written = true;
+            try
+            {
+                write_block(block);
+            }
+            catch (...)
+            {
+                written = false;
+            }
+            lock.lock();
+
+            if (written)
+            {
+                _statistics.blocks++;
+            }
+            else
+            {
+                _statistics.dropped += block.events;
+                _write_failed = true;
+            }
+            _statistics.file_bytes = _file_offset;
+            block.data.clear();
+            _pending_first = (_pending_first + 1) % _pending.size();
+            _pending_count--;
+            _cv.notify_all();
+        }
+    }
+
+    // Runs on the writer thread without the lock. The block is not in the index unless it was written.
+    void capture_writer::write_block(const pending_block& block)
+    {
+        const uint8_t* payload = block.data.data();
+        size_t payload_size = block.data.size();
+        uint32_t flags = 0;
+        if (_options.compress)
+        {
+            compress(block.data.data(), block.data.size(), _compressed, _hash_table);
+            if (_compressed.size() < block.data.size())
+            {
+                payload = _compressed.data();
+                payload_size = _compressed.size();
+                flags |= block_compressed;
+            }
+        }
+
+        const index_entry entry = {_file_offset, block.first_time, block.events};
+        uint8_t header[block_header_size];
+        memcpy(header, "SMCB", 4);
+        put_u32(header + 4, static_cast<uint32_t>(block.data.size()));
+        put_u32(header + 8, static_cast<uint32_t>(payload_size));
+        put_u32(header + 12, block.events);
+        put_u32(header + 16, flags);
+        put_u64(header + 20, block.first_time);
+        write_bytes(header, sizeof(header));
+        write_bytes(payload, payload_size);
+
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        _index.push_back(entry);
+    }
+
+    void capture_writer::write_bytes(const void* data, size_t size)
+    {
+        if (std::fwrite(data, 1, size, _file) != size)
+        {
+            throw std::runtime_error("Failed to write capture log.");
+        }
+        _file_offset += size;
+    }
+
+    struct capture_reader::mapping
+    {
+        explicit mapping(const std::string& path)
+        {
+#if defined(_WIN32)
+            _file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+            if (_file == INVALID_HANDLE_VALUE)
+            {
+                throw std::runtime_error("Failed to open " + path + ".");
+            }
+
+            LARGE_INTEGER size;
+            if (!GetFileSizeEx(_file, &size))
+            {
+                CloseHandle(_file);
+                throw std::runtime_error("Failed to read the size of " + path + ".");
+            }
+            this->size = static_cast<size_t>(size.QuadPart);
+            if (this->size == 0)
+            {
+                return;
+            }
+
+            _mapping = CreateFileMappingA(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            data = _mapping != nullptr ? static_cast<const uint8_t*>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+            if (data == nullptr)
+            {
+                close();
+                throw std::runtime_error("Failed to map " + path + ".");
+            }
+#else
+            int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0)
+            {
+                throw std::runtime_error("Failed to open " + path + ".");
+            }
+
+            struct stat status;
+            if (fstat(fd, &status) != 0)
+            {
+                ::close(fd);
+                throw std::runtime_error("Failed to read the size of " + path + ".");
+            }
+            size = static_cast<size_t>(status.st_size);
+            if (size > 0)
+            {
+                void* view = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (view == MAP_FAILED)
+                {
+                    ::close(fd);
+                    throw std::runtime_error("Failed to map " + path + ".");
+                }
+                madvise(view, size, MADV_SEQUENTIAL);
+                data = static_cast<const uint8_t*>(view);
+            }
+            ::close(fd);
+#endif
+        }
+
+        ~mapping()
+        {
+            close();
+        }
+
+        void close() noexcept
+        {
+#if defined(_WIN32)
+            if (data != nullptr)
+            {
+                UnmapViewOfFile(data);
+            }
+            if (_mapping != nullptr)
+            {
+                CloseHandle(_mapping);
+            }
+            if (_file != INVALID_HANDLE_VALUE)
+            {
+                CloseHandle(_file);
+            }
+            _file = INVALID_HANDLE_VALUE;
+            _mapping = nullptr;
+#else
+            if (data != nullptr)
+            {
+                munmap(const_cast<uint8_t*>(data), size);
+            }
+#endif
+            data = nullptr;
+        }
+
+        const uint8_t* data = nullptr;
+        size_t size = 0;
+#if defined(_WIN32)
+        HANDLE _file = INVALID_HANDLE_VALUE;
+        HANDLE _mapping = nullptr;
+#endif
+    };
+
+    capture_reader::capture_reader(const uint8_t* data, size_t size)
+    {
+        if (data == nullptr)
+        {
+            throw std::invalid_argument("NULL buffer.");
+        }
+        open(data, size);
+    }
+
+    capture_reader::capture_reader(const std::string& path)
+        : _mapping(std::make_unique<mapping>(path))
+    {
+        open(_mapping->data, _mapping->size);
+    }
+
+    capture_reader::~capture_reader() = default;
+
+    size_t capture_reader::block_count() const noexcept
+    {
+        return _blocks.size();
+    }
+
+    uint64_t capture_reader::event_count() const noexcept
+    {
+        return _event_count;
+    }
+
+    bool capture_reader::complete() const noexcept
+    {
+        return _complete;
+    }
+
+    bool capture_reader::next(capture_event& event)
+    {
+        while (_position >= _events_size)
+        {
+            if (_next_block >= _blocks.size())
+            {
+                return false;
+            }
+            load_block(_next_block);
+        }
+
+        uint64_t delta = 0;
+        uint64_t port = 0;
+        uint64_t size = 0;
+        if (!get_varint(_events, _events_size, _position, delta) || !get_varint(_events, _events_size, _position, port) ||
+            !get_varint(_events, _events_size, _position, size) || size > _events_size - _position || port > UINT32_MAX)
+        {
+            throw std::runtime_error("Corrupt capture block.");
+        }
+
+        _time += delta;
+        event.port = static_cast<uint32_t>(port);
+        event.time = std::chrono::nanoseconds(static_cast<int64_t>(_time));
+        event.data = _events + _position;
+        event.size = static_cast<size_t>(size);
+        _position += static_cast<size_t>(size);
+        return true;
+    }
+
+    void capture_reader::seek(std::chrono::nanoseconds time)
+    {
+        const uint64_t target = time.count() > 0 ? static_cast<uint64_t>(time.count()) : 0;
+        auto iter = std::upper_bound(_blocks.begin(), _blocks.end(), target,
+                                     [](uint64_t value, const block_entry& block) { return value < block.first_time; });
+        rewind();
+        if (iter == _blocks.begin())
+        {
+            return;
+        }
+        load_block(static_cast<size_t>(iter - _blocks.begin()) - 1);
+
+        // Step over the earlier events of the block, and of the next blocks if they all are.
+        while (true)
+        {
+            const size_t position = _position;
+            const uint64_t event_time = _time;
+            const size_t next_block = _next_block;
+            capture_event event;
+            if (!next(event))
+            {
+                return;
+            }
+
+            if (static_cast<uint64_t>(event.time.count()) >= target)
+            {
+                if (_next_block != next_block)
+                {
+                    // The event opened the next block, loading it again starts before the event.
+                    load_block(_next_block - 1);
+                }
+                else
+                {
+                    _position = position;
+                    _time = event_time;
+                }
+                return;
+            }
+        }
+    }
+
+    void capture_reader::rewind() noexcept
+    {
+        _next_block = 0;
+        _events = nullptr;
+        _events_size = 0;
+        _position = 0;
+        _time = 0;
+    }
+
+    void capture_reader::open(const uint8_t* data, size_t size)
+    {
+        _data = data;
+        _size = size;
+        if (size < file_header_size || memcmp(data, "SMCP", 4) != 0)
+        {
+            throw std::runtime_error("Not a capture log.");
+        }
+
+        if (get_u32(data + 4) != capture_version)
+        {
+            throw std::runtime_error("Unsupported capture log version.");
+        }
+
+        // The index, if the capture finished and it is intact.
+        if (size >= file_header_size + index_header_size + trailer_size && memcmp(data + size - 4, "SMCE", 4) == 0)
+        {
+            const uint64_t index_offset = get_u64(data + size - trailer_size);
+            if (index_offset >= file_header_size && index_offset <= size - index_header_size - trailer_size &&
+                memcmp(data + index_offset, "SMCI", 4) == 0)
+            {
+                const uint64_t block_count = get_u32(data + index_offset + 4);
+                if (block_count * index_entry_size == size - trailer_size - index_offset - index_header_size)
+                {
+                    const uint8_t* entry = data + index_offset + index_header_size;
+                    for (uint64_t block_idx = 0; block_idx < block_count; block_idx++, entry += index_entry_size)
+                    {
+                        _blocks.push_back({get_u64(entry), get_u64(entry + 8), get_u32(entry + 16)});
+                        _event_count += _blocks.back().events;
+                    }
+                    _complete = true;
+                    return;
+                }
+            }
+        }
+
+        // Otherwise every complete block up to where the capture stopped.
+        size_t offset = file_header_size;
+        while (size - offset >= block_header_size && memcmp(data + offset, "SMCB", 4) == 0)
+        {
+            const size_t stored_size = get_u32(data + offset + 8);
+            if (stored_size > size - offset - block_header_size)
+            {
+                break;
+            }
+            _blocks.push_back({offset, get_u64(data + offset + 20), get_u32(data + offset + 12)});
+            _event_count += _blocks.back().events;
+            offset += block_header_size + stored_size;
+        }
+    }
+
+    void capture_reader::load_block(size_t block_idx)
+    {
+        const block_entry& block = _blocks[block_idx];
+        if (block.offset > _size || _size - block.offset < block_header_size || memcmp(_data + block.offset, "SMCB", 4) != 0)
+        {
+            throw std::runtime_error("Corrupt capture log index.");
+        }
+
+        const uint8_t* header = _data + block.offset;
+        const size_t encoded_size = get_u32(header + 4);
+        const size_t stored_size = get_u32(header + 8);
+        const uint32_t flags = get_u32(header + 16);
+        if (stored_size > _size - block.offset - block_header_size)
+        {
+            throw std::runtime_error("Corrupt capture block.");
+        }
+
+        const uint8_t* payload = header + block_header_size;
+        if ((flags & block_compressed) != 0)
+        {
+            _decoded.resize(encoded_size);
+            decompress(payload, stored_size, _decoded);
+            _events = _decoded.data();
+        }
+        else
+        {
+            if (stored_size != encoded_size)
+            {
+                throw std::runtime_error("Corrupt capture block.");
+            }
+            _events = payload;
+        }
+
+        _events_size = encoded_size;
+        _position = 0;
+        _time = get_u64(header + 20);
+        _next_block = block_idx + 1;
+    }
+
+    capture_replayer::capture_replayer(capture_reader& reader, const std::vector<output_device*>& outputs, const replay_options& options)
+        : _reader(reader)
+        , _outputs(outputs)
+        , _options(options)
+    {
+        if (!(options.speed >= 0.0))
+        {
+            throw std::invalid_argument("Invalid replay speed.");
+        }
+    }
+
+    void capture_replayer::start(clock::time_point time)
+    {
+        _started = true;
+        _start_time = time;
+        _pending = _reader.next(_event);
+        _first_time = _event.time;
+    }
+
+    capture_replayer::clock::time_point capture_replayer::pump(clock::time_point now)
+    {
+        if (!_started)
+        {
+            return clock::time_point::max();
+        }
+
+        while (_pending)
+        {
+            const clock::time_point due = due_time();
+            if (due > now)
+            {
+                return due;
+            }
+
+            if (_options.speed > 0.0 && due < now && !_blocked)
+            {
+                _statistics.late++;
+                _statistics.max_lateness = std::max(_statistics.max_lateness, std::chrono::duration_cast<std::chrono::nanoseconds>(now - due));
+            }
+
+            output_device* output = _event.port < _outputs.size() ? _outputs[_event.port] : nullptr;
+            if (output == nullptr)
+            {
+                _statistics.skipped++;
+            }
+            else
+            {
+                const result sent = output->try_send(_event.data, _event.size);
+                if (sent == SMIDI_RESULT_WOULD_BLOCK)
+                {
+                    // Later events wait behind this one, the log order is kept.
+                    _statistics.blocked++;
+                    _blocked = true;
+                    return now + blocked_retry_interval;
+                }
+                if (sent != SMIDI_RESULT_OK)
+                {
+                    _statistics.failed++;
+                }
+            }
+            _blocked = false;
+            _statistics.events++;
+            _pending = _reader.next(_event);
+        }
+        return clock::time_point::max();
+    }
+
+    bool capture_replayer::finished() const noexcept
+    {
+        return _started && !_pending;
+    }
+
+    replay_statistics capture_replayer::statistics() const noexcept
+    {
+        return _statistics;
+    }
+
+    // As fast as possible everything is due at the start.
+    capture_replayer::clock::time_point capture_replayer::due_time() const
+    {
+        if (_options.speed == 0.0)
+        {
+            return _start_time;
+        }
+
+        const double offset_ns = static_cast<double>((_event.time - _first_time).count()) / _options.speed;
+        return _start_time + std::chrono::nanoseconds(static_cast<int64_t>(offset_ns));
+    }
+
+    replay_statistics replay_capture(capture_reader& reader, const std::vector<output_device*>& outputs, const replay_options& options)
+    {
+        capture_replayer replayer(reader, outputs, options);
+        replayer.start(capture_replayer::clock::now());
+        while (!replayer.finished())
+        {
+            const capture_replayer::clock::time_point due = replayer.pump(capture_replayer::clock::now());
+            if (due != capture_replayer::clock::time_point::max())
+            {
+                std::this_thread::sleep_until(due);
+            }
+        }
+        return replayer.statistics();
+    }
+} // namespace smidi
@@ -0,0 +1,415 @@
+#include "smidi_ext/smidi_clock.h"
+#include "smidi_ext/smidi_messages.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace smidi
+{
+    namespace
+    {
+        constexpr uint8_t timing_clock_status = 0xF8;
+        constexpr uint8_t start_status = 0xFA;
+        constexpr uint8_t continue_status = 0xFB;
+        constexpr uint8_t stop_status = 0xFC;
+        constexpr uint8_t song_position_pointer_status = 0xF2;
+
+        // Clocks off the prediction by more than this share of the interval are suspect, this many in a row restart the
+        // follower's filter.
+        constexpr double max_suspect_error = 0.25;
+        constexpr uint32_t max_suspect_clocks = 3;
+
+        double tempo_ns_per_clock(double tempo)
+        {
+            if (!(tempo > 0.0))
+            {
+                throw std::invalid_argument("Invalid tempo.");
+            }
+            return 60.0e9 / (tempo * midi_clocks_per_quarter_note);
+        }
+
+        std::chrono::nanoseconds to_nanoseconds(double ns)
+        {
+            return std::chrono::nanoseconds(std::llround(ns));
+        }
+    } // namespace
+
+    clock_master::clock_master(output_device& output, const clock_master_options& options)
+        : _output(output)
+        , _ns_per_clock(tempo_ns_per_clock(options.tempo))
+    {
+    }
+
+    void clock_master::set_tempo(double tempo)
+    {
+        const double ns_per_clock = tempo_ns_per_clock(tempo);
+
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        if (_running)
+        {
+            _anchor_time = deadline(_next_clock);
+            _anchor_clock = _next_clock;
+        }
+        _ns_per_clock = ns_per_clock;
+    }
+
+    double clock_master::tempo() const
+    {
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        return 60.0e9 / (_ns_per_clock * midi_clocks_per_quarter_note);
+    }
+
+    void clock_master::start(clock::time_point time)
+    {
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        _next_clock = 0;
+        begin(time, start_status);
+    }
+
+    void clock_master::resume(clock::time_point time)
+    {
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        begin(time, continue_status);
+    }
+
+    void clock_master::stop()
+    {
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        _running = false;
+        _transport = 0;
+
+        const uint8_t message[] = {stop_status};
+        send(message, sizeof(message));
+    }
+
+    bool clock_master::running() const
+    {
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        return _running;
+    }
+
+    void clock_master::set_song_position(uint16_t sixteenths)
+    {
+        if (sixteenths > 0x3FFF)
+        {
+            throw std::invalid_argument("Invalid song position.");
+        }
+
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        if (_running)
+        {
+            throw std::runtime_error("Song position can only be set while stopped.");
+        }
+
+        _next_clock = static_cast<uint64_t>(sixteenths) * midi_clocks_per_song_position;
+
+        const uint8_t message[] = {song_position_pointer_status, static_cast<uint8_t>(sixteenths & 0x7F),
+                                   static_cast<uint8_t>(sixteenths >> 7)};
+        send(message, sizeof(message));
+    }
+
+    uint64_t clock_master::position() const
+    {
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        return _next_clock;
+    }
+
+    clock_master::clock::time_point clock_master::pump(clock::time_point now)
+    {
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        if (!_running)
+        {
+            return clock::time_point::max();
+        }
+
+        if (_transport != 0)
+        {
+            if (now < _anchor_time)
+            {
+                return _anchor_time;
+            }
+
+            const uint8_t message[] = {_transport};
+            send(message, sizeof(message));
+            _transport = 0;
+        }
+
+        clock::time_point due = deadline(_next_clock);
+        while (due <= now)
+        {
+            if (due < now)
+            {
+                _statistics.late++;
+                _statistics.max_lateness = std::max(_statistics.max_lateness, std::chrono::duration_cast<std::chrono::nanoseconds>(now - due));
+            }
+
+            const uint8_t message[] = {timing_clock_status};
+            send(message, sizeof(message));
+            _statistics.clocks++;
+
+            _next_clock++;
+            due = deadline(_next_clock);
+        }
+        return due;
+    }
+
+    clock_master_statistics clock_master::statistics() const
+    {
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        return _statistics;
+    }
+
+    clock_master::clock::time_point clock_master::deadline(uint64_t clock_idx) const
+    {
+        return _anchor_time + to_nanoseconds(static_cast<double>(clock_idx - _anchor_clock) * _ns_per_clock);
+    }
+
+    void clock_master::begin(clock::time_point time, uint8_t status)
+    {
+        _running = true;
+        _transport = status;
+        _anchor_time = time;
+        _anchor_clock = _next_clock;
+    }
+
+    void clock_master::send(const uint8_t* data, size_t size)
+    {
+        // A failed clock is not retried, the following ones stay on the grid.
+        if (_output.try_send(data, size) != SMIDI_RESULT_OK)
+        {
+            _statistics.failed++;
+        }
+    }
+
+    clock_follower::clock_follower(const clock_follower_options& options)
+        : _options(options)
+    {
+        if (!(options.phase_gain > 0.0 && options.phase_gain <= 1.0) || !(options.frequency_gain >= 0.0 && options.frequency_gain <= 1.0))
+        {
+            throw std::invalid_argument("Invalid loop filter gains.");
+        }
+    }
+
+    void clock_follower::process(const uint8_t* data, size_t size, clock::time_point time)
+    {
+        if (data == nullptr || size == 0)
+        {
+            throw std::invalid_argument("Invalid message.");
+        }
+
+        const uint8_t status = data[0];
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        if (is_timing_clock_message(status))
+        {
+            process_clock(time);
+        }
+        else if (is_start_message(status))
+        {
+            _running = true;
+            _position = 0;
+            restart_filter();
+        }
+        else if (is_continue_message(status))
+        {
+            _running = true;
+        }
+        else if (is_stop_message(status))
+        {
+            _running = false;
+            restart_filter();
+        }
+        else if (is_song_position_pointer_message(status) && size >= 3)
+        {
+            _position = static_cast<uint64_t>((data[1] & 0x7F) | ((data[2] & 0x7F) << 7)) * midi_clocks_per_song_position;
+            _clock_position = _position;
+        }
+    }
+
+    void clock_follower::reset()
+    {
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        _running = false;
+        _position = 0;
+        _clock_position = 0;
+        restart_filter();
+        _statistics = {0, 0, std::chrono::nanoseconds(0), std::chrono::nanoseconds(0)};
+        _squared_error_sum = 0.0;
+        _error_count = 0;
+    }
+
+    bool clock_follower::locked() const
+    {
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        return _filtered_clocks > _options.lock_clocks;
+    }
+
+    bool clock_follower::running() const
+    {
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        return _running;
+    }
+
+    double clock_follower::tempo() const
+    {
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        if (_ns_per_clock <= 0.0)
+        {
+            return 0.0;
+        }
+        return 60.0e9 / (_ns_per_clock * midi_clocks_per_quarter_note);
+    }
+
+    double clock_follower::beat_position(clock::time_point time) const
+    {
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        double clocks = static_cast<double>(_clock_position);
+        if (_running && _ns_per_clock > 0.0)
+        {
+            // Never past the next clock, the position would jump back when it arrives late.
+            const double elapsed_ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(time - _phase_time).count());
+            clocks += std::min(std::max(elapsed_ns / _ns_per_clock, 0.0), 1.0);
+        }
+        return clocks / midi_clocks_per_quarter_note;
+    }
+
+    uint64_t clock_follower::position() const
+    {
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        return _position;
+    }
+
+    clock_follower_statistics clock_follower::statistics() const
+    {
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        clock_follower_statistics statistics = _statistics;
+        if (_error_count > 0)
+        {
+            statistics.jitter_rms = to_nanoseconds(std::sqrt(_squared_error_sum / static_cast<double>(_error_count)));
+        }
+        return statistics;
+    }
+
+    void clock_follower::restart_filter()
+    {
+        _filtered_clocks = 0;
+        _skipped_clocks = 0;
+        _ns_per_clock = 0.0;
+        _suspect_clocks = 0;
+        _suspect_missed = 0;
+    }
+
+    void clock_follower::process_clock(clock::time_point time)
+    {
+        _statistics.clocks++;
+
+        if (_filtered_clocks > 0 && time > _last_clock_time && time - _last_clock_time >= _options.timeout)
+        {
+            restart_filter();
+        }
+
+        if (_running)
+        {
+            _clock_position = _position;
+            _position++;
+        }
+
+        // A clock stamped no later than the previous one, e.g. two clocks read in the same millisecond, has no
+        // interval to measure. It still counts for the position, the filter leaves it out. The raw times are compared,
+        // a clock a little early may still be before the filtered phase, which is what the filter corrects.
+        if (_filtered_clocks > 0 && time <= _last_clock_time)
+        {
+            _skipped_clocks++;
+            return;
+        }
+        const double raw_elapsed_ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(time - _last_clock_time).count());
+        _last_clock_time = time;
+
+        // Clocks left out since the last one are in this interval, they are not lost ones.
+        const uint64_t known_intervals = 1 + _skipped_clocks;
+        _skipped_clocks = 0;
+
+        if (_filtered_clocks == 0)
+        {
+            _phase_time = time;
+            _filtered_clocks = 1;
+            return;
+        }
+
+        const double elapsed_ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(time - _phase_time).count());
+        if (_filtered_clocks == 1)
+        {
+            _ns_per_clock = elapsed_ns / static_cast<double>(known_intervals);
+            _phase_time = time;
+            _filtered_clocks = 2;
+            return;
+        }
+
+        // A gap of whole intervals is clocks that got lost on the way, the filter predicts across them. Anything else
+        // far off the prediction is suspect, and a run of suspect clocks is a tempo jump the filter would take long to
+        // follow: it starts over from the last interval and the clocks assumed lost during the run are taken back.
+        const double ratio = elapsed_ns / _ns_per_clock;
+        double intervals = std::round(ratio);
+        if (intervals < 2.0 || std::abs(ratio - intervals) > max_suspect_error)
+        {
+            intervals = 1.0;
+        }
+        intervals = std::max(intervals, static_cast<double>(known_intervals));
+
+        const uint64_t missed = static_cast<uint64_t>(intervals) - known_intervals;
+        const double error_ns = elapsed_ns - intervals * _ns_per_clock;
+        if (missed > 0 || std::abs(error_ns) > max_suspect_error * _ns_per_clock)
+        {
+            _suspect_clocks++;
+            _suspect_missed += missed;
+        }
+        else
+        {
+            _suspect_clocks = 0;
+            _suspect_missed = 0;
+        }
+
+        if (_suspect_clocks >= max_suspect_clocks)
+        {
+            _statistics.missed -= _suspect_missed - missed;
+            if (_running)
+            {
+                _position -= _suspect_missed - missed;
+                _clock_position -= _suspect_missed - missed;
+            }
+
+            _ns_per_clock = raw_elapsed_ns / static_cast<double>(known_intervals);
+            _phase_time = time;
+            _filtered_clocks = 2;
+            _suspect_clocks = 0;
+            _suspect_missed = 0;
+            return;
+        }
+
+        if (missed > 0)
+        {
+            _statistics.missed += missed;
+            if (_running)
+            {
+                _position += missed;
+                _clock_position += missed;
+            }
+        }
+
+        // The first estimates come from a few clocks and can be far off, until the loop gains take over the filter
+        // uses those of a least squares line through the clocks so far.
+        const double count = static_cast<double>(_filtered_clocks + 1);
+        const double phase_gain = std::max(_options.phase_gain, 2.0 * (2.0 * count - 1.0) / (count * (count + 1.0)));
+        const double frequency_gain = std::max(_options.frequency_gain, 6.0 / (count * (count + 1.0)));
+        _phase_time += to_nanoseconds(intervals * _ns_per_clock + phase_gain * error_ns);
+        _ns_per_clock += frequency_gain * error_ns / intervals;
+        _filtered_clocks++;
+
+        if (_filtered_clocks > _options.lock_clocks)
+        {
+            _squared_error_sum += error_ns * error_ns;
+            _error_count++;
+            _statistics.jitter_max = std::max(_statistics.jitter_max, to_nanoseconds(std::abs(error_ns)));
+        }
+    }
+} // namespace smidi
@@ -0,0 +1,212 @@
+#include "smidi_ext/smidi_dejitter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace smidi
+{
+    namespace
+    {
+        // Consecutive outliers after which the model no longer describes the input.
+        constexpr uint32_t max_outlier_run = 16;
+        // Crystal oscillators are within a few hundred ppm, a larger slope is the fit following jitter.
+        constexpr double max_drift = 1.0e-3;
+
+        double to_ns(std::chrono::nanoseconds duration) noexcept
+        {
+            return static_cast<double>(duration.count());
+        }
+
+        std::chrono::nanoseconds to_nanoseconds(double ns) noexcept
+        {
+            return std::chrono::nanoseconds(std::llround(ns));
+        }
+    } // namespace
+
+    input_dejitter::input_dejitter(const input_dejitter_options& options)
+        : _options(options)
+    {
+        if (options.time_stamp_unit.count() <= 0 || options.byte_time.count() < 0 || options.window == 0 ||
+            options.drift_span.count() < 0 || options.outlier_threshold.count() <= 0)
+        {
+            throw std::invalid_argument("Invalid dejitter options.");
+        }
+        _decay = 1.0 - 1.0 / static_cast<double>(options.window);
+    }
+
+    input_dejitter::clock::time_point input_dejitter::process(time_stamp time_stamp, clock::time_point arrival, size_t size)
+    {
+        if (size == 0)
+        {
+            throw std::invalid_argument("Invalid buffer size.");
+        }
+
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        return correct(time_stamp, arrival, size);
+    }
+
+    void input_dejitter::reset()
+    {
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        _started = false;
+        _outlier_run = 0;
+        _last_size = 0;
+        _statistics = {0, 0, 0, 0, 0.0, std::chrono::nanoseconds(0)};
+        _squared_error_sum = 0.0;
+        _error_count = 0;
+    }
+
+    size_t input_dejitter::receive(input_device& device, uint8_t* data, size_t size, clock::time_point* time)
+    {
+        time_stamp stamp = 0;
+        const size_t message_size = device.receive(data, size, &stamp);
+        const clock::time_point arrival = clock::now();
+
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        const clock::time_point corrected = correct(stamp, arrival, message_size);
+        if (time != nullptr)
+        {
+            *time = corrected;
+        }
+        return message_size;
+    }
+
+    result input_dejitter::try_receive(input_device& device, uint8_t* data, size_t size, size_t* message_size,
+                                       clock::time_point* time) noexcept
+    {
+        time_stamp stamp = 0;
+        size_t received_size = 0;
+        const result received = device.try_receive(data, size, &received_size, &stamp);
+        if (message_size != nullptr)
+        {
+            *message_size = received_size;
+        }
+        if (received != SMIDI_RESULT_OK)
+        {
+            return received;
+        }
+
+        const clock::time_point arrival = clock::now();
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        const clock::time_point corrected = correct(stamp, arrival, received_size);
+        if (time != nullptr)
+        {
+            *time = corrected;
+        }
+        return SMIDI_RESULT_OK;
+    }
+
+    input_dejitter_statistics input_dejitter::statistics() const
+    {
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        input_dejitter_statistics statistics = _statistics;
+        statistics.drift_ppm = drift() * 1.0e6;
+        if (_error_count > 0)
+        {
+            statistics.arrival_jitter_rms = to_nanoseconds(std::sqrt(_squared_error_sum / static_cast<double>(_error_count)));
+        }
+        return statistics;
+    }
+
+    input_dejitter::clock::time_point input_dejitter::correct(time_stamp time_stamp, clock::time_point arrival, size_t size) noexcept
+    {
+        _statistics.events++;
+
+        // Time stamps going back mean the device was opened again and counts from zero.
+        if (!_started || time_stamp < _last_stamp)
+        {
+            if (_started)
+            {
+                _statistics.resets++;
+            }
+            restart(time_stamp, arrival);
+        }
+        _last_stamp = time_stamp;
+
+        double elapsed_ns = static_cast<double>(time_stamp - _origin_stamp) * to_ns(_options.time_stamp_unit);
+        double offset_ns = to_ns(arrival - _origin_arrival) - elapsed_ns;
+
+        bool update = true;
+        if (_weight > 0.0)
+        {
+            const double error_ns = offset_ns - predict(elapsed_ns);
+            if (std::abs(error_ns) > to_ns(_options.outlier_threshold))
+            {
+                _statistics.outliers++;
+                update = false;
+                if (++_outlier_run >= max_outlier_run)
+                {
+                    // The clocks jumped against each other, e.g. the device was reset without time stamps going back.
+                    _statistics.resets++;
+                    restart(time_stamp, arrival);
+                    elapsed_ns = 0.0;
+                    offset_ns = 0.0;
+                    update = true;
+                }
+            }
+            else
+            {
+                _outlier_run = 0;
+                _squared_error_sum += error_ns * error_ns;
+                _error_count++;
+            }
+        }
+
+        if (update)
+        {
+            _weight = _decay * _weight + 1.0;
+            const double share = 1.0 / _weight;
+            const double elapsed_deviation = elapsed_ns - _mean_elapsed;
+            _mean_elapsed += share * elapsed_deviation;
+            _mean_offset += share * (offset_ns - _mean_offset);
+            _elapsed_square_sum = _decay * _elapsed_square_sum + elapsed_deviation * (elapsed_ns - _mean_elapsed);
+            _product_sum = _decay * _product_sum + elapsed_deviation * (offset_ns - _mean_offset);
+        }
+
+        clock::time_point time = _origin_arrival + to_nanoseconds(elapsed_ns + predict(elapsed_ns));
+        if (_last_size > 0)
+        {
+            const clock::time_point earliest = _last_time + _options.byte_time * static_cast<int64_t>(_last_size);
+            if (time < earliest)
+            {
+                time = earliest;
+                _statistics.spread++;
+            }
+        }
+        _last_time = time;
+        _last_size = size;
+        return time;
+    }
+
+    void input_dejitter::restart(time_stamp time_stamp, clock::time_point arrival) noexcept
+    {
+        _started = true;
+        _origin_stamp = time_stamp;
+        _origin_arrival = arrival;
+        _outlier_run = 0;
+        _weight = 0.0;
+        _mean_elapsed = 0.0;
+        _mean_offset = 0.0;
+        _elapsed_square_sum = 0.0;
+        _product_sum = 0.0;
+    }
+
+    // Offset of the arrival from the nominal device clock at elapsed_ns.
+    double input_dejitter::predict(double elapsed_ns) const noexcept
+    {
+        return _mean_offset + drift() * (elapsed_ns - _mean_elapsed);
+    }
+
+    // The slope is only fitted once the time stamps in the window spread over drift_span, before that the device clock
+    // is taken to run at the nominal rate.
+    double input_dejitter::drift() const noexcept
+    {
+        const double span_ns = to_ns(_options.drift_span);
+        if (_weight == 0.0 || _elapsed_square_sum / _weight <= span_ns * span_ns)
+        {
+            return 0.0;
+        }
+        return std::min(std::max(_product_sum / _elapsed_square_sum, -max_drift), max_drift);
+    }
+} // namespace smidi
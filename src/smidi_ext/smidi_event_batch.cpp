@@ -0,0 +1,247 @@
+#include "smidi_ext/smidi_event_batch.h"
+#include "smidi_ext/smidi_messages.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace smidi
+{
+    namespace
+    {
+        constexpr uint8_t sysex_start = 0xF0;
+        constexpr uint8_t sysex_end = 0xF7;
+
+        // Length of the message at data, 0 if it is not a message and size + 1 if it is cut off by the end of the span.
+        size_t span_message_length(const uint8_t* data, size_t size) noexcept
+        {
+            const uint8_t status = data[0];
+            if (status == sysex_start)
+            {
+                const uint8_t* end = static_cast<const uint8_t*>(memchr(data + 1, sysex_end, size - 1));
+                return end != nullptr ? static_cast<size_t>(end - data) + 1 : size + 1;
+            }
+
+            const size_t length = status >= 0x80 ? non_system_exclusive_message_length(status) : 0;
+            if (length > size)
+            {
+                return size + 1;
+            }
+
+            // A status byte among the data bytes means the message was cut short.
+            for (size_t byte_idx = 1; byte_idx < length; byte_idx++)
+            {
+                if (data[byte_idx] >= 0x80)
+                {
+                    return 0;
+                }
+            }
+            return length;
+        }
+    } // namespace
+
+    event_batch::event_batch(size_t event_capacity, size_t arena_capacity)
+        : _times(event_capacity)
+        , _statuses(event_capacity)
+        , _data1(event_capacity)
+        , _data2(event_capacity)
+        , _sizes(event_capacity)
+        , _offsets(event_capacity)
+        , _arena(arena_capacity)
+    {
+        if (event_capacity == 0)
+        {
+            throw std::invalid_argument("Invalid batch capacity.");
+        }
+
+        if (arena_capacity > std::numeric_limits<uint32_t>::max())
+        {
+            throw std::invalid_argument("Invalid arena capacity.");
+        }
+    }
+
+    size_t event_batch::size() const noexcept
+    {
+        return _size;
+    }
+
+    bool event_batch::empty() const noexcept
+    {
+        return _size == 0;
+    }
+
+    size_t event_batch::capacity() const noexcept
+    {
+        return _times.size();
+    }
+
+    size_t event_batch::arena_size() const noexcept
+    {
+        return _arena_size;
+    }
+
+    size_t event_batch::arena_capacity() const noexcept
+    {
+        return _arena.size();
+    }
+
+    void event_batch::clear() noexcept
+    {
+        _size = 0;
+        _arena_size = 0;
+    }
+
+    bool event_batch::append(time_stamp time, const uint8_t* data, size_t size)
+    {
+        if (data == nullptr)
+        {
+            throw std::invalid_argument("NULL buffer.");
+        }
+
+        if (size == 0)
+        {
+            throw std::invalid_argument("Invalid buffer size.");
+        }
+
+        if (_size == _times.size() || size > _arena.size() - _arena_size)
+        {
+            return false;
+        }
+
+        memcpy(_arena.data() + _arena_size, data, size);
+        push_column(time, data, size, _arena_size);
+        _arena_size += size;
+        return true;
+    }
+
+    const time_stamp* event_batch::times() const noexcept
+    {
+        return _times.data();
+    }
+
+    const uint8_t* event_batch::statuses() const noexcept
+    {
+        return _statuses.data();
+    }
+
+    const uint8_t* event_batch::data1() const noexcept
+    {
+        return _data1.data();
+    }
+
+    const uint8_t* event_batch::data2() const noexcept
+    {
+        return _data2.data();
+    }
+
+    const uint32_t* event_batch::sizes() const noexcept
+    {
+        return _sizes.data();
+    }
+
+    const uint32_t* event_batch::offsets() const noexcept
+    {
+        return _offsets.data();
+    }
+
+    const uint8_t* event_batch::arena() const noexcept
+    {
+        return _arena.data();
+    }
+
+    const uint8_t* event_batch::message(size_t index) const
+    {
+        if (index >= _size)
+        {
+            throw std::out_of_range("Invalid event index.");
+        }
+        return _arena.data() + _offsets[index];
+    }
+
+    size_t event_batch::count(const event_filter& filter) const noexcept
+    {
+        const uint8_t status = filter.status & filter.status_mask;
+        const uint8_t data1 = filter.data1 & filter.data1_mask;
+
+        // Branch free so it vectorizes, the sum of matches is the count.
+        size_t matches = 0;
+        for (size_t event_idx = 0; event_idx < _size; event_idx++)
+        {
+            matches += static_cast<size_t>(((_statuses[event_idx] & filter.status_mask) == status) &
+                                           ((_data1[event_idx] & filter.data1_mask) == data1));
+        }
+        return matches;
+    }
+
+    void event_batch::push_column(time_stamp time, const uint8_t* message, size_t size, size_t offset) noexcept
+    {
+        _times[_size] = time;
+        _statuses[_size] = message[0];
+        _data1[_size] = size > 1 ? message[1] : 0;
+        _data2[_size] = size > 2 ? message[2] : 0;
+        _sizes[_size] = static_cast<uint32_t>(size);
+        _offsets[_size] = static_cast<uint32_t>(offset);
+        _size++;
+    }
+
+    size_t decode_messages(const uint8_t* data, size_t size, time_stamp time, event_batch& batch)
+    {
+        if (data == nullptr && size > 0)
+        {
+            throw std::invalid_argument("NULL buffer.");
+        }
+
+        // The consumed bytes are copied to the arena in one go at the end, skipped bytes included, so the offsets are
+        // the positions in the span shifted by where the span starts in the arena.
+        const size_t arena_base = batch._arena_size;
+        const size_t limit = std::min(size, batch._arena.size() - arena_base);
+
+        size_t offset = 0;
+        while (offset < limit && batch._size < batch._times.size())
+        {
+            const size_t length = span_message_length(data + offset, size - offset);
+            if (length == 0)
+            {
+                offset++;
+                continue;
+            }
+
+            if (length > limit - offset)
+            {
+                break;
+            }
+
+            batch.push_column(time, data + offset, length, arena_base + offset);
+            offset += length;
+        }
+
+        if (offset > 0)
+        {
+            memcpy(batch._arena.data() + arena_base, data, offset);
+            batch._arena_size += offset;
+        }
+        return offset;
+    }
+
+    size_t receive_messages(input_device& device, event_batch& batch)
+    {
+        size_t received = 0;
+        while (batch._size < batch._times.size())
+        {
+            uint8_t* message = batch._arena.data() + batch._arena_size;
+            size_t message_size = 0;
+            time_stamp stamp = 0;
+            if (device.try_receive(message, batch._arena.size() - batch._arena_size, &message_size, &stamp) != SMIDI_RESULT_OK ||
+                message_size == 0)
+            {
+                break;
+            }
+
+            batch.push_column(stamp, message, message_size, batch._arena_size);
+            batch._arena_size += message_size;
+            received++;
+        }
+        return received;
+    }
+} // namespace smidi
@@ -0,0 +1,290 @@
+#include "smidi_ext/smidi_event_store.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace smidi
+{
+    namespace
+    {
+        constexpr size_t short_message_size = 3;
+
+        // Normalized so the scans compare against masked values only.
+        struct scan_filter
+        {
+            uint8_t status;
+            uint8_t status_mask;
+            uint8_t data1;
+            uint8_t data1_mask;
+
+            scan_filter(const event_filter& filter) noexcept
+                : status(filter.status & filter.status_mask)
+                , status_mask(filter.status_mask)
+                , data1(filter.data1 & filter.data1_mask)
+                , data1_mask(filter.data1_mask)
+            {
+            }
+        };
+    } // namespace
+
+    struct event_store::chunk
+    {
+        std::array<time_stamp, chunk_capacity> times;
+        std::array<uint8_t, chunk_capacity> statuses;
+        std::array<uint8_t, chunk_capacity> data1;
+        std::array<uint8_t, chunk_capacity> data2;
+        std::array<uint32_t, chunk_capacity> sizes;
+        // Messages longer than three bytes are also stored whole in the arena.
+        std::array<uint32_t, chunk_capacity> arena_offsets;
+        std::vector<uint8_t> arena;
+        size_t count = 0;
+
+        // Branch free so it vectorizes, the sum of matches is the count.
+        size_t count_matches(size_t first, size_t last, const scan_filter& filter) const noexcept
+        {
+            size_t matches = 0;
+            for (size_t event_idx = first; event_idx < last; event_idx++)
+            {
+                matches += static_cast<size_t>(((statuses[event_idx] & filter.status_mask) == filter.status) &
+                                               ((data1[event_idx] & filter.data1_mask) == filter.data1));
+            }
+            return matches;
+        }
+
+        // Filters are usually selective, so blocks are counted first and only blocks with matches are compacted. The
+        // compaction writes every candidate index and only advances past matches, out must have room for last - first
+        // indices.
+        size_t select_matches(size_t first, size_t last, const scan_filter& filter, size_t base, size_t* out) const noexcept
+        {
+            constexpr size_t block_size = 64;
+
+            size_t matches = 0;
+            for (size_t block_first = first; block_first < last; block_first += block_size)
+            {
+                const size_t block_last = std::min(block_first + block_size, last);
+                if (count_matches(block_first, block_last, filter) == 0)
+                {
+                    continue;
+                }
+
+                for (size_t event_idx = block_first; event_idx < block_last; event_idx++)
+                {
+                    out[matches] = base + event_idx;
+                    matches += static_cast<size_t>(((statuses[event_idx] & filter.status_mask) == filter.status) &
+                                                   ((data1[event_idx] & filter.data1_mask) == filter.data1));
+                }
+            }
+            return matches;
+        }
+    };
+
+    event_store::event_store() = default;
+    event_store::~event_store() = default;
+    event_store::event_store(event_store&&) noexcept = default;
+    event_store& event_store::operator=(event_store&&) noexcept = default;
+
+    void event_store::append(time_stamp time, const uint8_t* data, size_t size)
+    {
+        if (data == nullptr)
+        {
+            throw std::invalid_argument("NULL buffer.");
+        }
+
+        if (size == 0 || size > std::numeric_limits<uint32_t>::max())
+        {
+            throw std::invalid_argument("Invalid buffer size.");
+        }
+
+        if (_size > 0 && time < this->time(_size - 1))
+        {
+            throw std::invalid_argument("Time stamps must not decrease.");
+        }
+
+        if (_chunks.empty() || _chunks.back()->count == chunk_capacity)
+        {
+            _chunks.push_back(std::make_unique<chunk>());
+            _chunk_times.push_back(time);
+        }
+
+        chunk& current = *_chunks.back();
+        const size_t event_idx = current.count;
+        current.times[event_idx] = time;
+        current.statuses[event_idx] = data[0];
+        current.data1[event_idx] = size > 1 ? data[1] : 0;
+        current.data2[event_idx] = size > 2 ? data[2] : 0;
+        current.sizes[event_idx] = static_cast<uint32_t>(size);
+        current.arena_offsets[event_idx] = static_cast<uint32_t>(current.arena.size());
+        if (size > short_message_size)
+        {
+            current.arena.insert(current.arena.end(), data, data + size);
+        }
+
+        current.count++;
+        _size++;
+    }
+
+    size_t event_store::size() const noexcept
+    {
+        return _size;
+    }
+
+    bool event_store::empty() const noexcept
+    {
+        return _size == 0;
+    }
+
+    void event_store::clear() noexcept
+    {
+        _chunks.clear();
+        _chunk_times.clear();
+        _size = 0;
+    }
+
+    size_t event_store::drop_before(time_stamp time) noexcept
+    {
+        size_t chunk_count = 0;
+        size_t dropped = 0;
+        while (chunk_count < _chunks.size())
+        {
+            const chunk& candidate = *_chunks[chunk_count];
+            if (candidate.times[candidate.count - 1] >= time)
+            {
+                break;
+            }
+            dropped += candidate.count;
+            chunk_count++;
+        }
+
+        _chunks.erase(_chunks.begin(), _chunks.begin() + chunk_count);
+        _chunk_times.erase(_chunk_times.begin(), _chunk_times.begin() + chunk_count);
+        _size -= dropped;
+        return dropped;
+    }
+
+    size_t event_store::lower_bound(time_stamp time) const noexcept
+    {
+        // The last chunk starting before time holds the first event at or after it, unless all of its events are
+        // earlier, in which case that is the first event of the next chunk.
+        auto next_chunk = std::lower_bound(_chunk_times.begin(), _chunk_times.end(), time);
+        if (next_chunk == _chunk_times.begin())
+        {
+            return 0;
+        }
+
+        const size_t chunk_idx = static_cast<size_t>(next_chunk - _chunk_times.begin()) - 1;
+        const chunk& candidate = *_chunks[chunk_idx];
+        auto event = std::lower_bound(candidate.times.begin(), candidate.times.begin() + candidate.count, time);
+        return chunk_idx * chunk_capacity + static_cast<size_t>(event - candidate.times.begin());
+    }
+
+    const event_store::chunk& event_store::chunk_at(size_t index, size_t& offset) const
+    {
+        if (index >= _size)
+        {
+            throw std::out_of_range("Invalid event index.");
+        }
+
+        offset = index % chunk_capacity;
+        return *_chunks[index / chunk_capacity];
+    }
+
+    time_stamp event_store::time(size_t index) const
+    {
+        size_t offset = 0;
+        return chunk_at(index, offset).times[offset];
+    }
+
+    uint8_t event_store::status(size_t index) const
+    {
+        size_t offset = 0;
+        return chunk_at(index, offset).statuses[offset];
+    }
+
+    uint8_t event_store::data1(size_t index) const
+    {
+        size_t offset = 0;
+        return chunk_at(index, offset).data1[offset];
+    }
+
+    uint8_t event_store::data2(size_t index) const
+    {
+        size_t offset = 0;
+        return chunk_at(index, offset).data2[offset];
+    }
+
+    size_t event_store::message_size(size_t index) const
+    {
+        size_t offset = 0;
+        return chunk_at(index, offset).sizes[offset];
+    }
+
+    size_t event_store::message(size_t index, uint8_t* data, size_t size) const
+    {
+        size_t offset = 0;
+        const chunk& source = chunk_at(index, offset);
+        const size_t message_size = source.sizes[offset];
+        if (data == nullptr || size < message_size)
+        {
+            throw std::invalid_argument("Buffer size is not large enough.");
+        }
+
+        if (message_size > short_message_size)
+        {
+            memcpy(data, source.arena.data() + source.arena_offsets[offset], message_size);
+        }
+        else
+        {
+            const uint8_t bytes[short_message_size] = {source.statuses[offset], source.data1[offset], source.data2[offset]};
+            memcpy(data, bytes, message_size);
+        }
+        return message_size;
+    }
+
+    size_t event_store::count(time_stamp begin, time_stamp end, const event_filter& filter) const noexcept
+    {
+        if (begin >= end)
+        {
+            return 0;
+        }
+
+        const scan_filter normalized(filter);
+        const size_t first = lower_bound(begin);
+        const size_t last = lower_bound(end);
+
+        size_t matches = 0;
+        for (size_t chunk_idx = first / chunk_capacity; chunk_idx * chunk_capacity < last; chunk_idx++)
+        {
+            const size_t base = chunk_idx * chunk_capacity;
+            const size_t chunk_first = std::max(first, base) - base;
+            const size_t chunk_last = std::min(last - base, chunk_capacity);
+            matches += _chunks[chunk_idx]->count_matches(chunk_first, chunk_last, normalized);
+        }
+        return matches;
+    }
+
+    void event_store::select(time_stamp begin, time_stamp end, const event_filter& filter, std::vector<size_t>& indices) const
+    {
+        if (begin >= end)
+        {
+            return;
+        }
+
+        const scan_filter normalized(filter);
+        const size_t first = lower_bound(begin);
+        const size_t last = lower_bound(end);
+
+        size_t selected = indices.size();
+        indices.resize(selected + (last - first));
+        for (size_t chunk_idx = first / chunk_capacity; chunk_idx * chunk_capacity < last; chunk_idx++)
+        {
+            const size_t base = chunk_idx * chunk_capacity;
+            const size_t chunk_first = std::max(first, base) - base;
+            const size_t chunk_last = std::min(last - base, chunk_capacity);
+            selected += _chunks[chunk_idx]->select_matches(chunk_first, chunk_last, normalized, base, indices.data() + selected);
+        }
+        indices.resize(selected);
+    }
+} // namespace smidi
@@ -0,0 +1,303 @@
+#include "smidi_ext/smidi_merge.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+namespace smidi
+{
+    namespace
+    {
+        constexpr size_t cache_line_size = 64;
+
+        uint64_t hash_message(const uint8_t* data, size_t size) noexcept
+        {
+            // FNV-1a.
+            uint64_t hash = 14695981039346656037ull;
+            for (size_t byte_idx = 0; byte_idx < size; byte_idx++)
+            {
+                hash = (hash ^ data[byte_idx]) * 1099511628211ull;
+            }
+            return hash;
+        }
+    } // namespace
+
+    // The producer only writes tail and the slot at it, the consumer only head and the slot at it. Both counters keep
+    // counting up, a slot is their value modulo the capacity. They sit on their own cache lines so neither side's
+    // writes slow down the other's reads, and sources do not share lines at all.
+    struct input_merge::source
+    {
+        // Channel and system messages are kept inline, only longer ones (SysEx) go to the heap.
+        struct slot
+        {
+            clock::time_point time;
+            size_t size;
+            std::array<uint8_t, 3> short_data;
+            std::vector<uint8_t> long_data;
+
+            const uint8_t* data() const noexcept
+            {
+                return size <= short_data.size() ? short_data.data() : long_data.data();
+            }
+        };
+
+        explicit source(size_t capacity)
+            : slots(capacity)
+        {
+        }
+
+        std::vector<slot> slots;
+        alignas(cache_line_size) std::atomic<uint64_t> tail{0};
+        std::atomic<uint64_t> overflows{0};
+        alignas(cache_line_size) std::atomic<uint64_t> head{0};
+    };
+
+    input_merge::input_merge(size_t source_count, const input_merge_options& options)
+        : _options(options)
+        , _in_heap(source_count, false)
+    {
+        if (source_count == 0 || options.source_capacity == 0 || options.reorder_window.count() < 0 || options.dedupe_window.count() < 0)
+        {
+            throw std::invalid_argument("Invalid merge options.");
+        }
+
+        _sources.reserve(source_count);
+        for (size_t source_idx = 0; source_idx < source_count; source_idx++)
+        {
+            _sources.push_back(std::make_unique<source>(options.source_capacity));
+        }
+        _heap.reserve(source_count);
+
+        _ready_words = (source_count + 63) / 64;
+        _ready = std::make_unique<std::atomic<uint64_t>[]>(_ready_words);
+        for (size_t word_idx = 0; word_idx < _ready_words; word_idx++)
+        {
+            _ready[word_idx].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    input_merge::~input_merge() = default;
+
+    size_t input_merge::source_count() const noexcept
+    {
+        return _sources.size();
+    }
+
+    bool input_merge::push(size_t source_idx, const uint8_t* data, size_t size, clock::time_point time)
+    {
+        if (source_idx >= _sources.size())
+        {
+            throw std::invalid_argument("Invalid source index.");
+        }
+
+        if (data == nullptr)
+        {
+            throw std::invalid_argument("NULL buffer.");
+        }
+
+        if (size == 0)
+        {
+            throw std::invalid_argument("Invalid buffer size.");
+        }
+
+        source& source = *_sources[source_idx];
+        const uint64_t tail = source.tail.load(std::memory_order_relaxed);
+        if (tail - source.head.load(std::memory_order_acquire) == source.slots.size())
+        {
+            source.overflows.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        // Slots keep their storage, once a slot has held a message this long assigning does not allocate.
+        source::slot& slot = source.slots[tail % source.slots.size()];
+        slot.time = time;
+        slot.size = size;
+        if (size <= slot.short_data.size())
+        {
+            std::copy(data, data + size, slot.short_data.begin());
+        }
+        else
+        {
+            slot.long_data.assign(data, data + size);
+        }
+
+        // Either the consumer advancing past the previous message sees this one, or this sees the ring it left empty
+        // and flags the source. Sequentially consistent on both sides, so they cannot both miss.
+        source.tail.store(tail + 1, std::memory_order_seq_cst);
+        if (source.head.load(std::memory_order_seq_cst) == tail)
+        {
+            _ready[source_idx / 64].fetch_or(uint64_t(1) << (source_idx % 64), std::memory_order_release);
+        }
+        return true;
+    }
+
+    result input_merge::try_pop(clock::time_point now, uint8_t* data, size_t size, merged_event* event) noexcept
+    {
+        collect();
+        while (!_heap.empty())
+        {
+            const heap_entry next = _heap.front();
+            if (_heap.size() < _sources.size() && now - next.time < _options.reorder_window)
+            {
+                return SMIDI_RESULT_NO_MESSAGE;
+            }
+
+            source& source = *_sources[next.source];
+            const source::slot& slot = source.slots[source.head.load(std::memory_order_relaxed) % source.slots.size()];
+            const size_t message_size = slot.size;
+            if (_options.dedupe && is_duplicate(next.source, next.time, slot.data(), message_size))
+            {
+                _statistics.duplicates++;
+                advance(next.source);
+                continue;
+            }
+
+            if (event != nullptr)
+            {
+                event->size = message_size;
+            }
+            if (data == nullptr || message_size > size)
+            {
+                return SMIDI_RESULT_BUFFER_TOO_SMALL;
+            }
+
+            clock::time_point time = next.time;
+            if (_released && time < _last_time)
+            {
+                _statistics.late++;
+                time = _last_time;
+            }
+
+            memcpy(data, slot.data(), message_size);
+            if (_options.dedupe)
+            {
+                try
+                {
+                    _recent.push_back({next.time, next.source, message_size, hash_message(data, message_size)});
+                }
+                catch (const std::bad_alloc&)
+                {
+                    // Duplicates of this message are let through then.
+                }
+            }
+            if (event != nullptr)
+            {
+                event->source = next.source;
+                event->time = time;
+            }
+
+            _released = true;
+            _last_time = time;
+            _statistics.merged++;
+            advance(next.source);
+            return SMIDI_RESULT_OK;
+        }
+        return SMIDI_RESULT_NO_MESSAGE;
+    }
+
+    input_merge::clock::time_point input_merge::next_release_time() noexcept
+    {
+        collect();
+        if (_heap.empty())
+        {
+            return clock::time_point::max();
+        }
+
+        const clock::time_point time = _heap.front().time;
+        if (_heap.size() == _sources.size())
+        {
+            return time;
+        }
+        return time + _options.reorder_window;
+    }
+
+    input_merge_statistics input_merge::statistics() const
+    {
+        input_merge_statistics statistics = _statistics;
+        for (const std::unique_ptr<source>& source : _sources)
+        {
+            statistics.overflows += source->overflows.load(std::memory_order_relaxed);
+        }
+        return statistics;
+    }
+
+    // Heap order, ties go to the lower source index so the merge does not depend on arrival order.
+    bool input_merge::later::operator()(const heap_entry& a, const heap_entry& b) const noexcept
+    {
+        return a.time > b.time || (a.time == b.time && a.source > b.source);
+    }
+
+    // Adds the oldest event of the flagged sources that are not in the heap yet.
+    void input_merge::collect() noexcept
+    {
+        for (size_t word_idx = 0; word_idx < _ready_words; word_idx++)
+        {
+            if (_ready[word_idx].load(std::memory_order_relaxed) == 0)
+            {
+                continue;
+            }
+
+            uint64_t bits = _ready[word_idx].exchange(0, std::memory_order_acquire);
+            while (bits != 0)
+            {
+                size_t bit_idx = 0;
+                while ((bits & (uint64_t(1) << bit_idx)) == 0)
+                {
+                    bit_idx++;
+                }
+                bits &= ~(uint64_t(1) << bit_idx);
+
+                const size_t source_idx = word_idx * 64 + bit_idx;
+                source& source = *_sources[source_idx];
+                const uint64_t head = source.head.load(std::memory_order_relaxed);
+                if (!_in_heap[source_idx] && head != source.tail.load(std::memory_order_acquire))
+                {
+                    _heap.push_back({source.slots[head % source.slots.size()].time, source_idx});
+                    std::push_heap(_heap.begin(), _heap.end(), later());
+                    _in_heap[source_idx] = true;
+                }
+            }
+        }
+    }
+
+    // Removes the earliest event, the one of source_idx, and puts the source's next event in its place.
+    void input_merge::advance(size_t source_idx) noexcept
+    {
+        std::pop_heap(_heap.begin(), _heap.end(), later());
+        _heap.pop_back();
+        _in_heap[source_idx] = false;
+
+        source& source = *_sources[source_idx];
+        const uint64_t head = source.head.load(std::memory_order_relaxed) + 1;
+        source.head.store(head, std::memory_order_seq_cst);
+        if (head != source.tail.load(std::memory_order_seq_cst))
+        {
+            _heap.push_back({source.slots[head % source.slots.size()].time, source_idx});
+            std::push_heap(_heap.begin(), _heap.end(), later());
+            _in_heap[source_idx] = true;
+        }
+    }
+
+    // Messages are compared by size and hash against the messages of other sources released within the dedupe window.
+    // A source repeating a message is not a duplicate, e.g. two note offs for the same key.
+    bool input_merge::is_duplicate(size_t source_idx, clock::time_point time, const uint8_t* data, size_t size) noexcept
+    {
+        while (!_recent.empty() && (time - _recent.front().time > _options.dedupe_window))
+        {
+            _recent.pop_front();
+        }
+
+        const uint64_t hash = hash_message(data, size);
+        for (const recent_event& recent : _recent)
+        {
+            if (recent.source != source_idx && recent.size == size && recent.hash == hash)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+} // namespace smidi
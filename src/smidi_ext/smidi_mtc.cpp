@@ -0,0 +1,411 @@
+#include "smidi_ext/smidi_mtc.h"
+#include "smidi_ext/smidi_messages.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace smidi
+{
+    namespace
+    {
+        constexpr uint8_t quarter_frame_status = 0xF1;
+        constexpr uint8_t sysex_start = 0xF0;
+        constexpr uint8_t sysex_end = 0xF7;
+        constexpr uint8_t universal_real_time = 0x7F;
+        constexpr uint8_t sub_id_time_code = 0x01;
+        constexpr uint8_t sub_id_full_frame = 0x01;
+
+        constexpr uint32_t quarter_frames_per_frame = 4;
+        constexpr uint32_t pieces_per_time_code = 8;
+
+        // Drop frame counts 17982 frames every ten minutes, 1800 in the first minute and 1798 in the nine others.
+        constexpr uint64_t drop_frames_per_ten_minutes = 17982;
+        constexpr uint64_t drop_frames_per_minute = 1798;
+
+        uint32_t nominal_frames_per_second(mtc_frame_rate rate) noexcept
+        {
+            switch (rate)
+            {
+            case mtc_frame_rate::fps_24:
+                return 24;
+            case mtc_frame_rate::fps_25:
+                return 25;
+            default:
+                return 30;
+            }
+        }
+
+        std::array<uint8_t, 8> time_code_pieces(const smpte_time& time) noexcept
+        {
+            return {
+                static_cast<uint8_t>(time.frames & 0xF),
+                static_cast<uint8_t>((time.frames >> 4) & 0x1),
+                static_cast<uint8_t>(time.seconds & 0xF),
+                static_cast<uint8_t>((time.seconds >> 4) & 0x3),
+                static_cast<uint8_t>(time.minutes & 0xF),
+                static_cast<uint8_t>((time.minutes >> 4) & 0x3),
+                static_cast<uint8_t>(time.hours & 0xF),
+                static_cast<uint8_t>(((time.hours >> 4) & 0x1) | (static_cast<uint8_t>(time.rate) << 1)),
+            };
+        }
+
+        smpte_time time_code_from_pieces(const std::array<uint8_t, 8>& pieces) noexcept
+        {
+            smpte_time time;
+            time.frames = static_cast<uint8_t>(pieces[0] | ((pieces[1] & 0x1) << 4));
+            time.seconds = static_cast<uint8_t>(pieces[2] | ((pieces[3] & 0x3) << 4));
+            time.minutes = static_cast<uint8_t>(pieces[4] | ((pieces[5] & 0x3) << 4));
+            time.hours = static_cast<uint8_t>(pieces[6] | ((pieces[7] & 0x1) << 4));
+            time.rate = static_cast<mtc_frame_rate>((pieces[7] >> 1) & 0x3);
+            return time;
+        }
+    } // namespace
+
+    double frames_per_second(mtc_frame_rate rate) noexcept
+    {
+        if (rate == mtc_frame_rate::fps_29_97_drop)
+        {
+            return 30000.0 / 1001.0;
+        }
+        return nominal_frames_per_second(rate);
+    }
+
+    uint64_t smpte_to_frames(const smpte_time& time) noexcept
+    {
+        const uint64_t fps = nominal_frames_per_second(time.rate);
+        const uint64_t total_minutes = static_cast<uint64_t>(time.hours) * 60 + time.minutes;
+        uint64_t frames = (total_minutes * 60 + time.seconds) * fps + time.frames;
+        if (time.rate == mtc_frame_rate::fps_29_97_drop)
+        {
+            const uint64_t dropped = 2 * (total_minutes - total_minutes / 10);
+            frames = frames >= dropped ? frames - dropped : 0;
+        }
+        return frames;
+    }
+
+    smpte_time smpte_from_frames(uint64_t frames, mtc_frame_rate rate) noexcept
+    {
+        const uint64_t fps = nominal_frames_per_second(rate);
+        if (rate == mtc_frame_rate::fps_29_97_drop)
+        {
+            // Add back the frame numbers skipped so far and count on as 30 frames per second.
+            const uint64_t ten_minutes = frames / drop_frames_per_ten_minutes;
+            const uint64_t remainder = frames % drop_frames_per_ten_minutes;
+            frames += 18 * ten_minutes;
+            if (remainder >= 2)
+            {
+                frames += 2 * ((remainder - 2) / drop_frames_per_minute);
+            }
+        }
+
+        smpte_time time;
+        time.frames = static_cast<uint8_t>(frames % fps);
+        time.seconds = static_cast<uint8_t>((frames / fps) % 60);
+        time.minutes = static_cast<uint8_t>((frames / (fps * 60)) % 60);
+        time.hours = static_cast<uint8_t>((frames / (fps * 3600)) % 24);
+        time.rate = rate;
+        return time;
+    }
+
+    void make_mtc_full_frame(const smpte_time& time, uint8_t* data, uint8_t device_id)
+    {
+        if (data == nullptr)
+        {
+            throw std::invalid_argument("NULL buffer.");
+        }
+
+        data[0] = sysex_start;
+        data[1] = universal_real_time;
+        data[2] = device_id & 0x7F;
+        data[3] = sub_id_time_code;
+        data[4] = sub_id_full_frame;
+        data[5] = static_cast<uint8_t>((static_cast<uint8_t>(time.rate) << 5) | (time.hours & 0x1F));
+        data[6] = time.minutes & 0x3F;
+        data[7] = time.seconds & 0x3F;
+        data[8] = time.frames & 0x1F;
+        data[9] = sysex_end;
+    }
+
+    bool is_mtc_full_frame(const uint8_t* data, size_t size) noexcept
+    {
+        return data != nullptr && size == mtc_full_frame_size && data[0] == sysex_start && data[1] == universal_real_time &&
+               data[3] == sub_id_time_code && data[4] == sub_id_full_frame && data[9] == sysex_end;
+    }
+
+    mtc_generator::mtc_generator(output_device& output, const mtc_generator_options& options)
+        : _output(output)
+        , _options(options)
+        , _ns_per_quarter_frame(1.0e9 / (frames_per_second(options.rate) * quarter_frames_per_frame))
+    {
+    }
+
+    void mtc_generator::locate(const smpte_time& time)
+    {
+        if (time.rate != _options.rate)
+        {
+            throw std::invalid_argument("Time code rate does not match the generator.");
+        }
+
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        if (_running)
+        {
+            throw std::runtime_error("Time code can only be located while stopped.");
+        }
+
+        _start_frame = smpte_to_frames(time);
+        _next_quarter_frame = 0;
+
+        uint8_t message[mtc_full_frame_size];
+        make_mtc_full_frame(smpte_from_frames(_start_frame, _options.rate), message, _options.device_id);
+        if (_output.try_send(message, sizeof(message)) != SMIDI_RESULT_OK)
+        {
+            _statistics.failed++;
+        }
+    }
+
+    void mtc_generator::start(clock::time_point time)
+    {
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        _running = true;
+        _start_time = time;
+    }
+
+    void mtc_generator::stop()
+    {
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        if (!_running)
+        {
+            return;
+        }
+
+        // Resume from the frame the last quarter frame was in.
+        _start_frame += _next_quarter_frame / quarter_frames_per_frame;
+        _next_quarter_frame = 0;
+        _running = false;
+    }
+
+    bool mtc_generator::running() const
+    {
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        return _running;
+    }
+
+    smpte_time mtc_generator::position() const
+    {
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        return smpte_from_frames(_start_frame + _next_quarter_frame / quarter_frames_per_frame, _options.rate);
+    }
+
+    mtc_generator::clock::time_point mtc_generator::pump(clock::time_point now)
+    {
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        if (!_running)
+        {
+            return clock::time_point::max();
+        }
+
+        clock::time_point due = deadline(_next_quarter_frame);
+        while (due <= now)
+        {
+            if (due < now)
+            {
+                _statistics.late++;
+                _statistics.max_lateness = std::max(_statistics.max_lateness, std::chrono::duration_cast<std::chrono::nanoseconds>(now - due));
+            }
+
+            const size_t piece = _next_quarter_frame % pieces_per_time_code;
+            if (piece == 0)
+            {
+                const uint64_t frame = _start_frame + _next_quarter_frame / quarter_frames_per_frame;
+                _pieces = time_code_pieces(smpte_from_frames(frame, _options.rate));
+            }
+
+            // A failed quarter frame is not retried, the following ones stay on the grid.
+            const uint8_t message[] = {quarter_frame_status, static_cast<uint8_t>((piece << 4) | _pieces[piece])};
+            if (_output.try_send(message, sizeof(message)) != SMIDI_RESULT_OK)
+            {
+                _statistics.failed++;
+            }
+            _statistics.quarter_frames++;
+
+            _next_quarter_frame++;
+            due = deadline(_next_quarter_frame);
+        }
+        return due;
+    }
+
+    mtc_generator_statistics mtc_generator::statistics() const
+    {
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        return _statistics;
+    }
+
+    mtc_generator::clock::time_point mtc_generator::deadline(uint64_t quarter_frame) const
+    {
+        return _start_time + std::chrono::nanoseconds(std::llround(static_cast<double>(quarter_frame) * _ns_per_quarter_frame));
+    }
+
+    mtc_decoder::mtc_decoder() = default;
+
+    void mtc_decoder::process(const uint8_t* data, size_t size, clock::time_point time)
+    {
+        if (data == nullptr || size == 0)
+        {
+            throw std::invalid_argument("Invalid message.");
+        }
+
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        if (is_midi_time_code_quarter_message(data[0]) && size >= 2)
+        {
+            process_quarter_frame(data[1], time);
+        }
+        else if (is_mtc_full_frame(data, size))
+        {
+            smpte_time located;
+            located.hours = data[5] & 0x1F;
+            located.minutes = data[6] & 0x3F;
+            located.seconds = data[7] & 0x3F;
+            located.frames = data[8] & 0x1F;
+            located.rate = static_cast<mtc_frame_rate>((data[5] >> 5) & 0x3);
+
+            // Full frames are sent when locating, the quarter frames that follow start a new time code.
+            _rate = located.rate;
+            _anchor_quarter_frames = static_cast<int64_t>(smpte_to_frames(located)) * quarter_frames_per_frame;
+            _anchor_time = time;
+            _locked = true;
+            _moving = false;
+            _piece_count = 0;
+            _last_piece = -1;
+            _statistics.full_frames++;
+        }
+    }
+
+    void mtc_decoder::reset()
+    {
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        _pieces = {};
+        _piece_count = 0;
+        _last_piece = -1;
+        _forward = true;
+        _locked = false;
+        _moving = false;
+        _rate = mtc_frame_rate::fps_25;
+        _anchor_quarter_frames = 0;
+        _statistics = {0, 0, 0, 0};
+    }
+
+    bool mtc_decoder::locked() const
+    {
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        return _locked;
+    }
+
+    bool mtc_decoder::running(clock::time_point time) const
+    {
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        const double elapsed_ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(time - _anchor_time).count());
+        return _moving && elapsed_ns <= 2 * quarter_frames_per_frame * quarter_frame_ns();
+    }
+
+    mtc_frame_rate mtc_decoder::rate() const
+    {
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        return _rate;
+    }
+
+    double mtc_decoder::frame_position(clock::time_point time) const
+    {
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        double quarter_frames = static_cast<double>(_anchor_quarter_frames);
+        if (_moving)
+        {
+            // Never past the next quarter frame, the position would jump back when it arrives late.
+            const double elapsed_ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(time - _anchor_time).count());
+            const double elapsed = std::min(std::max(elapsed_ns / quarter_frame_ns(), 0.0), 1.0);
+            quarter_frames += _forward ? elapsed : -elapsed;
+        }
+        return std::max(quarter_frames, 0.0) / quarter_frames_per_frame;
+    }
+
+    smpte_time mtc_decoder::position(clock::time_point time) const
+    {
+        const double frames = frame_position(time);
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        return smpte_from_frames(static_cast<uint64_t>(frames), _rate);
+    }
+
+    mtc_decoder_statistics mtc_decoder::statistics() const
+    {
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        return _statistics;
+    }
+
+    void mtc_decoder::process_quarter_frame(uint8_t value, clock::time_point time)
+    {
+        _statistics.quarter_frames++;
+
+        const int piece = (value >> 4) & 0x7;
+        const bool next = _last_piece >= 0 && piece == (_last_piece + 1) % static_cast<int>(pieces_per_time_code);
+        const bool previous = _last_piece >= 0 && piece == (_last_piece + static_cast<int>(pieces_per_time_code) - 1) % static_cast<int>(pieces_per_time_code);
+        if (_last_piece >= 0 && !next && !previous)
+        {
+            _statistics.dropouts++;
+        }
+        _last_piece = piece;
+
+        if (_locked && (next || previous))
+        {
+            _anchor_quarter_frames += next ? 1 : -1;
+            _anchor_time = time;
+            _forward = next;
+            _moving = true;
+        }
+
+        // Only a run forwards from piece 0 assembles a time code.
+        if (piece == 0)
+        {
+            _piece_count = 1;
+        }
+        else if (next && _piece_count > 0)
+        {
+            _piece_count++;
+        }
+        else
+        {
+            _piece_count = 0;
+        }
+        _pieces[piece] = value & 0xF;
+
+        if (piece != static_cast<int>(pieces_per_time_code) - 1 || _piece_count != pieces_per_time_code)
+        {
+            return;
+        }
+        _piece_count = 0;
+
+        // The time code is the frame piece 0 was sent on, piece 7 comes seven quarter frames later.
+        const smpte_time assembled = time_code_from_pieces(_pieces);
+        const int64_t quarter_frames =
+            static_cast<int64_t>(smpte_to_frames(assembled)) * quarter_frames_per_frame + static_cast<int64_t>(pieces_per_time_code) - 1;
+        if (_locked && _moving && quarter_frames == _anchor_quarter_frames && assembled.rate == _rate)
+        {
+            return;
+        }
+
+        if (_locked && _moving)
+        {
+            _statistics.resyncs++;
+        }
+        _rate = assembled.rate;
+        _anchor_quarter_frames = quarter_frames;
+        _anchor_time = time;
+        _forward = true;
+        _moving = true;
+        _locked = true;
+    }
+
+    double mtc_decoder::quarter_frame_ns() const noexcept
+    {
+        return 1.0e9 / (frames_per_second(_rate) * quarter_frames_per_frame);
+    }
+} // namespace smidi
@@ -0,0 +1,481 @@
+#include "smidi_ext/smidi_sequencer.h"
+#include "smidi_ext/smidi_messages.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace smidi
+{
+    namespace
+    {
+        constexpr size_t short_message_size = 3;
+        constexpr uint8_t note_off_message_status = 0x80;
+
+        double tempo_ns_per_tick(double tempo)
+        {
+            if (!(tempo > 0.0))
+            {
+                throw std::invalid_argument("Invalid tempo.");
+            }
+            return 60.0e9 / (tempo * sequencer_ticks_per_quarter_note);
+        }
+
+        void update_sounding(std::array<std::bitset<128>, 16>& sounding, const uint8_t* data, size_t size)
+        {
+            const uint8_t status = data[0];
+            if (size == short_message_size && is_note_on_message(status) && data[2] != 0)
+            {
+                sounding[get_channel(status)].set(data[1] & 0x7F);
+            }
+            else if (size == short_message_size && (is_note_off_message(status) || is_note_on_message(status)))
+            {
+                sounding[get_channel(status)].reset(data[1] & 0x7F);
+            }
+        }
+    } // namespace
+
+    pattern::pattern(uint64_t length)
+        : _length(length)
+    {
+        if (length == 0)
+        {
+            throw std::invalid_argument("Invalid pattern length.");
+        }
+    }
+
+    void pattern::add(uint64_t tick, const uint8_t* data, size_t size)
+    {
+        if (data == nullptr)
+        {
+            throw std::invalid_argument("NULL buffer.");
+        }
+
+        if (size == 0)
+        {
+            throw std::invalid_argument("Invalid buffer size.");
+        }
+
+        if (tick >= _length)
+        {
+            throw std::invalid_argument("Event outside of the pattern.");
+        }
+
+        event added;
+        added.tick = tick;
+        added.size = size;
+        added.short_data = {0, 0, 0};
+        if (size <= short_message_size)
+        {
+            std::copy(data, data + size, added.short_data.begin());
+        }
+        else
+        {
+            added.long_data.assign(data, data + size);
+        }
+
+        auto position = std::upper_bound(_events.begin(), _events.end(), tick,
+                                         [](uint64_t tick, const event& existing) { return tick < existing.tick; });
+        _events.insert(position, std::move(added));
+    }
+
+    uint64_t pattern::length() const noexcept
+    {
+        return _length;
+    }
+
+    size_t pattern::size() const noexcept
+    {
+        return _events.size();
+    }
+
+    const uint8_t* pattern::event::data() const noexcept
+    {
+        return long_data.empty() ? short_data.data() : long_data.data();
+    }
+
+    sequencer::track::track(output_device& output, const pattern& clip, bool loop)
+        : output(&output)
+        , clip(clip)
+        , loop(loop)
+        , mute(false)
+        , solo(false)
+        , audible(true)
+        , next_event(0)
+        , loop_start(0)
+        , finished(true)
+        , sounding()
+        , sent_sounding()
+    {
+    }
+
+    sequencer::sequencer(const sequencer_options& options)
+        : _options(options)
+    {
+        if (options.lookahead.count() <= 0)
+        {
+            throw std::invalid_argument("Invalid lookahead.");
+        }
+
+        _tempo.push_back({0, tempo_ns_per_tick(options.tempo), clock::time_point()});
+    }
+
+    size_t sequencer::add_track(output_device& output, const pattern& pattern, bool loop)
+    {
+        std::unique_ptr<track> added = std::make_unique<track>(output, pattern, loop);
+
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        seek(*added, _playing ? _rendered_tick : 0);
+        _tracks.push_back(std::move(added));
+        return _tracks.size() - 1;
+    }
+
+    void sequencer::set_mute(size_t track, bool mute)
+    {
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        if (track >= _tracks.size())
+        {
+            throw std::invalid_argument("Invalid track index.");
+        }
+        _tracks[track]->mute = mute;
+    }
+
+    void sequencer::set_solo(size_t track, bool solo)
+    {
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        if (track >= _tracks.size())
+        {
+            throw std::invalid_argument("Invalid track index.");
+        }
+        _tracks[track]->solo = solo;
+    }
+
+    void sequencer::set_tempo(double tempo)
+    {
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        insert_tempo(_playing ? _rendered_tick : 0, tempo);
+    }
+
+    void sequencer::schedule_tempo(uint64_t tick, double tempo)
+    {
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        insert_tempo(_playing ? std::max(tick, _rendered_tick) : tick, tempo);
+    }
+
+    void sequencer::start(clock::time_point time)
+    {
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        if (_playing)
+        {
+            end_sent_notes();
+        }
+
+        _tempo.front().time = time;
+        rebuild_tempo_times(1);
+
+        _queue.clear();
+        _rendered_tick = 0;
+        const bool any_solo = std::any_of(_tracks.begin(), _tracks.end(), [](const std::unique_ptr<track>& candidate) { return candidate->solo; });
+        for (std::unique_ptr<track>& target : _tracks)
+        {
+            seek(*target, 0);
+            target->sounding = {};
+            target->sent_sounding = {};
+            target->audible = !target->mute && (!any_solo || target->solo);
+        }
+        _playing = true;
+    }
+
+    void sequencer::stop()
+    {
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        if (!_playing)
+        {
+            return;
+        }
+
+        end_sent_notes();
+        _playing = false;
+    }
+
+    bool sequencer::playing() const
+    {
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        return _playing;
+    }
+
+    sequencer::clock::time_point sequencer::pump(clock::time_point now)
+    {
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        if (!_playing)
+        {
+            return clock::time_point::max();
+        }
+
+        const clock::time_point horizon = now + _options.lookahead;
+        if (horizon >= _tempo.front().time)
+        {
+            const uint64_t end_tick = tick_at_locked(horizon) + 1;
+            if (end_tick > _rendered_tick)
+            {
+                render(end_tick, now);
+            }
+        }
+
+        while (!_queue.empty() && _queue.front().time <= now)
+        {
+            send(_queue.front());
+            _queue.pop_front();
+        }
+
+        // Render again halfway through the window so the next one is ready before it is due.
+        clock::time_point next = now + _options.lookahead / 2;
+        if (!_queue.empty())
+        {
+            next = std::min(next, _queue.front().time);
+        }
+        return next;
+    }
+
+    sequencer::clock::time_point sequencer::time_at(uint64_t tick) const
+    {
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        return time_at_locked(tick);
+    }
+
+    uint64_t sequencer::tick_at(clock::time_point time) const
+    {
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        return tick_at_locked(time);
+    }
+
+    sequencer_statistics sequencer::statistics() const
+    {
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        return _statistics;
+    }
+
+    void sequencer::seek(track& target, uint64_t tick)
+    {
+        const std::vector<pattern::event>& events = target.clip._events;
+        const uint64_t length = target.clip._length;
+
+        target.finished = events.empty() || (!target.loop && tick >= length);
+        if (target.finished)
+        {
+            return;
+        }
+
+        target.loop_start = target.loop ? tick / length * length : 0;
+        auto next = std::lower_bound(events.begin(), events.end(), tick - target.loop_start,
+                                     [](const pattern::event& event, uint64_t tick) { return event.tick < tick; });
+        target.next_event = static_cast<size_t>(next - events.begin());
+        if (target.next_event == events.size())
+        {
+            target.next_event--;
+            advance(target);
+        }
+    }
+
+    void sequencer::advance(track& target)
+    {
+        target.next_event++;
+        if (target.next_event < target.clip._events.size())
+        {
+            return;
+        }
+
+        if (target.loop)
+        {
+            target.next_event = 0;
+            target.loop_start += target.clip._length;
+        }
+        else
+        {
+            target.finished = true;
+        }
+    }
+
+    void sequencer::render(uint64_t end_tick, clock::time_point now)
+    {
+        update_audible(time_at_locked(_rendered_tick));
+
+        // Only the events before end_tick are visited, every track resumes where the previous window stopped.
+        _window.clear();
+        for (size_t track_idx = 0; track_idx < _tracks.size(); track_idx++)
+        {
+            track& source = *_tracks[track_idx];
+            while (!source.finished)
+            {
+                const pattern::event& event = source.clip._events[source.next_event];
+                const uint64_t tick = source.loop_start + event.tick;
+                if (tick >= end_tick)
+                {
+                    break;
+                }
+
+                if (source.audible)
+                {
+                    _window.push_back({tick, track_idx, &event});
+                }
+                advance(source);
+            }
+        }
+
+        // Stable, so events at the same tick stay in track order.
+        std::stable_sort(_window.begin(), _window.end(), [](const window_event& a, const window_event& b) { return a.tick < b.tick; });
+
+        for (const window_event& rendered : _window)
+        {
+            track& source = *_tracks[rendered.track];
+            const pattern::event& event = *rendered.event;
+
+            update_sounding(source.sounding, event.short_data.data(), event.size);
+
+            queued_event queued;
+            queued.time = time_at_locked(rendered.tick);
+            queued.source = &source;
+            queued.size = event.size;
+            queued.short_data = event.short_data;
+            queued.long_data = event.long_data.empty() ? nullptr : event.long_data.data();
+            _queue.push_back(queued);
+
+            _statistics.rendered++;
+            if (queued.time < now)
+            {
+                _statistics.late++;
+            }
+        }
+
+        _rendered_tick = end_tick;
+    }
+
+    void sequencer::end_notes(track& target, clock::time_point time)
+    {
+        for (size_t channel = 0; channel < target.sounding.size(); channel++)
+        {
+            if (target.sounding[channel].none())
+            {
+                continue;
+            }
+
+            for (size_t note = 0; note < target.sounding[channel].size(); note++)
+            {
+                if (target.sounding[channel].test(note))
+                {
+                    queued_event queued;
+                    queued.time = time;
+                    queued.source = &target;
+                    queued.size = short_message_size;
+                    queued.short_data = {static_cast<uint8_t>(note_off_message_status | channel), static_cast<uint8_t>(note), 0};
+                    queued.long_data = nullptr;
+                    _queue.push_back(queued);
+                }
+            }
+            target.sounding[channel].reset();
+        }
+    }
+
+    // Queued note offs are dropped with the rest, so the notes to end are the ones the outputs have seen.
+    void sequencer::end_sent_notes()
+    {
+        _queue.clear();
+        for (std::unique_ptr<track>& target : _tracks)
+        {
+            target->sounding = target->sent_sounding;
+            end_notes(*target, clock::time_point::min());
+        }
+
+        for (const queued_event& event : _queue)
+        {
+            send(event);
+        }
+        _queue.clear();
+    }
+
+    void sequencer::send(const queued_event& event)
+    {
+        const uint8_t* data = event.long_data != nullptr ? event.long_data : event.short_data.data();
+        result sent = event.source->output->try_send(data, event.size);
+        if (sent == SMIDI_RESULT_OK)
+        {
+            update_sounding(event.source->sent_sounding, data, event.size);
+            _statistics.sent++;
+        }
+        else
+        {
+            _statistics.failed++;
+        }
+    }
+
+    void sequencer::update_audible(clock::time_point time)
+    {
+        const bool any_solo = std::any_of(_tracks.begin(), _tracks.end(), [](const std::unique_ptr<track>& candidate) { return candidate->solo; });
+        for (std::unique_ptr<track>& target : _tracks)
+        {
+            const bool audible = !target->mute && (!any_solo || target->solo);
+            if (target->audible && !audible)
+            {
+                end_notes(*target, time);
+            }
+            target->audible = audible;
+        }
+    }
+
+    void sequencer::insert_tempo(uint64_t tick, double tempo)
+    {
+        const double ns_per_tick = tempo_ns_per_tick(tempo);
+
+        auto position = std::upper_bound(_tempo.begin(), _tempo.end(), tick,
+                                         [](uint64_t tick, const tempo_segment& segment) { return tick < segment.tick; });
+        if ((position - 1)->tick == tick)
+        {
+            (position - 1)->ns_per_tick = ns_per_tick;
+            rebuild_tempo_times(static_cast<size_t>(position - _tempo.begin()));
+        }
+        else
+        {
+            position = _tempo.insert(position, {tick, ns_per_tick, clock::time_point()});
+            rebuild_tempo_times(static_cast<size_t>(position - _tempo.begin()));
+        }
+    }
+
+    void sequencer::rebuild_tempo_times(size_t first_segment)
+    {
+        for (size_t segment_idx = std::max<size_t>(first_segment, 1); segment_idx < _tempo.size(); segment_idx++)
+        {
+            const tempo_segment& previous = _tempo[segment_idx - 1];
+            const double elapsed_ns = static_cast<double>(_tempo[segment_idx].tick - previous.tick) * previous.ns_per_tick;
+            _tempo[segment_idx].time = previous.time + std::chrono::nanoseconds(std::llround(elapsed_ns));
+        }
+    }
+
+    const sequencer::tempo_segment& sequencer::segment_for_tick(uint64_t tick) const
+    {
+        auto next = std::upper_bound(_tempo.begin(), _tempo.end(), tick,
+                                     [](uint64_t tick, const tempo_segment& segment) { return tick < segment.tick; });
+        return *(next - 1);
+    }
+
+    // Both directions start from the segment's own anchor, so rounding never accumulates across windows.
+    sequencer::clock::time_point sequencer::time_at_locked(uint64_t tick) const
+    {
+        const tempo_segment& segment = segment_for_tick(tick);
+        const double elapsed_ns = static_cast<double>(tick - segment.tick) * segment.ns_per_tick;
+        return segment.time + std::chrono::nanoseconds(std::llround(elapsed_ns));
+    }
+
+    uint64_t sequencer::tick_at_locked(clock::time_point time) const
+    {
+        auto next = std::upper_bound(_tempo.begin(), _tempo.end(), time,
+                                     [](clock::time_point time, const tempo_segment& segment) { return time < segment.time; });
+        if (next == _tempo.begin())
+        {
+            return 0;
+        }
+
+        const tempo_segment& segment = *(next - 1);
+        const double elapsed_ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(time - segment.time).count());
+        return segment.tick + static_cast<uint64_t>(std::floor(elapsed_ns / segment.ns_per_tick));
+    }
+} // namespace smidi
@@ -0,0 +1,256 @@
+#include "smidi_ext/smidi_smf.h"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace smidi
+{
+    namespace
+    {
+        constexpr size_t chunk_header_size = 8;
+        constexpr size_t file_header_size = 6;
+
+        uint16_t read_u16(const uint8_t* data) noexcept
+        {
+            return static_cast<uint16_t>((data[0] << 8) | data[1]);
+        }
+
+        uint32_t read_u32(const uint8_t* data) noexcept
+        {
+            return (static_cast<uint32_t>(data[0]) << 24) | (static_cast<uint32_t>(data[1]) << 16) |
+                   (static_cast<uint32_t>(data[2]) << 8) | static_cast<uint32_t>(data[3]);
+        }
+
+        size_t channel_data_byte_count(uint8_t status) noexcept
+        {
+            const uint8_t prefix = status & 0xF0;
+            return prefix == 0xC0 || prefix == 0xD0 ? 1 : 2;
+        }
+    } // namespace
+
+    smf_reader::smf_reader(const uint8_t* data, size_t size)
+        : _data(data)
+        , _size(size)
+    {
+        if (data == nullptr)
+        {
+            throw std::invalid_argument("NULL buffer.");
+        }
+
+        if (size < chunk_header_size + file_header_size || memcmp(data, "MThd", 4) != 0)
+        {
+            throw std::invalid_argument("Not a standard MIDI file.");
+        }
+
+        const uint32_t header_size = read_u32(data + 4);
+        if (header_size < file_header_size || header_size > size - chunk_header_size)
+        {
+            throw std::invalid_argument("Invalid standard MIDI file header.");
+        }
+
+        _format = read_u16(data + 8);
+        _track_count = read_u16(data + 10);
+        _division = read_u16(data + 12);
+        _chunk_offset = chunk_header_size + header_size;
+    }
+
+    uint16_t smf_reader::format() const noexcept
+    {
+        return _format;
+    }
+
+    uint16_t smf_reader::track_count() const noexcept
+    {
+        return _track_count;
+    }
+
+    uint16_t smf_reader::division() const noexcept
+    {
+        return _division;
+    }
+
+    bool smf_reader::next(smf_event& event)
+    {
+        while (true)
+        {
+            if (_in_track && next_in_track(event))
+            {
+                return true;
+            }
+
+            if (_chunk_offset >= _size)
+            {
+                return false;
+            }
+
+            if (_size - _chunk_offset < chunk_header_size)
+            {
+                _statistics.malformed_chunks++;
+                _chunk_offset = _size;
+                return false;
+            }
+
+            const uint8_t* chunk = _data + _chunk_offset;
+            const uint32_t chunk_size = read_u32(chunk + 4);
+            const size_t chunk_begin = _chunk_offset + chunk_header_size;
+            size_t chunk_end = chunk_begin + chunk_size;
+            const bool truncated = chunk_size > _size - chunk_begin;
+            if (truncated)
+            {
+                // Truncated files are common, the events that are there are still read.
+                _statistics.malformed_chunks++;
+                chunk_end = _size;
+            }
+            _chunk_offset = chunk_end;
+
+            if (memcmp(chunk, "MTrk", 4) != 0)
+            {
+                _statistics.unknown_chunks++;
+                continue;
+            }
+
+            _in_track = true;
+            _track_malformed = truncated;
+            _track = static_cast<size_t>(_statistics.tracks);
+            _position = chunk_begin;
+            _track_end = chunk_end;
+            _tick = 0;
+            _running_status = 0;
+            _statistics.tracks++;
+        }
+    }
+
+    smf_statistics smf_reader::statistics() const noexcept
+    {
+        return _statistics;
+    }
+
+    bool smf_reader::next_in_track(smf_event& event)
+    {
+        uint32_t delta = 0;
+        if (_position >= _track_end || !read_variable_length(delta) || _position >= _track_end)
+        {
+            // Every track ends with an end of track event, running out of data first means the track is broken.
+            end_track(true);
+            return false;
+        }
+        _tick += delta;
+
+        event.track = _track;
+        event.tick = _tick;
+        event.meta_type = 0;
+
+        const uint8_t byte = _data[_position];
+        if (byte == 0xFF || byte == 0xF0 || byte == 0xF7)
+        {
+            _position++;
+            uint8_t meta_type = 0;
+            if (byte == 0xFF)
+            {
+                if (_position >= _track_end)
+                {
+                    end_track(true);
+                    return false;
+                }
+                meta_type = _data[_position++];
+            }
+
+            uint32_t length = 0;
+            if (!read_variable_length(length) || length > _track_end - _position)
+            {
+                end_track(true);
+                return false;
+            }
+
+            // SysEx and meta events cancel running status.
+            _running_status = 0;
+            event.type = byte == 0xFF ? smf_event_type::meta : smf_event_type::system_exclusive;
+            event.status = byte;
+            event.meta_type = meta_type;
+            event.data = _data + _position;
+            event.size = length;
+            _position += length;
+
+            if (byte == 0xFF && meta_type == meta_end_of_track)
+            {
+                end_track(false);
+            }
+            return true;
+        }
+
+        uint8_t status = _running_status;
+        if (byte >= 0x80 && byte < 0xF0)
+        {
+            status = byte;
+            _position++;
+        }
+        else if (byte >= 0xF0 || status == 0)
+        {
+            // System common and real time messages have no place in a file, neither do data bytes without a status.
+            end_track(true);
+            return false;
+        }
+
+        const size_t data_byte_count = channel_data_byte_count(status);
+        if (data_byte_count > _track_end - _position)
+        {
+            end_track(true);
+            return false;
+        }
+
+        _message[0] = status;
+        for (size_t byte_idx = 0; byte_idx < data_byte_count; byte_idx++)
+        {
+            const uint8_t data_byte = _data[_position + byte_idx];
+            if (data_byte >= 0x80)
+            {
+                end_track(true);
+                return false;
+            }
+            _message[1 + byte_idx] = data_byte;
+        }
+        _position += data_byte_count;
+        _running_status = status;
+
+        event.type = smf_event_type::midi;
+        event.status = status;
+        event.data = _message.data();
+        event.size = 1 + data_byte_count;
+        return true;
+    }
+
+    // Variable length quantities are at most four bytes.
+    bool smf_reader::read_variable_length(uint32_t& value) noexcept
+    {
+        value = 0;
+        for (size_t byte_idx = 0; byte_idx < 4 && _position < _track_end; byte_idx++)
+        {
+            const uint8_t byte = _data[_position++];
+            value = (value << 7) | (byte & 0x7F);
+            if ((byte & 0x80) == 0)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void smf_reader::end_track(bool malformed) noexcept
+    {
+        if (malformed && !_track_malformed)
+        {
+            _statistics.malformed_chunks++;
+        }
+        _in_track = false;
+    }
+
+    uint32_t smf_tempo(const smf_event& event) noexcept
+    {
+        if (event.type != smf_event_type::meta || event.meta_type != smf_reader::meta_tempo || event.size < 3)
+        {
+            return 0;
+        }
+
+        return (static_cast<uint32_t>(event.data[0]) << 16) | (static_cast<uint32_t>(event.data[1]) << 8) | event.data[2];
+    }
+} // namespace smidi
@@ -0,0 +1,401 @@
+#include "smidi_ext/smidi_state.h"
+#include "smidi_ext/smidi_messages.h"
+
+#include <stdexcept>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace smidi
+{
+    namespace
+    {
+        constexpr uint8_t note_off_status = 0x80;
+        constexpr uint8_t control_change_status = 0xB0;
+        constexpr uint8_t program_change_status = 0xC0;
+        constexpr uint8_t channel_pressure_status = 0xD0;
+        constexpr uint8_t pitch_bend_status = 0xE0;
+        constexpr uint8_t system_reset_status = 0xFF;
+
+        constexpr uint8_t bank_select_msb = 0;
+        constexpr uint8_t bank_select_lsb = 32;
+        constexpr uint8_t sustain_pedal = 64;
+        constexpr uint8_t sostenuto_pedal = 66;
+        constexpr uint8_t all_sound_off = 120;
+        constexpr uint8_t reset_all_controllers = 121;
+        constexpr uint8_t local_control = 122;
+        constexpr uint8_t first_channel_mode_controller = 120;
+
+        constexpr uint16_t pitch_bend_center = 0x2000;
+
+        size_t count_trailing_zeros(uint64_t word) noexcept
+        {
+#if defined(_MSC_VER)
+            unsigned long index = 0;
+            _BitScanForward64(&index, word);
+            return index;
+#elif defined(__GNUC__)
+            return static_cast<size_t>(__builtin_ctzll(word));
+#else
+            size_t index = 0;
+            while ((word & 1) == 0)
+            {
+                word >>= 1;
+                index++;
+            }
+            return index;
+#endif
+        }
+
+        size_t count_bits(uint64_t word) noexcept
+        {
+            size_t count = 0;
+            for (; word != 0; word &= word - 1)
+            {
+                count++;
+            }
+            return count;
+        }
+
+        bool test_bit(const std::array<uint64_t, 2>& bits, uint8_t index) noexcept
+        {
+            return (bits[index >> 6] >> (index & 63)) & 1;
+        }
+
+        // Data entry, increment, decrement and the RPN/NRPN selections.
+        bool is_parameter_controller(uint8_t controller) noexcept
+        {
+            return controller == 6 || controller == 38 || (controller >= 96 && controller <= 101);
+        }
+
+        // Kept by reset all controllers, as recommended practice RP-015 has it.
+        bool survives_controller_reset(uint8_t controller) noexcept
+        {
+            return controller == bank_select_msb || controller == bank_select_lsb || controller == 7 || controller == 10 ||
+                   (controller >= 91 && controller <= 95);
+        }
+
+        bool send_message(output_device& output, uint8_t status, uint8_t data1, uint8_t data2, size_t size) noexcept
+        {
+            const uint8_t message[] = {status, data1, data2};
+            return output.try_send(message, size) == SMIDI_RESULT_OK;
+        }
+    } // namespace
+
+    midi_state_tracker::midi_state_tracker() noexcept
+    {
+        reset();
+    }
+
+    void midi_state_tracker::process(const uint8_t* data, size_t size) noexcept
+    {
+        if (data == nullptr || size == 0)
+        {
+            return;
+        }
+
+        const uint8_t status = data[0];
+        if (status == system_reset_status)
+        {
+            reset();
+            return;
+        }
+
+        if (!is_channel_message(status) || size < non_system_exclusive_message_length(status))
+        {
+            return;
+        }
+
+        const size_t channel = get_channel(status);
+        channel_state& state = _channels[channel];
+        if (is_note_on_message(status))
+        {
+            set_note(channel, data[1] & 0x7F, (data[2] & 0x7F) != 0);
+        }
+        else if (is_note_off_message(status))
+        {
+            set_note(channel, data[1] & 0x7F, false);
+        }
+        else if (is_control_change_message(status))
+        {
+            const uint8_t controller = data[1] & 0x7F;
+            if (controller == reset_all_controllers)
+            {
+                for (uint8_t reset_controller = 0; reset_controller < first_channel_mode_controller; reset_controller++)
+                {
+                    if (!survives_controller_reset(reset_controller))
+                    {
+                        state.controllers_set[reset_controller >> 6] &= ~(uint64_t(1) << (reset_controller & 63));
+                    }
+                }
+                state.pitch_bend_set = false;
+                state.pressure_set = false;
+            }
+            else if (controller == all_sound_off || controller > local_control)
+            {
+                // All notes off and the mode changes, which end all notes too.
+                state.notes = {0, 0};
+                _active_channels &= static_cast<uint16_t>(~(1u << channel));
+            }
+            else if (controller < first_channel_mode_controller)
+            {
+                state.controllers[controller] = data[2] & 0x7F;
+                state.controllers_set[controller >> 6] |= uint64_t(1) << (controller & 63);
+            }
+        }
+        else if (is_program_change_message(status))
+        {
+            state.program = data[1] & 0x7F;
+            state.program_set = true;
+        }
+        else if (is_pitch_bend_change_message(status))
+        {
+            state.pitch_bend = static_cast<uint16_t>((data[1] & 0x7F) | ((data[2] & 0x7F) << 7));
+            state.pitch_bend_set = true;
+        }
+        else if (is_channel_pressure_message(status))
+        {
+            state.pressure = data[1] & 0x7F;
+            state.pressure_set = true;
+        }
+    }
+
+    void midi_state_tracker::reset() noexcept
+    {
+        for (channel_state& state : _channels)
+        {
+            state.notes = {0, 0};
+            state.controllers_set = {0, 0};
+            state.controllers.fill(0);
+            state.pitch_bend = pitch_bend_center;
+            state.program = 0;
+            state.pressure = 0;
+            state.program_set = false;
+            state.pitch_bend_set = false;
+            state.pressure_set = false;
+        }
+        _active_channels = 0;
+    }
+
+    bool midi_state_tracker::note_active(uint8_t channel, uint8_t note) const noexcept
+    {
+        return channel < _channels.size() && note < 128 && test_bit(_channels[channel].notes, note);
+    }
+
+    size_t midi_state_tracker::active_note_count() const noexcept
+    {
+        size_t count = 0;
+        for (const channel_state& state : _channels)
+        {
+            count += count_bits(state.notes[0]) + count_bits(state.notes[1]);
+        }
+        return count;
+    }
+
+    int midi_state_tracker::controller(uint8_t channel, uint8_t controller) const noexcept
+    {
+        if (channel >= _channels.size() || controller >= 128 || !test_bit(_channels[channel].controllers_set, controller))
+        {
+            return -1;
+        }
+        return _channels[channel].controllers[controller];
+    }
+
+    int midi_state_tracker::program(uint8_t channel) const noexcept
+    {
+        if (channel >= _channels.size() || !_channels[channel].program_set)
+        {
+            return -1;
+        }
+        return _channels[channel].program;
+    }
+
+    int midi_state_tracker::pitch_bend(uint8_t channel) const noexcept
+    {
+        if (channel >= _channels.size() || !_channels[channel].pitch_bend_set)
+        {
+            return -1;
+        }
+        return _channels[channel].pitch_bend;
+    }
+
+    int midi_state_tracker::channel_pressure(uint8_t channel) const noexcept
+    {
+        if (channel >= _channels.size() || !_channels[channel].pressure_set)
+        {
+            return -1;
+        }
+        return _channels[channel].pressure;
+    }
+
+    size_t midi_state_tracker::panic(output_device& output) noexcept
+    {
+        size_t sent = 0;
+        for (uint16_t channels = _active_channels; channels != 0; channels &= static_cast<uint16_t>(channels - 1))
+        {
+            const size_t channel = count_trailing_zeros(channels);
+            channel_state& state = _channels[channel];
+            for (size_t word_idx = 0; word_idx < state.notes.size(); word_idx++)
+            {
+                for (uint64_t word = state.notes[word_idx]; word != 0; word &= word - 1)
+                {
+                    const uint8_t note = static_cast<uint8_t>(word_idx * 64 + count_trailing_zeros(word));
+                    sent += send_message(output, static_cast<uint8_t>(note_off_status | channel), note, 0, 3);
+                }
+            }
+            state.notes = {0, 0};
+        }
+        _active_channels = 0;
+
+        // A held pedal would keep the released notes sounding. Channels whose keys all went up while the pedal was down
+        // are no longer active, so every channel is checked.
+        for (size_t channel = 0; channel < _channels.size(); channel++)
+        {
+            channel_state& state = _channels[channel];
+            for (uint8_t pedal : {sustain_pedal, sostenuto_pedal})
+            {
+                if (test_bit(state.controllers_set, pedal) && state.controllers[pedal] >= 64)
+                {
+                    sent += send_message(output, static_cast<uint8_t>(control_change_status | channel), pedal, 0, 3);
+                    state.controllers[pedal] = 0;
+                }
+            }
+        }
+        return sent;
+    }
+
+    size_t midi_state_tracker::chase(output_device& output) const noexcept
+    {
+        size_t sent = 0;
+        for (size_t channel = 0; channel < _channels.size(); channel++)
+        {
+            const channel_state& state = _channels[channel];
+            const uint8_t control_change = static_cast<uint8_t>(control_change_status | channel);
+
+            // Bank select only takes effect with the next program change.
+            for (uint8_t bank_controller : {bank_select_msb, bank_select_lsb})
+            {
+                if (test_bit(state.controllers_set, bank_controller))
+                {
+                    sent += send_message(output, control_change, bank_controller, state.controllers[bank_controller], 3);
+                }
+            }
+
+            if (state.program_set)
+            {
+                sent += send_message(output, static_cast<uint8_t>(program_change_status | channel), state.program, 0, 2);
+            }
+
+            for (size_t word_idx = 0; word_idx < state.controllers_set.size(); word_idx++)
+            {
+                for (uint64_t word = state.controllers_set[word_idx]; word != 0; word &= word - 1)
+                {
+                    const uint8_t controller = static_cast<uint8_t>(word_idx * 64 + count_trailing_zeros(word));
+                    if (controller == bank_select_msb || controller == bank_select_lsb || is_parameter_controller(controller))
+                    {
+                        continue;
+                    }
+                    sent += send_message(output, control_change, controller, state.controllers[controller], 3);
+                }
+            }
+
+            if (state.pitch_bend_set)
+            {
+                sent += send_message(output, static_cast<uint8_t>(pitch_bend_status | channel), static_cast<uint8_t>(state.pitch_bend & 0x7F),
+                                     static_cast<uint8_t>(state.pitch_bend >> 7), 3);
+            }
+
+            if (state.pressure_set)
+            {
+                sent += send_message(output, static_cast<uint8_t>(channel_pressure_status | channel), state.pressure, 0, 2);
+            }
+        }
+        return sent;
+    }
+
+    void midi_state_tracker::set_note(size_t channel, uint8_t note, bool active) noexcept
+    {
+        channel_state& state = _channels[channel];
+        const uint64_t bit = uint64_t(1) << (note & 63);
+        if (active)
+        {
+            state.notes[note >> 6] |= bit;
+            _active_channels |= static_cast<uint16_t>(1u << channel);
+        }
+        else
+        {
+            state.notes[note >> 6] &= ~bit;
+            if (state.notes[0] == 0 && state.notes[1] == 0)
+            {
+                _active_channels &= static_cast<uint16_t>(~(1u << channel));
+            }
+        }
+    }
+
+    state_tracking_output_device::state_tracking_output_device(output_device& output, const state_tracking_options& options)
+        : _output(output)
+        , _options(options)
+    {
+    }
+
+    state_tracking_output_device::~state_tracking_output_device()
+    {
+        if (_options.panic_on_destroy)
+        {
+            panic();
+        }
+    }
+
+    size_t state_tracking_output_device::send(const uint8_t* data, size_t size)
+    {
+        if (data == nullptr)
+        {
+            throw std::invalid_argument("NULL buffer.");
+        }
+
+        if (size == 0)
+        {
+            throw std::invalid_argument("Invalid buffer size.");
+        }
+
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        const size_t sent = _output.send(data, size);
+        _state.process(data, size);
+        return sent;
+    }
+
+    result state_tracking_output_device::try_send(const uint8_t* data, size_t size) noexcept
+    {
+        if (data == nullptr || size == 0)
+        {
+            return SMIDI_RESULT_INVALID_ARGUMENT;
+        }
+
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        const result sent = _output.try_send(data, size);
+        if (sent == SMIDI_RESULT_OK)
+        {
+            _state.process(data, size);
+        }
+        return sent;
+    }
+
+    size_t state_tracking_output_device::panic() noexcept
+    {
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        return _state.panic(_output);
+    }
+
+    size_t state_tracking_output_device::chase() noexcept
+    {
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        return _state.chase(_output);
+    }
+
+    midi_state_tracker state_tracking_output_device::state() const
+    {
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        return _state;
+    }
+} // namespace smidi
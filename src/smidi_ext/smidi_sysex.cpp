@@ -0,0 +1,384 @@
+#include "smidi_ext/smidi_sysex.h"
+#include "smidi_ext/smidi_messages.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace smidi
+{
+    namespace
+    {
+        constexpr uint8_t sysex_start = 0xF0;
+        constexpr uint8_t sysex_end = 0xF7;
+        constexpr uint8_t universal_non_real_time = 0x7E;
+
+        constexpr uint8_t handshake_ack = 0x7F;
+        constexpr uint8_t handshake_nak = 0x7E;
+        constexpr uint8_t handshake_wait = 0x7C;
+        constexpr uint8_t handshake_cancel = 0x7D;
+        constexpr size_t handshake_size = 6;
+
+        // Sample dump packet numbers count modulo 128.
+        constexpr size_t packet_number_count = 128;
+    } // namespace
+
+    sysex_transfer::sysex_transfer(output_device& output, const sysex_transfer_options& options)
+        : _output(output)
+        , _options(options)
+    {
+        if (options.window == 0)
+        {
+            throw std::invalid_argument("Invalid window size.");
+        }
+
+        if (options.handshake == sysex_handshake::sample_dump && options.window > packet_number_count / 2)
+        {
+            throw std::invalid_argument("Window too large for sample dump packet numbers.");
+        }
+    }
+
+    void sysex_transfer::start(const uint8_t* data, size_t size)
+    {
+        if (data == nullptr)
+        {
+            throw std::invalid_argument("NULL buffer.");
+        }
+
+        if (size < 2 || data[0] != sysex_start || data[size - 1] != sysex_end)
+        {
+            throw std::invalid_argument("Dump is not a sequence of SysEx messages.");
+        }
+
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        if (_state == sysex_transfer_state::sending)
+        {
+            throw std::runtime_error("A transfer is already running.");
+        }
+
+        _dump.assign(data, data + size);
+        split_packets();
+
+        _state = sysex_transfer_state::sending;
+        _acknowledged = 0;
+        _next = 0;
+        _waiting = false;
+        _retries = 0;
+        _next_send_time = clock::time_point::min();
+        _reply_deadline = clock::time_point::max();
+    }
+
+    void sysex_transfer::cancel()
+    {
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        if (_state == sysex_transfer_state::sending)
+        {
+            _state = sysex_transfer_state::cancelled;
+        }
+    }
+
+    void sysex_transfer::process(const uint8_t* data, size_t size, clock::time_point now)
+    {
+        if (data == nullptr || size != handshake_size || data[0] != sysex_start || data[1] != universal_non_real_time ||
+            data[5] != sysex_end)
+        {
+            return;
+        }
+
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        if (_state != sysex_transfer_state::sending || _options.handshake != sysex_handshake::sample_dump)
+        {
+            return;
+        }
+
+        const uint8_t reply = data[3];
+        if (reply == handshake_wait)
+        {
+            _waiting = true;
+            return;
+        }
+
+        if (reply == handshake_cancel)
+        {
+            _state = sysex_transfer_state::cancelled;
+            return;
+        }
+
+        // The packet in flight the reply is for, replies to anything else are stale.
+        size_t packet_idx = _acknowledged;
+        while (packet_idx < _next && packet_idx % packet_number_count != data[4])
+        {
+            packet_idx++;
+        }
+        if (packet_idx == _next)
+        {
+            return;
+        }
+
+        _waiting = false;
+        _reply_deadline = now + _options.reply_timeout;
+        if (reply == handshake_ack)
+        {
+            _acknowledged = packet_idx + 1;
+            _retries = 0;
+            if (_acknowledged == _packets.size())
+            {
+                _state = sysex_transfer_state::done;
+            }
+        }
+        else if (reply == handshake_nak)
+        {
+            _statistics.naks++;
+            fail_or_retry(packet_idx);
+        }
+    }
+
+    sysex_transfer::clock::time_point sysex_transfer::pump(clock::time_point now)
+    {
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        if (_state != sysex_transfer_state::sending)
+        {
+            return clock::time_point::max();
+        }
+
+        const bool handshake = _options.handshake != sysex_handshake::none;
+        if (handshake && !_waiting && _acknowledged < _next && now >= _reply_deadline)
+        {
+            _statistics.timeouts++;
+            fail_or_retry(_acknowledged);
+        }
+
+        while (_state == sysex_transfer_state::sending && !_waiting && _next < _packets.size() &&
+               _next - _acknowledged < _options.window && now >= _next_send_time)
+        {
+            const packet& sent = _packets[_next];
+            if (_output.try_send(_dump.data() + sent.offset, sent.size) != SMIDI_RESULT_OK)
+            {
+                _state = sysex_transfer_state::failed;
+                break;
+            }
+            _statistics.packets++;
+            _next++;
+
+            if (handshake)
+            {
+                _reply_deadline = now + _options.reply_timeout;
+            }
+            else
+            {
+                _acknowledged = _next;
+                if (_acknowledged == _packets.size())
+                {
+                    _state = sysex_transfer_state::done;
+                }
+            }
+
+            // Paced packets go out one per pump, a late pump does not send a burst.
+            if (_options.packet_interval.count() > 0)
+            {
+                _next_send_time = now + _options.packet_interval;
+                break;
+            }
+        }
+
+        if (_state != sysex_transfer_state::sending || _waiting)
+        {
+            return clock::time_point::max();
+        }
+
+        clock::time_point next = clock::time_point::max();
+        if (_next < _packets.size() && _next - _acknowledged < _options.window)
+        {
+            next = std::max(_next_send_time, now);
+        }
+        if (handshake && _acknowledged < _next)
+        {
+            next = std::min(next, _reply_deadline);
+        }
+        return next;
+    }
+
+    sysex_transfer_state sysex_transfer::state() const
+    {
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        return _state;
+    }
+
+    size_t sysex_transfer::bytes_done() const
+    {
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        return _acknowledged < _packets.size() ? _packets[_acknowledged].offset : _dump.size();
+    }
+
+    size_t sysex_transfer::bytes_total() const
+    {
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        return _dump.size();
+    }
+
+    sysex_transfer_statistics sysex_transfer::statistics() const
+    {
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        return _statistics;
+    }
+
+    void sysex_transfer::split_packets()
+    {
+        _packets.clear();
+        if (_options.packet_size > 0)
+        {
+            for (size_t offset = 0; offset < _dump.size(); offset += _options.packet_size)
+            {
+                _packets.push_back({offset, std::min(_options.packet_size, _dump.size() - offset)});
+            }
+            return;
+        }
+
+        size_t offset = 0;
+        while (offset < _dump.size())
+        {
+            if (_dump[offset] != sysex_start)
+            {
+                _packets.clear();
+                throw std::invalid_argument("Dump is not a sequence of SysEx messages.");
+            }
+
+            const uint8_t* end = static_cast<const uint8_t*>(memchr(_dump.data() + offset, sysex_end, _dump.size() - offset));
+            const size_t size = static_cast<size_t>(end - (_dump.data() + offset)) + 1;
+            _packets.push_back({offset, size});
+            offset += size;
+        }
+    }
+
+    void sysex_transfer::rewind(size_t packet_idx)
+    {
+        _statistics.resent += _next - packet_idx;
+        _next = packet_idx;
+        _next_send_time = clock::time_point::min();
+    }
+
+    void sysex_transfer::fail_or_retry(size_t packet_idx)
+    {
+        _retries++;
+        if (_retries > _options.retry_limit)
+        {
+            _state = sysex_transfer_state::failed;
+            return;
+        }
+        rewind(packet_idx);
+    }
+
+    sysex_reassembler::sysex_reassembler(const sysex_reassembly_options& options)
+        : _options(options)
+    {
+    }
+
+    bool sysex_reassembler::process(const uint8_t* data, size_t size)
+    {
+        if (data == nullptr)
+        {
+            throw std::invalid_argument("NULL buffer.");
+        }
+
+        if (size == 0)
+        {
+            throw std::invalid_argument("Invalid buffer size.");
+        }
+
+        _message = nullptr;
+        _message_size = 0;
+
+        const uint8_t status = data[0];
+        if (status != sysex_start && status >= 0x80)
+        {
+            // Real time messages may arrive in the middle of SysEx, anything else ends it.
+            if (_assembling && !is_system_real_time_message(status))
+            {
+                _assembling = false;
+                _statistics.dropped++;
+            }
+            _message = data;
+            _message_size = size;
+            return true;
+        }
+
+        if (status == sysex_start)
+        {
+            if (_assembling)
+            {
+                _statistics.dropped++;
+            }
+
+            // Complete messages need no copy.
+            if (data[size - 1] == sysex_end)
+            {
+                _assembling = false;
+                _message = data;
+                _message_size = size;
+                _statistics.messages++;
+                return true;
+            }
+
+            _assembling = true;
+            _overflowed = false;
+            _buffer.clear();
+        }
+        else if (!_assembling)
+        {
+            return false;
+        }
+
+        _statistics.fragments++;
+        const uint8_t* end = static_cast<const uint8_t*>(memchr(data, sysex_end, size));
+        const size_t fragment_size = end != nullptr ? static_cast<size_t>(end - data) + 1 : size;
+        if (_overflowed || _buffer.size() + fragment_size > _options.max_size)
+        {
+            _overflowed = true;
+        }
+        else
+        {
+            _buffer.insert(_buffer.end(), data, data + fragment_size);
+        }
+
+        if (end == nullptr)
+        {
+            return false;
+        }
+
+        _assembling = false;
+        if (_overflowed)
+        {
+            _statistics.dropped++;
+            return false;
+        }
+
+        _message = _buffer.data();
+        _message_size = _buffer.size();
+        _statistics.messages++;
+        return true;
+    }
+
+    void sysex_reassembler::reset() noexcept
+    {
+        _buffer.clear();
+        _assembling = false;
+        _overflowed = false;
+        _message = nullptr;
+        _message_size = 0;
+    }
+
+    const uint8_t* sysex_reassembler::message() const noexcept
+    {
+        return _message;
+    }
+
+    size_t sysex_reassembler::message_size() const noexcept
+    {
+        return _message_size;
+    }
+
+    sysex_reassembly_statistics sysex_reassembler::statistics() const noexcept
+    {
+        return _statistics;
+    }
+} // namespace smidi
@@ -0,0 +1,526 @@
+#include "smidi_ext/smidi_sysex_codec.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define SMIDI_SYSEX_CODEC_X86_64
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#elif defined(__ARM_NEON)
+#define SMIDI_SYSEX_CODEC_NEON
+#include <arm_neon.h>
+#endif
+
+// SSE2 is part of x86-64, the SSSE3 and AVX2 kernels are compiled for those instruction sets on their own and only
+// called after the CPU was checked for them.
+#if defined(__GNUC__)
+#define SMIDI_TARGET(features) __attribute__((target(features)))
+#else
+#define SMIDI_TARGET(features)
+#endif
+
+namespace smidi
+{
+    namespace
+    {
+        constexpr size_t group_size = 7;
+        constexpr size_t packed_group_size = 8;
+
+        // Bit 7 of bytes 0 to 6 and bits 0 to 6 of the same bytes.
+        constexpr uint64_t top_bits = 0x0080808080808080ull;
+        constexpr uint64_t low_bits = 0x007F7F7F7F7F7F7Full;
+
+        // Multiplying the top bits of a group by these moves bit 7 of byte i to bit i (or bit 6 - i) of byte 7, and
+        // multiplying a top bits byte by them moves its bits back to bit 7 of their bytes. Every partial product
+        // lands on a bit of its own, so none of them carry into the bits that are kept.
+        constexpr uint64_t first_in_lsb_multiplier = 0x0002040810204080ull;
+        constexpr uint64_t first_in_msb_multiplier = 0x0080402010080402ull;
+
+        uint64_t load_u64(const uint8_t* data) noexcept
+        {
+            uint64_t value;
+            memcpy(&value, data, sizeof(value));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+            value = __builtin_bswap64(value);
+#endif
+            return value;
+        }
+
+        void store_u64(uint8_t* data, uint64_t value) noexcept
+        {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+            value = __builtin_bswap64(value);
+#endif
+            memcpy(data, &value, sizeof(value));
+        }
+
+        uint64_t order_multiplier(sysex_7bit_order order) noexcept
+        {
+            return order == sysex_7bit_order::first_in_lsb ? first_in_lsb_multiplier : first_in_msb_multiplier;
+        }
+
+        size_t top_bit_position(size_t byte_idx, sysex_7bit_order order) noexcept
+        {
+            return order == sysex_7bit_order::first_in_lsb ? byte_idx : group_size - 1 - byte_idx;
+        }
+
+        // Packs whole groups 8 bytes at a time. Every group loads one byte past its own, so one more must follow.
+        size_t pack_groups_swar(const uint8_t* data, size_t size, uint8_t* out, uint64_t multiplier) noexcept
+        {
+            size_t group_count = 0;
+            for (; size >= packed_group_size; size -= group_size, data += group_size, out += packed_group_size, group_count++)
+            {
+                const uint64_t group = load_u64(data);
+                const uint64_t top = ((group & top_bits) * multiplier) >> 56;
+                store_u64(out, top | ((group & low_bits) << 8));
+            }
+            return group_count;
+        }
+
+        // Unpacks whole groups with 8 byte stores. The byte stored past a group's output belongs to the output of the
+        // groups after it, which must have one.
+        size_t unpack_groups_swar(const uint8_t* data, size_t size, uint8_t* out, uint64_t multiplier) noexcept
+        {
+            size_t group_count = 0;
+            for (; size >= packed_group_size + 2; size -= packed_group_size, data += packed_group_size, out += group_size, group_count++)
+            {
+                const uint64_t group = load_u64(data);
+                const uint64_t top = ((group & 0x7F) * multiplier) & top_bits;
+                store_u64(out, ((group >> 8) & low_bits) | top);
+            }
+            return group_count;
+        }
+
+        // A group of 1 to 7 bytes.
+        void pack_group(const uint8_t* data, size_t size, uint8_t* out, sysex_7bit_order order) noexcept
+        {
+            uint8_t top = 0;
+            for (size_t byte_idx = 0; byte_idx < size; byte_idx++)
+            {
+                top |= static_cast<uint8_t>((data[byte_idx] >> 7) << top_bit_position(byte_idx, order));
+                out[1 + byte_idx] = data[byte_idx] & 0x7F;
+            }
+            out[0] = top;
+        }
+
+        // A top bits byte followed by 0 to 7 data bytes.
+        void unpack_group(const uint8_t* data, size_t size, uint8_t* out, sysex_7bit_order order) noexcept
+        {
+            for (size_t byte_idx = 0; byte_idx + 1 < size; byte_idx++)
+            {
+                const uint8_t top = static_cast<uint8_t>(((data[0] >> top_bit_position(byte_idx, order)) & 1) << 7);
+                out[byte_idx] = static_cast<uint8_t>((data[1 + byte_idx] & 0x7F) | top);
+            }
+        }
+
+#if defined(SMIDI_SYSEX_CODEC_X86_64)
+        enum class x86_features
+        {
+            sse2,
+            ssse3,
+            avx2,
+        };
+
+        x86_features detect_x86_features() noexcept
+        {
+#if defined(__GNUC__)
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2"))
+            {
+                return x86_features::avx2;
+            }
+            if (__builtin_cpu_supports("ssse3"))
+            {
+                return x86_features::ssse3;
+            }
+#elif defined(_MSC_VER)
+            int info[4];
+            __cpuid(info, 0);
+            const int max_leaf = info[0];
+            __cpuid(info, 1);
+            const bool ssse3 = (info[2] & (1 << 9)) != 0;
+            // AVX2 also needs the OS to save the upper halves of the registers.
+            const bool ymm_saved = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 0x6) == 0x6;
+            if (max_leaf >= 7 && ymm_saved)
+            {
+                __cpuidex(info, 7, 0);
+                if ((info[1] & (1 << 5)) != 0)
+                {
+                    return x86_features::avx2;
+                }
+            }
+            if (ssse3)
+            {
+                return x86_features::ssse3;
+            }
+#endif
+            return x86_features::sse2;
+        }
+
+        x86_features cpu_features() noexcept
+        {
+            static const x86_features features = detect_x86_features();
+            return features;
+        }
+
+        // Shuffles for two groups per 16 bytes: the data bytes move up one place behind their top bits byte, and the
+        // same with every group reversed, so the sign bits come out of movemask in first_in_msb order.
+        SMIDI_TARGET("ssse3")
+        __m128i pack_shuffle() noexcept
+        {
+            return _mm_setr_epi8(-1, 0, 1, 2, 3, 4, 5, 6, -1, 7, 8, 9, 10, 11, 12, 13);
+        }
+
+        SMIDI_TARGET("ssse3")
+        __m128i pack_top_shuffle(sysex_7bit_order order) noexcept
+        {
+            return order == sysex_7bit_order::first_in_lsb ? pack_shuffle()
+                                                           : _mm_setr_epi8(-1, 6, 5, 4, 3, 2, 1, 0, -1, 13, 12, 11, 10, 9, 8, 7);
+        }
+
+        // The top bits byte of its group next to every data byte, the bit of each data byte, and the data bytes moved
+        // together again.
+        SMIDI_TARGET("ssse3")
+        __m128i unpack_top_shuffle() noexcept
+        {
+            return _mm_setr_epi8(-1, 0, 0, 0, 0, 0, 0, 0, -1, 8, 8, 8, 8, 8, 8, 8);
+        }
+
+        SMIDI_TARGET("ssse3")
+        __m128i unpack_top_bits(sysex_7bit_order order) noexcept
+        {
+            return order == sysex_7bit_order::first_in_lsb ? _mm_setr_epi8(0, 1, 2, 4, 8, 16, 32, 64, 0, 1, 2, 4, 8, 16, 32, 64)
+                                                           : _mm_setr_epi8(0, 64, 32, 16, 8, 4, 2, 1, 0, 64, 32, 16, 8, 4, 2, 1);
+        }
+
+        SMIDI_TARGET("ssse3")
+        __m128i unpack_shuffle() noexcept
+        {
+            return _mm_setr_epi8(1, 2, 3, 4, 5, 6, 7, 9, 10, 11, 12, 13, 14, 15, -1, -1);
+        }
+
+        SMIDI_TARGET("ssse3")
+        size_t pack_groups_ssse3(const uint8_t* data, size_t size, uint8_t* out, sysex_7bit_order order) noexcept
+        {
+            const __m128i shuffle = pack_shuffle();
+            const __m128i top_shuffle = pack_top_shuffle(order);
+            const __m128i low = _mm_set1_epi8(0x7F);
+
+            size_t group_count = 0;
+            for (; size >= 16; size -= 2 * group_size, data += 2 * group_size, out += 2 * packed_group_size, group_count += 2)
+            {
+                const __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+                const int top = _mm_movemask_epi8(_mm_shuffle_epi8(input, top_shuffle));
+                const __m128i tops = _mm_set_epi64x((top >> 9) & 0x7F, (top >> 1) & 0x7F);
+                const __m128i bytes = _mm_and_si128(_mm_shuffle_epi8(input, shuffle), low);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_or_si128(bytes, tops));
+            }
+            return group_count;
+        }
+
+        SMIDI_TARGET("ssse3")
+        size_t unpack_groups_ssse3(const uint8_t* data, size_t size, uint8_t* out, sysex_7bit_order order) noexcept
+        {
+            const __m128i top_shuffle = unpack_top_shuffle();
+            const __m128i top_bits = unpack_top_bits(order);
+            const __m128i shuffle = unpack_shuffle();
+            const __m128i low = _mm_set1_epi8(0x7F);
+            const __m128i high = _mm_set1_epi8(static_cast<char>(0x80));
+
+            // Stores write 16 bytes for 14, the groups after these have the room.
+            size_t group_count = 0;
+            for (; size >= 2 * packed_group_size + 3; size -= 2 * packed_group_size, data += 2 * packed_group_size, out += 2 * group_size,
+                                                       group_count += 2)
+            {
+                const __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+                const __m128i top = _mm_and_si128(_mm_shuffle_epi8(input, top_shuffle), top_bits);
+                const __m128i tops = _mm_and_si128(_mm_cmpeq_epi8(top, top_bits), high);
+                const __m128i bytes = _mm_or_si128(_mm_and_si128(input, low), tops);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_shuffle_epi8(bytes, shuffle));
+            }
+            return group_count;
+        }
+
+        // The AVX2 kernels do what the SSSE3 ones do in both 128-bit lanes, four groups at a time.
+        SMIDI_TARGET("avx2")
+        size_t pack_groups_avx2(const uint8_t* data, size_t size, uint8_t* out, sysex_7bit_order order) noexcept
+        {
+            const __m256i shuffle = _mm256_broadcastsi128_si256(pack_shuffle());
+            const __m256i top_shuffle = _mm256_broadcastsi128_si256(pack_top_shuffle(order));
+            const __m256i low = _mm256_set1_epi8(0x7F);
+
+            // The upper lane loads the third and fourth group from 14 bytes in, reading 2 bytes past them.
+            size_t group_count = 0;
+            for (; size >= 30; size -= 4 * group_size, data += 4 * group_size, out += 4 * packed_group_size, group_count += 4)
+            {
+                const __m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+                const __m128i second = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 2 * group_size));
+                const __m256i input = _mm256_inserti128_si256(_mm256_castsi128_si256(first), second, 1);
+                const uint32_t top = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_shuffle_epi8(input, top_shuffle)));
+                const __m256i tops = _mm256_set_epi64x((top >> 25) & 0x7F, (top >> 17) & 0x7F, (top >> 9) & 0x7F, (top >> 1) & 0x7F);
+                const __m256i bytes = _mm256_and_si256(_mm256_shuffle_epi8(input, shuffle), low);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), _mm256_or_si256(bytes, tops));
+            }
+            return group_count;
+        }
+
+        SMIDI_TARGET("avx2")
+        size_t unpack_groups_avx2(const uint8_t* data, size_t size, uint8_t* out, sysex_7bit_order order) noexcept
+        {
+            const __m256i top_shuffle = _mm256_broadcastsi128_si256(unpack_top_shuffle());
+            const __m256i top_bits = _mm256_broadcastsi128_si256(unpack_top_bits(order));
+            const __m256i shuffle = _mm256_broadcastsi128_si256(unpack_shuffle());
+            const __m256i low = _mm256_set1_epi8(0x7F);
+            const __m256i high = _mm256_set1_epi8(static_cast<char>(0x80));
+
+            // Each lane holds 14 bytes, the upper one is stored over the 2 bytes the lower one stores past them.
+            size_t group_count = 0;
+            for (; size >= 4 * packed_group_size + 3; size -= 4 * packed_group_size, data += 4 * packed_group_size, out += 4 * group_size,
+                                                       group_count += 4)
+            {
+                const __m256i input = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+                const __m256i top = _mm256_and_si256(_mm256_shuffle_epi8(input, top_shuffle), top_bits);
+                const __m256i tops = _mm256_and_si256(_mm256_cmpeq_epi8(top, top_bits), high);
+                const __m256i bytes = _mm256_shuffle_epi8(_mm256_or_si256(_mm256_and_si256(input, low), tops), shuffle);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm256_castsi256_si128(bytes));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 2 * group_size), _mm256_extracti128_si256(bytes, 1));
+            }
+            return group_count;
+        }
+#endif
+    } // namespace
+
+    size_t sysex_7bit_packed_size(size_t size) noexcept
+    {
+        return size + (size + group_size - 1) / group_size;
+    }
+
+    size_t sysex_7bit_unpacked_size(size_t packed_size) noexcept
+    {
+        const size_t remainder = packed_size % packed_group_size;
+        return packed_size / packed_group_size * group_size + (remainder > 0 ? remainder - 1 : 0);
+    }
+
+    size_t pack_sysex_7bit(const uint8_t* data, size_t size, uint8_t* out, sysex_7bit_order order) noexcept
+    {
+        const size_t packed_size = sysex_7bit_packed_size(size);
+        size_t group_count = 0;
+
+#if defined(SMIDI_SYSEX_CODEC_X86_64)
+        if (cpu_features() == x86_features::avx2)
+        {
+            group_count = pack_groups_avx2(data, size, out, order);
+        }
+        if (cpu_features() != x86_features::sse2)
+        {
+            group_count += pack_groups_ssse3(data + group_count * group_size, size - group_count * group_size,
+                                             out + group_count * packed_group_size, order);
+        }
+#endif
+        group_count += pack_groups_swar(data + group_count * group_size, size - group_count * group_size,
+                                        out + group_count * packed_group_size, order_multiplier(order));
+
+        data += group_count * group_size;
+        size -= group_count * group_size;
+        out += group_count * packed_group_size;
+        while (size > 0)
+        {
+            const size_t byte_count = std::min(size, group_size);
+            pack_group(data, byte_count, out, order);
+            data += byte_count;
+            size -= byte_count;
+            out += byte_count + 1;
+        }
+        return packed_size;
+    }
+
+    size_t unpack_sysex_7bit(const uint8_t* data, size_t size, uint8_t* out, sysex_7bit_order order) noexcept
+    {
+        const size_t unpacked_size = sysex_7bit_unpacked_size(size);
+        size_t group_count = 0;
+
+#if defined(SMIDI_SYSEX_CODEC_X86_64)
+        if (cpu_features() == x86_features::avx2)
+        {
+            group_count = unpack_groups_avx2(data, size, out, order);
+        }
+        if (cpu_features() != x86_features::sse2)
+        {
+            group_count += unpack_groups_ssse3(data + group_count * packed_group_size, size - group_count * packed_group_size,
+                                               out + group_count * group_size, order);
+        }
+#endif
+        group_count += unpack_groups_swar(data + group_count * packed_group_size, size - group_count * packed_group_size,
+                                          out + group_count * group_size, order_multiplier(order));
+
+        data += group_count * packed_group_size;
+        size -= group_count * packed_group_size;
+        out += group_count * group_size;
+        while (size > 0)
+        {
+            const size_t packed_count = std::min(size, packed_group_size);
+            unpack_group(data, packed_count, out, order);
+            data += packed_count;
+            size -= packed_count;
+            out += packed_count - 1;
+        }
+        return unpacked_size;
+    }
+
+    size_t pack_sysex_nibbles(const uint8_t* data, size_t size, uint8_t* out, sysex_nibble_order order) noexcept
+    {
+        const bool low_first = order == sysex_nibble_order::low_first;
+        size_t byte_idx = 0;
+
+#if defined(SMIDI_SYSEX_CODEC_X86_64)
+        const __m128i nibble = _mm_set1_epi8(0x0F);
+        for (; size - byte_idx >= 16; byte_idx += 16)
+        {
+            const __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + byte_idx));
+            const __m128i low = _mm_and_si128(input, nibble);
+            const __m128i high = _mm_and_si128(_mm_srli_epi16(input, 4), nibble);
+            const __m128i first = low_first ? low : high;
+            const __m128i second = low_first ? high : low;
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 2 * byte_idx), _mm_unpacklo_epi8(first, second));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 2 * byte_idx + 16), _mm_unpackhi_epi8(first, second));
+        }
+#elif defined(SMIDI_SYSEX_CODEC_NEON)
+        const uint8x16_t nibble = vdupq_n_u8(0x0F);
+        for (; size - byte_idx >= 16; byte_idx += 16)
+        {
+            const uint8x16_t input = vld1q_u8(data + byte_idx);
+            const uint8x16_t low = vandq_u8(input, nibble);
+            const uint8x16_t high = vshrq_n_u8(input, 4);
+            uint8x16x2_t pair;
+            pair.val[0] = low_first ? low : high;
+            pair.val[1] = low_first ? high : low;
+            vst2q_u8(out + 2 * byte_idx, pair);
+        }
+#endif
+
+        for (; byte_idx < size; byte_idx++)
+        {
+            const uint8_t low = data[byte_idx] & 0x0F;
+            const uint8_t high = data[byte_idx] >> 4;
+            out[2 * byte_idx] = low_first ? low : high;
+            out[2 * byte_idx + 1] = low_first ? high : low;
+        }
+        return 2 * size;
+    }
+
+    size_t unpack_sysex_nibbles(const uint8_t* data, size_t size, uint8_t* out, sysex_nibble_order order) noexcept
+    {
+        const bool low_first = order == sysex_nibble_order::low_first;
+        const size_t unpacked_size = size / 2;
+        size_t byte_idx = 0;
+
+#if defined(SMIDI_SYSEX_CODEC_X86_64)
+        // Even and odd bytes are split by masking and shifting 16-bit lanes and packing them back to bytes.
+        const __m128i nibble = _mm_set1_epi16(0x0F);
+        for (; unpacked_size - byte_idx >= 16; byte_idx += 16)
+        {
+            const __m128i first_half = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 2 * byte_idx));
+            const __m128i second_half = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 2 * byte_idx + 16));
+            const __m128i even = _mm_packus_epi16(_mm_and_si128(first_half, nibble), _mm_and_si128(second_half, nibble));
+            const __m128i odd = _mm_packus_epi16(_mm_and_si128(_mm_srli_epi16(first_half, 8), nibble),
+                                                 _mm_and_si128(_mm_srli_epi16(second_half, 8), nibble));
+            const __m128i low = low_first ? even : odd;
+            const __m128i high = low_first ? odd : even;
+            // Nibbles shifted within 16-bit lanes stay in their byte.
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + byte_idx), _mm_or_si128(low, _mm_slli_epi16(high, 4)));
+        }
+#elif defined(SMIDI_SYSEX_CODEC_NEON)
+        const uint8x16_t nibble = vdupq_n_u8(0x0F);
+        for (; unpacked_size - byte_idx >= 16; byte_idx += 16)
+        {
+            const uint8x16x2_t pair = vld2q_u8(data + 2 * byte_idx);
+            const uint8x16_t low = vandq_u8(low_first ? pair.val[0] : pair.val[1], nibble);
+            const uint8x16_t high = vandq_u8(low_first ? pair.val[1] : pair.val[0], nibble);
+            vst1q_u8(out + byte_idx, vorrq_u8(low, vshlq_n_u8(high, 4)));
+        }
+#endif
+
+        for (; byte_idx < unpacked_size; byte_idx++)
+        {
+            const uint8_t first = data[2 * byte_idx] & 0x0F;
+            const uint8_t second = data[2 * byte_idx + 1] & 0x0F;
+            out[byte_idx] = low_first ? static_cast<uint8_t>(first | (second << 4)) : static_cast<uint8_t>(second | (first << 4));
+        }
+        return unpacked_size;
+    }
+
+    // Sums are kept in bytes that wrap at 256, which leaves them right modulo 128.
+    uint8_t sysex_sum_checksum(const uint8_t* data, size_t size) noexcept
+    {
+        uint32_t sum = 0;
+        size_t byte_idx = 0;
+
+#if defined(SMIDI_SYSEX_CODEC_X86_64)
+        __m128i sums = _mm_setzero_si128();
+        for (; size - byte_idx >= 16; byte_idx += 16)
+        {
+            sums = _mm_add_epi8(sums, _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + byte_idx)));
+        }
+        const __m128i halves = _mm_sad_epu8(sums, _mm_setzero_si128());
+        sum = static_cast<uint32_t>(_mm_cvtsi128_si32(halves) + _mm_cvtsi128_si32(_mm_srli_si128(halves, 8)));
+#elif defined(SMIDI_SYSEX_CODEC_NEON)
+        uint8x16_t sums = vdupq_n_u8(0);
+        for (; size - byte_idx >= 16; byte_idx += 16)
+        {
+            sums = vaddq_u8(sums, vld1q_u8(data + byte_idx));
+        }
+        uint8_t lanes[16];
+        vst1q_u8(lanes, sums);
+        for (uint8_t lane : lanes)
+        {
+            sum += lane;
+        }
+#endif
+
+        for (; byte_idx < size; byte_idx++)
+        {
+            sum += data[byte_idx];
+        }
+        return static_cast<uint8_t>((0x80 - (sum & 0x7F)) & 0x7F);
+    }
+
+    uint8_t sysex_xor_checksum(const uint8_t* data, size_t size) noexcept
+    {
+        uint8_t checksum = 0;
+        size_t byte_idx = 0;
+
+#if defined(SMIDI_SYSEX_CODEC_X86_64)
+        __m128i checksums = _mm_setzero_si128();
+        for (; size - byte_idx >= 16; byte_idx += 16)
+        {
+            checksums = _mm_xor_si128(checksums, _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + byte_idx)));
+        }
+        checksums = _mm_xor_si128(checksums, _mm_srli_si128(checksums, 8));
+        checksums = _mm_xor_si128(checksums, _mm_srli_si128(checksums, 4));
+        checksums = _mm_xor_si128(checksums, _mm_srli_si128(checksums, 2));
+        checksums = _mm_xor_si128(checksums, _mm_srli_si128(checksums, 1));
+        checksum = static_cast<uint8_t>(_mm_cvtsi128_si32(checksums));
+#elif defined(SMIDI_SYSEX_CODEC_NEON)
+        uint8x16_t checksums = vdupq_n_u8(0);
+        for (; size - byte_idx >= 16; byte_idx += 16)
+        {
+            checksums = veorq_u8(checksums, vld1q_u8(data + byte_idx));
+        }
+        uint8_t lanes[16];
+        vst1q_u8(lanes, checksums);
+        for (uint8_t lane : lanes)
+        {
+            checksum ^= lane;
+        }
+#endif
+
+        for (; byte_idx < size; byte_idx++)
+        {
+            checksum ^= data[byte_idx];
+        }
+        return checksum & 0x7F;
+    }
+} // namespace smidi
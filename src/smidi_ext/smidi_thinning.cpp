@@ -0,0 +1,232 @@
+#include "smidi_ext/smidi_thinning.h"
+#include "smidi_ext/smidi_messages.h"
+
+#include <algorithm>
+#include <new>
+#include <stdexcept>
+
+namespace smidi
+{
+    namespace
+    {
+        constexpr size_t no_key = static_cast<size_t>(-1);
+
+        // Control change: 16 channels x 128 controllers, polyphonic key pressure: 16 channels x 128 keys, then 16
+        // channel pressure and 16 pitch bend keys.
+        constexpr size_t poly_pressure_key_base = 16 * 128;
+        constexpr size_t channel_pressure_key_base = poly_pressure_key_base + 16 * 128;
+        constexpr size_t pitch_bend_key_base = channel_pressure_key_base + 16;
+        constexpr size_t key_count = pitch_bend_key_base + 16;
+
+        // Data entry, increment/decrement and (N)RPN selection only make sense in sequence, channel mode messages act
+        // like notes.
+        bool is_order_sensitive_controller(uint8_t controller) noexcept
+        {
+            return controller == 6 || controller == 38 || (controller >= 96 && controller <= 101) || controller >= 120;
+        }
+
+        // Only complete messages of their type's length are merged, they fit the short storage of a pending message.
+        // Anything else is a barrier like any message that cannot be merged.
+        size_t merge_key(const uint8_t* data, size_t size) noexcept
+        {
+            const uint8_t status = data[0];
+            if (size < 2 || size != non_system_exclusive_message_length(status))
+            {
+                return no_key;
+            }
+
+            const size_t channel = get_channel(status);
+            const uint8_t data1 = data[1] & 0x7F;
+            if (is_control_change_message(status) && !is_order_sensitive_controller(data1))
+            {
+                return channel * 128 + data1;
+            }
+            else if (is_polyphonic_key_pressure_message(status))
+            {
+                return poly_pressure_key_base + channel * 128 + data1;
+            }
+            else if (is_channel_pressure_message(status))
+            {
+                return channel_pressure_key_base + channel;
+            }
+            else if (is_pitch_bend_change_message(status))
+            {
+                return pitch_bend_key_base + channel;
+            }
+            else
+            {
+                return no_key;
+            }
+        }
+    } // namespace
+
+    const uint8_t* thinning_output_device::pending_message::data() const noexcept
+    {
+        return long_data.empty() ? short_data.data() : long_data.data();
+    }
+
+    thinning_output_device::thinning_output_device(output_device& output, const thinning_options& options)
+        : _output(output)
+        , _options(options)
+        , _key_sequences(key_count, 0)
+        , _budget(static_cast<double>(options.burst_bytes))
+        , _last_refill(clock::now())
+    {
+        if (options.bytes_per_second == 0)
+        {
+            throw std::invalid_argument("Invalid wire rate.");
+        }
+    }
+
+    size_t thinning_output_device::send(const uint8_t* data, size_t size)
+    {
+        if (data == nullptr)
+        {
+            throw std::invalid_argument("NULL buffer.");
+        }
+
+        if (size == 0)
+        {
+            throw std::invalid_argument("Invalid buffer size.");
+        }
+
+        clock::time_point now = clock::now();
+        {
+            std::lock_guard<decltype(_mutex)> lock(_mutex);
+            refill(now);
+
+            if (is_system_real_time_message(data[0]))
+            {
+                send_to_wire(data, size);
+                return size;
+            }
+
+            const size_t key = merge_key(data, size);
+            const uint64_t sequence = _front_sequence + _pending.size();
+            if (key != no_key)
+            {
+                // _key_sequences holds sequence + 1 so zero means nothing pending.
+                uint64_t pending_sequence = _key_sequences[key];
+                if (pending_sequence > _barrier_sequence && pending_sequence - 1 >= _front_sequence)
+                {
+                    pending_message& pending = _pending[static_cast<size_t>(pending_sequence - 1 - _front_sequence)];
+                    std::copy(data, data + size, pending.short_data.begin());
+                    pending.size = size;
+                    _statistics.merged++;
+                    return size;
+                }
+                _key_sequences[key] = sequence + 1;
+            }
+            else
+            {
+                _barrier_sequence = sequence + 1;
+            }
+
+            pending_message pending;
+            pending.size = size;
+            if (size <= pending.short_data.size())
+            {
+                std::copy(data, data + size, pending.short_data.begin());
+            }
+            else
+            {
+                pending.long_data.assign(data, data + size);
+            }
+            _pending.push_back(std::move(pending));
+        }
+
+        pump(now);
+        return size;
+    }
+
+    result thinning_output_device::try_send(const uint8_t* data, size_t size) noexcept
+    {
+        if (data == nullptr || size == 0)
+        {
+            return SMIDI_RESULT_INVALID_ARGUMENT;
+        }
+
+        // Queueing may allocate and the wrapped device is driven through its throwing send, translate both.
+        try
+        {
+            send(data, size);
+            return SMIDI_RESULT_OK;
+        }
+        catch (const std::bad_alloc&)
+        {
+            return SMIDI_RESULT_OUT_OF_MEMORY;
+        }
+        catch (const std::invalid_argument&)
+        {
+            return SMIDI_RESULT_INVALID_ARGUMENT;
+        }
+        catch (...)
+        {
+            return SMIDI_RESULT_DEVICE_ERROR;
+        }
+    }
+
+    size_t thinning_output_device::pump(clock::time_point now)
+    {
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        refill(now);
+
+        size_t sent = 0;
+        while (!_pending.empty() && _budget >= 0.0)
+        {
+            const pending_message& pending = _pending.front();
+            send_to_wire(pending.data(), pending.size);
+
+            _pending.pop_front();
+            _front_sequence++;
+            sent++;
+        }
+        return sent;
+    }
+
+    thinning_output_device::clock::time_point thinning_output_device::next_send_time() const
+    {
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        if (_pending.empty())
+        {
+            return clock::time_point::max();
+        }
+
+        if (_budget >= 0.0)
+        {
+            return _last_refill;
+        }
+
+        std::chrono::duration<double> wait(-_budget / static_cast<double>(_options.bytes_per_second));
+        return _last_refill + std::chrono::duration_cast<clock::duration>(wait) + clock::duration(1);
+    }
+
+    thinning_statistics thinning_output_device::statistics() const
+    {
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        thinning_statistics statistics = _statistics;
+        statistics.pending = _pending.size();
+        return statistics;
+    }
+
+    void thinning_output_device::refill(clock::time_point now)
+    {
+        if (now <= _last_refill)
+        {
+            return;
+        }
+
+        std::chrono::duration<double> elapsed = now - _last_refill;
+        _budget = std::min(_budget + elapsed.count() * static_cast<double>(_options.bytes_per_second),
+                           static_cast<double>(_options.burst_bytes));
+        _last_refill = now;
+    }
+
+    void thinning_output_device::send_to_wire(const uint8_t* data, size_t size)
+    {
+        _output.send(data, size);
+        _budget -= static_cast<double>(size);
+        _statistics.sent_messages++;
+        _statistics.sent_bytes += size;
+    }
+} // namespace smidi
@@ -0,0 +1,669 @@
+#include "smidi_ext/smidi_ump.h"
+#include "smidi_ext/smidi_messages.h"
+
+#include <algorithm>
+#include <assert.h>
+
+namespace smidi
+{
+    namespace
+    {
+        constexpr uint8_t system_exclusive_message_status = 0xF0;
+        constexpr uint8_t system_exclusive_message_footer = 0xF7;
+
+        constexpr uint8_t midi2_registered_controller_status = 0x2;
+        constexpr uint8_t midi2_assignable_controller_status = 0x3;
+
+        constexpr uint8_t bank_select_msb_controller = 0;
+        constexpr uint8_t bank_select_lsb_controller = 32;
+        constexpr uint8_t data_entry_msb_controller = 6;
+        constexpr uint8_t data_entry_lsb_controller = 38;
+        constexpr uint8_t nrpn_lsb_controller = 98;
+        constexpr uint8_t nrpn_msb_controller = 99;
+        constexpr uint8_t rpn_lsb_controller = 100;
+        constexpr uint8_t rpn_msb_controller = 101;
+        constexpr uint8_t parameter_null = 127;
+
+        constexpr uint32_t make_first_word(ump_message_type type, uint8_t group, uint8_t status, uint8_t byte2, uint8_t byte3)
+        {
+            return (static_cast<uint32_t>(type) << 28) | (static_cast<uint32_t>(group & 0xF) << 24) | (static_cast<uint32_t>(status) << 16) |
+                   (static_cast<uint32_t>(byte2) << 8) | byte3;
+        }
+
+        // Total length of a non-SysEx message, undefined status bytes are treated as single byte messages.
+        size_t status_message_length(uint8_t status) noexcept
+        {
+            size_t length = non_system_exclusive_message_length(status);
+            return (length == 0) ? 1 : length;
+        }
+
+        constexpr uint8_t word_byte(uint32_t word, size_t byte_idx)
+        {
+            return static_cast<uint8_t>(word >> (24 - byte_idx * 8));
+        }
+
+        // Closed forms of scale_up for the common bit widths. Values above the source center repeat their low bits
+        // into the new low bits, written with masks instead of branches.
+        inline uint16_t scale_7_to_16_value(uint8_t value) noexcept
+        {
+            const uint32_t v = value & 0x7F;
+            const uint32_t repeat = v & 0x3F;
+            const uint32_t mask = 0u - static_cast<uint32_t>(v > 0x40);
+            return static_cast<uint16_t>((v << 9) | (((repeat << 3) | (repeat >> 3)) & mask));
+        }
+
+        inline uint32_t scale_7_to_32_value(uint8_t value) noexcept
+        {
+            const uint32_t v = value & 0x7F;
+            const uint32_t repeat = v & 0x3F;
+            const uint32_t mask = 0u - static_cast<uint32_t>(v > 0x40);
+            return (v << 25) | (((repeat << 19) | (repeat << 13) | (repeat << 7) | (repeat << 1) | (repeat >> 5)) & mask);
+        }
+
+        inline uint32_t scale_14_to_32_value(uint16_t value) noexcept
+        {
+            const uint32_t v = value & 0x3FFF;
+            const uint32_t repeat = v & 0x1FFF;
+            const uint32_t mask = 0u - static_cast<uint32_t>(v > 0x2000);
+            return (v << 18) | (((repeat << 5) | (repeat >> 8)) & mask);
+        }
+    } // namespace
+
+    ump_message_type ump_type(uint32_t first_word) noexcept
+    {
+        return static_cast<ump_message_type>(first_word >> 28);
+    }
+
+    size_t ump_word_count(ump_message_type type) noexcept
+    {
+        switch (type)
+        {
+        case ump_message_type::utility:
+        case ump_message_type::system:
+        case ump_message_type::midi1_channel_voice:
+        case ump_message_type::reserved_32_6:
+        case ump_message_type::reserved_32_7:
+            return 1;
+        case ump_message_type::data64:
+        case ump_message_type::midi2_channel_voice:
+        case ump_message_type::reserved_64_8:
+        case ump_message_type::reserved_64_9:
+        case ump_message_type::reserved_64_a:
+            return 2;
+        case ump_message_type::reserved_96_b:
+        case ump_message_type::reserved_96_c:
+            return 3;
+        default:
+            return 4;
+        }
+    }
+
+    size_t ump_word_count(uint32_t first_word) noexcept
+    {
+        return ump_word_count(ump_type(first_word));
+    }
+
+    uint8_t ump_group(uint32_t first_word) noexcept
+    {
+        return (first_word >> 24) & 0xF;
+    }
+
+    ump_packet::ump_packet() noexcept
+        : _words{0}
+    {
+    }
+
+    ump_packet::ump_packet(const uint32_t* words, size_t count) noexcept
+        : _words{0}
+    {
+        assert(count > 0 && count == ump_word_count(words[0]));
+        for (size_t word_idx = 0; word_idx < count && word_idx < ump_max_words; word_idx++)
+        {
+            _words[word_idx] = words[word_idx];
+        }
+    }
+
+    ump_message_type ump_packet::type() const noexcept
+    {
+        return ump_type(_words[0]);
+    }
+
+    uint8_t ump_packet::group() const noexcept
+    {
+        return ump_group(_words[0]);
+    }
+
+    uint8_t ump_packet::status() const noexcept
+    {
+        switch (type())
+        {
+        case ump_message_type::system:
+        case ump_message_type::midi1_channel_voice:
+            return word_byte(_words[0], 1);
+        default:
+            return word_byte(_words[0], 1) >> 4;
+        }
+    }
+
+    uint8_t ump_packet::channel() const noexcept
+    {
+        return word_byte(_words[0], 1) & 0xF;
+    }
+
+    const uint32_t* ump_packet::data() const noexcept
+    {
+        return _words.data();
+    }
+
+    size_t ump_packet::size() const noexcept
+    {
+        return ump_word_count(_words[0]);
+    }
+
+    ump_packet make_ump_system_message(uint8_t group, uint8_t status, uint8_t data1, uint8_t data2) noexcept
+    {
+        uint32_t word = make_first_word(ump_message_type::system, group, status, data1 & 0x7F, data2 & 0x7F);
+        return ump_packet(&word, 1);
+    }
+
+    ump_packet make_ump_midi1_channel_voice_message(uint8_t group, uint8_t status, uint8_t data1, uint8_t data2) noexcept
+    {
+        uint32_t word = make_first_word(ump_message_type::midi1_channel_voice, group, status, data1 & 0x7F, data2 & 0x7F);
+        return ump_packet(&word, 1);
+    }
+
+    ump_packet make_ump_midi2_channel_voice_message(uint8_t group, uint8_t status, uint8_t index1, uint8_t index2, uint32_t data) noexcept
+    {
+        uint32_t words[2] = {make_first_word(ump_message_type::midi2_channel_voice, group, status, index1, index2), data};
+        return ump_packet(words, 2);
+    }
+
+    void ump_stream_parser::reset() noexcept
+    {
+        _word_count = 0;
+    }
+
+    uint32_t scale_up(uint32_t value, uint8_t source_bits, uint8_t destination_bits) noexcept
+    {
+        assert(source_bits > 1 && source_bits <= destination_bits && destination_bits <= 32);
+
+        const uint8_t scale_bits = destination_bits - source_bits;
+        const uint32_t shifted_value = value << scale_bits;
+        const uint32_t source_center = 1u << (source_bits - 1);
+        if (value <= source_center)
+        {
+            return shifted_value;
+        }
+
+        const uint8_t repeat_bits = source_bits - 1;
+        const uint32_t repeat_mask = (1u << repeat_bits) - 1;
+        uint32_t repeat_value = value & repeat_mask;
+        if (scale_bits > repeat_bits)
+        {
+            repeat_value <<= scale_bits - repeat_bits;
+        }
+        else
+        {
+            repeat_value >>= repeat_bits - scale_bits;
+        }
+
+        uint32_t result = shifted_value;
+        while (repeat_value != 0)
+        {
+            result |= repeat_value;
+            repeat_value >>= repeat_bits;
+        }
+        return result;
+    }
+
+    uint32_t scale_down(uint32_t value, uint8_t source_bits, uint8_t destination_bits) noexcept
+    {
+        assert(destination_bits <= source_bits);
+        return value >> (source_bits - destination_bits);
+    }
+
+    void scale_7_to_16(const uint8_t* values, uint16_t* out, size_t count) noexcept
+    {
+        for (size_t value_idx = 0; value_idx < count; value_idx++)
+        {
+            out[value_idx] = scale_7_to_16_value(values[value_idx]);
+        }
+    }
+
+    void scale_7_to_32(const uint8_t* values, uint32_t* out, size_t count) noexcept
+    {
+        for (size_t value_idx = 0; value_idx < count; value_idx++)
+        {
+            out[value_idx] = scale_7_to_32_value(values[value_idx]);
+        }
+    }
+
+    void scale_14_to_32(const uint16_t* values, uint32_t* out, size_t count) noexcept
+    {
+        for (size_t value_idx = 0; value_idx < count; value_idx++)
+        {
+            out[value_idx] = scale_14_to_32_value(values[value_idx]);
+        }
+    }
+
+    void scale_16_to_7(const uint16_t* values, uint8_t* out, size_t count) noexcept
+    {
+        for (size_t value_idx = 0; value_idx < count; value_idx++)
+        {
+            out[value_idx] = static_cast<uint8_t>(values[value_idx] >> 9);
+        }
+    }
+
+    void scale_32_to_7(const uint32_t* values, uint8_t* out, size_t count) noexcept
+    {
+        for (size_t value_idx = 0; value_idx < count; value_idx++)
+        {
+            out[value_idx] = static_cast<uint8_t>(values[value_idx] >> 25);
+        }
+    }
+
+    void scale_32_to_14(const uint32_t* values, uint16_t* out, size_t count) noexcept
+    {
+        for (size_t value_idx = 0; value_idx < count; value_idx++)
+        {
+            out[value_idx] = static_cast<uint16_t>(values[value_idx] >> 18);
+        }
+    }
+
+    midi1_to_ump_translator::midi1_to_ump_translator(uint8_t group, ump_protocol protocol) noexcept
+        : _group(group & 0xF)
+        , _protocol(protocol)
+    {
+        reset();
+    }
+
+    void midi1_to_ump_translator::reset() noexcept
+    {
+        _running_status = 0;
+        _message_size = 0;
+        _in_system_exclusive = false;
+        _system_exclusive_started = false;
+        _system_exclusive_size = 0;
+        _channels.fill(channel_state{0, 0, false, 0, 0, 0, 0});
+    }
+
+    size_t midi1_to_ump_translator::translate(const uint8_t* data, size_t size, uint32_t* out) noexcept
+    {
+        size_t word_count = 0;
+        for (size_t byte_idx = 0; byte_idx < size; byte_idx++)
+        {
+            const uint8_t byte = data[byte_idx];
+
+            if (byte >= 0xF8)
+            {
+                out[word_count++] = make_first_word(ump_message_type::system, _group, byte, 0, 0);
+                continue;
+            }
+
+            if (_in_system_exclusive)
+            {
+                if ((byte & 0x80) == 0)
+                {
+                    // Only emit a full packet once more data follows, so the last one can carry the end status.
+                    if (_system_exclusive_size == ump_system_exclusive7_bytes_per_packet)
+                    {
+                        word_count += flush_system_exclusive(_system_exclusive_started ? ump_data_status::continue_ : ump_data_status::start,
+                                                             out + word_count);
+                    }
+                    _system_exclusive[_system_exclusive_size++] = byte;
+                    continue;
+                }
+
+                // Any status byte ends the SysEx, F7 is the regular footer.
+                _in_system_exclusive = false;
+                word_count += flush_system_exclusive(_system_exclusive_started ? ump_data_status::end : ump_data_status::complete,
+                                                     out + word_count);
+                if (byte == system_exclusive_message_footer)
+                {
+                    continue;
+                }
+            }
+
+            if ((byte & 0x80) != 0)
+            {
+                _message_size = 0;
+                if (byte == system_exclusive_message_status)
+                {
+                    _running_status = 0;
+                    _in_system_exclusive = true;
+                    _system_exclusive_started = false;
+                    _system_exclusive_size = 0;
+                    continue;
+                }
+                if (byte == system_exclusive_message_footer)
+                {
+                    continue;
+                }
+
+                _running_status = byte;
+                _message[_message_size++] = byte;
+            }
+            else
+            {
+                if (_running_status == 0)
+                {
+                    continue;
+                }
+                if (_message_size == 0)
+                {
+                    _message[_message_size++] = _running_status;
+                }
+                _message[_message_size++] = byte;
+            }
+
+            if (_message_size == status_message_length(_message[0]))
+            {
+                word_count += translate_message(out + word_count);
+                if (_message[0] >= 0xF0)
+                {
+                    _running_status = 0;
+                }
+                _message_size = 0;
+            }
+        }
+        return word_count;
+    }
+
+    void midi1_to_ump_translator::translate(const uint8_t* data, size_t size, std::vector<uint32_t>& out)
+    {
+        size_t offset = out.size();
+        out.resize(offset + max_words(size));
+        out.resize(offset + translate(data, size, out.data() + offset));
+    }
+
+    size_t midi1_to_ump_translator::translate_message(uint32_t* out) noexcept
+    {
+        const uint8_t status = _message[0];
+        const uint8_t data1 = (_message_size > 1) ? _message[1] : 0;
+        const uint8_t data2 = (_message_size > 2) ? _message[2] : 0;
+
+        if (!is_channel_message(status))
+        {
+            out[0] = make_first_word(ump_message_type::system, _group, status, data1, data2);
+            return 1;
+        }
+
+        if (_protocol == ump_protocol::midi1)
+        {
+            out[0] = make_first_word(ump_message_type::midi1_channel_voice, _group, status, data1, data2);
+            return 1;
+        }
+
+        return translate_midi2_channel_voice(out);
+    }
+
+    size_t midi1_to_ump_translator::translate_midi2_channel_voice(uint32_t* out) noexcept
+    {
+        const uint8_t status = _message[0];
+        const uint8_t channel = static_cast<uint8_t>(get_channel(status));
+        const uint8_t data1 = _message[1];
+        const uint8_t data2 = (_message_size > 2) ? _message[2] : 0;
+        channel_state& state = _channels[channel];
+
+        auto write = [&](uint8_t midi2_status, uint8_t index1, uint8_t index2, uint32_t value) -> size_t {
+            out[0] = make_first_word(ump_message_type::midi2_channel_voice, _group, static_cast<uint8_t>((midi2_status << 4) | channel), index1,
+                                     index2);
+            out[1] = value;
+            return 2;
+        };
+
+        switch (status >> 4)
+        {
+        case 0x8:
+            return write(0x8, data1, 0, static_cast<uint32_t>(scale_7_to_16_value(data2)) << 16);
+
+        case 0x9:
+            if (data2 == 0)
+            {
+                // A MIDI 1.0 note on with velocity 0 is a note off with the default release velocity of 64.
+                return write(0x8, data1, 0, static_cast<uint32_t>(scale_7_to_16_value(64)) << 16);
+            }
+            return write(0x9, data1, 0, static_cast<uint32_t>(scale_7_to_16_value(data2)) << 16);
+
+        case 0xA:
+            return write(0xA, data1, 0, scale_7_to_32_value(data2));
+
+        case 0xB:
+            switch (data1)
+            {
+            case bank_select_msb_controller:
+                state.bank_msb = data2;
+                state.bank_valid = true;
+                return 0;
+            case bank_select_lsb_controller:
+                state.bank_lsb = data2;
+                state.bank_valid = true;
+                return 0;
+            case rpn_msb_controller:
+            case rpn_lsb_controller:
+            case nrpn_msb_controller:
+            case nrpn_lsb_controller:
+                if (data1 == rpn_msb_controller || data1 == nrpn_msb_controller)
+                {
+                    state.parameter_msb = data2;
+                }
+                else
+                {
+                    state.parameter_lsb = data2;
+                }
+                state.parameter_status = (data1 >= rpn_lsb_controller) ? midi2_registered_controller_status : midi2_assignable_controller_status;
+                if (state.parameter_msb == parameter_null && state.parameter_lsb == parameter_null)
+                {
+                    state.parameter_status = 0;
+                }
+                return 0;
+            case data_entry_msb_controller:
+                if (state.parameter_status != 0)
+                {
+                    state.data_msb = data2;
+                    return write(state.parameter_status, state.parameter_msb, state.parameter_lsb,
+                                 scale_14_to_32_value(static_cast<uint16_t>(data2 << 7)));
+                }
+                break;
+            case data_entry_lsb_controller:
+                if (state.parameter_status != 0)
+                {
+                    return write(state.parameter_status, state.parameter_msb, state.parameter_lsb,
+                                 scale_14_to_32_value(static_cast<uint16_t>((state.data_msb << 7) | data2)));
+                }
+                break;
+            default:
+                break;
+            }
+            return write(0xB, data1, 0, scale_7_to_32_value(data2));
+
+        case 0xC:
+        {
+            uint32_t value = static_cast<uint32_t>(data1) << 24;
+            if (state.bank_valid)
+            {
+                value |= (static_cast<uint32_t>(state.bank_msb) << 8) | state.bank_lsb;
+            }
+            return write(0xC, 0, state.bank_valid ? 1 : 0, value);
+        }
+
+        case 0xD:
+            return write(0xD, 0, 0, scale_7_to_32_value(data1));
+
+        case 0xE:
+            return write(0xE, 0, 0, scale_14_to_32_value(static_cast<uint16_t>((data2 << 7) | data1)));
+
+        default:
+            return 0;
+        }
+    }
+
+    size_t midi1_to_ump_translator::flush_system_exclusive(ump_data_status status, uint32_t* out) noexcept
+    {
+        uint8_t bytes[ump_system_exclusive7_bytes_per_packet] = {0};
+        for (size_t byte_idx = 0; byte_idx < _system_exclusive_size; byte_idx++)
+        {
+            bytes[byte_idx] = _system_exclusive[byte_idx];
+        }
+
+        out[0] = make_first_word(ump_message_type::data64, _group,
+                                 static_cast<uint8_t>((static_cast<uint8_t>(status) << 4) | _system_exclusive_size), bytes[0], bytes[1]);
+        out[1] = (static_cast<uint32_t>(bytes[2]) << 24) | (static_cast<uint32_t>(bytes[3]) << 16) | (static_cast<uint32_t>(bytes[4]) << 8) |
+                 bytes[5];
+
+        _system_exclusive_started = (status == ump_data_status::start || status == ump_data_status::continue_);
+        _system_exclusive_size = 0;
+        return 2;
+    }
+
+    size_t ump_to_midi1_translator::translate(const uint32_t* words, size_t count, uint8_t* out) noexcept
+    {
+        size_t byte_count = 0;
+        _parser.parse(words, count, [&](const ump_packet& packet) { byte_count += translate_packet(packet, out + byte_count); });
+        return byte_count;
+    }
+
+    void ump_to_midi1_translator::translate(const uint32_t* words, size_t count, std::vector<uint8_t>& out)
+    {
+        size_t offset = out.size();
+        out.resize(offset + max_bytes(count));
+        out.resize(offset + translate(words, count, out.data() + offset));
+    }
+
+    uint64_t ump_to_midi1_translator::skipped_packets() const noexcept
+    {
+        return _skipped_packets;
+    }
+
+    void ump_to_midi1_translator::reset() noexcept
+    {
+        _parser.reset();
+        _skipped_packets = 0;
+    }
+
+    size_t ump_to_midi1_translator::translate_packet(const ump_packet& packet, uint8_t* out) noexcept
+    {
+        const uint32_t* words = packet.data();
+        switch (packet.type())
+        {
+        case ump_message_type::system:
+        case ump_message_type::midi1_channel_voice:
+        {
+            const uint8_t status = word_byte(words[0], 1);
+            if ((status & 0x80) == 0 || is_system_exclusive_message(status))
+            {
+                _skipped_packets++;
+                return 0;
+            }
+
+            const size_t length = status_message_length(status);
+            for (size_t byte_idx = 0; byte_idx < length; byte_idx++)
+            {
+                out[byte_idx] = word_byte(words[0], byte_idx + 1) & ((byte_idx == 0) ? 0xFF : 0x7F);
+            }
+            return length;
+        }
+
+        case ump_message_type::data64:
+        {
+            const uint8_t status = word_byte(words[0], 1) >> 4;
+            const size_t data_size = std::min<size_t>(word_byte(words[0], 1) & 0xF, ump_system_exclusive7_bytes_per_packet);
+            const uint8_t bytes[ump_system_exclusive7_bytes_per_packet] = {
+                word_byte(words[0], 2), word_byte(words[0], 3), word_byte(words[1], 0),
+                word_byte(words[1], 1), word_byte(words[1], 2), word_byte(words[1], 3),
+            };
+
+            size_t byte_count = 0;
+            if (status == static_cast<uint8_t>(ump_data_status::complete) || status == static_cast<uint8_t>(ump_data_status::start))
+            {
+                out[byte_count++] = system_exclusive_message_status;
+            }
+            for (size_t byte_idx = 0; byte_idx < data_size; byte_idx++)
+            {
+                out[byte_count++] = bytes[byte_idx] & 0x7F;
+            }
+            if (status == static_cast<uint8_t>(ump_data_status::complete) || status == static_cast<uint8_t>(ump_data_status::end))
+            {
+                out[byte_count++] = system_exclusive_message_footer;
+            }
+            return byte_count;
+        }
+
+        case ump_message_type::midi2_channel_voice:
+            return translate_midi2_channel_voice(packet, out);
+
+        default:
+            _skipped_packets++;
+            return 0;
+        }
+    }
+
+    size_t ump_to_midi1_translator::translate_midi2_channel_voice(const ump_packet& packet, uint8_t* out) noexcept
+    {
+        const uint32_t* words = packet.data();
+        const uint8_t channel = packet.channel();
+        const uint8_t index1 = word_byte(words[0], 2) & 0x7F;
+        const uint8_t index2 = word_byte(words[0], 3) & 0x7F;
+        const uint32_t value = words[1];
+
+        size_t byte_count = 0;
+        auto write = [&](uint8_t status, uint8_t data1, uint8_t data2) {
+            out[byte_count++] = static_cast<uint8_t>(status | channel);
+            out[byte_count++] = data1;
+            if (non_system_exclusive_message_length(status) == 3)
+            {
+                out[byte_count++] = data2;
+            }
+        };
+
+        const uint16_t value14 = static_cast<uint16_t>(value >> 18);
+        switch (packet.status())
+        {
+        case 0x8:
+            write(0x80, index1, static_cast<uint8_t>(value >> 25));
+            break;
+        case 0x9:
+        {
+            // Velocity 0 would turn the note on into a note off in MIDI 1.0.
+            uint8_t velocity = static_cast<uint8_t>(value >> 25);
+            write(0x90, index1, (velocity == 0) ? 1 : velocity);
+            break;
+        }
+        case 0xA:
+            write(0xA0, index1, static_cast<uint8_t>(value >> 25));
+            break;
+        case 0xB:
+            write(0xB0, index1, static_cast<uint8_t>(value >> 25));
+            break;
+        case midi2_registered_controller_status:
+        case midi2_assignable_controller_status:
+        {
+            const bool registered = packet.status() == midi2_registered_controller_status;
+            write(0xB0, registered ? rpn_msb_controller : nrpn_msb_controller, index1);
+            write(0xB0, registered ? rpn_lsb_controller : nrpn_lsb_controller, index2);
+            write(0xB0, data_entry_msb_controller, static_cast<uint8_t>(value14 >> 7));
+            write(0xB0, data_entry_lsb_controller, static_cast<uint8_t>(value14 & 0x7F));
+            break;
+        }
+        case 0xC:
+            if ((index2 & 0x1) != 0)
+            {
+                write(0xB0, bank_select_msb_controller, static_cast<uint8_t>((value >> 8) & 0x7F));
+                write(0xB0, bank_select_lsb_controller, static_cast<uint8_t>(value & 0x7F));
+            }
+            write(0xC0, static_cast<uint8_t>((value >> 24) & 0x7F), 0);
+            break;
+        case 0xD:
+            write(0xD0, static_cast<uint8_t>(value >> 25), 0);
+            break;
+        case 0xE:
+            write(0xE0, static_cast<uint8_t>(value14 & 0x7F), static_cast<uint8_t>(value14 >> 7));
+            break;
+        default:
+            // Per-note controllers, relative controllers and per-note management have no MIDI 1.0 equivalent.
+            _skipped_packets++;
+            break;
+        }
+        return byte_count;
+    }
+} // namespace smidi
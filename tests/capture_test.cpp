@@ -0,0 +1,271 @@
+#include "test.h"
+
+#include "smidi/smidi.h"
+#include "smidi_ext/smidi_capture.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace
+{
+    using std::chrono::milliseconds;
+
+    constexpr size_t event_count = 5000;
+
+    // Removes the log when the test is done, pass or fail.
+    class temporary_file
+    {
+      public:
+        temporary_file()
+        {
+            const std::string name = "smidi_capture_test_" + std::to_string(std::random_device()()) + ".smcp";
+            _path = (std::filesystem::temp_directory_path() / name).string();
+        }
+
+        ~temporary_file()
+        {
+            std::error_code error;
+            std::filesystem::remove(_path, error);
+        }
+
+        const std::string& path() const noexcept
+        {
+            return _path;
+        }
+
+        std::vector<uint8_t> contents() const
+        {
+            std::ifstream file(_path, std::ios::binary);
+            return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        }
+
+      private:
+        std::string _path;
+    };
+
+    // Every 100th event is a SysEx, the rest alternate note on and off across three ports.
+    std::vector<uint8_t> make_message(size_t index)
+    {
+        if (index % 100 == 99)
+        {
+            std::vector<uint8_t> message(2 + index % 300, static_cast<uint8_t>(index & 0x7F));
+            message.front() = 0xF0;
+            message.back() = 0xF7;
+            return message;
+        }
+        return {static_cast<uint8_t>(index % 2 ? 0x80 : 0x90), static_cast<uint8_t>(index & 0x7F), 0x40};
+    }
+
+    uint32_t make_port(size_t index)
+    {
+        return static_cast<uint32_t>(index % 3);
+    }
+
+    milliseconds make_time(size_t index)
+    {
+        return milliseconds(index * 2);
+    }
+
+    void write_log(const std::string& path, const smidi::capture_options& options)
+    {
+        const smidi::capture_writer::clock::time_point start = smidi::capture_writer::clock::now();
+        smidi::capture_writer writer(path, options);
+        for (size_t event_idx = 0; event_idx < event_count; event_idx++)
+        {
+            std::vector<uint8_t> message = make_message(event_idx);
+            writer.write(make_port(event_idx), start + make_time(event_idx), message.data(), message.size());
+        }
+        writer.close();
+
+        const smidi::capture_statistics statistics = writer.statistics();
+        SMIDI_CHECK(statistics.events == event_count);
+        SMIDI_CHECK(statistics.dropped == 0);
+        SMIDI_CHECK(statistics.blocks > 1);
+    }
+
+    // Checks the events from index on and returns how many were read.
+    size_t check_events(smidi::capture_reader& reader, size_t index)
+    {
+        smidi::capture_event event;
+        size_t read = 0;
+        for (; reader.next(event); index++, read++)
+        {
+            const std::vector<uint8_t> expected = make_message(index);
+            SMIDI_CHECK(event.port == make_port(index));
+            SMIDI_CHECK(event.time == make_time(index));
+            SMIDI_CHECK(event.size == expected.size());
+            SMIDI_CHECK(std::equal(expected.begin(), expected.end(), event.data));
+        }
+        return read;
+    }
+} // namespace
+
+SMIDI_TEST(log_round_trip)
+{
+    for (bool compress : {true, false})
+    {
+        temporary_file file;
+        smidi::capture_options options;
+        options.block_size = 4096;
+        options.compress = compress;
+        write_log(file.path(), options);
+
+        smidi::capture_reader reader(file.path());
+        SMIDI_CHECK(reader.complete());
+        SMIDI_CHECK(reader.block_count() > 1);
+        SMIDI_CHECK(reader.event_count() == event_count);
+        SMIDI_CHECK(check_events(reader, 0) == event_count);
+
+        reader.rewind();
+        SMIDI_CHECK(check_events(reader, 0) == event_count);
+    }
+}
+
+SMIDI_TEST(seek_moves_to_first_event_at_or_after)
+{
+    temporary_file file;
+    smidi::capture_options options;
+    options.block_size = 1024;
+    write_log(file.path(), options);
+
+    smidi::capture_reader reader(file.path());
+    for (size_t event_idx : {size_t(0), size_t(1), size_t(777), event_count / 2, event_count - 1})
+    {
+        reader.seek(make_time(event_idx));
+        SMIDI_CHECK(check_events(reader, event_idx) == event_count - event_idx);
+
+        // Between two events, the later one is next.
+        reader.seek(make_time(event_idx) - milliseconds(1));
+        SMIDI_CHECK(check_events(reader, event_idx) == event_count - event_idx);
+    }
+
+    reader.seek(make_time(event_count));
+    smidi::capture_event event;
+    SMIDI_CHECK(!reader.next(event));
+}
+
+SMIDI_TEST(truncated_log_reads_complete_blocks)
+{
+    temporary_file file;
+    smidi::capture_options options;
+    options.block_size = 1024;
+    write_log(file.path(), options);
+
+    // Cut into the last blocks, as if the capture never finished. What is left reads as a prefix of the log.
+    std::vector<uint8_t> contents = file.contents();
+    contents.resize(contents.size() * 3 / 4);
+    smidi::capture_reader reader(contents.data(), contents.size());
+    SMIDI_CHECK(!reader.complete());
+    SMIDI_CHECK(reader.block_count() > 0);
+
+    const size_t read = check_events(reader, 0);
+    SMIDI_CHECK(read > 0 && read < event_count);
+    SMIDI_CHECK(read == reader.event_count());
+}
+
+SMIDI_TEST(corrupt_log_throws)
+{
+    temporary_file file;
+    smidi::capture_options options;
+    options.block_size = 4096;
+    write_log(file.path(), options);
+    const std::vector<uint8_t> contents = file.contents();
+
+    std::vector<uint8_t> bad_header = contents;
+    bad_header[0] ^= 0xFF;
+    SMIDI_CHECK_THROWS(smidi::capture_reader(bad_header.data(), bad_header.size()), std::runtime_error);
+
+    // Garbage in the compressed blocks fails to decode instead of producing events.
+    std::vector<uint8_t> bad_blocks = contents;
+    for (size_t byte_idx = 64; byte_idx < bad_blocks.size() / 2; byte_idx += 7)
+    {
+        bad_blocks[byte_idx] ^= 0x5A;
+    }
+    SMIDI_CHECK_THROWS(
+        {
+            smidi::capture_reader reader(bad_blocks.data(), bad_blocks.size());
+            smidi::capture_event event;
+            while (reader.next(event))
+            {
+            }
+        },
+        std::runtime_error);
+
+    SMIDI_CHECK_THROWS(smidi::capture_reader(file.path() + ".missing"), std::runtime_error);
+}
+
+SMIDI_TEST(replay_waits_for_full_queues)
+{
+    temporary_file file;
+    smidi::capture_options capture_options;
+    capture_options.block_size = 4096;
+    write_log(file.path(), capture_options);
+    smidi::capture_reader reader(file.path());
+
+    // Queues far smaller than the log under the block policy, the replayer has to wait for the consumer.
+    smidi::device_options input_options = smidi::default_device_options;
+    input_options.queue.capacity = 8;
+    input_options.queue.overflow_policy = SMIDI_OVERFLOW_POLICY_BLOCK;
+    const std::vector<std::string> port_names = {"replay_0", "replay_1", "replay_2"};
+    std::unique_ptr<smidi::system> system = smidi::create_loopback_system(port_names);
+    std::vector<std::unique_ptr<smidi::input_device>> inputs;
+    std::vector<std::unique_ptr<smidi::output_device>> outputs;
+    std::vector<smidi::output_device*> output_ptrs;
+    for (const std::string& name : port_names)
+    {
+        inputs.push_back(system->create_input_device(name, input_options));
+        outputs.push_back(system->create_output_device(name));
+        output_ptrs.push_back(outputs.back().get());
+    }
+
+    std::vector<std::vector<std::vector<uint8_t>>> received(port_names.size());
+    auto drain = [&]() {
+        std::vector<uint8_t> message(1024);
+        size_t message_size = 0;
+        for (size_t port_idx = 0; port_idx < inputs.size(); port_idx++)
+        {
+            while (inputs[port_idx]->try_receive(message.data(), message.size(), &message_size, nullptr) == SMIDI_RESULT_OK)
+            {
+                received[port_idx].emplace_back(message.begin(), message.begin() + message_size);
+            }
+        }
+    };
+
+    smidi::replay_options options;
+    options.speed = 0.0;
+    smidi::capture_replayer replayer(reader, output_ptrs, options);
+    const smidi::capture_replayer::clock::time_point start = smidi::capture_replayer::clock::now();
+    replayer.start(start);
+    while (!replayer.finished())
+    {
+        const smidi::capture_replayer::clock::time_point next = replayer.pump(start);
+        SMIDI_CHECK(replayer.finished() || next == start + smidi::capture_replayer::blocked_retry_interval);
+        drain();
+    }
+
+    const smidi::replay_statistics statistics = replayer.statistics();
+    SMIDI_CHECK(statistics.events == event_count);
+    SMIDI_CHECK(statistics.failed == 0);
+    SMIDI_CHECK(statistics.blocked > 0);
+
+    // Nothing was lost or reordered on any port.
+    std::vector<size_t> positions(port_names.size(), 0);
+    for (size_t event_idx = 0; event_idx < event_count; event_idx++)
+    {
+        const uint32_t port = make_port(event_idx);
+        SMIDI_CHECK(positions[port] < received[port].size());
+        SMIDI_CHECK(received[port][positions[port]++] == make_message(event_idx));
+    }
+    for (size_t port_idx = 0; port_idx < port_names.size(); port_idx++)
+    {
+        SMIDI_CHECK(positions[port_idx] == received[port_idx].size());
+    }
+}
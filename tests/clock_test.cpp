@@ -0,0 +1,123 @@
+#include "test.h"
+
+#include "smidi_ext/smidi_clock.h"
+
+#include <chrono>
+#include <cmath>
+#include <random>
+
+namespace
+{
+    using clock = smidi::clock_follower::clock;
+
+    constexpr uint8_t timing_clock[] = {0xF8};
+    constexpr uint8_t start[] = {0xFA};
+    constexpr uint8_t stop[] = {0xFC};
+
+    const clock::time_point base_time = clock::time_point() + std::chrono::hours(1);
+
+    // Clock index at 120 BPM, exactly on the grid.
+    clock::time_point clock_time(size_t index)
+    {
+        return base_time + std::chrono::nanoseconds(static_cast<int64_t>(index) * 60000000000 / (120 * 24));
+    }
+
+    // As a device time stamp would have it, whole milliseconds.
+    clock::time_point quantized_clock_time(size_t index)
+    {
+        return std::chrono::floor<std::chrono::milliseconds>(clock_time(index));
+    }
+
+    bool near_120_bpm(const smidi::clock_follower& follower)
+    {
+        return std::abs(follower.tempo() - 120.0) < 0.5;
+    }
+} // namespace
+
+SMIDI_TEST(quantized_clocks_stay_locked_through_early_and_duplicate_stamps)
+{
+    smidi::clock_follower follower;
+    follower.process(start, sizeof(start), base_time);
+    size_t clock_idx = 0;
+    for (; clock_idx < 200; clock_idx++)
+    {
+        follower.process(timing_clock, sizeof(timing_clock), quantized_clock_time(clock_idx));
+    }
+    SMIDI_CHECK(follower.locked());
+    SMIDI_CHECK(near_120_bpm(follower));
+
+    // A clock stamped a millisecond early lands before the filtered phase, then one with the same stamp again.
+    const clock::time_point early_time = quantized_clock_time(clock_idx++) - std::chrono::milliseconds(1);
+    follower.process(timing_clock, sizeof(timing_clock), early_time);
+    SMIDI_CHECK(follower.locked());
+    SMIDI_CHECK(near_120_bpm(follower));
+    follower.process(timing_clock, sizeof(timing_clock), early_time);
+    clock_idx++;
+    SMIDI_CHECK(follower.locked());
+    SMIDI_CHECK(near_120_bpm(follower));
+
+    for (; clock_idx < 300; clock_idx++)
+    {
+        follower.process(timing_clock, sizeof(timing_clock), quantized_clock_time(clock_idx));
+        SMIDI_CHECK(follower.locked());
+        SMIDI_CHECK(near_120_bpm(follower));
+    }
+
+    // Every clock counts for the position, none was taken for a lost one.
+    SMIDI_CHECK(follower.position() == 300);
+    const smidi::clock_follower_statistics statistics = follower.statistics();
+    SMIDI_CHECK(statistics.clocks == 300);
+    SMIDI_CHECK(statistics.missed == 0);
+}
+
+SMIDI_TEST(jittered_clocks_settle_on_the_average_tempo)
+{
+    smidi::clock_follower follower;
+    std::mt19937 random(1234);
+    std::uniform_int_distribution<int64_t> jitter_us(-2000, 2000);
+    follower.process(start, sizeof(start), base_time);
+    for (size_t clock_idx = 0; clock_idx < 2000; clock_idx++)
+    {
+        follower.process(timing_clock, sizeof(timing_clock), clock_time(clock_idx) + std::chrono::microseconds(jitter_us(random)));
+        if (clock_idx > 200)
+        {
+            SMIDI_CHECK(follower.locked());
+            SMIDI_CHECK(near_120_bpm(follower));
+        }
+    }
+
+    // The filter sits near the grid, so the clocks are off it by about the jitter that was added.
+    const smidi::clock_follower_statistics statistics = follower.statistics();
+    SMIDI_CHECK(statistics.missed == 0);
+    SMIDI_CHECK(statistics.jitter_rms < std::chrono::microseconds(2000));
+    SMIDI_CHECK(statistics.jitter_max < std::chrono::microseconds(5000));
+    SMIDI_CHECK(follower.position() == 2000);
+}
+
+SMIDI_TEST(timeout_and_transport_restart_the_filter)
+{
+    smidi::clock_follower follower;
+    size_t clock_idx = 0;
+    for (; clock_idx < 100; clock_idx++)
+    {
+        follower.process(timing_clock, sizeof(timing_clock), clock_time(clock_idx));
+    }
+    SMIDI_CHECK(follower.locked());
+
+    // A second without clocks, the next one starts over.
+    clock_idx += 48;
+    follower.process(timing_clock, sizeof(timing_clock), clock_time(clock_idx++));
+    SMIDI_CHECK(!follower.locked());
+    SMIDI_CHECK(follower.tempo() == 0.0);
+    for (; clock_idx < 300; clock_idx++)
+    {
+        follower.process(timing_clock, sizeof(timing_clock), clock_time(clock_idx));
+    }
+    SMIDI_CHECK(follower.locked());
+    SMIDI_CHECK(near_120_bpm(follower));
+
+    follower.process(stop, sizeof(stop), clock_time(clock_idx));
+    SMIDI_CHECK(!follower.running());
+    SMIDI_CHECK(!follower.locked());
+    SMIDI_CHECK(follower.statistics().missed == 0);
+}
@@ -0,0 +1,138 @@
+#include "test.h"
+
+#include "smidi/smidi.h"
+#include "smidi_ext/smidi_coro.h"
+
+#include <condition_variable>
+#include <deque>
+#include <fcntl.h>
+#include <mutex>
+#include <stdlib.h>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+    // Hands posted coroutines to the test thread, which resumes them one at a time.
+    class manual_executor final : public smidi::coro::executor
+    {
+      public:
+        void post(std::coroutine_handle<> handle) override
+        {
+            {
+                std::lock_guard<decltype(_mutex)> lock(_mutex);
+                _ready.push_back(handle);
+            }
+            _cv.notify_one();
+        }
+
+        void post_at(smidi::coro::clock::time_point, std::coroutine_handle<> handle) override
+        {
+            post(handle);
+        }
+
+        // Resumes the next posted coroutine, false if none was posted within a few seconds.
+        bool resume_next()
+        {
+            std::coroutine_handle<> handle;
+            {
+                std::unique_lock<decltype(_mutex)> lock(_mutex);
+                if (!_cv.wait_for(lock, std::chrono::seconds(5), [this]() { return !_ready.empty(); }))
+                {
+                    return false;
+                }
+                handle = _ready.front();
+                _ready.pop_front();
+            }
+            handle.resume();
+            return true;
+        }
+
+      private:
+        std::mutex _mutex;
+        std::condition_variable _cv;
+        std::deque<std::coroutine_handle<>> _ready;
+    };
+
+    // A rawmidi node played by a FIFO, the device disconnects when the writing end closes.
+    class fifo_directory
+    {
+      public:
+        fifo_directory()
+        {
+            char path[] = "/tmp/smidi_coro_test_XXXXXX";
+            if (mkdtemp(path) == nullptr)
+            {
+                throw std::runtime_error("Failed to create a temporary directory.");
+            }
+            _path = path;
+            _node = _path + "/midiC0D0";
+            if (mkfifo(_node.c_str(), 0600) != 0)
+            {
+                rmdir(_path.c_str());
+                throw std::runtime_error("Failed to create " + _node);
+            }
+        }
+
+        ~fifo_directory()
+        {
+            unlink(_node.c_str());
+            rmdir(_path.c_str());
+        }
+
+        const std::string& path() const noexcept
+        {
+            return _path;
+        }
+
+        const std::string& node() const noexcept
+        {
+            return _node;
+        }
+
+      private:
+        std::string _path;
+        std::string _node;
+    };
+
+    smidi::coro::task receive_until_disconnected(smidi::input_device& device, smidi::coro::executor& executor,
+                                                 std::vector<smidi::result>& results)
+    {
+        smidi::coro::async_input_device input(device, executor);
+        uint8_t message[16];
+        smidi::result result = SMIDI_RESULT_OK;
+        while (result == SMIDI_RESULT_OK)
+        {
+            result = co_await input.async_receive(message, sizeof(message));
+            results.push_back(result);
+        }
+    }
+} // namespace
+
+SMIDI_TEST(async_receive_completes_on_disconnect)
+{
+    fifo_directory directory;
+    smidi::rawmidi_options options = smidi::default_rawmidi_options;
+    options.device_directory = directory.path().c_str();
+    std::unique_ptr<smidi::system> system = smidi::create_rawmidi_system(options);
+    std::unique_ptr<smidi::input_device> device = system->create_input_device(system->input_devices()[0].name);
+
+    manual_executor executor;
+    std::vector<smidi::result> results;
+    receive_until_disconnected(*device, executor, results);
+    SMIDI_CHECK(results.empty());
+
+    int writer = open(directory.node().c_str(), O_WRONLY | O_CLOEXEC);
+    SMIDI_CHECK(writer >= 0);
+    const uint8_t note_on[] = {0x90, 0x3C, 0x64};
+    SMIDI_CHECK(write(writer, note_on, sizeof(note_on)) == static_cast<ssize_t>(sizeof(note_on)));
+    SMIDI_CHECK(executor.resume_next());
+    SMIDI_CHECK(results.size() == 1 && results[0] == SMIDI_RESULT_OK);
+
+    // The coroutine is waiting again, closing the writer unplugs the device and completes the wait.
+    close(writer);
+    SMIDI_CHECK(executor.resume_next());
+    SMIDI_CHECK(results.size() == 2 && results[1] == SMIDI_RESULT_DISCONNECTED);
+}
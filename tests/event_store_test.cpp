@@ -0,0 +1,148 @@
+#include "test.h"
+
+#include "smidi_ext/smidi_event_store.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+namespace
+{
+    // Two and a half chunks, two events per time stamp so ranges start and end between equal times.
+    constexpr size_t event_count = smidi::event_store::chunk_capacity * 5 / 2;
+
+    std::vector<uint8_t> make_message(size_t index)
+    {
+        if (index % 1000 == 999)
+        {
+            return {0xF0, 0x7D, static_cast<uint8_t>(index & 0x7F), static_cast<uint8_t>((index >> 7) & 0x7F), 0xF7};
+        }
+
+        switch (index % 4)
+        {
+        case 0:
+            return {0x90, static_cast<uint8_t>(index & 0x7F), 0x64};
+        case 1:
+            return {0x80, static_cast<uint8_t>(index & 0x7F), 0x00};
+        case 2:
+            return {0xB2, 64, static_cast<uint8_t>(index & 0x7F)};
+        default:
+            return {0xD5, static_cast<uint8_t>(index & 0x7F)};
+        }
+    }
+
+    smidi::time_stamp make_time(size_t index)
+    {
+        return static_cast<smidi::time_stamp>(index / 2);
+    }
+
+    smidi::event_store make_store()
+    {
+        smidi::event_store store;
+        for (size_t event_idx = 0; event_idx < event_count; event_idx++)
+        {
+            std::vector<uint8_t> message = make_message(event_idx);
+            store.append(make_time(event_idx), message.data(), message.size());
+        }
+        return store;
+    }
+
+    bool matches(const std::vector<uint8_t>& message, const smidi::event_filter& filter)
+    {
+        const uint8_t data1 = message.size() > 1 ? message[1] : 0;
+        return (message[0] & filter.status_mask) == filter.status && (data1 & filter.data1_mask) == filter.data1;
+    }
+} // namespace
+
+SMIDI_TEST(messages_round_trip_across_chunks)
+{
+    smidi::event_store store = make_store();
+    SMIDI_CHECK(store.size() == event_count);
+
+    std::vector<uint8_t> message(16);
+    for (size_t event_idx = 0; event_idx < event_count; event_idx++)
+    {
+        const std::vector<uint8_t> expected = make_message(event_idx);
+        SMIDI_CHECK(store.time(event_idx) == make_time(event_idx));
+        SMIDI_CHECK(store.status(event_idx) == expected[0]);
+        SMIDI_CHECK(store.message_size(event_idx) == expected.size());
+        SMIDI_CHECK(store.message(event_idx, message.data(), message.size()) == expected.size());
+        SMIDI_CHECK(std::equal(expected.begin(), expected.end(), message.begin()));
+    }
+
+    SMIDI_CHECK_THROWS(store.time(event_count), std::out_of_range);
+    SMIDI_CHECK_THROWS(store.message(999, message.data(), 4), std::invalid_argument);
+
+    const uint8_t earlier[] = {0xF8};
+    SMIDI_CHECK_THROWS(store.append(make_time(event_count - 1) - 1, earlier, sizeof(earlier)), std::invalid_argument);
+}
+
+SMIDI_TEST(lower_bound_finds_first_event_at_or_after)
+{
+    smidi::event_store store = make_store();
+    SMIDI_CHECK(store.lower_bound(-1) == 0);
+    for (size_t event_idx = 0; event_idx < event_count; event_idx += 2)
+    {
+        SMIDI_CHECK(store.lower_bound(make_time(event_idx)) == event_idx);
+    }
+    SMIDI_CHECK(store.lower_bound(make_time(event_count - 1) + 1) == event_count);
+}
+
+SMIDI_TEST(count_and_select_match_linear_scan)
+{
+    smidi::event_store store = make_store();
+    const smidi::event_filter filters[] = {
+        {0x00, 0x00, 0, 0x00},    // everything
+        {0x90, 0xF0, 0, 0x00},    // every note on
+        {0xB2, 0xFF, 64, 0x7F},   // sustain on channel 3
+        {0xF0, 0xFF, 0x7D, 0x7F}, // SysEx of the non-commercial ID
+        {0xA0, 0xF0, 0, 0x00},    // nothing
+    };
+
+    const smidi::time_stamp ranges[][2] = {{0, make_time(event_count)}, {1000, 1001}, {2047, 6000}, {5000, 5000}, {3000, 2000}};
+    for (const smidi::event_filter& filter : filters)
+    {
+        for (const auto& range : ranges)
+        {
+            std::vector<size_t> expected;
+            for (size_t event_idx = 0; event_idx < event_count; event_idx++)
+            {
+                const smidi::time_stamp time = make_time(event_idx);
+                if (time >= range[0] && time < range[1] && matches(make_message(event_idx), filter))
+                {
+                    expected.push_back(event_idx);
+                }
+            }
+
+            std::vector<size_t> selected;
+            store.select(range[0], range[1], filter, selected);
+            SMIDI_CHECK(selected == expected);
+            SMIDI_CHECK(store.count(range[0], range[1], filter) == expected.size());
+        }
+    }
+}
+
+SMIDI_TEST(drop_before_releases_whole_chunks)
+{
+    smidi::event_store store = make_store();
+
+    // The first chunk ends at time 2047, dropping up to it keeps everything.
+    SMIDI_CHECK(store.drop_before(make_time(smidi::event_store::chunk_capacity - 1)) == 0);
+
+    const size_t dropped = store.drop_before(make_time(smidi::event_store::chunk_capacity) + 10);
+    SMIDI_CHECK(dropped == smidi::event_store::chunk_capacity);
+    SMIDI_CHECK(store.size() == event_count - dropped);
+    SMIDI_CHECK(store.time(0) == make_time(dropped));
+    SMIDI_CHECK(store.status(0) == make_message(dropped)[0]);
+    SMIDI_CHECK(store.lower_bound(make_time(dropped) + 10) == 20);
+
+    // Appending after a drop and moving keep indices consistent.
+    const uint8_t stop[] = {0xFC};
+    store.append(make_time(event_count), stop, sizeof(stop));
+    smidi::event_store moved = std::move(store);
+    SMIDI_CHECK(moved.size() == event_count - dropped + 1);
+    SMIDI_CHECK(moved.status(moved.size() - 1) == 0xFC);
+
+    SMIDI_CHECK(moved.drop_before(make_time(event_count) + 1) == event_count - dropped + 1);
+    SMIDI_CHECK(moved.empty());
+}
@@ -0,0 +1,173 @@
+#include "test.h"
+
+#include "smidi_ext/smidi_merge.h"
+
+#include <chrono>
+#include <vector>
+
+namespace
+{
+    using message = std::vector<uint8_t>;
+    using clock = smidi::input_merge::clock;
+
+    struct popped
+    {
+        size_t source;
+        clock::time_point time;
+        message data;
+    };
+
+    void push(smidi::input_merge& merge, size_t source, const message& data, clock::time_point time)
+    {
+        SMIDI_CHECK(merge.push(source, data.data(), data.size(), time));
+    }
+
+    // Pops every message released at now.
+    std::vector<popped> pop_all(smidi::input_merge& merge, clock::time_point now)
+    {
+        std::vector<popped> result;
+        uint8_t data[16];
+        smidi::merged_event event;
+        while (merge.try_pop(now, data, sizeof(data), &event) == SMIDI_RESULT_OK)
+        {
+            result.push_back({event.source, event.time, message(data, data + event.size)});
+        }
+        return result;
+    }
+} // namespace
+
+SMIDI_TEST(messages_of_all_sources_are_released_in_time_order)
+{
+    const clock::time_point start = clock::now();
+    const auto at = [&](int ms) { return start + std::chrono::milliseconds(ms); };
+
+    smidi::input_merge merge(3);
+    push(merge, 0, {0x90, 60, 100}, at(1));
+    push(merge, 0, {0x80, 60, 0}, at(4));
+    push(merge, 1, {0x91, 62, 100}, at(2));
+    push(merge, 1, {0x81, 62, 0}, at(3));
+    push(merge, 2, {0x92, 64, 100}, at(4));
+    push(merge, 2, {0x82, 64, 0}, at(6));
+
+    // Every source has a message pending, so the earliest ones go out without waiting for the reorder window.
+    const std::vector<popped> early = pop_all(merge, at(0));
+    SMIDI_CHECK(early.size() == 3);
+    SMIDI_CHECK(early[0].source == 0 && early[0].time == at(1));
+    SMIDI_CHECK(early[1].source == 1 && early[1].time == at(2));
+    SMIDI_CHECK(early[2].source == 1 && early[2].time == at(3));
+    SMIDI_CHECK(early[2].data == message({0x81, 62, 0}));
+
+    // Source 1 is empty now, the rest waits for the window. The tie at 4 ms goes to the lower source.
+    SMIDI_CHECK(merge.next_release_time() == at(4) + smidi::input_merge_options().reorder_window);
+    const std::vector<popped> rest = pop_all(merge, at(100));
+    SMIDI_CHECK(rest.size() == 3);
+    SMIDI_CHECK(rest[0].source == 0 && rest[0].time == at(4));
+    SMIDI_CHECK(rest[1].source == 2 && rest[1].time == at(4));
+    SMIDI_CHECK(rest[2].source == 2 && rest[2].time == at(6));
+
+    const smidi::input_merge_statistics statistics = merge.statistics();
+    SMIDI_CHECK(statistics.merged == 6);
+    SMIDI_CHECK(statistics.late == 0);
+}
+
+SMIDI_TEST(messages_wait_for_the_reorder_window_and_late_ones_keep_the_order)
+{
+    const clock::time_point start = clock::now();
+    smidi::input_merge_options options;
+    options.reorder_window = std::chrono::milliseconds(5);
+    smidi::input_merge merge(2, options);
+
+    push(merge, 0, {0x90, 60, 100}, start);
+    SMIDI_CHECK(merge.next_release_time() == start + options.reorder_window);
+    SMIDI_CHECK(pop_all(merge, start + std::chrono::milliseconds(4)).empty());
+
+    // An earlier message of the other source arriving within the window still goes first.
+    push(merge, 1, {0x91, 62, 100}, start - std::chrono::milliseconds(1));
+    SMIDI_CHECK(merge.next_release_time() == start - std::chrono::milliseconds(1));
+    std::vector<popped> released = pop_all(merge, start + std::chrono::milliseconds(4));
+    SMIDI_CHECK(released.size() == 1);
+    SMIDI_CHECK(released[0].source == 1);
+    released = pop_all(merge, start + options.reorder_window);
+    SMIDI_CHECK(released.size() == 1);
+    SMIDI_CHECK(released[0].source == 0 && released[0].time == start);
+
+    // One arriving after a later message was released is stamped with that message's time, to keep the order.
+    push(merge, 1, {0x81, 62, 0}, start - std::chrono::milliseconds(2));
+    released = pop_all(merge, start + options.reorder_window);
+    SMIDI_CHECK(released.size() == 1);
+    SMIDI_CHECK(released[0].source == 1 && released[0].time == start);
+    SMIDI_CHECK(merge.statistics().late == 1);
+    SMIDI_CHECK(merge.next_release_time() == clock::time_point::max());
+}
+
+SMIDI_TEST(duplicates_of_other_sources_within_the_window_are_dropped)
+{
+    const clock::time_point start = clock::now();
+    const auto at = [&](int us) { return start + std::chrono::microseconds(us); };
+
+    smidi::input_merge_options options;
+    options.dedupe = true;
+    options.dedupe_window = std::chrono::milliseconds(2);
+    smidi::input_merge merge(2, options);
+
+    // The same note on reaching the host on both paths, once more within the window on the second path.
+    push(merge, 0, {0x90, 60, 100}, at(0));
+    push(merge, 1, {0x90, 60, 100}, at(300));
+    // A source repeating a message keeps it, e.g. two note offs for the same key.
+    push(merge, 0, {0x80, 60, 0}, at(500));
+    push(merge, 0, {0x80, 60, 0}, at(600));
+    // A different message of the other source is kept.
+    push(merge, 1, {0x80, 60, 64}, at(700));
+    // The same message again after the window has passed is a new one.
+    push(merge, 1, {0x90, 60, 100}, at(5000));
+
+    const std::vector<popped> released = pop_all(merge, at(100000));
+    SMIDI_CHECK(released.size() == 5);
+    SMIDI_CHECK(released[0].source == 0 && released[0].time == at(0));
+    SMIDI_CHECK(released[1].source == 0 && released[1].time == at(500));
+    SMIDI_CHECK(released[2].source == 0 && released[2].time == at(600));
+    SMIDI_CHECK(released[3].source == 1 && released[3].data == message({0x80, 60, 64}));
+    SMIDI_CHECK(released[4].source == 1 && released[4].time == at(5000));
+
+    const smidi::input_merge_statistics statistics = merge.statistics();
+    SMIDI_CHECK(statistics.duplicates == 1);
+    SMIDI_CHECK(statistics.merged == 5);
+}
+
+SMIDI_TEST(duplicates_are_kept_without_dedupe)
+{
+    const clock::time_point start = clock::now();
+    smidi::input_merge merge(2);
+    push(merge, 0, {0x90, 60, 100}, start);
+    push(merge, 1, {0x90, 60, 100}, start);
+
+    const std::vector<popped> released = pop_all(merge, start + std::chrono::seconds(1));
+    SMIDI_CHECK(released.size() == 2);
+    SMIDI_CHECK(released[0].source == 0);
+    SMIDI_CHECK(released[1].source == 1);
+    SMIDI_CHECK(merge.statistics().duplicates == 0);
+}
+
+SMIDI_TEST(full_sources_and_small_buffers_keep_messages_pending)
+{
+    const clock::time_point start = clock::now();
+    smidi::input_merge_options options;
+    options.source_capacity = 2;
+    smidi::input_merge merge(1, options);
+
+    const message sysex = {0xF0, 0x7D, 0x01, 0x02, 0x03, 0xF7};
+    push(merge, 0, sysex, start);
+    push(merge, 0, {0xF8}, start);
+    SMIDI_CHECK(!merge.push(0, sysex.data(), sysex.size(), start));
+    SMIDI_CHECK(merge.statistics().overflows == 1);
+
+    uint8_t data[3];
+    smidi::merged_event event;
+    SMIDI_CHECK(merge.try_pop(start, data, sizeof(data), &event) == SMIDI_RESULT_BUFFER_TOO_SMALL);
+    SMIDI_CHECK(event.size == sysex.size());
+
+    const std::vector<popped> released = pop_all(merge, start);
+    SMIDI_CHECK(released.size() == 2);
+    SMIDI_CHECK(released[0].data == sysex);
+    SMIDI_CHECK(released[1].data == message({0xF8}));
+}
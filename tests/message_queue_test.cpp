@@ -0,0 +1,168 @@
+#include "test.h"
+
+#include "message_queue.h"
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    smidi::message_queue make_queue(size_t capacity, smidi::overflow_policy policy)
+    {
+        return smidi::message_queue({static_cast<unsigned int>(capacity), policy});
+    }
+
+    void push(smidi::message_queue& queue, std::vector<uint8_t> message, smidi::time_stamp stamp = 0)
+    {
+        queue.push(message.data(), message.size(), stamp);
+    }
+
+    std::vector<uint8_t> pop(smidi::message_queue& queue, smidi::time_stamp* stamp = nullptr)
+    {
+        std::vector<uint8_t> message(16);
+        message.resize(queue.pop(message.data(), message.size(), stamp));
+        return message;
+    }
+
+    std::vector<uint8_t> note_on(uint8_t key)
+    {
+        return {0x90, key, 0x40};
+    }
+
+    // Long enough for a thread to get to its wait, the checks below only fail if it did not wait at all.
+    void let_thread_block()
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+} // namespace
+
+SMIDI_TEST(drop_oldest_keeps_the_newest_messages)
+{
+    smidi::message_queue queue = make_queue(4, SMIDI_OVERFLOW_POLICY_DROP_OLDEST);
+    for (uint8_t key = 0; key < 6; key++)
+    {
+        push(queue, note_on(key), key);
+    }
+
+    for (uint8_t key = 2; key < 6; key++)
+    {
+        smidi::time_stamp stamp = 0;
+        SMIDI_CHECK(pop(queue, &stamp) == note_on(key));
+        SMIDI_CHECK(stamp == key);
+    }
+
+    const smidi::queue_statistics statistics = queue.statistics();
+    SMIDI_CHECK(statistics.received == 6);
+    SMIDI_CHECK(statistics.dropped == 2);
+    SMIDI_CHECK(statistics.high_water_mark == 4);
+    SMIDI_CHECK(statistics.size == 0);
+}
+
+SMIDI_TEST(drop_newest_keeps_the_oldest_messages)
+{
+    smidi::message_queue queue = make_queue(4, SMIDI_OVERFLOW_POLICY_DROP_NEWEST);
+    for (uint8_t key = 0; key < 6; key++)
+    {
+        push(queue, note_on(key));
+    }
+
+    for (uint8_t key = 0; key < 4; key++)
+    {
+        SMIDI_CHECK(pop(queue) == note_on(key));
+    }
+    SMIDI_CHECK(queue.try_pop(nullptr, 0, nullptr, nullptr) == SMIDI_RESULT_NO_MESSAGE);
+    SMIDI_CHECK(queue.statistics().dropped == 2);
+}
+
+SMIDI_TEST(block_waits_for_room)
+{
+    smidi::message_queue queue = make_queue(2, SMIDI_OVERFLOW_POLICY_BLOCK);
+    push(queue, note_on(0));
+    push(queue, note_on(1));
+
+    // Producers that must not wait get the message back.
+    const std::vector<uint8_t> refused = note_on(2);
+    SMIDI_CHECK(!queue.try_push(refused.data(), refused.size(), 0));
+    SMIDI_CHECK(queue.statistics().dropped == 1);
+
+    std::atomic<bool> pushed{false};
+    std::thread producer([&]() {
+        push(queue, note_on(3));
+        pushed = true;
+    });
+    let_thread_block();
+    SMIDI_CHECK(!pushed);
+
+    SMIDI_CHECK(pop(queue) == note_on(0));
+    producer.join();
+    SMIDI_CHECK(pushed);
+    SMIDI_CHECK(pop(queue) == note_on(1));
+    SMIDI_CHECK(pop(queue) == note_on(3));
+    SMIDI_CHECK(queue.statistics().dropped == 1);
+}
+
+SMIDI_TEST(coalesce_replaces_the_queued_value)
+{
+    smidi::message_queue queue = make_queue(3, SMIDI_OVERFLOW_POLICY_COALESCE);
+    push(queue, {0xB0, 7, 1}, 1);
+    push(queue, note_on(60), 2);
+    push(queue, {0xB0, 7, 2}, 3);
+
+    // A full queue folds the new value into the newest queued message of the same controller, which keeps its place
+    // and time stamp.
+    push(queue, {0xB0, 7, 3}, 4);
+    SMIDI_CHECK(queue.size() == 3);
+    SMIDI_CHECK(queue.statistics().coalesced == 1);
+
+    // Messages without a value to replace drop the oldest.
+    push(queue, note_on(61), 5);
+    SMIDI_CHECK(queue.statistics().dropped == 1);
+
+    smidi::time_stamp stamp = 0;
+    SMIDI_CHECK(pop(queue, &stamp) == note_on(60));
+    SMIDI_CHECK(stamp == 2);
+    SMIDI_CHECK(pop(queue, &stamp) == std::vector<uint8_t>({0xB0, 7, 3}));
+    SMIDI_CHECK(stamp == 3);
+    SMIDI_CHECK(pop(queue, &stamp) == note_on(61));
+    SMIDI_CHECK(stamp == 5);
+}
+
+SMIDI_TEST(close_wakes_blocked_senders_and_receivers)
+{
+    smidi::message_queue full = make_queue(1, SMIDI_OVERFLOW_POLICY_BLOCK);
+    push(full, note_on(0));
+    std::thread producer([&]() { push(full, note_on(1)); });
+
+    smidi::message_queue empty = make_queue(1, SMIDI_OVERFLOW_POLICY_BLOCK);
+    std::atomic<bool> disconnected{false};
+    std::thread consumer([&]() {
+        try
+        {
+            pop(empty);
+        }
+        catch (const std::runtime_error&)
+        {
+            disconnected = true;
+        }
+    });
+
+    let_thread_block();
+    full.close();
+    empty.close();
+    producer.join();
+    consumer.join();
+    SMIDI_CHECK(disconnected);
+
+    // The waiting message is dropped, the queued one is still delivered before the disconnect.
+    SMIDI_CHECK(full.statistics().dropped == 1);
+    SMIDI_CHECK(pop(full) == note_on(0));
+    SMIDI_CHECK(full.try_pop(nullptr, 0, nullptr, nullptr) == SMIDI_RESULT_DISCONNECTED);
+    SMIDI_CHECK_THROWS(pop(full), std::runtime_error);
+
+    // Pushing after the close is dropped too.
+    push(full, note_on(2));
+    SMIDI_CHECK(full.try_pop(nullptr, 0, nullptr, nullptr) == SMIDI_RESULT_DISCONNECTED);
+}
@@ -0,0 +1,148 @@
+#include "test.h"
+
+#include "smidi_ext/smidi_mtc.h"
+
+#include <cmath>
+#include <stdexcept>
+
+namespace
+{
+    constexpr smidi::mtc_frame_rate rates[] = {
+        smidi::mtc_frame_rate::fps_24,
+        smidi::mtc_frame_rate::fps_25,
+        smidi::mtc_frame_rate::fps_29_97_drop,
+        smidi::mtc_frame_rate::fps_30,
+    };
+
+    bool operator==(const smidi::smpte_time& a, const smidi::smpte_time& b)
+    {
+        return a.hours == b.hours && a.minutes == b.minutes && a.seconds == b.seconds && a.frames == b.frames && a.rate == b.rate;
+    }
+
+    // Hands every message the generator sends straight to a decoder, at the time the generator was pumped.
+    class decoding_output_device : public smidi::output_device
+    {
+      public:
+        size_t send(const uint8_t* data, size_t size) override
+        {
+            try_send(data, size);
+            return size;
+        }
+
+        smidi::result try_send(const uint8_t* data, size_t size) noexcept override
+        {
+            decoder.process(data, size, now);
+            messages++;
+            return SMIDI_RESULT_OK;
+        }
+
+        smidi::mtc_decoder decoder;
+        smidi::mtc_decoder::clock::time_point now;
+        size_t messages = 0;
+    };
+} // namespace
+
+SMIDI_TEST(frames_round_trip_for_every_rate)
+{
+    for (smidi::mtc_frame_rate rate : rates)
+    {
+        // The first two hours frame by frame, covering every minute boundary.
+        const uint64_t frame_count = static_cast<uint64_t>(std::ceil(smidi::frames_per_second(rate) * 2 * 60 * 60));
+        for (uint64_t frame = 0; frame < frame_count; frame++)
+        {
+            const smidi::smpte_time time = smidi::smpte_from_frames(frame, rate);
+            SMIDI_CHECK(time.rate == rate);
+            SMIDI_CHECK(smidi::smpte_to_frames(time) == frame);
+        }
+    }
+}
+
+SMIDI_TEST(drop_frame_skips_frame_numbers)
+{
+    constexpr smidi::mtc_frame_rate rate = smidi::mtc_frame_rate::fps_29_97_drop;
+
+    // 00:00:59;29 is followed by 00:01:00;02, but 00:09:59;29 by 00:10:00;00.
+    const smidi::smpte_time before_minute = {0, 0, 59, 29, rate};
+    const smidi::smpte_time after_minute = {0, 1, 0, 2, rate};
+    SMIDI_CHECK(smidi::smpte_from_frames(smidi::smpte_to_frames(before_minute) + 1, rate) == after_minute);
+
+    const smidi::smpte_time before_tenth_minute = {0, 9, 59, 29, rate};
+    const smidi::smpte_time after_tenth_minute = {0, 10, 0, 0, rate};
+    SMIDI_CHECK(smidi::smpte_from_frames(smidi::smpte_to_frames(before_tenth_minute) + 1, rate) == after_tenth_minute);
+
+    // Ten minutes of drop frame time code hold exactly 17982 frames.
+    SMIDI_CHECK(smidi::smpte_to_frames(after_tenth_minute) == 17982);
+}
+
+SMIDI_TEST(full_frame_round_trip)
+{
+    for (smidi::mtc_frame_rate rate : rates)
+    {
+        const smidi::smpte_time time = {1, 2, 3, 4, rate};
+        uint8_t message[smidi::mtc_full_frame_size];
+        smidi::make_mtc_full_frame(time, message, 0x10);
+        SMIDI_CHECK(message[0] == 0xF0 && message[2] == 0x10 && message[smidi::mtc_full_frame_size - 1] == 0xF7);
+        SMIDI_CHECK(smidi::is_mtc_full_frame(message, sizeof(message)));
+        SMIDI_CHECK(!smidi::is_mtc_full_frame(message, sizeof(message) - 1));
+
+        smidi::mtc_decoder decoder;
+        const smidi::mtc_decoder::clock::time_point now = smidi::mtc_decoder::clock::now();
+        SMIDI_CHECK(!decoder.locked());
+        decoder.process(message, sizeof(message), now);
+        SMIDI_CHECK(decoder.locked());
+        SMIDI_CHECK(!decoder.running(now));
+        SMIDI_CHECK(decoder.rate() == rate);
+        SMIDI_CHECK(decoder.position(now) == time);
+        SMIDI_CHECK(decoder.statistics().full_frames == 1);
+    }
+}
+
+SMIDI_TEST(decoder_follows_generator)
+{
+    for (smidi::mtc_frame_rate rate : rates)
+    {
+        decoding_output_device output;
+        smidi::mtc_generator_options options;
+        options.rate = rate;
+        smidi::mtc_generator generator(output, options);
+
+        // Two seconds across the hour.
+        const smidi::smpte_time start_position = {0, 59, 59, 0, rate};
+        const uint64_t start_frame = smidi::smpte_to_frames(start_position);
+        SMIDI_CHECK_THROWS(generator.locate({0, 0, 0, 0, rate == rates[0] ? rates[1] : rates[0]}), std::invalid_argument);
+        generator.locate(start_position);
+        SMIDI_CHECK(output.decoder.position(output.now) == start_position);
+
+        const smidi::mtc_generator::clock::time_point start = smidi::mtc_generator::clock::time_point() + std::chrono::hours(1);
+        generator.start(start);
+        SMIDI_CHECK(generator.running());
+        SMIDI_CHECK_THROWS(generator.locate(start_position), std::runtime_error);
+
+        const uint64_t quarter_frame_count = static_cast<uint64_t>(smidi::frames_per_second(rate) * 4 * 2);
+        output.now = start;
+        for (uint64_t quarter_frame = 0; quarter_frame < quarter_frame_count; quarter_frame++)
+        {
+            const smidi::mtc_generator::clock::time_point next = generator.pump(output.now);
+            SMIDI_CHECK(output.messages == quarter_frame + 2);
+
+            // Once a whole time code arrived, the decoder is on the frame the generator plays.
+            if (quarter_frame >= 7)
+            {
+                SMIDI_CHECK(output.decoder.locked());
+                SMIDI_CHECK(output.decoder.running(output.now));
+                SMIDI_CHECK(output.decoder.position(output.now) == smidi::smpte_from_frames(start_frame + quarter_frame / 4, rate));
+            }
+            output.now = next;
+        }
+
+        const smidi::mtc_decoder_statistics statistics = output.decoder.statistics();
+        SMIDI_CHECK(statistics.quarter_frames == quarter_frame_count);
+        SMIDI_CHECK(statistics.dropouts == 0);
+        SMIDI_CHECK(statistics.resyncs == 0);
+        SMIDI_CHECK(generator.statistics().late == 0);
+
+        generator.stop();
+        SMIDI_CHECK(generator.pump(output.now) == smidi::mtc_generator::clock::time_point::max());
+        SMIDI_CHECK(generator.position() == smidi::smpte_from_frames(start_frame + quarter_frame_count / 4, rate));
+    }
+}
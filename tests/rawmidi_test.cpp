@@ -0,0 +1,197 @@
+#include "test.h"
+
+#include "smidi/smidi_static.h"
+
+#include <atomic>
+#include <chrono>
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+    // Scratch directory standing in for /dev/snd, regular files named like device nodes play the devices.
+    class device_directory
+    {
+      public:
+        device_directory()
+        {
+            char path[] = "/tmp/smidi_rawmidi_test_XXXXXX";
+            if (mkdtemp(path) == nullptr)
+            {
+                throw std::runtime_error("Failed to create a temporary directory.");
+            }
+            _path = path;
+        }
+
+        ~device_directory()
+        {
+            if (DIR* directory = opendir(_path.c_str()))
+            {
+                while (dirent* entry = readdir(directory))
+                {
+                    if (entry->d_name[0] != '.')
+                    {
+                        unlink((_path + "/" + entry->d_name).c_str());
+                    }
+                }
+                closedir(directory);
+            }
+            rmdir(_path.c_str());
+        }
+
+        const std::string& path() const noexcept
+        {
+            return _path;
+        }
+
+        // Returns the file path, the device node name is the file name.
+        std::string add(const std::string& name, const std::vector<uint8_t>& contents = std::vector<uint8_t>())
+        {
+            std::string file_path = _path + "/" + name;
+            int fd = open(file_path.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0644);
+            if (fd < 0 || (!contents.empty() && write(fd, contents.data(), contents.size()) != static_cast<ssize_t>(contents.size())))
+            {
+                throw std::runtime_error("Failed to create " + file_path);
+            }
+            close(fd);
+            return file_path;
+        }
+
+        void remove(const std::string& name)
+        {
+            unlink((_path + "/" + name).c_str());
+        }
+
+      private:
+        std::string _path;
+    };
+
+    template <typename condition_type>
+    bool wait_for(condition_type&& condition)
+    {
+        const auto end = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (!condition())
+        {
+            if (std::chrono::steady_clock::now() >= end)
+            {
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        return true;
+    }
+
+    std::unique_ptr<smidi::system> create_system(const device_directory& directory)
+    {
+        smidi::rawmidi_options options = smidi::default_rawmidi_options;
+        options.device_directory = directory.path().c_str();
+        return smidi::create_rawmidi_system(options);
+    }
+
+    std::vector<uint8_t> read_file(const std::string& path)
+    {
+        std::vector<uint8_t> contents(256);
+        int fd = open(path.c_str(), O_RDONLY);
+        ssize_t size = fd >= 0 ? read(fd, contents.data(), contents.size()) : -1;
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        contents.resize(size > 0 ? static_cast<size_t>(size) : 0);
+        return contents;
+    }
+} // namespace
+
+SMIDI_TEST(hotplug_reports_added_and_removed_nodes)
+{
+    device_directory directory;
+    directory.add("midiC0D0");
+    std::unique_ptr<smidi::system> system = create_system(directory);
+    SMIDI_CHECK(system->input_devices().size() == 1);
+    SMIDI_CHECK(system->output_devices().size() == 1);
+
+    std::atomic<unsigned int> notifications{0};
+    system->set_device_change_callback([&]() { notifications++; });
+
+    // Files that do not look like rawmidi nodes are ignored.
+    directory.add("controlC0");
+    directory.add("midiC1D2");
+    SMIDI_CHECK(wait_for([&]() { return notifications > 0; }));
+
+    // Lists only change on refresh.
+    SMIDI_CHECK(system->input_devices().size() == 1);
+    std::vector<smidi::device_change> changes = system->refresh();
+    SMIDI_CHECK(changes.size() == 2);
+    for (const smidi::device_change& change : changes)
+    {
+        SMIDI_CHECK(change.type == SMIDI_DEVICE_CHANGE_ADDED);
+    }
+    SMIDI_CHECK(changes[0].input != changes[1].input);
+    SMIDI_CHECK(system->input_devices().size() == 2);
+    SMIDI_CHECK(system->output_devices().size() == 2);
+    SMIDI_CHECK(system->refresh().empty());
+
+    notifications = 0;
+    directory.remove("midiC1D2");
+    SMIDI_CHECK(wait_for([&]() { return notifications > 0; }));
+    changes = system->refresh();
+    SMIDI_CHECK(changes.size() == 2);
+    for (const smidi::device_change& change : changes)
+    {
+        SMIDI_CHECK(change.type == SMIDI_DEVICE_CHANGE_REMOVED);
+        SMIDI_CHECK(std::string(change.device_info.name) != system->input_devices()[0].name);
+    }
+    SMIDI_CHECK(system->input_devices().size() == 1);
+    SMIDI_CHECK(system->output_devices().size() == 1);
+
+    system->set_device_change_callback(smidi::device_change_callback());
+}
+
+SMIDI_TEST(input_reports_disconnect_after_draining)
+{
+    device_directory directory;
+    directory.add("midiC0D0", {0x90, 0x3C, 0x64});
+    std::unique_ptr<smidi::system> system = create_system(directory);
+    std::unique_ptr<smidi::rawmidi::input_device> input = smidi::rawmidi::create_input_device(*system, system->input_devices()[0].name);
+
+    // The end of a regular file reads like an unplugged device: queued messages first, then the disconnect.
+    uint8_t message[8];
+    smidi::time_stamp time_stamp = 0;
+    SMIDI_CHECK(input->receive(message, sizeof(message), &time_stamp) == 3);
+    SMIDI_CHECK(message[0] == 0x90 && message[1] == 0x3C && message[2] == 0x64);
+    SMIDI_CHECK_THROWS(input->receive(message, sizeof(message), &time_stamp), std::runtime_error);
+
+    size_t message_size = 0;
+    SMIDI_CHECK(input->try_receive(message, sizeof(message), &message_size, &time_stamp) == SMIDI_RESULT_DISCONNECTED);
+}
+
+SMIDI_TEST(output_running_status_refreshes_status)
+{
+    device_directory directory;
+    const std::string path = directory.add("midiC0D0");
+    std::unique_ptr<smidi::system> system = create_system(directory);
+
+    smidi::device_options options = smidi::default_device_options;
+    options.running_status = 1;
+    options.running_status_refresh_interval = 2;
+    std::unique_ptr<smidi::rawmidi::output_device> output =
+        smidi::rawmidi::create_output_device(*system, system->output_devices()[0].name, options);
+
+    uint8_t note_on[3] = {0x90, 0x3C, 0x64};
+    for (uint8_t note = 0x3C; note < 0x40; note++)
+    {
+        note_on[1] = note;
+        SMIDI_CHECK(output->try_send(note_on, sizeof(note_on)) == SMIDI_RESULT_OK);
+    }
+    SMIDI_CHECK(output->send(note_on, sizeof(note_on)) == sizeof(note_on));
+    output.reset();
+
+    // The status byte is left out while it repeats and sent again after every two omissions.
+    const std::vector<uint8_t> expected = {0x90, 0x3C, 0x64, 0x3D, 0x64, 0x3E, 0x64, 0x90, 0x3F, 0x64, 0x3F, 0x64};
+    SMIDI_CHECK(read_file(path) == expected);
+}
@@ -0,0 +1,277 @@
+#include "test.h"
+
+#include "smidi/smidi.h"
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <netinet/in.h>
+#include <poll.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+    using clock = std::chrono::steady_clock;
+    constexpr auto timeout = std::chrono::seconds(5);
+
+    sockaddr_in loopback_address(uint16_t port)
+    {
+        sockaddr_in address;
+        memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = htons(port);
+        return address;
+    }
+
+    // Stands between an initiating session and the session it invites, on a control and data port pair of its own.
+    // Forwards everything in both directions, counts the clock synchronization exchanges and drops one RTP packet of
+    // the initiator on request.
+    class relay
+    {
+      public:
+        relay(uint16_t control_port, uint16_t responder_control_port)
+        {
+            for (size_t port_idx = 0; port_idx < 2; port_idx++)
+            {
+                _sockets[port_idx] = socket(AF_INET, SOCK_DGRAM, 0);
+                sockaddr_in address = loopback_address(static_cast<uint16_t>(control_port + port_idx));
+                if (_sockets[port_idx] < 0 || bind(_sockets[port_idx], reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+                {
+                    throw std::runtime_error("Failed to bind relay port " + std::to_string(control_port + port_idx));
+                }
+                _responders[port_idx] = loopback_address(static_cast<uint16_t>(responder_control_port + port_idx));
+            }
+            _thread = std::thread([this]() { run(); });
+        }
+
+        ~relay()
+        {
+            _running = false;
+            _thread.join();
+            close(_sockets[0]);
+            close(_sockets[1]);
+        }
+
+        // Drops the next RTP MIDI packet of the initiator.
+        void drop_next_packet()
+        {
+            _drop_next = true;
+        }
+
+        bool dropped() const
+        {
+            return _dropped;
+        }
+
+        // Synchronization packets seen with count 0, 1 and 2.
+        unsigned int synchronizations(size_t count) const
+        {
+            return _synchronizations[count];
+        }
+
+      private:
+        void run()
+        {
+            std::vector<uint8_t> buffer(65536);
+            sockaddr_in initiators[2];
+            memset(initiators, 0, sizeof(initiators));
+            while (_running)
+            {
+                pollfd fds[2] = {
+                    {_sockets[0], POLLIN, 0},
+                    {_sockets[1], POLLIN, 0},
+                };
+                if (poll(fds, 2, 10) <= 0)
+                {
+                    continue;
+                }
+
+                for (size_t port_idx = 0; port_idx < 2; port_idx++)
+                {
+                    if ((fds[port_idx].revents & POLLIN) == 0)
+                    {
+                        continue;
+                    }
+
+                    sockaddr_in from;
+                    socklen_t from_size = sizeof(from);
+                    ssize_t received = recvfrom(_sockets[port_idx], buffer.data(), buffer.size(), 0, reinterpret_cast<sockaddr*>(&from), &from_size);
+                    if (received <= 0)
+                    {
+                        continue;
+                    }
+
+                    const bool from_responder = from.sin_port == _responders[port_idx].sin_port;
+                    const bool session_command = received >= 4 && buffer[0] == 0xFF && buffer[1] == 0xFF;
+                    if (session_command && received >= 9 && buffer[2] == 'C' && buffer[3] == 'K' && buffer[8] <= 2)
+                    {
+                        _synchronizations[buffer[8]]++;
+                    }
+
+                    if (!from_responder)
+                    {
+                        initiators[port_idx] = from;
+                        if (port_idx == 1 && !session_command && _drop_next.exchange(false))
+                        {
+                            _dropped = true;
+                            continue;
+                        }
+                    }
+
+                    const sockaddr_in& to = from_responder ? initiators[port_idx] : _responders[port_idx];
+                    sendto(_sockets[port_idx], buffer.data(), static_cast<size_t>(received), 0, reinterpret_cast<const sockaddr*>(&to), sizeof(to));
+                }
+            }
+        }
+
+        int _sockets[2] = {-1, -1};
+        sockaddr_in _responders[2];
+        std::atomic<bool> _running{true};
+        std::atomic<bool> _drop_next{false};
+        std::atomic<bool> _dropped{false};
+        std::atomic<unsigned int> _synchronizations[3] = {};
+        std::thread _thread;
+    };
+
+    template <typename condition_type>
+    bool wait_for(condition_type&& condition)
+    {
+        const clock::time_point end = clock::now() + timeout;
+        while (!condition())
+        {
+            if (clock::now() >= end)
+            {
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        return true;
+    }
+
+    bool has_device(smidi::system& system, const std::string& name)
+    {
+        system.refresh();
+        for (const smidi::device_info& device : system.input_devices())
+        {
+            if (name == device.name)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::vector<uint8_t> receive(smidi::input_device& device)
+    {
+        std::vector<uint8_t> message(16);
+        size_t message_size = 0;
+        wait_for([&]() { return device.try_receive(message.data(), message.size(), &message_size, nullptr) == SMIDI_RESULT_OK; });
+        message.resize(message_size);
+        return message;
+    }
+
+    // A responder session and an initiator session inviting it through a relay, on ports apart per process and per test
+    // so concurrent test runs do not collide.
+    struct connected_sessions
+    {
+        connected_sessions(size_t test_idx)
+            : base_port(static_cast<uint16_t>(20000 + (getpid() % 1000) * 16 + test_idx * 8))
+            , peer("127.0.0.1:" + std::to_string(base_port + 4))
+            , link(static_cast<uint16_t>(base_port + 4), base_port)
+        {
+            smidi::rtp_midi_options responder_options = smidi::default_rtp_midi_options;
+            responder_options.session_name = "responder";
+            responder_options.control_port = base_port;
+            responder_options.packing_interval_us = 0;
+            responder = smidi::create_rtp_midi_system(responder_options);
+
+            const char* peers[] = {peer.c_str()};
+            smidi::rtp_midi_options initiator_options = responder_options;
+            initiator_options.session_name = "initiator";
+            initiator_options.control_port = static_cast<uint16_t>(base_port + 2);
+            initiator_options.peers = peers;
+            initiator_options.peer_count = 1;
+            initiator = smidi::create_rtp_midi_system(initiator_options);
+        }
+
+        // Both sides list the other once the invitations on the control and data ports went through.
+        bool connect()
+        {
+            return wait_for([&]() { return has_device(*initiator, "responder") && has_device(*responder, "initiator"); });
+        }
+
+        const uint16_t base_port;
+        const std::string peer;
+        relay link;
+        std::unique_ptr<smidi::system> responder;
+        std::unique_ptr<smidi::system> initiator;
+    };
+} // namespace
+
+SMIDI_TEST(sessions_connect_synchronize_and_recover_lost_packets)
+{
+    connected_sessions sessions(0);
+    SMIDI_CHECK(sessions.connect());
+
+    // The initiator starts the clock synchronization right after connecting: CK0, CK1 back and CK2 to finish.
+    relay& link = sessions.link;
+    SMIDI_CHECK(wait_for([&]() { return link.synchronizations(0) > 0 && link.synchronizations(1) > 0 && link.synchronizations(2) > 0; }));
+
+    std::unique_ptr<smidi::output_device> output = sessions.initiator->create_output_device("responder");
+    std::unique_ptr<smidi::input_device> input = sessions.responder->create_input_device("initiator");
+
+    const std::vector<uint8_t> note_on = {0x90, 0x3C, 0x64};
+    SMIDI_CHECK(output->try_send(note_on.data(), note_on.size()) == SMIDI_RESULT_OK);
+    SMIDI_CHECK(receive(*input) == note_on);
+
+    // The volume change is lost on the way, the journal of the next packet restores it before the pan change.
+    link.drop_next_packet();
+    const std::vector<uint8_t> volume = {0xB0, 0x07, 0x50};
+    SMIDI_CHECK(output->try_send(volume.data(), volume.size()) == SMIDI_RESULT_OK);
+    SMIDI_CHECK(wait_for([&]() { return link.dropped(); }));
+
+    const std::vector<uint8_t> pan = {0xB0, 0x0A, 0x40};
+    SMIDI_CHECK(output->try_send(pan.data(), pan.size()) == SMIDI_RESULT_OK);
+    SMIDI_CHECK(receive(*input) == volume);
+    SMIDI_CHECK(receive(*input) == pan);
+}
+
+SMIDI_TEST(message_callback_can_send_on_the_receiving_session)
+{
+    connected_sessions sessions(1);
+    SMIDI_CHECK(sessions.connect());
+
+    // The responder echoes everything back from its socket thread, on the session the messages arrived on.
+    std::unique_ptr<smidi::input_device> thru_input = sessions.responder->create_input_device("initiator");
+    std::unique_ptr<smidi::output_device> thru_output = sessions.responder->create_output_device("initiator");
+    std::atomic<unsigned int> echoed{0};
+    thru_input->set_message_callback([&]() {
+        uint8_t message[16];
+        size_t message_size = 0;
+        while (thru_input->try_receive(message, sizeof(message), &message_size, nullptr) == SMIDI_RESULT_OK)
+        {
+            if (thru_output->try_send(message, message_size) == SMIDI_RESULT_OK)
+            {
+                echoed++;
+            }
+        }
+    });
+
+    std::unique_ptr<smidi::output_device> output = sessions.initiator->create_output_device("responder");
+    std::unique_ptr<smidi::input_device> input = sessions.initiator->create_input_device("responder");
+    for (uint8_t note = 0x3C; note < 0x40; note++)
+    {
+        const std::vector<uint8_t> note_on = {0x90, note, 0x64};
+        SMIDI_CHECK(output->try_send(note_on.data(), note_on.size()) == SMIDI_RESULT_OK);
+        SMIDI_CHECK(receive(*input) == note_on);
+    }
+    SMIDI_CHECK(echoed == 4);
+
+    thru_input->set_message_callback(smidi::message_callback());
+}
@@ -0,0 +1,150 @@
+#include "test.h"
+
+#include "smidi_ext/smidi_sequencer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    using clock = smidi::sequencer::clock;
+
+    // Counts how many times every note was started and not yet ended on the output.
+    class note_counting_output_device : public smidi::output_device
+    {
+      public:
+        size_t send(const uint8_t* data, size_t size) override
+        {
+            try_send(data, size);
+            return size;
+        }
+
+        smidi::result try_send(const uint8_t* data, size_t size) noexcept override
+        {
+            if (size == 3 && (data[0] & 0xE0) == 0x80)
+            {
+                const bool note_on = (data[0] & 0xF0) == 0x90 && data[2] != 0;
+                int& count = sounding[{data[0] & 0x0F, data[1]}];
+                count += note_on ? 1 : -1;
+                note_ons += note_on ? 1 : 0;
+            }
+            return SMIDI_RESULT_OK;
+        }
+
+        int count(int channel, int note) const
+        {
+            auto found = sounding.find({channel, note});
+            return found != sounding.end() ? found->second : 0;
+        }
+
+        bool silent() const
+        {
+            for (const auto& note : sounding)
+            {
+                if (note.second != 0)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        std::map<std::pair<int, int>, int> sounding;
+        size_t note_ons = 0;
+    };
+
+    constexpr uint64_t quarter = smidi::sequencer_ticks_per_quarter_note;
+
+    // Two overlapping notes a beat long, on the track's own channel.
+    smidi::pattern make_pattern(uint8_t channel)
+    {
+        smidi::pattern clip(4 * quarter);
+        const uint8_t note_on = static_cast<uint8_t>(0x90 | channel);
+        const uint8_t note_off = static_cast<uint8_t>(0x80 | channel);
+        const uint8_t events[][3] = {{note_on, 60, 100}, {note_on, 64, 100}, {note_off, 60, 0}, {note_on, 64, 0}};
+        const uint64_t ticks[] = {0, quarter / 2, quarter, quarter + quarter / 2};
+        for (size_t event_idx = 0; event_idx < 4; event_idx++)
+        {
+            clip.add(ticks[event_idx], events[event_idx], sizeof(events[event_idx]));
+        }
+        return clip;
+    }
+
+    // Pumps up to time the way a player thread would.
+    void play_until(smidi::sequencer& sequencer, clock::time_point now, clock::time_point end)
+    {
+        while (now < end)
+        {
+            now = std::min(sequencer.pump(now), end);
+        }
+        sequencer.pump(end);
+    }
+} // namespace
+
+SMIDI_TEST(stop_ends_the_notes_that_were_sent)
+{
+    note_counting_output_device output;
+    smidi::sequencer sequencer;
+    sequencer.add_track(output, make_pattern(0));
+    sequencer.add_track(output, make_pattern(9));
+
+    // Both notes of both tracks are on, their note offs are queued or not rendered yet.
+    const clock::time_point start = clock::time_point() + std::chrono::hours(1);
+    sequencer.start(start);
+    play_until(sequencer, start, sequencer.time_at(quarter * 3 / 4));
+    SMIDI_CHECK(output.note_ons == 4);
+    SMIDI_CHECK(!output.silent());
+
+    sequencer.stop();
+    SMIDI_CHECK(!sequencer.playing());
+    SMIDI_CHECK(output.silent());
+    SMIDI_CHECK(sequencer.statistics().failed == 0);
+}
+
+SMIDI_TEST(restart_mid_note_ends_the_notes_first)
+{
+    note_counting_output_device output;
+    smidi::sequencer sequencer;
+    sequencer.add_track(output, make_pattern(0));
+
+    const clock::time_point start = clock::time_point() + std::chrono::hours(1);
+    sequencer.start(start);
+    play_until(sequencer, start, sequencer.time_at(quarter * 3 / 4));
+    SMIDI_CHECK(output.note_ons == 2);
+
+    // Back to the start of the pattern while both notes sound.
+    const clock::time_point restart = sequencer.time_at(quarter);
+    sequencer.start(restart);
+    SMIDI_CHECK(output.silent());
+
+    // The pattern plays again from its first note, and ends it.
+    play_until(sequencer, restart, restart + std::chrono::milliseconds(100));
+    SMIDI_CHECK(output.note_ons == 3);
+    SMIDI_CHECK(!output.silent());
+    sequencer.stop();
+    SMIDI_CHECK(output.silent());
+}
+
+SMIDI_TEST(muting_mid_note_ends_the_track_notes)
+{
+    note_counting_output_device output;
+    smidi::sequencer sequencer;
+    const size_t muted = sequencer.add_track(output, make_pattern(0));
+    sequencer.add_track(output, make_pattern(1));
+
+    const clock::time_point start = clock::time_point() + std::chrono::hours(1);
+    sequencer.start(start);
+    play_until(sequencer, start, sequencer.time_at(quarter * 3 / 4));
+
+    // The note offs go out with the next window, the other track keeps playing.
+    sequencer.set_mute(muted, true);
+    const clock::time_point later = sequencer.time_at(quarter * 7 / 8);
+    play_until(sequencer, sequencer.time_at(quarter * 3 / 4), later);
+    SMIDI_CHECK(output.count(0, 60) == 0 && output.count(0, 64) == 0);
+    SMIDI_CHECK(output.count(1, 60) == 1 && output.count(1, 64) == 1);
+    sequencer.stop();
+    SMIDI_CHECK(output.silent());
+}
@@ -0,0 +1,168 @@
+#include "test.h"
+
+#include "smidi/smidi.h"
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+    // Port names are shared by every process of the user, the pid keeps concurrent test runs apart.
+    std::string port_name(const char* test)
+    {
+        return std::string("smidi_test_") + std::to_string(getpid()) + "_" + test;
+    }
+
+    // Sizes vary so records end anywhere in the ring and some need padding before the wrap. The index is in the first
+    // four bytes.
+    std::vector<uint8_t> make_message(uint32_t index)
+    {
+        std::vector<uint8_t> message(4 + index % 120);
+        for (size_t byte_idx = 0; byte_idx < message.size(); byte_idx++)
+        {
+            message[byte_idx] = byte_idx < 4 ? static_cast<uint8_t>(index >> (8 * byte_idx)) : static_cast<uint8_t>(index + byte_idx);
+        }
+        return message;
+    }
+
+    uint32_t message_index(const std::vector<uint8_t>& message)
+    {
+        uint32_t index = 0;
+        for (size_t byte_idx = 0; byte_idx < 4; byte_idx++)
+        {
+            index |= static_cast<uint32_t>(message[byte_idx]) << (8 * byte_idx);
+        }
+        return index;
+    }
+
+    std::vector<uint8_t> receive(smidi::input_device& input)
+    {
+        std::vector<uint8_t> message(256);
+        message.resize(input.receive(message.data(), message.size(), nullptr));
+        return message;
+    }
+
+    std::unique_ptr<smidi::output_device> create_port(const std::string& name, uint32_t capacity)
+    {
+        smidi::shared_memory_port_options options = smidi::default_shared_memory_port_options;
+        options.capacity = capacity;
+        return smidi::create_shared_memory_port(name, options);
+    }
+} // namespace
+
+SMIDI_TEST(records_wrap_around_the_ring)
+{
+    const std::string name = port_name("wrap");
+    std::unique_ptr<smidi::output_device> output = create_port(name, 1024);
+    std::unique_ptr<smidi::system> system = smidi::create_shared_memory_system();
+    std::unique_ptr<smidi::input_device> input = system->create_input_device(name);
+
+    // Many times around a small ring, one message at a time so the reader is never lapped.
+    for (uint32_t message_idx = 0; message_idx < 2000; message_idx++)
+    {
+        const std::vector<uint8_t> message = make_message(message_idx);
+        SMIDI_CHECK(output->try_send(message.data(), message.size()) == SMIDI_RESULT_OK);
+        SMIDI_CHECK(receive(*input) == message);
+    }
+    SMIDI_CHECK(input->get_queue_statistics().dropped == 0);
+
+    // Records over half the ring are refused.
+    const std::vector<uint8_t> too_large(1024 / 2, 0xF0);
+    SMIDI_CHECK(output->try_send(too_large.data(), too_large.size()) == SMIDI_RESULT_MESSAGE_TOO_LARGE);
+}
+
+SMIDI_TEST(lapped_reader_skips_ahead_and_counts_the_overrun)
+{
+    const std::string name = port_name("overrun");
+    std::unique_ptr<smidi::output_device> output = create_port(name, 1024);
+    std::unique_ptr<smidi::system> system = smidi::create_shared_memory_system();
+
+    // The reader thread waits for room in a one message queue while the producer goes around the ring many times.
+    smidi::device_options options = smidi::default_device_options;
+    options.queue.capacity = 1;
+    options.queue.overflow_policy = SMIDI_OVERFLOW_POLICY_BLOCK;
+    std::unique_ptr<smidi::input_device> input = system->create_input_device(name, options);
+
+    constexpr uint32_t message_count = 1000;
+    for (uint32_t message_idx = 0; message_idx < message_count; message_idx++)
+    {
+        const std::vector<uint8_t> message = make_message(message_idx);
+        SMIDI_CHECK(output->try_send(message.data(), message.size()) == SMIDI_RESULT_OK);
+    }
+
+    // The reader skips to the newest record when it notices, a marker sent after the flood shows it caught up.
+    const std::vector<uint8_t> marker = make_message(message_count);
+    std::vector<uint32_t> received;
+    const auto end = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (std::chrono::steady_clock::now() < end)
+    {
+        std::vector<uint8_t> message(256);
+        size_t message_size = 0;
+        if (input->try_receive(message.data(), message.size(), &message_size, nullptr) != SMIDI_RESULT_OK)
+        {
+            SMIDI_CHECK(output->try_send(marker.data(), marker.size()) == SMIDI_RESULT_OK);
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+
+        message.resize(message_size);
+        const uint32_t index = message_index(message);
+        SMIDI_CHECK(message == make_message(index));
+        if (index == message_count)
+        {
+            break;
+        }
+        received.push_back(index);
+    }
+
+    // Whatever got through is intact and in order, the rest is counted as dropped.
+    SMIDI_CHECK(received.size() < message_count);
+    for (size_t received_idx = 1; received_idx < received.size(); received_idx++)
+    {
+        SMIDI_CHECK(received[received_idx - 1] < received[received_idx]);
+    }
+    SMIDI_CHECK(input->get_queue_statistics().dropped > 0);
+}
+
+SMIDI_TEST(every_reader_receives_every_message)
+{
+    const std::string name = port_name("fan_out");
+    std::unique_ptr<smidi::output_device> output = create_port(name, 65536);
+    std::unique_ptr<smidi::system> system = smidi::create_shared_memory_system();
+    std::vector<std::unique_ptr<smidi::input_device>> inputs;
+    for (size_t input_idx = 0; input_idx < 3; input_idx++)
+    {
+        inputs.push_back(system->create_input_device(name));
+    }
+
+    // Fits in the ring, the readers take it in their own time.
+    constexpr uint32_t message_count = 300;
+    for (uint32_t message_idx = 0; message_idx < message_count; message_idx++)
+    {
+        const std::vector<uint8_t> message = make_message(message_idx);
+        SMIDI_CHECK(output->try_send(message.data(), message.size()) == SMIDI_RESULT_OK);
+    }
+
+    for (const std::unique_ptr<smidi::input_device>& input : inputs)
+    {
+        for (uint32_t message_idx = 0; message_idx < message_count; message_idx++)
+        {
+            SMIDI_CHECK(receive(*input) == make_message(message_idx));
+        }
+        SMIDI_CHECK(input->get_queue_statistics().dropped == 0);
+    }
+
+    // A reader opened now starts at the newest record.
+    std::unique_ptr<smidi::input_device> late_input = system->create_input_device(name);
+    const std::vector<uint8_t> message = make_message(message_count);
+    SMIDI_CHECK(output->try_send(message.data(), message.size()) == SMIDI_RESULT_OK);
+    SMIDI_CHECK(receive(*late_input) == message);
+    for (const std::unique_ptr<smidi::input_device>& input : inputs)
+    {
+        SMIDI_CHECK(receive(*input) == message);
+    }
+}
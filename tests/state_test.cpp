@@ -0,0 +1,110 @@
+#include "test.h"
+
+#include "smidi_ext/smidi_state.h"
+
+#include <vector>
+
+namespace
+{
+    using message = std::vector<uint8_t>;
+
+    // Keeps what is sent to it.
+    class recording_output_device : public smidi::output_device
+    {
+      public:
+        size_t send(const uint8_t* data, size_t size) override
+        {
+            try_send(data, size);
+            return size;
+        }
+
+        smidi::result try_send(const uint8_t* data, size_t size) noexcept override
+        {
+            sent.emplace_back(data, data + size);
+            return SMIDI_RESULT_OK;
+        }
+
+        std::vector<message> sent;
+    };
+
+    void process(smidi::midi_state_tracker& state, const message& data)
+    {
+        state.process(data.data(), data.size());
+    }
+} // namespace
+
+SMIDI_TEST(panic_ends_notes_and_releases_pedals)
+{
+    smidi::midi_state_tracker state;
+    process(state, {0x90, 64, 100});
+    process(state, {0x90, 60, 100});
+    process(state, {0x99, 36, 127});
+
+    // Keys that went up under a held pedal are not active, but still sound until the pedal is released.
+    process(state, {0xB3, 64, 127});
+    process(state, {0x93, 50, 90});
+    process(state, {0x83, 50, 0});
+    process(state, {0xB5, 66, 100});
+    process(state, {0x95, 70, 90});
+    process(state, {0x95, 70, 0});
+    SMIDI_CHECK(state.active_note_count() == 3);
+    SMIDI_CHECK(!state.note_active(3, 50));
+    SMIDI_CHECK(state.controller(3, 64) == 127);
+
+    // A pedal that is up is left alone.
+    process(state, {0xB6, 64, 127});
+    process(state, {0xB6, 64, 0});
+
+    recording_output_device output;
+    SMIDI_CHECK(state.panic(output) == 5);
+    const std::vector<message> expected = {
+        {0x80, 60, 0}, {0x80, 64, 0}, {0x89, 36, 0}, {0xB3, 64, 0}, {0xB5, 66, 0},
+    };
+    SMIDI_CHECK(output.sent == expected);
+    SMIDI_CHECK(state.active_note_count() == 0);
+    SMIDI_CHECK(state.controller(3, 64) == 0);
+
+    // Nothing is left to end.
+    output.sent.clear();
+    SMIDI_CHECK(state.panic(output) == 0);
+    SMIDI_CHECK(output.sent.empty());
+}
+
+SMIDI_TEST(all_notes_off_ends_the_channel_notes)
+{
+    smidi::midi_state_tracker state;
+    process(state, {0x91, 60, 100});
+    process(state, {0x91, 61, 100});
+    process(state, {0x92, 62, 100});
+    process(state, {0x93, 63, 100});
+
+    // All notes off, and all sound off on another channel.
+    process(state, {0xB1, 123, 0});
+    process(state, {0xB2, 120, 0});
+    SMIDI_CHECK(!state.note_active(1, 60) && !state.note_active(1, 61) && !state.note_active(2, 62));
+    SMIDI_CHECK(state.note_active(3, 63));
+    SMIDI_CHECK(state.active_note_count() == 1);
+
+    // Channel mode messages are not controller values.
+    SMIDI_CHECK(state.controller(1, 123) == -1);
+
+    recording_output_device output;
+    SMIDI_CHECK(state.panic(output) == 1);
+    SMIDI_CHECK(output.sent == std::vector<message>({{0x83, 63, 0}}));
+}
+
+SMIDI_TEST(tracking_device_panics_when_destroyed)
+{
+    recording_output_device output;
+    {
+        smidi::state_tracking_output_device tracking(output);
+        const message note_on = {0x90, 60, 100};
+        const message sustain = {0xB0, 64, 127};
+        tracking.send(note_on.data(), note_on.size());
+        SMIDI_CHECK(tracking.try_send(sustain.data(), sustain.size()) == SMIDI_RESULT_OK);
+        SMIDI_CHECK(tracking.state().note_active(0, 60));
+    }
+
+    const std::vector<message> expected = {{0x90, 60, 100}, {0xB0, 64, 127}, {0x80, 60, 0}, {0xB0, 64, 0}};
+    SMIDI_CHECK(output.sent == expected);
+}
@@ -0,0 +1,141 @@
+#include "test.h"
+
+#include "smidi_ext/smidi_sysex_codec.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace
+{
+    constexpr smidi::sysex_7bit_order orders[] = {smidi::sysex_7bit_order::first_in_lsb, smidi::sysex_7bit_order::first_in_msb};
+
+    // Straightforward packing the kernels are checked against, one group of up to 7 bytes at a time.
+    std::vector<uint8_t> reference_pack(const std::vector<uint8_t>& data, smidi::sysex_7bit_order order)
+    {
+        std::vector<uint8_t> packed;
+        for (size_t group = 0; group < data.size(); group += 7)
+        {
+            const size_t count = std::min<size_t>(7, data.size() - group);
+            uint8_t top_bits = 0;
+            for (size_t byte_idx = 0; byte_idx < count; byte_idx++)
+            {
+                const size_t bit = order == smidi::sysex_7bit_order::first_in_lsb ? byte_idx : 6 - byte_idx;
+                top_bits |= static_cast<uint8_t>((data[group + byte_idx] >> 7) << bit);
+            }
+            packed.push_back(top_bits);
+            for (size_t byte_idx = 0; byte_idx < count; byte_idx++)
+            {
+                packed.push_back(data[group + byte_idx] & 0x7F);
+            }
+        }
+        return packed;
+    }
+
+    std::vector<uint8_t> random_bytes(std::mt19937& random, size_t size)
+    {
+        std::vector<uint8_t> data(size);
+        for (uint8_t& byte : data)
+        {
+            byte = static_cast<uint8_t>(random());
+        }
+        return data;
+    }
+} // namespace
+
+SMIDI_TEST(pack_7bit_matches_reference)
+{
+    // Sizes around every vector width, the output buffers are exactly the packed size.
+    std::mt19937 random(1);
+    for (size_t size = 0; size < 300; size++)
+    {
+        const std::vector<uint8_t> data = random_bytes(random, size);
+        for (smidi::sysex_7bit_order order : orders)
+        {
+            const std::vector<uint8_t> expected = reference_pack(data, order);
+            SMIDI_CHECK(smidi::sysex_7bit_packed_size(size) == expected.size());
+            SMIDI_CHECK(smidi::sysex_7bit_unpacked_size(expected.size()) == size);
+
+            std::vector<uint8_t> packed(expected.size());
+            SMIDI_CHECK(smidi::pack_sysex_7bit(data.data(), data.size(), packed.data(), order) == expected.size());
+            SMIDI_CHECK(packed == expected);
+
+            std::vector<uint8_t> unpacked(size);
+            SMIDI_CHECK(smidi::unpack_sysex_7bit(packed.data(), packed.size(), unpacked.data(), order) == size);
+            SMIDI_CHECK(unpacked == data);
+        }
+    }
+}
+
+SMIDI_TEST(pack_7bit_known_values)
+{
+    const uint8_t data[] = {0x80, 0x01, 0xFF, 0x7F, 0x00, 0x81, 0x42, 0xC0};
+    const uint8_t lsb_first[] = {0x25, 0x00, 0x01, 0x7F, 0x7F, 0x00, 0x01, 0x42, 0x01, 0x40};
+    const uint8_t msb_first[] = {0x52, 0x00, 0x01, 0x7F, 0x7F, 0x00, 0x01, 0x42, 0x40, 0x40};
+
+    uint8_t packed[sizeof(lsb_first)];
+    SMIDI_CHECK(smidi::pack_sysex_7bit(data, sizeof(data), packed, smidi::sysex_7bit_order::first_in_lsb) == sizeof(packed));
+    SMIDI_CHECK(std::equal(packed, packed + sizeof(packed), lsb_first));
+    SMIDI_CHECK(smidi::pack_sysex_7bit(data, sizeof(data), packed, smidi::sysex_7bit_order::first_in_msb) == sizeof(packed));
+    SMIDI_CHECK(std::equal(packed, packed + sizeof(packed), msb_first));
+
+    // Top bits of the data bytes are ignored, a top bits byte without data bytes unpacks to nothing.
+    const uint8_t dirty[] = {0x25, 0x80, 0x81, 0xFF, 0x7F, 0x80, 0x81, 0xC2, 0x7F};
+    uint8_t unpacked[7];
+    SMIDI_CHECK(smidi::sysex_7bit_unpacked_size(sizeof(dirty)) == sizeof(unpacked));
+    SMIDI_CHECK(smidi::unpack_sysex_7bit(dirty, sizeof(dirty), unpacked) == sizeof(unpacked));
+    SMIDI_CHECK(std::equal(unpacked, unpacked + sizeof(unpacked), data));
+}
+
+SMIDI_TEST(nibbles_round_trip)
+{
+    const uint8_t data[] = {0x12, 0xAB, 0xF0};
+    const uint8_t low_first[] = {0x02, 0x01, 0x0B, 0x0A, 0x00, 0x0F};
+    const uint8_t high_first[] = {0x01, 0x02, 0x0A, 0x0B, 0x0F, 0x00};
+
+    uint8_t packed[sizeof(low_first)];
+    SMIDI_CHECK(smidi::pack_sysex_nibbles(data, sizeof(data), packed, smidi::sysex_nibble_order::low_first) == sizeof(packed));
+    SMIDI_CHECK(std::equal(packed, packed + sizeof(packed), low_first));
+    SMIDI_CHECK(smidi::pack_sysex_nibbles(data, sizeof(data), packed, smidi::sysex_nibble_order::high_first) == sizeof(packed));
+    SMIDI_CHECK(std::equal(packed, packed + sizeof(packed), high_first));
+
+    std::mt19937 random(2);
+    for (size_t size = 0; size < 100; size++)
+    {
+        const std::vector<uint8_t> bytes = random_bytes(random, size);
+        for (smidi::sysex_nibble_order order : {smidi::sysex_nibble_order::low_first, smidi::sysex_nibble_order::high_first})
+        {
+            // A trailing odd byte is ignored.
+            std::vector<uint8_t> nibbles(size * 2 + 1, 0x0F);
+            SMIDI_CHECK(smidi::pack_sysex_nibbles(bytes.data(), size, nibbles.data(), order) == size * 2);
+
+            std::vector<uint8_t> unpacked(size);
+            SMIDI_CHECK(smidi::unpack_sysex_nibbles(nibbles.data(), nibbles.size(), unpacked.data(), order) == size);
+            SMIDI_CHECK(unpacked == bytes);
+        }
+    }
+}
+
+SMIDI_TEST(checksums)
+{
+    // Roland DT1 F0 41 10 42 12 40 00 7F 00 41 F7, the checksum covers the address and data.
+    const uint8_t roland[] = {0x40, 0x00, 0x7F, 0x00};
+    SMIDI_CHECK(smidi::sysex_sum_checksum(roland, sizeof(roland)) == 0x41);
+    SMIDI_CHECK(smidi::sysex_sum_checksum(nullptr, 0) == 0);
+
+    std::mt19937 random(3);
+    for (size_t size = 0; size < 300; size++)
+    {
+        const std::vector<uint8_t> data = random_bytes(random, size);
+        unsigned int sum = 0;
+        uint8_t xor_sum = 0;
+        for (uint8_t byte : data)
+        {
+            sum += byte;
+            xor_sum ^= byte;
+        }
+        SMIDI_CHECK((sum + smidi::sysex_sum_checksum(data.data(), size)) % 128 == 0);
+        SMIDI_CHECK(smidi::sysex_sum_checksum(data.data(), size) < 0x80);
+        SMIDI_CHECK(smidi::sysex_xor_checksum(data.data(), size) == (xor_sum & 0x7F));
+    }
+}
@@ -0,0 +1,65 @@
+#include "test.h"
+
+#include <algorithm>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+namespace smidi_test
+{
+    namespace
+    {
+        using test_entry = std::pair<std::string, test_function>;
+
+        std::vector<test_entry>& registered_tests()
+        {
+            static std::vector<test_entry> tests;
+            return tests;
+        }
+    } // namespace
+
+    registrar::registrar(const char* name, test_function function)
+    {
+        registered_tests().emplace_back(name, function);
+    }
+
+    failure::failure(const char* file, int line, const std::string& message)
+        : std::runtime_error(std::string(file) + ":" + std::to_string(line) + ": " + message)
+    {
+    }
+} // namespace smidi_test
+
+int main(int argc, char* argv[])
+{
+    // Optional arguments are substrings, only tests whose name contains one of them are run.
+    std::vector<smidi_test::test_entry> tests = smidi_test::registered_tests();
+    std::sort(tests.begin(), tests.end());
+
+    int failed = 0;
+    for (const smidi_test::test_entry& test : tests)
+    {
+        bool selected = (argc <= 1);
+        for (int arg_idx = 1; arg_idx < argc; arg_idx++)
+        {
+            selected = selected || test.first.find(argv[arg_idx]) != std::string::npos;
+        }
+
+        if (!selected)
+        {
+            continue;
+        }
+
+        try
+        {
+            test.second();
+            std::cout << "ok: " << test.first << std::endl;
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "FAILED: " << test.first << ": " << e.what() << std::endl;
+            failed++;
+        }
+    }
+
+    return failed == 0 ? 0 : 1;
+}
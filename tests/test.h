@@ -0,0 +1,56 @@
+#ifndef SMIDI_TEST_H
+#define SMIDI_TEST_H
+
+#include <stdexcept>
+#include <string>
+
+namespace smidi_test
+{
+    using test_function = void (*)();
+
+    struct registrar
+    {
+        registrar(const char* name, test_function function);
+    };
+
+    // Thrown by the checks, the runner reports it and carries on with the next test.
+    class failure : public std::runtime_error
+    {
+      public:
+        failure(const char* file, int line, const std::string& message);
+    };
+} // namespace smidi_test
+
+#define SMIDI_TEST(name)                                                                                                                   \
+    static void name();                                                                                                                    \
+    static smidi_test::registrar name##_registrar(#name, &name);                                                                           \
+    static void name()
+
+#define SMIDI_CHECK(condition)                                                                                                             \
+    do                                                                                                                                     \
+    {                                                                                                                                      \
+        if (!(condition))                                                                                                                  \
+        {                                                                                                                                  \
+            throw smidi_test::failure(__FILE__, __LINE__, #condition);                                                                     \
+        }                                                                                                                                  \
+    } while (false)
+
+#define SMIDI_CHECK_THROWS(statement, exception_type)                                                                                      \
+    do                                                                                                                                     \
+    {                                                                                                                                      \
+        bool smidi_test_thrown = false;                                                                                                    \
+        try                                                                                                                                \
+        {                                                                                                                                  \
+            statement;                                                                                                                     \
+        }                                                                                                                                  \
+        catch (const exception_type&)                                                                                                      \
+        {                                                                                                                                  \
+            smidi_test_thrown = true;                                                                                                      \
+        }                                                                                                                                  \
+        if (!smidi_test_thrown)                                                                                                            \
+        {                                                                                                                                  \
+            throw smidi_test::failure(__FILE__, __LINE__, #statement " did not throw " #exception_type);                                   \
+        }                                                                                                                                  \
+    } while (false)
+
+#endif // SMIDI_TEST_H
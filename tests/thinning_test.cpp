@@ -0,0 +1,139 @@
+#include "test.h"
+
+#include "smidi_ext/smidi_thinning.h"
+
+#include <chrono>
+#include <vector>
+
+namespace
+{
+    using message = std::vector<uint8_t>;
+    using clock = smidi::thinning_output_device::clock;
+
+    // Keeps what is sent to it.
+    class recording_output_device : public smidi::output_device
+    {
+      public:
+        size_t send(const uint8_t* data, size_t size) override
+        {
+            sent.emplace_back(data, data + size);
+            return size;
+        }
+
+        smidi::result try_send(const uint8_t* data, size_t size) noexcept override
+        {
+            sent.emplace_back(data, data + size);
+            return SMIDI_RESULT_OK;
+        }
+
+        std::vector<message> sent;
+    };
+
+    void send(smidi::thinning_output_device& thinning, const message& data)
+    {
+        thinning.send(data.data(), data.size());
+    }
+
+    // Pumps at every time the device asks for until the queue is empty, returns the time it was.
+    clock::time_point drain(smidi::thinning_output_device& thinning)
+    {
+        clock::time_point now = clock::now();
+        while (thinning.statistics().pending > 0)
+        {
+            now = std::max(now, thinning.next_send_time());
+            thinning.pump(now);
+        }
+        return now;
+    }
+
+    // A byte a second and no burst: the first message goes out, everything after it waits long enough to be merged.
+    smidi::thinning_options slow_link()
+    {
+        smidi::thinning_options options;
+        options.bytes_per_second = 1;
+        options.burst_bytes = 0;
+        return options;
+    }
+} // namespace
+
+SMIDI_TEST(waiting_updates_merge_up_to_the_last_order_sensitive_message)
+{
+    recording_output_device output;
+    smidi::thinning_output_device thinning(output, slow_link());
+    send(thinning, {0xB0, 7, 1});
+    send(thinning, {0xB0, 7, 2});
+    send(thinning, {0xB0, 10, 5});
+    send(thinning, {0xB0, 7, 3});
+    send(thinning, {0xE0, 0, 0x40});
+    send(thinning, {0xE0, 0, 0x50});
+    // Another channel is another key.
+    send(thinning, {0xB1, 7, 9});
+
+    // A note is a barrier, the update after it does not merge into the one before.
+    send(thinning, {0x90, 60, 100});
+    send(thinning, {0xB0, 7, 4});
+    send(thinning, {0xB0, 7, 5});
+
+    // Real time messages skip the queue.
+    send(thinning, {0xF8});
+    SMIDI_CHECK(output.sent == std::vector<message>({{0xB0, 7, 1}, {0xF8}}));
+
+    drain(thinning);
+    const std::vector<message> expected = {
+        {0xB0, 7, 1}, {0xF8}, {0xB0, 7, 3}, {0xB0, 10, 5}, {0xE0, 0, 0x50}, {0xB1, 7, 9}, {0x90, 60, 100}, {0xB0, 7, 5},
+    };
+    SMIDI_CHECK(output.sent == expected);
+
+    const smidi::thinning_statistics statistics = thinning.statistics();
+    SMIDI_CHECK(statistics.merged == 3);
+    SMIDI_CHECK(statistics.sent_messages == expected.size());
+    SMIDI_CHECK(statistics.pending == 0);
+}
+
+SMIDI_TEST(order_sensitive_and_incomplete_messages_are_kept)
+{
+    recording_output_device output;
+    smidi::thinning_output_device thinning(output, slow_link());
+    send(thinning, {0xF8});
+
+    // An RPN selection and its data entry, all notes off, and a control change cut short.
+    const std::vector<message> sent = {
+        {0xB0, 101, 0}, {0xB0, 100, 0}, {0xB0, 6, 2}, {0xB0, 6, 12}, {0xB0, 123, 0}, {0xB0, 123, 0}, {0xB0, 7}, {0xB0, 7},
+    };
+    for (const message& data : sent)
+    {
+        send(thinning, data);
+    }
+    drain(thinning);
+
+    std::vector<message> expected = {{0xF8}};
+    expected.insert(expected.end(), sent.begin(), sent.end());
+    SMIDI_CHECK(output.sent == expected);
+    SMIDI_CHECK(thinning.statistics().merged == 0);
+}
+
+SMIDI_TEST(messages_are_paced_to_the_wire_rate)
+{
+    recording_output_device output;
+    smidi::thinning_output_device thinning(output);
+    const clock::time_point start = clock::now();
+    for (uint8_t key = 0; key < 100; key++)
+    {
+        send(thinning, {0x90, key, 100});
+    }
+
+    // The burst goes out right away, about a dozen three byte notes.
+    SMIDI_CHECK(output.sent.size() >= 10 && output.sent.size() < 20);
+    SMIDI_CHECK(thinning.next_send_time() > start);
+
+    // The rest takes the time the wire needs for its bytes, in order.
+    const clock::time_point end = drain(thinning);
+    SMIDI_CHECK(output.sent.size() == 100);
+    for (uint8_t key = 0; key < 100; key++)
+    {
+        SMIDI_CHECK(output.sent[key] == message({0x90, key, 100}));
+    }
+    const size_t waited_bytes = 300 - smidi::thinning_options().burst_bytes - 3;
+    SMIDI_CHECK(end - start >= std::chrono::microseconds(waited_bytes * 1000000 / smidi::din_bytes_per_second));
+    SMIDI_CHECK(thinning.statistics().sent_bytes == 300);
+}
@@ -0,0 +1,134 @@
+#include "test.h"
+
+#include "smidi_ext/smidi_ump.h"
+
+#include <vector>
+
+namespace
+{
+    std::vector<uint32_t> to_ump(const std::vector<uint8_t>& bytes, smidi::ump_protocol protocol)
+    {
+        smidi::midi1_to_ump_translator translator(3, protocol);
+        std::vector<uint32_t> words;
+        translator.translate(bytes.data(), bytes.size(), words);
+        return words;
+    }
+
+    std::vector<uint8_t> to_midi1(const std::vector<uint32_t>& words)
+    {
+        smidi::ump_to_midi1_translator translator;
+        std::vector<uint8_t> bytes;
+        translator.translate(words.data(), words.size(), bytes);
+        return bytes;
+    }
+} // namespace
+
+SMIDI_TEST(midi1_protocol_round_trip)
+{
+    // Running status and a clock in the middle of a message come back as complete messages in arrival order.
+    const std::vector<uint8_t> stream = {0x90, 0x3C, 0x64, 0x3E, 0xF8, 0x50, 0xB1, 0x07, 0x7F, 0xE2, 0x00, 0x40, 0xC3, 0x05, 0xD4, 0x22, 0xFA};
+    const std::vector<uint8_t> expected = {0x90, 0x3C, 0x64, 0xF8, 0x90, 0x3E, 0x50, 0xB1, 0x07, 0x7F,
+                                           0xE2, 0x00, 0x40, 0xC3, 0x05, 0xD4, 0x22, 0xFA};
+
+    std::vector<uint32_t> words = to_ump(stream, smidi::ump_protocol::midi1);
+    SMIDI_CHECK(words.size() == 8);
+    for (uint32_t word : words)
+    {
+        SMIDI_CHECK(smidi::ump_group(word) == 3);
+    }
+    SMIDI_CHECK(smidi::ump_type(words[0]) == smidi::ump_message_type::midi1_channel_voice);
+    SMIDI_CHECK(smidi::ump_type(words[1]) == smidi::ump_message_type::system);
+    SMIDI_CHECK(to_midi1(words) == expected);
+}
+
+SMIDI_TEST(midi2_protocol_round_trip)
+{
+    // 7 and 14-bit values survive the upscaling to MIDI 2.0 and the downscaling back.
+    std::vector<uint8_t> stream;
+    for (uint8_t value = 1; value < 128; value++)
+    {
+        const uint8_t channel = value & 0xF;
+        stream.insert(stream.end(), {static_cast<uint8_t>(0x90 | channel), value, value});
+        stream.insert(stream.end(), {static_cast<uint8_t>(0x80 | channel), value, static_cast<uint8_t>(127 - value)});
+        stream.insert(stream.end(), {static_cast<uint8_t>(0xA0 | channel), value, static_cast<uint8_t>(value / 2)});
+        stream.insert(stream.end(), {static_cast<uint8_t>(0xB0 | channel), 0x07, value});
+        stream.insert(stream.end(), {static_cast<uint8_t>(0xD0 | channel), value});
+        stream.insert(stream.end(), {static_cast<uint8_t>(0xE0 | channel), static_cast<uint8_t>(127 - value), value});
+    }
+
+    std::vector<uint32_t> words = to_ump(stream, smidi::ump_protocol::midi2);
+    SMIDI_CHECK(words.size() == 127 * 6 * 2);
+    SMIDI_CHECK(smidi::ump_type(words[0]) == smidi::ump_message_type::midi2_channel_voice);
+    SMIDI_CHECK(to_midi1(words) == stream);
+}
+
+SMIDI_TEST(system_exclusive_split_across_calls)
+{
+    std::vector<uint8_t> message = {0xF0};
+    for (uint8_t byte = 0; byte < 20; byte++)
+    {
+        message.push_back(byte);
+    }
+    message.push_back(0xF7);
+
+    // One byte at a time, so every packet boundary falls between calls.
+    smidi::midi1_to_ump_translator translator;
+    std::vector<uint32_t> words;
+    for (uint8_t byte : message)
+    {
+        translator.translate(&byte, 1, words);
+    }
+
+    // 20 data bytes are four SysEx7 packets of two words: start, two continues and the end.
+    SMIDI_CHECK(words.size() == 8);
+    SMIDI_CHECK(smidi::ump_type(words[0]) == smidi::ump_message_type::data64);
+    SMIDI_CHECK(to_midi1(words) == message);
+}
+
+SMIDI_TEST(stream_parser_reassembles_packets)
+{
+    const smidi::ump_packet clock = smidi::make_ump_system_message(1, 0xF8, 0, 0);
+    const smidi::ump_packet note = smidi::make_ump_midi2_channel_voice_message(2, 0x93, 60, 0, 0xFFFF0000);
+
+    std::vector<uint32_t> words(note.data(), note.data() + note.size());
+    words.insert(words.end(), clock.data(), clock.data() + clock.size());
+
+    smidi::ump_stream_parser parser;
+    std::vector<smidi::ump_packet> packets;
+    for (uint32_t word : words)
+    {
+        parser.parse(&word, 1, [&](const smidi::ump_packet& packet) { packets.push_back(packet); });
+    }
+
+    SMIDI_CHECK(packets.size() == 2);
+    SMIDI_CHECK(packets[0].size() == 2 && packets[0].type() == smidi::ump_message_type::midi2_channel_voice);
+    SMIDI_CHECK(packets[0].group() == 2 && packets[0].status() == 0x9 && packets[0].channel() == 3);
+    SMIDI_CHECK(packets[0].data()[1] == 0xFFFF0000);
+    SMIDI_CHECK(packets[1].size() == 1 && packets[1].status() == 0xF8 && packets[1].group() == 1);
+}
+
+SMIDI_TEST(min_center_max_scaling)
+{
+    SMIDI_CHECK(smidi::scale_up(0, 7, 32) == 0);
+    SMIDI_CHECK(smidi::scale_up(64, 7, 32) == 0x80000000);
+    SMIDI_CHECK(smidi::scale_up(127, 7, 32) == 0xFFFFFFFF);
+    SMIDI_CHECK(smidi::scale_up(0x2000, 14, 32) == 0x80000000);
+
+    std::vector<uint8_t> values7(128);
+    for (size_t value = 0; value < values7.size(); value++)
+    {
+        values7[value] = static_cast<uint8_t>(value);
+        SMIDI_CHECK(smidi::scale_down(smidi::scale_up(static_cast<uint32_t>(value), 7, 16), 16, 7) == value);
+    }
+
+    // The batch versions match the scalar ones.
+    std::vector<uint32_t> values32(values7.size());
+    std::vector<uint8_t> back7(values7.size());
+    smidi::scale_7_to_32(values7.data(), values32.data(), values7.size());
+    smidi::scale_32_to_7(values32.data(), back7.data(), values32.size());
+    for (size_t value = 0; value < values7.size(); value++)
+    {
+        SMIDI_CHECK(values32[value] == smidi::scale_up(static_cast<uint32_t>(value), 7, 32));
+    }
+    SMIDI_CHECK(back7 == values7);
+}